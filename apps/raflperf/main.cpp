@@ -93,6 +93,7 @@ int main(int argc, char *argv[])
       .add_param("seenExamplesThreshold", list_of<size_t>(50))
       .add_param("splittabilityThreshold", list_of<float>(0.8f))
       .add_param("usePMFReweighting", list_of<bool>(false)(true))
+      .add_param("parallelTraining", list_of<bool>(false)(true))
       .generate_param_sets();
 
     outputResultPath = "UnitCircleExampleGenerator-Results.txt";
@@ -126,6 +127,7 @@ int main(int argc, char *argv[])
       .add_param("seenExamplesThreshold", list_of<size_t>(512))
       .add_param("splittabilityThreshold", list_of<float>(0.8f))
       .add_param("usePMFReweighting", list_of<bool>(false)(true))
+      .add_param("parallelTraining", list_of<bool>(false)(true))
       .generate_param_sets();
   }
 
@@ -150,9 +152,15 @@ int main(int argc, char *argv[])
   boost::shared_ptr<RandomForestEvaluator<Label> > evaluator;
   for(size_t n = 0, size = params.size(); n < size; ++n)
   {
+    // Time the evaluation for each parameter set separately, so that the scaling of parallel training can be seen.
+    Timer<boost::chrono::milliseconds> paramSetTimer("ParamSetEvaluation");
+
     evaluator.reset(new RandomForestEvaluator<Label>(splitGenerator, params[n]));
     PerformanceResult result = evaluator->evaluate(examples);
     results.record_performance(params[n], result);
+
+    paramSetTimer.stop();
+    std::cout << ParamSetUtil::param_set_to_string(params[n]) << ": " << paramSetTimer.duration() << '\n';
   }
 
   timer.stop();
@@ -10,10 +10,25 @@
 
 #include <DatasetRGBDInfiniTAM.hpp>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/random.hpp>
 
 using namespace grove;
 
+/**
+ * \brief Saves a forest to disk, either as a packed (binary) file or as a text file, depending on the extension of the output filename.
+ *
+ * \param forest      The forest to save.
+ * \param outputFile  The name of the file to which to save the forest (packed files should have the extension .pkd).
+ */
+template <typename Forest_Ptr>
+void save_forest(const Forest_Ptr& forest, const std::string& outputFile)
+{
+  std::cout << "Saving forest in: " << outputFile << std::endl;
+  if(boost::algorithm::ends_with(outputFile, ".pkd")) forest->save_structure_to_packed_file(outputFile);
+  else forest->save_structure_to_file(outputFile);
+}
+
 int main(int argc, char *argv[])
 {
   static const int nbTrees = 5;
@@ -24,10 +39,24 @@ int main(int argc, char *argv[])
   const bool loadFeatures = false;
   const int randomSeed = 42;
 
+  // If requested, convert an existing forest (e.g. a text forest) into a packed forest (or vice versa).
+  if (argc == 4 && std::string(argv[1]) == "--convert")
+  {
+    const std::string inputFile = argv[2];
+    const std::string outputFile = argv[3];
+
+    std::cout << "Loading forest from: " << inputFile << std::endl;
+    auto scoreForest = DecisionForestFactory<RGBDPatchDescriptor, nbTrees>::make_forest(inputFile, ORUtils::DeviceType::DEVICE_CPU);
+    save_forest(scoreForest, outputFile);
+    return 0;
+  }
+
   if (argc < 4)
   {
     std::cerr << "Usage: " << argv[0]
-        << " \"scoreforest config file\" \"7scenes base path\" \"output forest filename\""
+        << " \"scoreforest config file\" \"7scenes base path\" \"output forest filename\"\n"
+        << "       " << argv[0] << " --convert \"input forest filename\" \"output forest filename\"\n"
+        << "(output forests whose filenames end in .pkd are saved as packed binary files)"
         << std::endl;
     return 1;
   }
@@ -44,8 +73,7 @@ int main(int argc, char *argv[])
 
   auto scoreForest = DecisionForestFactory<RGBDPatchDescriptor, nbTrees>::make_forest(*m_dataset->GetForest(), ORUtils::DeviceType::DEVICE_CPU);
 
-  std::cout << "Saving forest in: " << outputFile << std::endl;
-  scoreForest->save_structure_to_file(outputFile);
+  save_forest(scoreForest, outputFile);
 
 #if 0
   // Randomly select one prediction per tree
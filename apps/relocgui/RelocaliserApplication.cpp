@@ -18,6 +18,7 @@
 #include <ITMLib/Objects/Camera/ITMCalibIO.h>
 
 #include <itmx/persistence/PosePersister.h>
+#include <itmx/persistence/SequenceFileReader.h>
 
 #include <orx/base/MemoryBlockFactory.h>
 
@@ -41,6 +42,23 @@ namespace relocgui {
 
 namespace {
 
+/**
+ * \brief Determines whether or not two camera calibrations would be used in the same way by the application,
+ *        i.e. whether they have the same image sizes, depth intrinsics and disparity calibration.
+ *
+ * \param calib1 The first calibration.
+ * \param calib2 The second calibration.
+ * \return       true, if the calibrations are interchangeable as far as the application is concerned, or false otherwise.
+ */
+bool calibrations_match(const ITMRGBDCalib &calib1, const ITMRGBDCalib &calib2)
+{
+  return calib1.intrinsics_rgb.imgSize == calib2.intrinsics_rgb.imgSize &&
+         calib1.intrinsics_d.imgSize == calib2.intrinsics_d.imgSize &&
+         calib1.intrinsics_d.projectionParamsSimple.all == calib2.intrinsics_d.projectionParamsSimple.all &&
+         calib1.disparityCalib.GetType() == calib2.disparityCalib.GetType() &&
+         calib1.disparityCalib.GetParams() == calib2.disparityCalib.GetParams();
+}
+
 /**
  * \brief Computes the angular separation between two rotation matrices.
  *
@@ -125,23 +143,48 @@ RelocaliserApplication::RelocaliserApplication(const std::string &calibrationPat
   , m_testSequencePath(testingPath)
   , m_trainSequencePath(trainingPath)
 {
-  // Read camera calibration parameters.
-  if(!ITMLib::readRGBDCalib(m_calibrationFilePath.string().c_str(), m_cameraCalibration))
+  // Check that training and testing folders (or sequence files) exist.
+  if(SequenceFileReader::is_sequence_file(m_trainSequencePath.string()))
   {
-    throw std::invalid_argument("Couldn't read calibration parameters.");
+    m_trainingSequenceEngine.reset(new SequenceFileImageSourceEngine(m_trainSequencePath.string()));
   }
-
-  // Check that training and testing folders exist.
-  if(!bf::is_directory(m_trainSequencePath))
+  else if(!bf::is_directory(m_trainSequencePath))
   {
     throw std::invalid_argument("The specified training path does not exist.");
   }
 
-  if(!bf::is_directory(m_testSequencePath))
+  if(SequenceFileReader::is_sequence_file(m_testSequencePath.string()))
+  {
+    m_testingSequenceEngine.reset(new SequenceFileImageSourceEngine(m_testSequencePath.string()));
+  }
+  else if(!bf::is_directory(m_testSequencePath))
   {
     throw std::invalid_argument("The specified testing path does not exist.");
   }
 
+  // Determine the camera calibration to use. Sequence files store the calibration of the camera that captured them,
+  // so we use that for any split that is a sequence file, and the specified calibration file for any split that is
+  // a folder. Since both splits share the same view builder and intrinsics, their calibrations must then agree.
+  if(!m_trainingSequenceEngine || !m_testingSequenceEngine)
+  {
+    if(!ITMLib::readRGBDCalib(m_calibrationFilePath.string().c_str(), m_cameraCalibration))
+    {
+      throw std::invalid_argument("Couldn't read calibration parameters.");
+    }
+  }
+
+  if(m_trainingSequenceEngine)
+  {
+    const ITMRGBDCalib trainingCalibration = m_trainingSequenceEngine->getCalib();
+    if(m_testingSequenceEngine || calibrations_match(trainingCalibration, m_cameraCalibration)) m_cameraCalibration = trainingCalibration;
+    else throw std::invalid_argument("The calibration stored in the training sequence file does not match the specified calibration file.");
+  }
+
+  if(m_testingSequenceEngine && !calibrations_match(m_testingSequenceEngine->getCalib(), m_cameraCalibration))
+  {
+    throw std::invalid_argument("The calibration stored in the testing sequence file does not match the one used for the training split.");
+  }
+
   // Setup the image masks.
   m_depthImageMask = m_settingsContainer->get_first_value<std::string>("depthImageMask", "frame-%06d.depth.png");
   m_poseFileMask = m_settingsContainer->get_first_value<std::string>("poseFileMask", "frame-%06d.pose.txt");
@@ -184,6 +227,8 @@ RelocaliserApplication::RelocaliserApplication(const std::string &calibrationPat
   m_currentDepthImage = mbf.make_image<float>();
   m_currentRawDepthImage = mbf.make_image<short>();
   m_currentRgbImage = mbf.make_image<Vector4u>();
+  m_sequenceRawDepthImage.reset(new ORShortImage(m_cameraCalibration.intrinsics_d.imgSize, true, false));
+  m_sequenceRgbImage.reset(new ORUChar4Image(m_cameraCalibration.intrinsics_rgb.imgSize, true, false));
 }
 
 void RelocaliserApplication::run()
@@ -194,7 +239,7 @@ void RelocaliserApplication::run()
 
   // First of all, train the relocaliser processing each image from the training folder.
   AverageTimer<boost::chrono::milliseconds> trainingTimer("Training Timer");
-  while((currentExample = read_example(m_trainingSequencePathGenerator)))
+  while((currentExample = read_example(m_trainingSequencePathGenerator, m_trainingSequenceEngine)))
   {
     trainingTimer.start_sync();
 
@@ -221,7 +266,7 @@ void RelocaliserApplication::run()
   // Now test the relocaliser accumulating the number of successful relocalisations.
   uint32_t successfulExamples = 0;
   AverageTimer<boost::chrono::milliseconds> testingTimer("Testing Timer");
-  while((currentExample = read_example(m_testingSequencePathGenerator)))
+  while((currentExample = read_example(m_testingSequencePathGenerator, m_testingSequenceEngine)))
   {
     testingTimer.start_sync();
     prepare_example_images(*currentExample);
@@ -283,8 +328,29 @@ void RelocaliserApplication::run()
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 boost::optional<RelocaliserApplication::RelocalisationExample>
-    RelocaliserApplication::read_example(const RelocaliserApplication::SequentialPathGenerator_Ptr &pathGenerator) const
+    RelocaliserApplication::read_example(const RelocaliserApplication::SequentialPathGenerator_Ptr &pathGenerator,
+                                         const SequenceFileImageSourceEngine_Ptr &sequenceEngine)
 {
+  // If the sequence is stored in a sequence file, get the next (already uncompressed) frame from the engine.
+  if(sequenceEngine)
+  {
+    if(!sequenceEngine->hasMoreImages()) return boost::none;
+
+    sequenceEngine->getImages(m_sequenceRgbImage.get(), m_sequenceRawDepthImage.get());
+
+    // Copy the images into Mats (the engine provides the colour image in RGBA format already).
+    RelocalisationExample example;
+    const Vector2i depthImageDims = m_sequenceRawDepthImage->noDims;
+    const Vector2i rgbImageDims = m_sequenceRgbImage->noDims;
+    example.depthImage = cv::Mat(depthImageDims.y, depthImageDims.x, CV_16UC1, m_sequenceRawDepthImage->GetData(MEMORYDEVICE_CPU)).clone();
+    example.rgbImage = cv::Mat(rgbImageDims.y, rgbImageDims.x, CV_8UC4, m_sequenceRgbImage->GetData(MEMORYDEVICE_CPU)).clone();
+
+    // Sequence files store the world-to-camera pose directly.
+    example.cameraPose = sequenceEngine->get_last_pose();
+
+    return example;
+  }
+
   bf::path currentDepthPath = pathGenerator->make_path(m_depthImageMask);
   bf::path currentRgbPath = pathGenerator->make_path(m_rgbImageMask);
   bf::path currentPosePath = pathGenerator->make_path(m_poseFileMask);
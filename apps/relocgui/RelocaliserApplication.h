@@ -19,6 +19,7 @@
 #include <ORUtils/SE3Pose.h>
 
 #include <itmx/base/ITMObjectPtrTypes.h>
+#include <itmx/imagesources/SequenceFileImageSourceEngine.h>
 
 #include <orx/base/ORImagePtrTypes.h>
 #include <orx/relocalisation/Relocaliser.h>
@@ -44,6 +45,9 @@ namespace relocgui {
  * .
  * frame-NNNNNN.pose.txt  // ...
  *
+ * Alternatively, either split can be provided as a sequence file (e.g. as recorded by spaintgui), in which case its
+ * frames are uncompressed in parallel and prefetched ahead of the frame currently being processed.
+ *
  * By default the application computes the percentage of testing frames relocalised correctly against the ground truth
  * pose (according to Shotton et al's 5cm/5deg metric). The application also saves the relocalised pose for each frame
  * of the testing sequence in the reloc_poses/experimentTag subfolder of the current executable using the following
@@ -75,12 +79,13 @@ public:
   /**
    * \brief Constructs an instance of the RelocaliserApplication.
    *
-   * \param calibrationPath Path to a camera calibration file in the InfiniTAM format.
-   * \param trainingPath    Path to a training split of a 7-scenes-like sequence.
-   * \param testingPath     Path to a testing split of a 7-scenes-like sequence.
+   * \param calibrationPath Path to a camera calibration file in the InfiniTAM format (used for any split that is a folder;
+   *                        splits that are sequence files use the calibration stored in the file).
+   * \param trainingPath    Path to a training split of a 7-scenes-like sequence (either a folder or a sequence file).
+   * \param testingPath     Path to a testing split of a 7-scenes-like sequence (either a folder or a sequence file).
    * \param settings        A container of settings for the relocaliser.
    *
-   * \throws std::invalid_argument if the paths are incorrect.
+   * \throws std::invalid_argument if the paths are incorrect, or if the calibrations used for the two splits differ.
    */
   RelocaliserApplication(const std::string &calibrationPath,
                          const std::string &trainingPath,
@@ -99,14 +104,16 @@ public:
 private:
   /**
    * \brief Tries to read a RGB-D example from the 7-scenes-like sequence contained in the folder specified by the
-   * pathGenerator.
+   * pathGenerator (or from the specified sequence file engine, if any).
    *
-   * \param pathGenerator The path generator used to obtain the current file names for RGB, depth and pose files.
+   * \param pathGenerator  The path generator used to obtain the current file names for RGB, depth and pose files.
+   * \param sequenceEngine The engine used to read the sequence from a sequence file (NULL if the sequence is in a folder).
    *
    * \return An example if found, boost::none if the index contained in the pathGenerator is greater than the number of
-   * examples in the folder.
+   * examples in the folder (or if the sequence file has no more frames).
    */
-  boost::optional<RelocalisationExample> read_example(const SequentialPathGenerator_Ptr &pathGenerator) const;
+  boost::optional<RelocalisationExample> read_example(const SequentialPathGenerator_Ptr &pathGenerator,
+                                                      const itmx::SequenceFileImageSourceEngine_Ptr &sequenceEngine);
 
   /**
    * \brief Convert the images contained in the example to ORUtil's image format and copy them on the GPU.
@@ -128,7 +135,7 @@ private:
   /** The path to a camera calibration file. */
   boost::filesystem::path m_calibrationFilePath;
 
-  /** The camera calibration informations. */
+  /** The camera calibration informations (shared by the training and testing splits). */
   ITMLib::ITMRGBDCalib m_cameraCalibration;
 
   /** The (printf-like) mask used to generate the depth image filenames. */
@@ -155,12 +162,18 @@ private:
   /** The container storing the relocaliser's settings (and miscellaneous data such as the experimentTag). */
   tvgutil::SettingsContainer_CPtr m_settingsContainer;
 
+  /** The engine used to read the testing split if it is stored in a sequence file (NULL otherwise). */
+  itmx::SequenceFileImageSourceEngine_Ptr m_testingSequenceEngine;
+
   /** A path generator used to generate testing example filenames. */
   SequentialPathGenerator_Ptr m_testingSequencePathGenerator;
 
   /** The path to a testing split of a 7-scenes-like sequence. */
   boost::filesystem::path m_testSequencePath;
 
+  /** The engine used to read the training split if it is stored in a sequence file (NULL otherwise). */
+  itmx::SequenceFileImageSourceEngine_Ptr m_trainingSequenceEngine;
+
   /** A path generator used to generate training example filenames. */
   SequentialPathGenerator_Ptr m_trainingSequencePathGenerator;
 
@@ -184,6 +197,12 @@ private:
 
   /** The current colour image. */
   ORUChar4Image_Ptr m_currentRgbImage;
+
+  /** The depth image most recently read from a sequence file (CPU only). */
+  ORShortImage_Ptr m_sequenceRawDepthImage;
+
+  /** The colour image most recently read from a sequence file (CPU only). */
+  ORUChar4Image_Ptr m_sequenceRgbImage;
 };
 
 }
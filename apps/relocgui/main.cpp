@@ -70,9 +70,9 @@ bool parse_command_line(int argc, char *argv[], CommandLineArguments &args, cons
 
   po::options_description diskSequenceOptions("Disk sequence options");
   diskSequenceOptions.add_options()
-      ("calib,c", po::value<std::string>(&args.calibrationFilename)->required(), "calibration filename")
-      ("test", po::value<std::string>(&args.testFolder)->required(), "path to the folder containing the training sequence")
-      ("train", po::value<std::string>(&args.trainFolder)->required(), "path to the folder containing the training sequence")
+      ("calib,c", po::value<std::string>(&args.calibrationFilename)->default_value(""), "calibration filename (not needed if both sequences are sequence files, which store their own calibrations)")
+      ("test", po::value<std::string>(&args.testFolder)->required(), "path to the folder (or sequence file) containing the testing sequence")
+      ("train", po::value<std::string>(&args.trainFolder)->required(), "path to the folder (or sequence file) containing the training sequence")
       ;
 
   po::options_description options;
@@ -8,10 +8,17 @@
 #include <limits>
 #include <stdexcept>
 
+#ifndef _MSC_VER
+#include <sys/wait.h>
+#endif
+
 #include <boost/assign/list_of.hpp>
+#include <boost/atomic.hpp>
 #include <boost/bind.hpp>
 #include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
+#include <boost/thread.hpp>
 #include <boost/timer/timer.hpp>
 using boost::assign::list_of;
 
@@ -37,14 +44,18 @@ namespace po = boost::program_options;
 
 struct Arguments
 {
+  bf::path cachePath;
+  std::string cacheSpecifier;
   std::string datasetDir;
   bf::path dir;
   std::string iniSpecifier;
+  size_t jobCount;
   bf::path logPath;
   std::string logSpecifier;
   std::string outputSpecifier;
   bf::path scriptPath;
   std::string scriptSpecifier;
+  int timeLimit;
 
   Arguments()
   : dir(find_subdir_from_executable("resources")),
@@ -57,8 +68,12 @@ struct Arguments
 
 float grove_cost_fn(const Arguments& args, const ParamSet& params)
 {
+  // Since several evaluations may be running in parallel, give the files used by this one unique names.
+  static boost::atomic<int> evaluationCount(0);
+  const std::string evaluationSuffix = "-" + boost::lexical_cast<std::string>(evaluationCount++);
+
   // Write the parameters to the specified .ini file.
-  const bf::path iniPath = args.dir / (args.iniSpecifier + ".ini");
+  const bf::path iniPath = args.dir / (args.iniSpecifier + evaluationSuffix + ".ini");
 
   {
     std::ofstream fs(iniPath.string().c_str());
@@ -68,9 +83,12 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
     }
   }
 
-  // Run the specified script.
-  const bf::path outputPath = args.dir / (args.outputSpecifier + ".txt");
-  const std::string command = "\"" + args.scriptPath.string() + "\" \"" + iniPath.string() + "\" \"" + outputPath.string() + "\" \"" + bf::path(args.datasetDir).string() + "\"";
+  // Run the specified script. If a time limit has been specified (and is supported on this platform), the script will be terminated if it exceeds it.
+  const bf::path outputPath = args.dir / (args.outputSpecifier + evaluationSuffix + ".txt");
+  std::string command = "\"" + args.scriptPath.string() + "\" \"" + iniPath.string() + "\" \"" + outputPath.string() + "\" \"" + bf::path(args.datasetDir).string() + "\"";
+#ifndef _MSC_VER
+  if(args.timeLimit > 0) command = "timeout -k 10 " + boost::lexical_cast<std::string>(args.timeLimit) + " " + command;
+#endif
 
   // Wrap the system call with a timer.
   bt::cpu_timer timer;
@@ -79,15 +97,23 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
 
   float elapsedSeconds = static_cast<float>(bc::duration_cast<bc::seconds>(bc::nanoseconds(timer.elapsed().system + timer.elapsed().user)).count());
 
-  if(exitCode)
+  // Determine whether or not the script was terminated for exceeding the time limit (the timeout command exits with status 124 in that case).
+  bool timedOut = false;
+#ifndef _MSC_VER
+  timedOut = args.timeLimit > 0 && WIFEXITED(exitCode) && WEXITSTATUS(exitCode) == 124;
+#endif
+
+  if(exitCode && !timedOut)
   {
     throw std::runtime_error("System call failed. Terminating evaluation.");
   }
 
-  // Read the results back in from the output file.
+  // Read the results back in from the output file (unless the script timed out, in which case the parameters get the maximum possible cost).
   float cost = std::numeric_limits<float>::max();
-  float relocLoss, icpLoss, trainingMicroseconds, updateMicroseconds, initialRelocalisationMicroseconds, icpRefinementMicroseconds, totalRelocalisationMicroseconds;
+  float relocLoss = -1.0f, icpLoss = -1.0f, trainingMicroseconds = -1.0f, updateMicroseconds = -1.0f;
+  float initialRelocalisationMicroseconds = -1.0f, icpRefinementMicroseconds = -1.0f, totalRelocalisationMicroseconds = -1.0f;
 
+  if(!timedOut)
   {
     std::ifstream fs(outputPath.string().c_str());
     fs >> relocLoss >> icpLoss >> trainingMicroseconds >> updateMicroseconds >> initialRelocalisationMicroseconds >> icpRefinementMicroseconds >> totalRelocalisationMicroseconds;
@@ -115,17 +141,23 @@ float grove_cost_fn(const Arguments& args, const ParamSet& params)
     }
   }
 
-  std::ofstream logStream(args.logPath.c_str(), std::ios::app);
-  logStream << cost << ';'
-            << elapsedSeconds << ';'
-            << relocLoss << ';'
-            << icpLoss << ';'
-            << trainingMicroseconds << ';'
-            << updateMicroseconds << ';'
-            << initialRelocalisationMicroseconds << ';'
-            << icpRefinementMicroseconds << ';'
-            << totalRelocalisationMicroseconds << ';'
-            << ParamSetUtil::param_set_to_string(params) << '\n';
+  // Append the results to the log (note that this must be synchronised, since several evaluations may be running in parallel).
+  {
+    static boost::mutex logMutex;
+    boost::lock_guard<boost::mutex> lock(logMutex);
+
+    std::ofstream logStream(args.logPath.c_str(), std::ios::app);
+    logStream << cost << ';'
+              << elapsedSeconds << ';'
+              << relocLoss << ';'
+              << icpLoss << ';'
+              << trainingMicroseconds << ';'
+              << updateMicroseconds << ';'
+              << initialRelocalisationMicroseconds << ';'
+              << icpRefinementMicroseconds << ';'
+              << totalRelocalisationMicroseconds << ';'
+              << ParamSetUtil::param_set_to_string(params) << '\n';
+  }
 
   // Delete the .ini file and the output file again.
   bf::remove(iniPath);
@@ -144,9 +176,12 @@ bool parse_command_line(int argc, char *argv[], Arguments& args)
   po::options_description options;
   options.add_options()
     ("help", "produce help message")
+    ("cacheSpecifier,c", po::value<std::string>(&args.cacheSpecifier)->default_value(""), "the cost cache specifier (if specified, the costs of the parameter sets are persisted so that interrupted searches can be resumed)")
     ("datasetDir,d", po::value<std::string>(&args.datasetDir)->default_value(""), "the dataset directory")
+    ("jobs,j", po::value<size_t>(&args.jobCount)->default_value(1), "the maximum number of evaluations to run in parallel")
     ("logSpecifier,l", po::value<std::string>(&args.logSpecifier)->default_value("relocopt.log"), "the log specifier")
     ("scriptSpecifier,s", po::value<std::string>(&args.scriptSpecifier)->default_value(""), "the script specifier")
+    ("timeLimit,t", po::value<int>(&args.timeLimit)->default_value(0), "the maximum time (in seconds) for which each evaluation may run (0 = unlimited)")
   ;
 
   // Actually parse the command line.
@@ -161,8 +196,9 @@ bool parse_command_line(int argc, char *argv[], Arguments& args)
     return false;
   }
 
-  // Prepare the log path.
+  // Prepare the log path and (if necessary) the cost cache path.
   args.logPath = args.dir / args.logSpecifier;
+  if(args.cacheSpecifier != "") args.cachePath = args.dir / args.cacheSpecifier;
 
   // Attempt to find the specified script file.
 #if _MSC_VER
@@ -204,10 +240,10 @@ try
   const unsigned seed = 12345;
 #ifdef USE_RANDOM
   const size_t epochCount = 100;
-  RandomParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed);
+  RandomParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed, args.jobCount, args.cachePath.string());
 #else
   const size_t epochCount = 5;
-  CoordinateDescentParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed);
+  CoordinateDescentParameterOptimiser optimiser(boost::bind(grove_cost_fn, args, _1), epochCount, seed, args.jobCount, args.cachePath.string());
 #endif
 
 //  // Scene parameters.
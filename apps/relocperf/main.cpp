@@ -3,16 +3,21 @@
  * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
  */
 
+#include <algorithm>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <stdexcept>
 
+#include <boost/cstdint.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
 #include <Eigen/Geometry>
+#include <Eigen/StdVector>
 
 #include <tvgutil/filesystem/SequentialPathGenerator.h>
 using namespace tvgutil;
@@ -28,6 +33,35 @@ static const std::string trainFolderName = "train";
 static const std::string validationFolderName = "validation";
 static const std::string testFolderName = "test";
 
+/** The magic number at the start of each pose archive (used to identify the file format and its version). */
+static const char poseArchiveMagic[] = { 'R', 'P', 'A', '1' };
+
+//#################### TYPEDEFS ####################
+
+typedef std::vector<Eigen::Matrix4f,Eigen::aligned_allocator<Eigen::Matrix4f> > PoseVector;
+
+//#################### TYPES ####################
+
+/**
+ * \brief The poses produced by an experiment for the frames of a sequence.
+ *
+ * \note  Each vector has one element per frame. Poses that are missing are represented by matrices filled with NaNs (when
+ *        evaluated, these behave in exactly the same way as missing poses used to, i.e. they always count as failures).
+ */
+struct RelocalisedPoses
+{
+  //#################### PUBLIC VARIABLES ####################
+
+  /** The poses after relocalisation, ICP and SVM-based pose selection. */
+  PoseVector finalPoses;
+
+  /** The poses after relocalisation and ICP. */
+  PoseVector icpPoses;
+
+  /** The poses after relocalisation. */
+  PoseVector relocPoses;
+};
+
 //#################### FUNCTIONS ####################
 
 /**
@@ -97,6 +131,182 @@ Eigen::Matrix4f read_pose_from_file(const fs::path& filename)
   return res;
 }
 
+/**
+ * \brief Reads in the ground truth poses for the frames of a sequence.
+ *
+ * \note  The sequence is deemed to end at the first frame whose ground truth pose file is missing.
+ *
+ * \param gtFolder  The folder storing the ground truth poses.
+ * \return          The ground truth poses.
+ */
+PoseVector read_gt_poses(const fs::path& gtFolder)
+{
+  PoseVector poses;
+  SequentialPathGenerator gtPathGenerator(gtFolder);
+  while(true)
+  {
+    const fs::path gtPath = gtPathGenerator.make_path("frame-%06i.pose.txt");
+    if(!fs::is_regular(gtPath)) break;
+    poses.push_back(read_pose_from_file(gtPath));
+    gtPathGenerator.increment_index();
+  }
+  return poses;
+}
+
+/**
+ * \brief Reads in the poses produced by an experiment for the frames of a sequence from the individual text files written during the experiment.
+ *
+ * \param relocFolder The folder storing the relocalisation results.
+ * \param frameCount  The number of frames in the sequence.
+ * \return            The poses (any that are missing are filled with NaNs).
+ */
+RelocalisedPoses read_relocalised_poses(const fs::path& relocFolder, size_t frameCount)
+{
+  RelocalisedPoses poses;
+  poses.finalPoses.reserve(frameCount);
+  poses.icpPoses.reserve(frameCount);
+  poses.relocPoses.reserve(frameCount);
+
+  const Eigen::Matrix4f missingPose = Eigen::Matrix4f::Constant(std::numeric_limits<float>::quiet_NaN());
+  SequentialPathGenerator relocPathGenerator(relocFolder);
+  for(size_t i = 0; i < frameCount; ++i)
+  {
+    const fs::path relocPath = relocPathGenerator.make_path("pose-%06i.reloc.txt");
+    const fs::path icpPath = relocPathGenerator.make_path("pose-%06i.icp.txt");
+    const fs::path finalPath = relocPathGenerator.make_path("pose-%06i.final.txt");
+
+    poses.relocPoses.push_back(fs::is_regular(relocPath) ? read_pose_from_file(relocPath) : missingPose);
+    poses.icpPoses.push_back(fs::is_regular(icpPath) ? read_pose_from_file(icpPath) : missingPose);
+    poses.finalPoses.push_back(fs::is_regular(finalPath) ? read_pose_from_file(finalPath) : missingPose);
+
+    relocPathGenerator.increment_index();
+  }
+
+  return poses;
+}
+
+/**
+ * \brief Attempts to read in the poses produced by an experiment for the frames of a sequence from a packed pose archive.
+ *
+ * A pose archive consists of a magic number, followed by a 32-bit frame count, followed by the relocalised, ICP and final poses
+ * for each frame in turn (each stored as 16 floats in row-major order). Reading a single archive is much faster than opening
+ * three text files per frame.
+ *
+ * \param archivePath The path to the pose archive.
+ * \param frameCount  The number of frames in the sequence.
+ * \param poses       A location into which to write the poses.
+ * \return            true, if the poses were successfully read in, or false otherwise (e.g. if the archive is for a different number of frames).
+ */
+bool read_pose_archive(const fs::path& archivePath, size_t frameCount, RelocalisedPoses& poses)
+{
+  std::ifstream in(archivePath.string().c_str(), std::ios::binary);
+  if(!in) return false;
+
+  char magic[sizeof(poseArchiveMagic)];
+  boost::uint32_t archiveFrameCount;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&archiveFrameCount), sizeof(archiveFrameCount));
+  if(!in || !std::equal(magic, magic + sizeof(magic), poseArchiveMagic) || archiveFrameCount != frameCount) return false;
+
+  poses.finalPoses.resize(frameCount);
+  poses.icpPoses.resize(frameCount);
+  poses.relocPoses.resize(frameCount);
+
+  Eigen::Matrix<float,4,4,Eigen::RowMajor> pose;
+  Eigen::Matrix4f *targets[3];
+  for(size_t i = 0; i < frameCount; ++i)
+  {
+    targets[0] = &poses.relocPoses[i];
+    targets[1] = &poses.icpPoses[i];
+    targets[2] = &poses.finalPoses[i];
+
+    for(int j = 0; j < 3; ++j)
+    {
+      in.read(reinterpret_cast<char*>(pose.data()), sizeof(float) * 16);
+      *targets[j] = pose;
+    }
+  }
+
+  return static_cast<bool>(in);
+}
+
+/**
+ * \brief Writes the poses produced by an experiment for the frames of a sequence to a packed pose archive.
+ *
+ * \param archivePath The path to the pose archive.
+ * \param poses       The poses.
+ *
+ * \throws std::runtime_error If the archive could not be written.
+ */
+void write_pose_archive(const fs::path& archivePath, const RelocalisedPoses& poses)
+{
+  std::ofstream out(archivePath.string().c_str(), std::ios::binary);
+
+  const boost::uint32_t frameCount = static_cast<boost::uint32_t>(poses.relocPoses.size());
+  out.write(poseArchiveMagic, sizeof(poseArchiveMagic));
+  out.write(reinterpret_cast<const char*>(&frameCount), sizeof(frameCount));
+
+  Eigen::Matrix<float,4,4,Eigen::RowMajor> pose;
+  for(size_t i = 0; i < frameCount; ++i)
+  {
+    const Eigen::Matrix4f *sources[] = { &poses.relocPoses[i], &poses.icpPoses[i], &poses.finalPoses[i] };
+    for(int j = 0; j < 3; ++j)
+    {
+      pose = *sources[j];
+      out.write(reinterpret_cast<const char*>(pose.data()), sizeof(float) * 16);
+    }
+  }
+
+  if(!out) throw std::runtime_error("Error: Could not write pose archive: " + archivePath.string());
+}
+
+/**
+ * \brief Determines when the relocalisation results in the specified folder last changed.
+ *
+ * Rewriting an existing pose file does not change the last write time of the folder containing it, so we take the
+ * latest of the last write times of the folder itself (which changes whenever a file is added or removed) and of
+ * each file in it.
+ *
+ * \param relocFolder The folder storing the relocalisation results.
+ * \return            The time at which the relocalisation results last changed.
+ */
+std::time_t last_results_write_time(const fs::path& relocFolder)
+{
+  std::time_t result = fs::last_write_time(relocFolder);
+  for(fs::directory_iterator it(relocFolder), iend; it != iend; ++it)
+  {
+    if(fs::is_regular(it->status())) result = std::max(result, fs::last_write_time(it->path()));
+  }
+  return result;
+}
+
+/**
+ * \brief Loads the poses produced by an experiment for the frames of a sequence.
+ *
+ * If an up-to-date pose archive exists for the experiment and sequence, the poses are read from that. Otherwise, they are read
+ * from the individual text files written during the experiment, and (if requested) packed into a pose archive for next time.
+ *
+ * \param relocFolder The folder storing the relocalisation results.
+ * \param archivePath The path to the pose archive for the experiment and sequence.
+ * \param frameCount  The number of frames in the sequence.
+ * \param packPoses   Whether or not to write a pose archive if the poses had to be read from the individual text files.
+ * \return            The poses.
+ */
+RelocalisedPoses load_relocalised_poses(const fs::path& relocFolder, const fs::path& archivePath, size_t frameCount, bool packPoses)
+{
+  RelocalisedPoses poses;
+
+  // Note: An archive is only considered to be up to date if it was written after the relocalisation results last changed.
+  //       Since file times have a coarse resolution, an archive written at the same time as the results is not trusted.
+  const bool archiveUpToDate = fs::is_regular(archivePath) && (!fs::is_directory(relocFolder) || fs::last_write_time(archivePath) > last_results_write_time(relocFolder));
+  if(archiveUpToDate && read_pose_archive(archivePath, frameCount, poses)) return poses;
+
+  poses = read_relocalised_poses(relocFolder, frameCount);
+  if(packPoses && fs::is_directory(relocFolder)) write_pose_archive(archivePath, poses);
+
+  return poses;
+}
+
 /**
  * \brief Computes the angular separation between two rotation matrices.
  *
@@ -172,43 +382,6 @@ bool pose_matches(const Eigen::Matrix4f& gtPose, const Eigen::Matrix4f& testPose
   return pose_matches(gtPose, testPose, translationError, angleError);
 }
 
-/**
- * \brief Check whether a pose stored in a text file matches with a ground truth pose, according to the 7-scenes metric.
- *
- * \param gtPose   The ground truth camera pose.
- * \param poseFile The path to a file storing a transformation matrix.
- *
- * \return Whether the pose stored in the file matches the ground truth pose. False if the file is missing.
- */
-bool pose_file_matches(const Eigen::Matrix4f& gtPose, const fs::path& poseFile)
-{
-  if(!fs::is_regular(poseFile)) return false;
-
-  const Eigen::Matrix4f otherPose = read_pose_from_file(poseFile);
-  return pose_matches(gtPose, otherPose);
-}
-
-/**
- * \brief Check whether a pose stored in a text file matches with a ground truth pose, according to the 7-scenes metric.
- *
- * \param gtPose   The ground truth camera pose.
- * \param poseFile The path to a file storing a transformation matrix.
- * \param translationError Returns the translational error (Infinity if the file does not exist).
- * \param angleError       Returns the angular error (Infinity if the file does not exist).
- *
- * \return Whether the pose stored in the file matches the ground truth pose. False if the file is missing.
- */
-bool pose_file_matches(const Eigen::Matrix4f& gtPose, const fs::path& poseFile, float& translationError, float& angleError)
-{
-  translationError = std::numeric_limits<float>::infinity();
-  angleError = static_cast<float>(M_PI);
-
-  if(!fs::is_regular(poseFile)) return false;
-
-  const Eigen::Matrix4f otherPose = read_pose_from_file(poseFile);
-  return pose_matches(gtPose, otherPose, translationError, angleError);
-}
-
 /**
  * \brief Struct used to accumulate stats on a dataset sequence.
  */
@@ -344,41 +517,27 @@ struct Comparer
 /**
  * \brief Process a dataset sequence computing how well the relocaliser performed on it.
  *
- * \param gtFolder    The folder storing the ground truth poses.
- * \param relocFolder The folder storing the relocalisation results.
- * \param statsFile   The file storing the average timings for the sequence (can be empty).
+ * \param gtPoses          The ground truth poses for the frames of the sequence.
+ * \param relocalisedPoses The poses produced by the relocaliser for the frames of the sequence.
+ * \param statsFile        The file storing the average timings for the sequence (can be empty).
  *
  * \return The SequenceResults on this sequence.
  */
-SequenceResults evaluate_sequence(const fs::path& gtFolder, const fs::path& relocFolder, const fs::path& statsFile)
+SequenceResults evaluate_sequence(const PoseVector& gtPoses, const RelocalisedPoses& relocalisedPoses, const fs::path& statsFile)
 {
   SequenceResults res;
 
-  // Create appropriate path generators.
-  SequentialPathGenerator gtPathGenerator(gtFolder);
-  SequentialPathGenerator relocPathGenerator(relocFolder);
-
-  while(true)
+  for(size_t i = 0, frameCount = gtPoses.size(); i < frameCount; ++i)
   {
-    // Generate the paths to evaluate.
-    const fs::path gtPath = gtPathGenerator.make_path("frame-%06i.pose.txt");
-    const fs::path relocPath = relocPathGenerator.make_path("pose-%06i.reloc.txt");
-    const fs::path icpPath = relocPathGenerator.make_path("pose-%06i.icp.txt");
-    const fs::path finalPath = relocPathGenerator.make_path("pose-%06i.final.txt");
-
-    // If the GT file is missing this sequence is over.
-    if(!fs::is_regular(gtPath)) break;
-
-    // Read the GT camera pose.
-    const Eigen::Matrix4f gtPose = read_pose_from_file(gtPath);
+    const Eigen::Matrix4f& gtPose = gtPoses[i];
 
     float relocalisationTranslationError, relocalisationAngleError;
     float icpTranslationError, icpAngleError;
 
     // Check whether different kinds of relocalisations succeeded.
-    bool validReloc = pose_file_matches(gtPose, relocPath, relocalisationTranslationError, relocalisationAngleError);
-    bool validICP = pose_file_matches(gtPose, icpPath, icpTranslationError, icpAngleError);
-    bool validFinal = pose_file_matches(gtPose, finalPath);
+    bool validReloc = pose_matches(gtPose, relocalisedPoses.relocPoses[i], relocalisationTranslationError, relocalisationAngleError);
+    bool validICP = pose_matches(gtPose, relocalisedPoses.icpPoses[i], icpTranslationError, icpAngleError);
+    bool validFinal = pose_matches(gtPose, relocalisedPoses.finalPoses[i]);
 
     // Accumulate stats.
     res.validPosesAfterReloc += validReloc;
@@ -411,8 +570,6 @@ SequenceResults evaluate_sequence(const fs::path& gtFolder, const fs::path& relo
 
     // Increment counters.
     ++res.poseCount;
-    gtPathGenerator.increment_index();
-    relocPathGenerator.increment_index();
   }
 
   // Compute medians.
@@ -494,78 +651,20 @@ void printWidth(const T& item, int width, bool leftAlign = false)
   std::cerr << (leftAlign ? std::left : std::right) << std::setw(width) << std::fixed << std::setprecision(3) << item;
 }
 
-int main(int argc, char *argv[])
+/**
+ * \brief Prints (and, if requested, saves) the results of evaluating an experiment on the sequences in a dataset.
+ *
+ * \param relocTag              The tag assigned to the experiment.
+ * \param sequenceNames         The names of the sequences in the dataset.
+ * \param results               The results for the sequences that were successfully evaluated.
+ * \param sequenceNameMaxLength The width to allocate to the sequence names when printing.
+ * \param useValidation         Whether the validation sequences were used to evaluate the relocaliser.
+ * \param onlineEvaluation      Whether to save the CSV for the evaluation of online relocalisation.
+ * \param verbose               Whether or not to print more information on the sequences.
+ */
+void output_results(const std::string& relocTag, const std::vector<std::string>& sequenceNames, std::map<std::string, SequenceResults>& results,
+                    int sequenceNameMaxLength, bool useValidation, bool onlineEvaluation, bool verbose)
 {
-  fs::path datasetFolder;
-  fs::path relocBaseFolder;
-  fs::path statsBaseFolder;
-  std::string relocTag;
-  bool useValidation = false;
-  bool onlineEvaluation = false;
-  bool verbose = false;
-
-  // Declare some options for the evaluation.
-  po::options_description options("Relocperf Options");
-  options.add_options()
-      ("datasetFolder,d", po::value(&datasetFolder)->required(), "The path to the dataset.")
-      ("relocBaseFolder,r", po::value(&relocBaseFolder)->required(), "The path to the folder where the relocalised poses are stored.")
-      ("statsBaseFolder,s", po::value(&statsBaseFolder), "The path to the folder where the relocalisation times are stored.")
-      ("relocTag,t", po::value(&relocTag)->required(), "The tag assigned to the experimento to evaluate.")
-      ("useValidation,v", po::bool_switch(&useValidation), "Whether to use the validation sequence to evaluate the relocaliser.")
-      ("onlineEvaluation,o", po::bool_switch(&onlineEvaluation), "Whether to save the CSV for the evaluation of online relocalisation.")
-      ("verbose", po::bool_switch(&verbose), "whether or not to print more informations on the sequences.")
-      ("help,h", "Print this help message.")
-      ;
-
-  po::variables_map vm;
-  po::store(po::parse_command_line(argc, argv, options), vm);
-
-  if(vm.count("help"))
-  {
-    std::cerr << "Usage: " << options << '\n';
-    exit(0);
-  }
-
-  try
-  {
-    po::notify(vm);
-  }
-  catch(const po::error &e)
-  {
-    std::cerr << "Error parsing the options: " << e.what() << '\n';
-    std::cerr << options << '\n';
-    exit(1);
-  }
-
-  // Find the valid sequences in the dataset folder.
-  const std::vector<std::string> sequenceNames = find_sequence_names(datasetFolder);
-  int sequenceNameMaxLength = 0;
-
-  std::map<std::string, SequenceResults> results;
-
-  // Evaluate each sequence.
-  for(size_t sequenceIdx = 0; sequenceIdx < sequenceNames.size(); ++sequenceIdx)
-  {
-    const std::string& sequence = sequenceNames[sequenceIdx];
-
-    sequenceNameMaxLength = std::max(sequenceNameMaxLength, static_cast<int>(sequence.length()) + 2);
-
-    // Compute the full paths.
-    const fs::path gtPath = datasetFolder / sequence / (useValidation ? validationFolderName : testFolderName);
-    const fs::path relocFolder = relocBaseFolder / (relocTag + '_' + sequence);
-    const fs::path statsFile = statsBaseFolder / (relocTag + '_' + sequence + ".txt");
-
-    std::cerr << "Processing sequence " << sequence << " in: " << gtPath << "\t - " << relocFolder << std::endl;
-    try
-    {
-      results[sequence] = evaluate_sequence(gtPath, relocFolder, statsFile);
-    }
-    catch(std::runtime_error &)
-    {
-      std::cerr << "\tSequence has not been evaluated.\n";
-    }
-  }
-
   // Print table
   printWidth("Sequence", sequenceNameMaxLength, true);
   printWidth("Poses", 8);
@@ -860,6 +959,152 @@ int main(int argc, char *argv[])
 
   std::cout << "\\\\\n";
 #endif
+}
+
+int main(int argc, char *argv[])
+{
+  fs::path datasetFolder;
+  fs::path relocBaseFolder;
+  fs::path statsBaseFolder;
+  std::vector<std::string> relocTags;
+  bool useValidation = false;
+  bool onlineEvaluation = false;
+  bool packPoses = false;
+  bool verbose = false;
+
+  // Declare some options for the evaluation.
+  po::options_description options("Relocperf Options");
+  options.add_options()
+      ("datasetFolder,d", po::value(&datasetFolder)->required(), "The path to the dataset.")
+      ("relocBaseFolder,r", po::value(&relocBaseFolder)->required(), "The path to the folder where the relocalised poses are stored.")
+      ("statsBaseFolder,s", po::value(&statsBaseFolder), "The path to the folder where the relocalisation times are stored.")
+      ("relocTag,t", po::value(&relocTags)->multitoken()->required(), "The tags assigned to the experiments to evaluate.")
+      ("useValidation,v", po::bool_switch(&useValidation), "Whether to use the validation sequence to evaluate the relocaliser.")
+      ("onlineEvaluation,o", po::bool_switch(&onlineEvaluation), "Whether to save the CSV for the evaluation of online relocalisation.")
+      ("packPoses,p", po::bool_switch(&packPoses), "Whether to pack the relocalised poses for each sequence into a pose archive to speed up later evaluations.")
+      ("verbose", po::bool_switch(&verbose), "whether or not to print more informations on the sequences.")
+      ("help,h", "Print this help message.")
+      ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, options), vm);
+
+  if(vm.count("help"))
+  {
+    std::cerr << "Usage: " << options << '\n';
+    exit(0);
+  }
+
+  try
+  {
+    po::notify(vm);
+  }
+  catch(const po::error &e)
+  {
+    std::cerr << "Error parsing the options: " << e.what() << '\n';
+    std::cerr << options << '\n';
+    exit(1);
+  }
+
+  // Find the valid sequences in the dataset folder.
+  const std::vector<std::string> sequenceNames = find_sequence_names(datasetFolder);
+  const int sequenceCount = static_cast<int>(sequenceNames.size());
+  const int tagCount = static_cast<int>(relocTags.size());
+  int sequenceNameMaxLength = 0;
+
+  for(int sequenceIdx = 0; sequenceIdx < sequenceCount; ++sequenceIdx)
+  {
+    sequenceNameMaxLength = std::max(sequenceNameMaxLength, static_cast<int>(sequenceNames[sequenceIdx].length()) + 2);
+  }
+
+  // Read in the ground truth poses for each sequence in parallel (these are shared between all of the experiments being evaluated).
+  std::vector<PoseVector> gtPoses(sequenceCount);
+  std::vector<char> gtPosesValid(sequenceCount, 0);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+#endif
+  for(int sequenceIdx = 0; sequenceIdx < sequenceCount; ++sequenceIdx)
+  {
+    const fs::path gtPath = datasetFolder / sequenceNames[sequenceIdx] / (useValidation ? validationFolderName : testFolderName);
+    try
+    {
+      gtPoses[sequenceIdx] = read_gt_poses(gtPath);
+      gtPosesValid[sequenceIdx] = 1;
+    }
+    catch(std::runtime_error &)
+    {
+      // If the ground truth poses can't be read, the sequence will not be evaluated for any experiment.
+    }
+  }
+
+  // Evaluate each experiment on each sequence in parallel. Each (experiment, sequence) pair writes into its own slot,
+  // so the results are always the same regardless of how the evaluations happen to be scheduled.
+  const int jobCount = tagCount * sequenceCount;
+  std::vector<SequenceResults> jobResults(jobCount);
+  std::vector<char> jobSucceeded(jobCount, 0);
+
+  for(int tagIdx = 0; tagIdx < tagCount; ++tagIdx)
+  {
+    for(int sequenceIdx = 0; sequenceIdx < sequenceCount; ++sequenceIdx)
+    {
+      const std::string& sequence = sequenceNames[sequenceIdx];
+      const fs::path gtPath = datasetFolder / sequence / (useValidation ? validationFolderName : testFolderName);
+      const fs::path relocFolder = relocBaseFolder / (relocTags[tagIdx] + '_' + sequence);
+      std::cerr << "Processing sequence " << sequence << " in: " << gtPath << "\t - " << relocFolder << std::endl;
+    }
+  }
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+#endif
+  for(int jobIdx = 0; jobIdx < jobCount; ++jobIdx)
+  {
+    const int tagIdx = jobIdx / sequenceCount;
+    const int sequenceIdx = jobIdx % sequenceCount;
+    if(!gtPosesValid[sequenceIdx]) continue;
+
+    // Compute the full paths.
+    const std::string& relocTag = relocTags[tagIdx];
+    const std::string& sequence = sequenceNames[sequenceIdx];
+    const fs::path relocFolder = relocBaseFolder / (relocTag + '_' + sequence);
+    const fs::path archivePath = relocBaseFolder / (relocTag + '_' + sequence + ".poses");
+    const fs::path statsFile = statsBaseFolder / (relocTag + '_' + sequence + ".txt");
+
+    try
+    {
+      const RelocalisedPoses relocalisedPoses = load_relocalised_poses(relocFolder, archivePath, gtPoses[sequenceIdx].size(), packPoses);
+      jobResults[jobIdx] = evaluate_sequence(gtPoses[sequenceIdx], relocalisedPoses, statsFile);
+      jobSucceeded[jobIdx] = 1;
+    }
+    catch(std::runtime_error &)
+    {
+      // Any sequence that cannot be evaluated is reported below.
+    }
+  }
+
+  // Output the results for each experiment in turn.
+  for(int tagIdx = 0; tagIdx < tagCount; ++tagIdx)
+  {
+    const std::string& relocTag = relocTags[tagIdx];
+    std::map<std::string, SequenceResults> results;
+
+    for(int sequenceIdx = 0; sequenceIdx < sequenceCount; ++sequenceIdx)
+    {
+      const int jobIdx = tagIdx * sequenceCount + sequenceIdx;
+      if(jobSucceeded[jobIdx])
+      {
+        results[sequenceNames[sequenceIdx]] = jobResults[jobIdx];
+      }
+      else
+      {
+        std::cerr << "\tSequence " << sequenceNames[sequenceIdx] << " has not been evaluated for " << relocTag << ".\n";
+      }
+    }
+
+    if(tagCount > 1) std::cerr << "\nResults for " << relocTag << ":\n";
+    output_results(relocTag, sequenceNames, results, sequenceNameMaxLength, useValidation, onlineEvaluation, verbose);
+  }
 
   return 0;
 }
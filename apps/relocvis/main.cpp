@@ -15,11 +15,13 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include <sstream>
+#include "orx/geometry/PoseIndex.h"
 #include "tvgutil/filesystem/PathFinder.h"
 #include "tvgutil/timing/TimeUtil.h"
 
 namespace fs = boost::filesystem;
 using namespace cv::viz;
+using namespace orx;
 
 //#################### FUNCTIONS ####################
 
@@ -174,6 +176,17 @@ std::vector<std::vector<TestICPPair>> classify_poses(
 
   res.resize(thresholds.size() + 1);
 
+  // Index the training poses, so that each test pose only needs to be compared with those training poses that
+  // are close enough to it to fall within at least one of the thresholds (rather than with all of them).
+  float maxTranslationError = 0.0f, maxAngleError = 0.0f;
+  for (const ErrorThreshold &threshold : thresholds)
+  {
+    maxTranslationError = std::max(maxTranslationError, threshold.translationMaxError);
+    maxAngleError = std::max(maxAngleError, threshold.angleMaxError);
+  }
+
+  const PoseIndexf trainPoseIndex(trainPoses);
+
   // For each test pose:
   for (size_t testIndex = 0, testCount = testPoses.size();
       testIndex < testCount; ++testIndex)
@@ -189,10 +202,12 @@ std::vector<std::vector<TestICPPair>> classify_poses(
     Eigen::Matrix4f closestTrainPose;
     closestTrainPose.setConstant(std::numeric_limits<float>::quiet_NaN());
 
-    // Determine a difficulty bin for the test.
+    // Determine a difficulty bin for the test. The candidates are in increasing order of training index,
+    // so this yields the same result as a linear scan over all of the training poses would.
     size_t chosenBin = thresholds.size();
-    for (size_t trainIndex = 0, trainCount = trainPoses.size();
-        trainIndex < trainCount; ++trainIndex)
+    const std::vector<size_t> candidateTrainIndices =
+        trainPoseIndex.find_poses_within(testPose, maxTranslationError, maxAngleError);
+    for (size_t trainIndex : candidateTrainIndices)
     {
       const Eigen::Matrix4f& trainPose = trainPoses[trainIndex];
       for (size_t binIndex = 0; binIndex < chosenBin; ++binIndex)
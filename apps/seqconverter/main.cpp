@@ -0,0 +1,33 @@
+/**
+ * seqconverter: main.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <itmx/persistence/SequenceFileConverter.h>
+using namespace itmx;
+
+int main(int argc, char *argv[])
+{
+  // This application can be used to convert a sequence file (e.g. as recorded by spaintgui) into the frame-%06i.* layout used for disk sequences.
+  if(argc != 3)
+  {
+    std::cout << "Usage: seqconverter <sequence file> <output directory>\n";
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    std::cout << "Converting " << argv[1] << " into frame files in " << argv[2] << "...\n";
+    SequenceFileConverter::convert_to_frame_files(argv[1], argv[2]);
+    return EXIT_SUCCESS;
+  }
+  catch(std::exception& e)
+  {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
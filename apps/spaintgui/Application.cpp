@@ -298,8 +298,8 @@ void Application::handle_key_down(const SDL_Keysym& keysym)
   // If right shift + / is pressed, toggle video recording.
   if(keysym.sym == SDLK_SLASH)
   {
-    if(m_inputState.key_down(KEYCODE_LSHIFT)) toggle_recording("sequence", m_sequencePathGenerator);
-    else if(m_inputState.key_down(KEYCODE_RSHIFT)) toggle_recording("video", m_videoPathGenerator);
+    if(m_inputState.key_down(KEYCODE_LSHIFT)) toggle_recording("sequence", m_sequencePathGenerator, m_sequenceRecorder);
+    else if(m_inputState.key_down(KEYCODE_RSHIFT)) toggle_recording("video", m_videoPathGenerator, m_videoRecorder);
     else save_screenshot();
   }
 
@@ -493,6 +493,16 @@ void Application::handle_mousebutton_up(const SDL_MouseButtonEvent& e)
   }
 }
 
+SequenceRecorder_Ptr Application::make_sequence_recorder(const boost::filesystem::path& filename, const ITMRGBDCalib& calib) const
+{
+  const Settings_CPtr& settings = m_pipeline->get_model()->get_settings();
+  const RGBCompressionType rgbCompressionType = settings->get_first_value<RGBCompressionType>("SequenceRecorder.rgbCompressionType", RGB_COMPRESSION_NONE);
+  const DepthCompressionType depthCompressionType = settings->get_first_value<DepthCompressionType>("SequenceRecorder.depthCompressionType", DEPTH_COMPRESSION_NONE);
+  const size_t capacity = settings->get_first_value<size_t>("SequenceRecorder.capacity", 60);
+  const pooled_queue::PoolEmptyStrategy poolEmptyStrategy = settings->get_first_value<pooled_queue::PoolEmptyStrategy>("SequenceRecorder.poolEmptyStrategy", pooled_queue::PES_WAIT);
+  return SequenceRecorder_Ptr(new SequenceRecorder(filename.string(), calib, rgbCompressionType, depthCompressionType, capacity, poolEmptyStrategy));
+}
+
 void Application::process_camera_input()
 {
   // Allow the user to change the camera mode of the active sub-window.
@@ -1053,21 +1063,35 @@ void Application::save_sequence_frame()
 {
   const Subwindow& mainSubwindow = m_renderer->get_subwindow_configuration()->subwindow(0);
   const std::string& sceneID = mainSubwindow.get_scene_id();
-
-  // If the RGBD calibration hasn't already been saved, save it now.
   SLAMState_CPtr slamState = m_pipeline->get_model()->get_slam_state(sceneID);
-  boost::filesystem::path calibrationFile = m_sequencePathGenerator->get_base_dir() / "calib.txt";
-  if(!boost::filesystem::exists(calibrationFile))
+
+  if(m_pipeline->get_model()->get_settings()->get_first_value<bool>("Application.useSequenceRecorder", true))
   {
-    writeRGBDCalib(calibrationFile.string().c_str(), slamState->get_view()->calib);
+    // If we're recording to a sequence file, queue the current input images and pose on the sequence recorder
+    // (creating it first if necessary). The sequence file also stores the RGBD calibration.
+    if(!m_sequenceRecorder)
+    {
+      m_sequenceRecorder = make_sequence_recorder(m_sequencePathGenerator->get_base_dir() / "sequence.seq", slamState->get_view()->calib);
+    }
+
+    m_sequenceRecorder->record_frame(slamState->get_input_rgb_image_copy(), slamState->get_input_raw_depth_image_copy(), slamState->get_pose());
   }
+  else
+  {
+    // If the RGBD calibration hasn't already been saved, save it now.
+    boost::filesystem::path calibrationFile = m_sequencePathGenerator->get_base_dir() / "calib.txt";
+    if(!boost::filesystem::exists(calibrationFile))
+    {
+      writeRGBDCalib(calibrationFile.string().c_str(), slamState->get_view()->calib);
+    }
 
-  // Save the current input images.
-  ImagePersister::save_image_on_thread(slamState->get_input_raw_depth_image_copy(), m_sequencePathGenerator->make_path("frame-%06i.depth.png"));
-  ImagePersister::save_image_on_thread(slamState->get_input_rgb_image_copy(), m_sequencePathGenerator->make_path("frame-%06i.color.png"));
+    // Save the current input images.
+    ImagePersister::save_image_on_thread(slamState->get_input_raw_depth_image_copy(), m_sequencePathGenerator->make_path("frame-%06i.depth.png"));
+    ImagePersister::save_image_on_thread(slamState->get_input_rgb_image_copy(), m_sequencePathGenerator->make_path("frame-%06i.color.png"));
 
-  // Save the inverse pose (i.e. the camera -> world transformation).
-  PosePersister::save_pose_on_thread(slamState->get_pose().GetInvM(), m_sequencePathGenerator->make_path("frame-%06i.pose.txt"));
+    // Save the inverse pose (i.e. the camera -> world transformation).
+    PosePersister::save_pose_on_thread(slamState->get_pose().GetInvM(), m_sequencePathGenerator->make_path("frame-%06i.pose.txt"));
+  }
 
   m_sequencePathGenerator->increment_index();
 }
@@ -1075,7 +1099,26 @@ void Application::save_sequence_frame()
 void Application::save_video_frame()
 {
   m_videoPathGenerator->increment_index();
-  ImagePersister::save_image_on_thread(m_renderer->capture_screenshot(), m_videoPathGenerator->make_path("%06i.png"));
+
+  ORUChar4Image_CPtr screenshot = m_renderer->capture_screenshot();
+  if(m_pipeline->get_model()->get_settings()->get_first_value<bool>("Application.useSequenceRecorder", true))
+  {
+    // If we're recording to a sequence file, queue the screenshot on the video recorder (creating it first if necessary).
+    // Videos have no depth images, so we record them using a calibration whose depth image size is zero.
+    if(!m_videoRecorder)
+    {
+      ITMRGBDCalib calib;
+      calib.intrinsics_rgb.imgSize = screenshot->noDims;
+      calib.intrinsics_d.imgSize = Vector2i(0, 0);
+      m_videoRecorder = make_sequence_recorder(m_videoPathGenerator->get_base_dir() / "video.seq", calib);
+    }
+
+    m_videoRecorder->record_frame(screenshot, ORShortImage_CPtr(), ORUtils::SE3Pose());
+  }
+  else
+  {
+    ImagePersister::save_image_on_thread(screenshot, m_videoPathGenerator->make_path("%06i.png"));
+  }
 }
 
 void Application::setup_labels()
@@ -1151,11 +1194,13 @@ void Application::switch_to_windowed_renderer(size_t subwindowConfigurationIndex
   m_renderer.reset(new WindowedRenderer(title, m_pipeline->get_model(), subwindowConfiguration, windowViewportSize));
 }
 
-void Application::toggle_recording(const std::string& type, boost::optional<tvgutil::SequentialPathGenerator>& pathGenerator)
+void Application::toggle_recording(const std::string& type, boost::optional<tvgutil::SequentialPathGenerator>& pathGenerator, SequenceRecorder_Ptr& recorder)
 {
   if(pathGenerator)
   {
+    // Note that destroying the recorder (if any) waits for any frames it has queued to be written.
     pathGenerator.reset();
+    recorder.reset();
     std::cout << "[spaint] Stopped saving " << type << ".\n";
   }
   else
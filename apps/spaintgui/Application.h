@@ -18,6 +18,8 @@
 
 #include <tvginput/InputState.h>
 
+#include <itmx/persistence/SequenceRecorder.h>
+
 #include <tvgutil/commands/CommandManager.h>
 #include <tvgutil/filesystem/SequentialPathGenerator.h>
 
@@ -93,6 +95,9 @@ private:
   /** The path generator for the current sequence recording (if any). */
   boost::optional<tvgutil::SequentialPathGenerator> m_sequencePathGenerator;
 
+  /** The recorder for the current sequence recording (if any, and if sequences are being recorded to a sequence file). */
+  itmx::SequenceRecorder_Ptr m_sequenceRecorder;
+
   /** A set of sub-window configurations that the user can switch between as desired. */
   mutable std::vector<SubwindowConfiguration_Ptr> m_subwindowConfigurations;
 
@@ -102,6 +107,9 @@ private:
   /** The path generator for the current video recording (if any). */
   boost::optional<tvgutil::SequentialPathGenerator> m_videoPathGenerator;
 
+  /** The recorder for the current video recording (if any, and if videos are being recorded to a sequence file). */
+  itmx::SequenceRecorder_Ptr m_videoRecorder;
+
   /** The stream of commands being sent from the voice command server. */
   boost::asio::ip::tcp::iostream m_voiceCommandStream;
 
@@ -243,6 +251,15 @@ private:
    */
   void handle_mousebutton_up(const SDL_MouseButtonEvent& e);
 
+  /**
+   * \brief Makes a recorder that can be used to record a sequence or video to a sequence file.
+   *
+   * \param filename  The name of the sequence file to which to record.
+   * \param calib     The calibration to store in the sequence file (the image sizes in this determine the sizes of the images recorded).
+   * \return          The recorder.
+   */
+  itmx::SequenceRecorder_Ptr make_sequence_recorder(const boost::filesystem::path& filename, const ITMLib::ITMRGBDCalib& calib) const;
+
   /**
    * \brief Processes user input that deals with the camera.
    */
@@ -351,8 +368,9 @@ private:
    *
    * \param type          The type or recording (sequence or video).
    * \param pathGenerator The path generator associated with that type of recording.
+   * \param recorder      The sequence recorder (if any) associated with that type of recording.
    */
-  void toggle_recording(const std::string& type, boost::optional<tvgutil::SequentialPathGenerator>& pathGenerator);
+  void toggle_recording(const std::string& type, boost::optional<tvgutil::SequentialPathGenerator>& pathGenerator, itmx::SequenceRecorder_Ptr& recorder);
 };
 
 #endif
@@ -7,6 +7,8 @@
 using namespace itmx;
 using namespace spaint;
 
+#include <stdexcept>
+
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 namespace bf = boost::filesystem;
@@ -31,11 +33,32 @@ MultiScenePipeline::MultiScenePipeline(const std::string& type, const Settings_P
 
   // Set up the spaint model.
   m_model.reset(new Model(settings, resourcesDir, maxLabelCount, mappingServer));
+
+  // Determine whether or not the frames for the different scenes should be processed concurrently. Note that we don't currently
+  // allow this when using the Vicon system, since the Vicon interface is shared between the scenes and is not thread-safe.
+  m_processScenesInParallel = settings->get_first_value<bool>("MultiScenePipeline.processScenesInParallel", false);
+  if(m_processScenesInParallel && m_model->get_vicon())
+  {
+    std::cerr << "[spaint] Warning: Scenes cannot be processed in parallel when using the Vicon system, so they will be processed sequentially\n";
+    m_processScenesInParallel = false;
+  }
+
+  m_printTimers = settings->get_first_value<bool>("MultiScenePipeline.printTimers", m_processScenesInParallel);
 }
 
 //#################### DESTRUCTOR ####################
 
-MultiScenePipeline::~MultiScenePipeline() {}
+MultiScenePipeline::~MultiScenePipeline()
+{
+  if(m_printTimers)
+  {
+    for(std::map<std::string,AverageTimer>::const_iterator it = m_sceneTimers.begin(), iend = m_sceneTimers.end(); it != iend; ++it)
+    {
+      const AverageTimer& timer = it->second;
+      std::cout << timer.name() << ": " << timer.count() << " times, avg: " << timer.average_duration() << ".\n";
+    }
+  }
+}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
@@ -76,11 +99,70 @@ void MultiScenePipeline::reset_scene(const std::string& sceneID)
 
 std::set<std::string> MultiScenePipeline::run_main_section()
 {
+  // Make sure that there is a timer for each scene (note that scenes can be added on the fly, e.g. when new remote clients connect).
+  for(std::map<std::string,SLAMComponent_Ptr>::const_iterator it = m_slamComponents.begin(), iend = m_slamComponents.end(); it != iend; ++it)
+  {
+    if(m_sceneTimers.find(it->first) == m_sceneTimers.end())
+    {
+      m_sceneTimers.insert(std::make_pair(it->first, AverageTimer("SLAM (" + it->first + ")")));
+    }
+  }
+
   std::set<std::string> result;
+
+  if(!m_processScenesInParallel)
+  {
+    for(std::map<std::string,SLAMComponent_Ptr>::const_iterator it = m_slamComponents.begin(), iend = m_slamComponents.end(); it != iend; ++it)
+    {
+      if(run_slam_component(it->first, it->second)) result.insert(it->first);
+    }
+    return result;
+  }
+
+  // Split the SLAM components into those that track their scenes independently, and those that mirror the pose of another scene
+  // (the latter need to wait until the scenes whose poses they mirror have been processed).
+  std::vector<std::map<std::string,SLAMComponent_Ptr>::const_iterator> independentComponents, mirroringComponents;
   for(std::map<std::string,SLAMComponent_Ptr>::const_iterator it = m_slamComponents.begin(), iend = m_slamComponents.end(); it != iend; ++it)
   {
-    if(it->second->process_frame()) result.insert(it->first);
+    if(it->second->get_mirror_scene_id() != "") mirroringComponents.push_back(it);
+    else independentComponents.push_back(it);
   }
+
+  // Run the independent SLAM components concurrently. Each component has its own tracker, dense mappers and relocaliser, so
+  // the components do not need to synchronise with each other. The implicit barrier at the end of the loop ensures that all
+  // of the scenes are in a consistent state before anything else (e.g. the collaborative component) tries to use them.
+  // Note: Any exception thrown by a component is rethrown after the barrier, since it cannot propagate out of the loop.
+  const int independentComponentCount = static_cast<int>(independentComponents.size());
+  std::vector<int> processed(independentComponentCount, 0);
+  std::vector<std::string> errors(independentComponentCount);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for(int i = 0; i < independentComponentCount; ++i)
+  {
+    try
+    {
+      processed[i] = run_slam_component(independentComponents[i]->first, independentComponents[i]->second) ? 1 : 0;
+    }
+    catch(std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+  }
+
+  for(int i = 0; i < independentComponentCount; ++i)
+  {
+    if(!errors[i].empty()) throw std::runtime_error(errors[i]);
+    if(processed[i]) result.insert(independentComponents[i]->first);
+  }
+
+  // Finally, run the mirroring SLAM components sequentially, now that the poses they mirror are up to date.
+  for(size_t i = 0, size = mirroringComponents.size(); i < size; ++i)
+  {
+    if(run_slam_component(mirroringComponents[i]->first, mirroringComponents[i]->second)) result.insert(mirroringComponents[i]->first);
+  }
+
   return result;
 }
 
@@ -178,3 +260,15 @@ void MultiScenePipeline::load_models(const SLAMComponent_Ptr& slamComponent, con
   std::cout << "Loading models for " << slamComponent->get_scene_id() << " from: " << inputDir << std::endl;
   slamComponent->load_models(inputDir);
 }
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+bool MultiScenePipeline::run_slam_component(const std::string& sceneID, const SLAMComponent_Ptr& slamComponent)
+{
+  // Note: The timer for each scene is only ever used by one thread at a time, and the map of timers is not modified here.
+  AverageTimer& timer = MapUtil::lookup(m_sceneTimers, sceneID);
+  timer.start_nosync();
+  const bool frameProcessed = slamComponent->process_frame();
+  timer.stop_nosync();
+  return frameProcessed;
+}
@@ -12,6 +12,8 @@
 #include <spaint/pipelinecomponents/SLAMComponent.h>
 #include <spaint/pipelinecomponents/SmoothingComponent.h>
 
+#include <tvgutil/timing/AverageTimer.h>
+
 #include "Model.h"
 
 /**
@@ -19,6 +21,10 @@
  */
 class MultiScenePipeline
 {
+  //#################### TYPEDEFS ####################
+private:
+  typedef tvgutil::AverageTimer<boost::chrono::milliseconds> AverageTimer;
+
   //#################### ENUMERATIONS ####################
 public:
   /**
@@ -80,6 +86,17 @@ protected:
   /** The pipeline type. */
   std::string m_type;
 
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** Whether or not to print the average time taken to process a frame for each scene when the pipeline is destroyed. */
+  bool m_printTimers;
+
+  /** Whether or not to process the frames for the different scenes concurrently. */
+  bool m_processScenesInParallel;
+
+  /** The timers used to measure how long it takes to process a frame for each scene. */
+  std::map<std::string,AverageTimer> m_sceneTimers;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -164,7 +181,9 @@ public:
   /**
    * \brief Runs the main section of the multi-scene pipeline.
    *
-   * This involves processing the next frame (if any) for each individual scene.
+   * This involves processing the next frame (if any) for each individual scene. If the MultiScenePipeline.processScenesInParallel
+   * setting is enabled, the scenes are processed concurrently, apart from those that mirror the pose of another scene, which
+   * are processed afterwards. Either way, all of the scenes will have been processed by the time this function returns.
    *
    * \return  The scenes for a which a new frame was available.
    */
@@ -235,6 +254,19 @@ protected:
    * \throws std::runtime_error If the input directory does not contain at least a voxel model for a SLAM component.
    */
   void load_models(const spaint::SLAMComponent_Ptr& slamComponent, const std::string& inputDir);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs the specified SLAM component for a single frame, timing how long it takes.
+   *
+   * \note  This can safely be called concurrently for SLAM components that are reconstructing different scenes.
+   *
+   * \param sceneID       The ID of the scene being reconstructed by the SLAM component.
+   * \param slamComponent The SLAM component.
+   * \return              true, if a frame was processed, or false otherwise.
+   */
+  bool run_slam_component(const std::string& sceneID, const spaint::SLAMComponent_Ptr& slamComponent);
 };
 
 //#################### TYPEDEFS ####################
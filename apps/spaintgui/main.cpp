@@ -46,6 +46,7 @@
 
 #include <itmx/imagesources/AsyncImageSourceEngine.h>
 #include <itmx/imagesources/RemoteImageSourceEngine.h>
+#include <itmx/imagesources/SequenceFileImageSourceEngine.h>
 #ifdef WITH_ZED
 #include <itmx/imagesources/ZedImageSourceEngine.h>
 #endif
@@ -348,6 +349,59 @@ ImageSourceEngine *make_camera_subengine(const CommandLineArguments& args)
   return cameraSubengine;
 }
 
+/**
+ * \brief Makes an image source engine that reads the images for the specified disk sequence.
+ *
+ * \param args                The program's command-line arguments.
+ * \param i                   The index of the disk sequence.
+ * \param calibrationFilename The name of the calibration file to use if the sequence is stored as individual image files.
+ * \return                    The image source engine.
+ */
+ImageSourceEngine *make_disk_subengine(const CommandLineArguments& args, size_t i, const std::string& calibrationFilename)
+{
+  const std::string& depthImageMask = args.depthImageMasks[i];
+  const std::string& rgbImageMask = args.rgbImageMasks[i];
+
+  // If the sequence is stored in a sequence file, read it using a multi-threaded prefetching reader (the calibration is stored in the file).
+  if(SequenceFileReader::is_sequence_file(depthImageMask))
+  {
+    std::cout << "[spaint] Reading images from sequence file: " << depthImageMask << '\n';
+    return new SequenceFileImageSourceEngine(depthImageMask, args.initialFrameNumber, args.prefetchBufferCapacity);
+  }
+
+  // Otherwise, read the individual image files asynchronously.
+  std::cout << "[spaint] Reading images from disk: " << rgbImageMask << ' ' << depthImageMask << '\n';
+  ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+  return new AsyncImageSourceEngine(
+    new ImageFileReader<ImageMaskPathGenerator>(calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
+    args.prefetchBufferCapacity
+  );
+}
+
+/**
+ * \brief Makes a configuration for a tracker that reads the poses for the specified disk sequence from disk.
+ *
+ * \param args            The program's command-line arguments.
+ * \param i               The index of the disk sequence.
+ * \param initialFrameNo  The number of the first frame whose pose should be read.
+ * \return                The tracker configuration.
+ */
+std::string make_disk_tracker_config(const CommandLineArguments& args, size_t i, int initialFrameNo)
+{
+  const std::string& poseFileMask = args.poseFileMasks[i];
+  const std::string initialFrameNoString = boost::lexical_cast<std::string>(initialFrameNo);
+
+  // If the poses are stored in a sequence file, read them from there; otherwise, read them from the individual pose files.
+  if(SequenceFileReader::is_sequence_file(poseFileMask))
+  {
+    return "<tracker type='sequencefile'><params>file=" + poseFileMask + ",initialFrameNo=" + initialFrameNoString + "</params></tracker>";
+  }
+  else
+  {
+    return "<tracker type='infinitam'><params>type=file,mask=" + poseFileMask + ",initialFrameNo=" + initialFrameNoString + "</params></tracker>";
+  }
+}
+
 /**
  * \brief Makes the overall tracker configuration based on any tracker specifiers that were passed in on the command line.
  *
@@ -423,7 +477,7 @@ std::string make_tracker_config(CommandLineArguments& args)
         }
 
         // Specify the creation of a file-based tracker that reads poses from disk.
-        result += "<tracker type='infinitam'><params>type=file,mask=" + args.poseFileMasks[i] + ",initialFrameNo=" + boost::lexical_cast<std::string>(args.initialFrameNumber) + "</params></tracker>";
+        result += make_disk_tracker_config(args, i, args.initialFrameNumber);
 
         // If we're using global poses for the scenes, add the necessary closing tag for the global tracker.
         if(!globalPoses.empty()) result += "</tracker>";
@@ -503,13 +557,22 @@ bool postprocess_arguments(CommandLineArguments& args, const po::options_descrip
     // Determine the sequence type.
     const std::string sequenceType = i < args.sequenceTypes.size() ? args.sequenceTypes[i] : "sequence";
 
-    // Determine the directory containing the sequence and record it for later use.
+    // Determine the directory (or sequence file) containing the sequence and record it for later use.
     const std::string& sequenceSpecifier = args.sequenceSpecifiers[i];
-    const bf::path dir = bf::is_directory(sequenceSpecifier)
+    const bf::path dir = bf::is_directory(sequenceSpecifier) || bf::is_regular_file(sequenceSpecifier)
       ? sequenceSpecifier
       : find_subdir_from_executable(sequenceType + "s") / sequenceSpecifier;
     args.sequenceDirs.push_back(dir);
 
+    // If the sequence is stored in a sequence file, the file contains the depth images, RGB images and poses, so use it for all three masks.
+    if(SequenceFileReader::is_sequence_file(dir.string()))
+    {
+      args.depthImageMasks.push_back(dir.string());
+      args.poseFileMasks.push_back(dir.string());
+      args.rgbImageMasks.push_back(dir.string());
+      continue;
+    }
+
     // Try to figure out the format of the sequence stored in the directory (we only check the depth images, since the colour ones might be missing).
     const bool sevenScenesNaming = bf::is_regular_file(dir / "frame-000000.depth.png");
     const bool spaintNaming = bf::is_regular_file(dir / "depthm000000.pgm");
@@ -824,15 +887,7 @@ try
     // Add a subengine for each disk sequence specified.
     for(size_t i = 0; i < args.depthImageMasks.size(); ++i)
     {
-      const std::string& depthImageMask = args.depthImageMasks[i];
-      const std::string& rgbImageMask = args.rgbImageMasks[i];
-
-      std::cout << "[spaint] Reading images from disk: " << rgbImageMask << ' ' << depthImageMask << '\n';
-      ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
-      imageSourceEngine->addSubengine(new AsyncImageSourceEngine(
-        new ImageFileReader<ImageMaskPathGenerator>(args.calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
-        args.prefetchBufferCapacity
-      ));
+      imageSourceEngine->addSubengine(make_disk_subengine(args, i, args.calibrationFilename));
     }
 
     // If no model and no disk sequences were specified, or we want to switch to the camera once all the disk sequences finish, add a camera subengine.
@@ -910,19 +965,12 @@ try
     // Add an image source engine for each disk sequence specified.
     for(size_t i = 0; i < args.depthImageMasks.size(); ++i)
     {
-      const std::string& depthImageMask = args.depthImageMasks[i];
-      const std::string& rgbImageMask = args.rgbImageMasks[i];
-
       const bf::path calibrationPath = args.sequenceDirs[i] / "calib.txt";
       const std::string calibrationFilename = bf::exists(calibrationPath) ? calibrationPath.string() : args.calibrationFilename;
 
-      std::cout << "[spaint] Adding local agent for disk sequence: " << rgbImageMask << ' ' << depthImageMask << '\n';
-      ImageMaskPathGenerator pathGenerator(rgbImageMask.c_str(), depthImageMask.c_str());
+      std::cout << "[spaint] Adding local agent for disk sequence: " << args.rgbImageMasks[i] << ' ' << args.depthImageMasks[i] << '\n';
       CompositeImageSourceEngine_Ptr imageSourceEngine(new CompositeImageSourceEngine);
-      imageSourceEngine->addSubengine(new AsyncImageSourceEngine(
-        new ImageFileReader<ImageMaskPathGenerator>(calibrationFilename.c_str(), pathGenerator, args.initialFrameNumber),
-        args.prefetchBufferCapacity
-      ));
+      imageSourceEngine->addSubengine(make_disk_subengine(args, i, calibrationFilename));
 
       imageSourceEngines.push_back(imageSourceEngine);
     }
@@ -933,7 +981,7 @@ try
     {
       mappingModes.push_back(args.mapSurfels ? SLAMComponent::MAP_BOTH : SLAMComponent::MAP_VOXELS_ONLY);
       trackingModes.push_back(args.trackSurfels ? SLAMComponent::TRACK_SURFELS : SLAMComponent::TRACK_VOXELS);
-      trackerConfigs.push_back("<tracker type='infinitam'><params>type=file,mask=" + args.poseFileMasks[i] + "</params></tracker>");
+      trackerConfigs.push_back(make_disk_tracker_config(args, i, 0));
     }
 
     // Construct the pipeline itself.
@@ -956,7 +1004,8 @@ try
   {
     std::cout << "Setting mapping client for host '" << args.host << "' and port '" << args.port << "'\n";
     const pooled_queue::PoolEmptyStrategy poolEmptyStrategy = settings->get_first_value<pooled_queue::PoolEmptyStrategy>("MappingClient.poolEmptyStrategy", pooled_queue::PES_DISCARD);
-    pipeline->set_mapping_client(Model::get_world_scene_id(), MappingClient_Ptr(new MappingClient(args.host, args.port, poolEmptyStrategy)));
+    const int maxFramesInFlight = settings->get_first_value<int>("MappingClient.maxFramesInFlight", 1);
+    pipeline->set_mapping_client(Model::get_world_scene_id(), MappingClient_Ptr(new MappingClient(args.host, args.port, poolEmptyStrategy, maxFramesInFlight)));
   }
 
 #ifdef WITH_LEAP
@@ -4,6 +4,14 @@
  */
 
 #include "Renderer.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 using namespace ITMLib;
 using namespace ORUtils;
 using namespace orx;
@@ -187,6 +195,7 @@ private:
 
 Renderer::Renderer(const Model_CPtr& model, const SubwindowConfiguration_Ptr& subwindowConfiguration, const Vector2i& windowViewportSize)
 : m_model(model),
+  m_multiSceneRenderTime(0),
   m_subwindowConfiguration(subwindowConfiguration),
   m_supersamplingEnabled(false),
   m_windowViewportSize(windowViewportSize)
@@ -461,17 +470,18 @@ void Renderer::set_window(const SDL_Window_Ptr& window)
 void Renderer::generate_visualisation(const ORUChar4Image_Ptr& output, const SpaintVoxelScene_CPtr& voxelScene, const SpaintSurfelScene_CPtr& surfelScene,
                                       VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState, const Relocaliser_CPtr& relocaliser,
                                       const ORUtils::SE3Pose& pose, const View_CPtr& view, const ITMIntrinsics& intrinsics,
-                                      VisualisationGenerator::VisualisationType visualisationType, bool surfelFlag) const
+                                      VisualisationGenerator::VisualisationType visualisationType, bool surfelFlag,
+                                      const VisualisationGenerator_CPtr& visualisationGenerator) const
 {
-  VisualisationGenerator_CPtr visualisationGenerator = m_model->get_visualisation_generator();
+  VisualisationGenerator_CPtr generator = visualisationGenerator ? visualisationGenerator : m_model->get_visualisation_generator();
 
   switch(visualisationType)
   {
     case VisualisationGenerator::VT_INPUT_COLOUR:
-      visualisationGenerator->get_rgb_input(output, view);
+      generator->get_rgb_input(output, view);
       break;
     case VisualisationGenerator::VT_INPUT_DEPTH:
-      visualisationGenerator->get_depth_input(output, view);
+      generator->get_depth_input(output, view);
       break;
     case VisualisationGenerator::VT_RELOCALISER_LEAVES:
     case VisualisationGenerator::VT_RELOCALISER_POINTS:
@@ -494,8 +504,8 @@ void Renderer::generate_visualisation(const ORUChar4Image_Ptr& output, const Spa
     {
       if(view)
       {
-        if(surfelFlag) visualisationGenerator->generate_surfel_visualisation(output, surfelScene, pose, intrinsics, surfelRenderState, visualisationType);
-        else visualisationGenerator->generate_voxel_visualisation(output, voxelScene, pose, intrinsics, voxelRenderState, visualisationType, get_postprocessor());
+        if(surfelFlag) generator->generate_surfel_visualisation(output, surfelScene, pose, intrinsics, surfelRenderState, visualisationType);
+        else generator->generate_voxel_visualisation(output, voxelScene, pose, intrinsics, voxelRenderState, visualisationType, get_postprocessor());
       }
       else output->Clear();
 
@@ -522,110 +532,207 @@ const boost::optional<VisualisationGenerator::Postprocessor>& Renderer::get_post
   return postprocessor;
 }
 
+const std::vector<VisualisationGenerator_CPtr>& Renderer::get_worker_visualisation_generators(int workerCount) const
+{
+  if(m_workerVisualisationGenerators.empty()) m_workerVisualisationGenerators.push_back(m_model->get_visualisation_generator());
+
+  while(static_cast<int>(m_workerVisualisationGenerators.size()) < workerCount)
+  {
+    m_workerVisualisationGenerators.push_back(VisualisationGenerator_CPtr(new VisualisationGenerator(m_model->get_settings(), m_model->get_label_manager())));
+  }
+
+  return m_workerVisualisationGenerators;
+}
+
 void Renderer::render_all_reconstructed_scenes(const ORUtils::SE3Pose& primaryPose, const std::string& primarySceneID,
                                                VisualisationGenerator::VisualisationType primaryVisualisationType,
                                                VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState,
                                                const ITMIntrinsics& intrinsics, bool surfelFlag, const ORUChar4Image_Ptr& output) const
 {
-  static std::vector<ORUChar4Image_Ptr> colourImages;
-  static std::vector<ORFloatImage_Ptr> depthImages;
-  const std::vector<std::string> sceneIDs = m_model->get_scene_ids();
-  std::vector<VisualisationGenerator::VisualisationType> visualisationTypes(sceneIDs.size());
+  const std::vector<std::string>& sceneIDs = m_model->get_scene_ids();
+  const int sceneCount = static_cast<int>(sceneIDs.size());
+  std::vector<VisualisationGenerator::VisualisationType> visualisationTypes(sceneCount, primaryVisualisationType);
 
-  // Step 1: If the output image size has changed since the last time we rendered the scenes, arrange for the colour and depth images for the scenes to be reallocated.
-  if(!colourImages.empty() && colourImages[0]->noDims != output->noDims)
+  // Step 1: Look up the intermediate images and render states for the output image size, allocating more of them if new scenes have been added.
+  //         Since remote clients can request images of arbitrary sizes, we only keep the render targets for a limited number of sizes
+  //         (enough for every sub-window, plus one other), evicting those for the least recently used size when a new size is needed.
+  const std::pair<int,int> outputSize(output->noDims.x, output->noDims.y);
+  const size_t maxRenderTargetsCount = m_subwindowConfiguration->subwindow_count() + 1;
+  if(m_multiSceneRenderTargets.find(outputSize) == m_multiSceneRenderTargets.end() && m_multiSceneRenderTargets.size() >= maxRenderTargetsCount)
   {
-    colourImages.clear();
-    depthImages.clear();
+    std::map<std::pair<int,int>,MultiSceneRenderTargets>::iterator lruIt = m_multiSceneRenderTargets.begin();
+    for(std::map<std::pair<int,int>,MultiSceneRenderTargets>::iterator it = m_multiSceneRenderTargets.begin(), iend = m_multiSceneRenderTargets.end(); it != iend; ++it)
+    {
+      if(it->second.m_lastUseTime < lruIt->second.m_lastUseTime) lruIt = it;
+    }
+    m_multiSceneRenderTargets.erase(lruIt);
   }
 
-  // Step 2: Reallocate the colour and depth images for the scenes if needed.
-  while(colourImages.size() < sceneIDs.size())
+  MultiSceneRenderTargets& targets = m_multiSceneRenderTargets[outputSize];
+  targets.m_lastUseTime = m_multiSceneRenderTime++;
+  while(targets.m_colourImages.size() < sceneIDs.size())
   {
-    colourImages.push_back(ORUChar4Image_Ptr(new ORUChar4Image(output->noDims, true, true)));
-    depthImages.push_back(ORFloatImage_Ptr(new ORFloatImage(output->noDims, true, true)));
+    targets.m_colourImages.push_back(ORUChar4Image_Ptr(new ORUChar4Image(output->noDims, true, true)));
+    targets.m_depthImages.push_back(ORFloatImage_Ptr(new ORFloatImage(output->noDims, true, true)));
+    targets.m_surfelRenderStates.push_back(SurfelRenderState_Ptr());
+    targets.m_voxelRenderStates.push_back(VoxelRenderState_Ptr());
   }
 
-  // Step 3: Render colour and depth images for each scene, making sure to render the primary scene for the
-  //         subwindow last so that the raycast result ultimately contains the correct voxels for picking.
-  size_t primarySceneIdx = 0;
-  for(size_t i = 0; i < sceneIDs.size() + 1; ++i)
+  // Step 2: Determine the SLAM state, pose and visualisation type to use for each scene. A scene whose SLAM state is
+  //         left null here is one for which we have not yet started reconstruction, and so will not be rendered.
+  std::vector<SLAMState_CPtr> slamStates(sceneCount);
+  std::vector<Relocaliser_CPtr> relocalisers(sceneCount);
+  std::vector<SE3Pose> poses(sceneCount, primaryPose);
+  for(int i = 0; i < sceneCount; ++i)
   {
-    // Determine which scene we should be rendering in this iteration of the loop. This will be the scene
-    // indicated by the loop counter unless either (i) i < sceneIDs[i] && sceneIDs[i] == primarySceneID,
-    // in which case we record the array index of the primary scene for later and skip the loop iteration,
-    // or (ii) i == sceneIDs.size(), in which case we arrange for the primary scene to be rendered.
-    size_t sceneIdx;
-    if(i < sceneIDs.size())
-    {
-      if(sceneIDs[i] == primarySceneID)
-      {
-        primarySceneIdx = i;
-        continue;
-      }
-      else sceneIdx = i;
-    }
-    else sceneIdx = primarySceneIdx;
-
-    // Clear the colour and depth images for the chosen scene.
-    colourImages[sceneIdx]->Clear();
-    depthImages[sceneIdx]->Fill(-1.0f);
-
-    // If we have not yet started reconstruction for this scene, avoid rendering it and early out.
-    SLAMState_CPtr slamState = m_model->get_slam_state(sceneIDs[sceneIdx]);
+    SLAMState_CPtr slamState = m_model->get_slam_state(sceneIDs[i]);
     if(!slamState || !slamState->get_view()) continue;
 
-    // Determine the pose and visualisation type to use for the scene.
-    SE3Pose tempPose = primaryPose;
-    visualisationTypes[sceneIdx] = primaryVisualisationType;
+    slamStates[i] = slamState;
+    relocalisers[i] = m_model->get_relocaliser(sceneIDs[i]);
 
-    if(sceneIDs[sceneIdx] != primarySceneID)
+    if(sceneIDs[i] != primarySceneID)
     {
-      boost::optional<std::pair<SE3Pose,size_t> > result = m_model->get_collaborative_pose_optimiser()->try_get_relative_transform(primarySceneID, sceneIDs[sceneIdx]);
-      SE3Pose relativeTransform = result ? result->first : SE3Pose(static_cast<float>((sceneIdx + 1) * 2.0f), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-      if(!result || result->second < static_cast<size_t>(CollaborativePoseOptimiser::confidence_threshold())) visualisationTypes[sceneIdx] = VisualisationGenerator::VT_SCENE_SEMANTICPHONG;
+      boost::optional<std::pair<SE3Pose,size_t> > result = m_model->get_collaborative_pose_optimiser()->try_get_relative_transform(primarySceneID, sceneIDs[i]);
+      SE3Pose relativeTransform = result ? result->first : SE3Pose(static_cast<float>((i + 1) * 2.0f), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+      if(!result || result->second < static_cast<size_t>(CollaborativePoseOptimiser::confidence_threshold())) visualisationTypes[i] = VisualisationGenerator::VT_SCENE_SEMANTICPHONG;
 
       // ciTwi * wiTwj = ciTwj
-      tempPose.SetM(tempPose.GetM() * relativeTransform.GetM());
+      poses[i].SetM(poses[i].GetM() * relativeTransform.GetM());
     }
+  }
 
-    // Actually render the colour and depth images for the scene.
-    Relocaliser_CPtr relocaliser = m_model->get_relocaliser(sceneIDs[sceneIdx]);
-    generate_visualisation(
-      colourImages[sceneIdx], slamState->get_voxel_scene(), slamState->get_surfel_scene(),
-      voxelRenderState, surfelRenderState, relocaliser, tempPose, slamState->get_view(), intrinsics,
-      visualisationTypes[sceneIdx], surfelFlag
-    );
+  // Step 3: Render colour and depth images for each scene, using one worker thread per scene (where possible). Each worker uses its own
+  //         visualisation generator. The primary scene is rendered using the render states passed in by the caller, so that they end
+  //         up containing the correct voxels for picking, whilst the other scenes are rendered using render states that we cache.
+  //
+  //         Note that when running on the CPU, InfiniTAM's raycasting is itself parallelised using OpenMP, and since nested parallelism
+  //         is disabled by default, rendering the scenes in parallel would make each raycast single-threaded. For that reason, we only
+  //         render the scenes in parallel on the CPU if there are at least as many scenes as threads (in which case no thread is left
+  //         idle), and otherwise render them one at a time so that each raycast can use all of the threads. On the GPU, the threads
+  //         only launch the kernels, so we always render the scenes in parallel. Any exception thrown whilst rendering a scene is
+  //         rethrown once all of the scenes have been rendered, since it cannot propagate out of the loop.
+#ifdef WITH_OPENMP
+  const int maxThreadCount = omp_get_max_threads();
+  const bool renderInParallel = m_model->get_settings()->deviceType == DEVICE_CUDA || sceneCount >= maxThreadCount;
+  const int workerCount = renderInParallel ? std::max(1, std::min(maxThreadCount, sceneCount)) : 1;
+#else
+  const int workerCount = 1;
+#endif
+  const std::vector<VisualisationGenerator_CPtr>& visualisationGenerators = get_worker_visualisation_generators(workerCount);
 
-    m_model->get_visualisation_generator()->generate_depth_from_voxels(
-      depthImages[sceneIdx], slamState->get_voxel_scene(), tempPose, intrinsics,
-      voxelRenderState, DepthVisualiser::DT_ORTHOGRAPHIC
-    );
+  // Note: We make sure that the postprocessor (if any) has been constructed before starting the workers, since they will all need it.
+  get_postprocessor();
+
+  std::vector<std::string> errors(sceneCount);
 
-    // Make sure the depth image for the scene is available on the CPU so that it can be used for depth testing.
-    depthImages[sceneIdx]->UpdateHostFromDevice();
+#ifdef WITH_OPENMP
+  #pragma omp parallel for num_threads(workerCount) schedule(dynamic, 1) if(workerCount > 1)
+#endif
+  for(int i = 0; i < sceneCount; ++i)
+  {
+    try
+    {
+#ifdef WITH_OPENMP
+      const VisualisationGenerator_CPtr& visualisationGenerator = visualisationGenerators[omp_get_thread_num()];
+#else
+      const VisualisationGenerator_CPtr& visualisationGenerator = visualisationGenerators[0];
+#endif
+
+      // Clear the colour and depth images for the scene.
+      targets.m_colourImages[i]->Clear();
+      targets.m_depthImages[i]->Fill(-1.0f);
+
+      // If we have not yet started reconstruction for the scene, avoid rendering it.
+      const SLAMState_CPtr& slamState = slamStates[i];
+      if(!slamState) continue;
+
+      const bool isPrimaryScene = sceneIDs[i] == primarySceneID;
+      VoxelRenderState_Ptr& sceneVoxelRenderState = isPrimaryScene ? voxelRenderState : targets.m_voxelRenderStates[i];
+      SurfelRenderState_Ptr& sceneSurfelRenderState = isPrimaryScene ? surfelRenderState : targets.m_surfelRenderStates[i];
+
+      // Render the colour image for the scene.
+      const SpaintVoxelScene_CPtr voxelScene = slamState->get_voxel_scene();
+      generate_visualisation(
+        targets.m_colourImages[i], voxelScene, slamState->get_surfel_scene(), sceneVoxelRenderState, sceneSurfelRenderState,
+        relocalisers[i], poses[i], slamState->get_view(), intrinsics, visualisationTypes[i], surfelFlag, visualisationGenerator
+      );
+
+      // Render the depth image for the scene. If the colour image was produced by raycasting the voxel scene, the raycast result
+      // will still be in the voxel render state, so we can simply reuse it. Otherwise, we need to raycast the voxel scene here.
+      const VisualisationGenerator::VisualisationType visualisationType = visualisationTypes[i];
+      const bool haveVoxelRaycast = !surfelFlag && voxelScene && sceneVoxelRenderState &&
+                                    visualisationType != VisualisationGenerator::VT_INPUT_COLOUR && visualisationType != VisualisationGenerator::VT_INPUT_DEPTH &&
+                                    visualisationType != VisualisationGenerator::VT_RELOCALISER_LEAVES && visualisationType != VisualisationGenerator::VT_RELOCALISER_POINTS;
+      if(haveVoxelRaycast)
+      {
+        visualisationGenerator->generate_depth_from_raycast(targets.m_depthImages[i], poses[i], sceneVoxelRenderState, DepthVisualiser::DT_ORTHOGRAPHIC);
+      }
+      else
+      {
+        visualisationGenerator->generate_depth_from_voxels(
+          targets.m_depthImages[i], voxelScene, poses[i], intrinsics, sceneVoxelRenderState, DepthVisualiser::DT_ORTHOGRAPHIC
+        );
+      }
+
+      // Make sure the depth image for the scene is available on the CPU so that it can be used for depth testing.
+      targets.m_depthImages[i]->UpdateHostFromDevice();
+    }
+    catch(std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+  }
+
+  for(int i = 0; i < sceneCount; ++i)
+  {
+    if(!errors[i].empty()) throw std::runtime_error(errors[i]);
   }
 
   // Step 4: Combine the colour images for the different scenes using per-pixel depth testing to produce the final output image.
+  //         Scenes whose relative transforms are not yet known with confidence are pushed to the back by giving all of their
+  //         pixels an arbitrarily large depth. The scenes are merged in order into a z-buffer, so that ties are resolved in
+  //         favour of the scene with the lowest index. Each thread handles the same range of pixels for every scene, and the
+  //         inner loop is branch-free so that the compiler can vectorise it.
+  const int pixelCount = output->noDims.width * output->noDims.height;
+  targets.m_zBuffer.resize(pixelCount);
+  float *zBuffer = targets.m_zBuffer.empty() ? NULL : &targets.m_zBuffer[0];
+  Vector4u *outputPtr = output->GetData(MEMORYDEVICE_CPU);
   output->Clear();
-  for(int k = 0; k < output->noDims.width * output->noDims.height; ++k)
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel
+#endif
   {
-    float smallestDepth = static_cast<float>(INT_MAX);
-    for(size_t i = 0, size = colourImages.size(); i < size; ++i)
+#ifdef WITH_OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(int k = 0; k < pixelCount; ++k)
     {
+      zBuffer[k] = FLT_MAX;
+    }
+
+    for(int i = 0; i < sceneCount; ++i)
+    {
+      if(!slamStates[i]) continue;
+
+      const Vector4u *colourPtr = targets.m_colourImages[i]->GetData(MEMORYDEVICE_CPU);
+      const float *depthPtr = targets.m_depthImages[i]->GetData(MEMORYDEVICE_CPU);
+      const bool pushToBack = visualisationTypes[i] == VisualisationGenerator::VT_SCENE_SEMANTICPHONG;
       const float arbitrarilyLargeDepth = 100.0f;
-      float depth = depthImages[i]->GetData(MEMORYDEVICE_CPU)[k];
-      if(depth != -1.0f && visualisationTypes[i] == VisualisationGenerator::VT_SCENE_SEMANTICPHONG) depth = arbitrarilyLargeDepth;
-      if(depth != -1.0f && depth < smallestDepth)
+
+#ifdef WITH_OPENMP
+      #pragma omp for schedule(static)
+#endif
+      for(int k = 0; k < pixelCount; ++k)
       {
-        smallestDepth = depth;
-        output->GetData(MEMORYDEVICE_CPU)[k] = colourImages[i]->GetData(MEMORYDEVICE_CPU)[k];
+        const float depth = depthPtr[k] == -1.0f ? FLT_MAX : (pushToBack ? arbitrarilyLargeDepth : depthPtr[k]);
+        const bool closer = depth < zBuffer[k];
+        zBuffer[k] = closer ? depth : zBuffer[k];
+        outputPtr[k] = closer ? colourPtr[k] : outputPtr[k];
       }
     }
   }
-
-  // Step 5: Render a quad textured with the final output image.
-  render_image(output);
 }
 
 void Renderer::render_all_reconstructed_scenes(const ORUtils::SE3Pose& primaryPose, Subwindow& subwindow, int viewIndex) const
@@ -634,6 +741,9 @@ void Renderer::render_all_reconstructed_scenes(const ORUtils::SE3Pose& primaryPo
     primaryPose, subwindow.get_scene_id(), subwindow.get_type(), subwindow.get_voxel_render_state(viewIndex), subwindow.get_surfel_render_state(viewIndex),
     subwindow.get_camera_intrinsics(), subwindow.get_surfel_flag(), subwindow.get_image()
   );
+
+  // Render a quad textured with the final output image.
+  render_image(subwindow.get_image());
 }
 
 void Renderer::render_image(const ORUChar4Image_CPtr& image, bool useAlphaBlending) const
@@ -9,6 +9,9 @@
 // Prevent SDL from trying to define M_PI.
 #define HAVE_M_PI
 
+#include <map>
+#include <vector>
+
 #include <SDL.h>
 
 #include <spaint/ogl/WrappedGL.h>
@@ -32,6 +35,32 @@ protected:
   typedef boost::shared_ptr<void> SDL_GLContext_Ptr;
   typedef boost::shared_ptr<SDL_Window> SDL_Window_Ptr;
 
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the intermediate images and render states used to render all of the reconstructed scenes at a particular image size.
+   */
+  struct MultiSceneRenderTargets
+  {
+    /** The colour images for the scenes. */
+    std::vector<ORUChar4Image_Ptr> m_colourImages;
+
+    /** The depth images for the scenes (a depth of -1 denotes a pixel at which a scene was not hit). */
+    std::vector<ORFloatImage_Ptr> m_depthImages;
+
+    /** The time at which the render targets were last used (used to decide which render targets to evict). */
+    size_t m_lastUseTime;
+
+    /** The surfel render states for the scenes (those for the primary scene are supplied by the caller instead). */
+    std::vector<SurfelRenderState_Ptr> m_surfelRenderStates;
+
+    /** The voxel render states for the scenes (those for the primary scene are supplied by the caller instead). */
+    std::vector<VoxelRenderState_Ptr> m_voxelRenderStates;
+
+    /** The z-buffer used when compositing the colour images for the scenes. */
+    std::vector<float> m_zBuffer;
+  };
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The OpenGL context for the window. */
@@ -43,6 +72,15 @@ private:
   /** The spaint model. */
   Model_CPtr m_model;
 
+  /**
+   * The intermediate images and render states used to render all of the reconstructed scenes, keyed by the size of the output image.
+   * Only the most recently used sizes are kept (see render_all_reconstructed_scenes).
+   */
+  mutable std::map<std::pair<int,int>,MultiSceneRenderTargets> m_multiSceneRenderTargets;
+
+  /** The number of times all of the reconstructed scenes have been rendered (used to timestamp the uses of the multi-scene render targets). */
+  mutable size_t m_multiSceneRenderTime;
+
   /** The sub-window configuration to use for visualising the scene. */
   SubwindowConfiguration_Ptr m_subwindowConfiguration;
 
@@ -58,6 +96,9 @@ private:
   /** The size of the window's viewport. */
   Vector2i m_windowViewportSize;
 
+  /** The visualisation generators used by the worker threads when rendering all of the reconstructed scenes (one per thread). */
+  mutable std::vector<spaint::VisualisationGenerator_CPtr> m_workerVisualisationGenerators;
+
   //#################### CONSTRUCTORS ####################
 protected:
   /**
@@ -233,22 +274,24 @@ private:
   /**
    * \brief Generates a visualisation of the scene.
    *
-   * \param output            The location into which to put the output image.
-   * \param voxelScene        The voxel version of the scene to visualise.
-   * \param surfelScene       The surfel version of the scene to visualise.
-   * \param voxelRenderState  The voxel render state to use for intermediate storage (if relevant).
-   * \param surfelRenderState The surfel render state to use for intermediate storage (if relevant).
-   * \param relocaliser       The relocaliser for the scene to visualise (used when visualising the relocaliser's internals).
-   * \param pose              The pose from which to visualise the scene (if relevant).
-   * \param view              The current view of the scene.
-   * \param intrinsics        The intrinsics to use when rendering synthetic visualisations of the scene.
-   * \param visualisationType The type of visualisation to generate.
-   * \param surfelFlag        Whether or not to render a surfel visualisation rather than a voxel one.
+   * \param output                  The location into which to put the output image.
+   * \param voxelScene              The voxel version of the scene to visualise.
+   * \param surfelScene             The surfel version of the scene to visualise.
+   * \param voxelRenderState        The voxel render state to use for intermediate storage (if relevant).
+   * \param surfelRenderState       The surfel render state to use for intermediate storage (if relevant).
+   * \param relocaliser             The relocaliser for the scene to visualise (used when visualising the relocaliser's internals).
+   * \param pose                    The pose from which to visualise the scene (if relevant).
+   * \param view                    The current view of the scene.
+   * \param intrinsics              The intrinsics to use when rendering synthetic visualisations of the scene.
+   * \param visualisationType       The type of visualisation to generate.
+   * \param surfelFlag              Whether or not to render a surfel visualisation rather than a voxel one.
+   * \param visualisationGenerator  The visualisation generator to use (if null, the model's visualisation generator will be used).
    */
   void generate_visualisation(const ORUChar4Image_Ptr& output, const spaint::SpaintVoxelScene_CPtr& voxelScene, const spaint::SpaintSurfelScene_CPtr& surfelScene,
                               VoxelRenderState_Ptr& voxelRenderState, SurfelRenderState_Ptr& surfelRenderState, const orx::Relocaliser_CPtr& relocaliser,
                               const ORUtils::SE3Pose& pose, const View_CPtr& view, const ITMLib::ITMIntrinsics& intrinsics,
-                              spaint::VisualisationGenerator::VisualisationType visualisationType, bool surfelFlag) const;
+                              spaint::VisualisationGenerator::VisualisationType visualisationType, bool surfelFlag,
+                              const spaint::VisualisationGenerator_CPtr& visualisationGenerator = spaint::VisualisationGenerator_CPtr()) const;
 
   /**
    * \brief Gets the function (if any) with which to postprocess scene visualisations.
@@ -257,9 +300,25 @@ private:
    */
   const boost::optional<spaint::VisualisationGenerator::Postprocessor>& get_postprocessor() const;
 
+  /**
+   * \brief Gets the visualisation generators to be used by the worker threads when rendering all of the reconstructed scenes.
+   *
+   * The generator for the first worker (i.e. the calling thread) is the model's own visualisation generator. Each other worker has
+   * its own generator, since the visualisation engines contain scratch memory that cannot safely be shared between threads.
+   *
+   * \param workerCount The number of worker threads.
+   * \return            The visualisation generators for the worker threads (at least workerCount of them).
+   */
+  const std::vector<spaint::VisualisationGenerator_CPtr>& get_worker_visualisation_generators(int workerCount) const;
+
   /**
    * \brief Renders all the reconstructed scenes into an image, with appropriate depth testing.
    *
+   * Each scene is raycast only once (to produce both its colour and depth images). When OpenMP is available, the scenes are
+   * rendered concurrently on the GPU, but on the CPU only when there are at least as many scenes as threads (since otherwise
+   * it is better to let each raycast use all of the threads). No OpenGL calls are made, so this can also be used to render
+   * images for remote clients.
+   *
    * \param primaryPose               The camera pose in the primary scene.
    * \param primarySceneID            The ID of the primary scene.
    * \param primaryVisualisationType  The type of visualisation to use for the primary scene.
@@ -58,11 +58,16 @@ protected:
   /**
    * \brief Evaluates the learner on the specified split of examples.
    *
-   * \param examples  The examples on which to evaluate the learner.
-   * \param split     The way in which the examples should be split into training and validation sets.
-   * \return          The results of evaluating the learner on the specified split.
+   * \note  The splits may be evaluated concurrently, so implementations must not modify any shared state. Any randomness
+   *        should be derived from the split index, so that the results do not depend on the order in which the splits
+   *        happen to be evaluated.
+   *
+   * \param examples    The examples on which to evaluate the learner (shared read-only between the splits).
+   * \param split       The way in which the examples should be split into training and validation sets.
+   * \param splitIndex  The index of the split.
+   * \return            The results of evaluating the learner on the specified split.
    */
-  virtual Result evaluate_on_split(const std::vector<Example_CPtr>& examples, const SplitGenerator::Split& split) const = 0;
+  virtual Result evaluate_on_split(const std::vector<Example_CPtr>& examples, const SplitGenerator::Split& split, size_t splitIndex) const = 0;
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -74,21 +79,20 @@ public:
    */
   Result evaluate(const std::vector<Example_CPtr>& examples) const
   {
-    std::vector<Result> results;
-    std::vector<SplitGenerator::Split> splits = m_splitGenerator->generate_splits(examples.size());
-    int size = static_cast<int>(splits.size());
+    const std::vector<SplitGenerator::Split> splits = m_splitGenerator->generate_splits(examples.size());
+    const int size = static_cast<int>(splits.size());
+
+    // Evaluate the learner on the splits in parallel. Each split writes its result into its own slot, so that the
+    // results are always averaged in split order, however the splits happen to be scheduled. Since the time taken
+    // to evaluate each split can vary significantly, the splits are scheduled dynamically.
+    std::vector<Result> results(size);
 
 #ifdef WITH_OPENMP
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(dynamic)
 #endif
     for(int i = 0; i < size; ++i)
     {
-      Result evaluationResult = evaluate_on_split(examples, splits[i]);
-
-#ifdef WITH_OPENMP
-      #pragma omp critical
-#endif
-      results.push_back(evaluationResult);
+      results[i] = evaluate_on_split(examples, splits[i], static_cast<size_t>(i));
     }
 
     return average_results(results);
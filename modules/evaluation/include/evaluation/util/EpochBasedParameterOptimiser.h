@@ -11,55 +11,65 @@
 
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 
-#include "../core/ParamSetUtil.h"
+#include "MemoisedCostEvaluator.h"
 
 namespace evaluation {
 
 /**
  * \brief An instance of a class deriving from this one can be used to try to find (over a series of optimisation epochs) a parameter set with as low a cost as possible.
+ *
+ * The epochs are independent of each other, and are run in parallel if more than one evaluation of the cost function is allowed to be in
+ * progress at once. All costs are obtained via a memoised cost evaluator, so no parameter set is ever evaluated more than once (either within
+ * a single search, or across searches if a cost cache file is specified). Since each epoch uses its own random number generator (seeded in a
+ * deterministic way), the result of the optimisation does not depend on the number of evaluations that are allowed to run at once.
  */
 class EpochBasedParameterOptimiser
 {
   //#################### TYPEDEFS ####################
 protected:
-  typedef boost::function<float(const ParamSet&)> CostFunction;
+  typedef MemoisedCostEvaluator::CostFunction CostFunction;
 
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The cost function to use to evaluate the different parameter sets. */
-  CostFunction m_costFunction;
+  /** The memoised evaluator to use to compute the costs of the different parameter sets. */
+  MemoisedCostEvaluator_Ptr m_costEvaluator;
 
   /** The number of epochs for which optimisation should be run. */
   size_t m_epochCount;
 
+  /** A random number generator (used to generate the initial parameter value indices and random number generator seeds for the epochs). */
+  mutable tvgutil::RandomNumberGenerator m_rng;
+
   //#################### PROTECTED VARIABLES ####################
 protected:
   /** A list of the possible values for each parameter (e.g. [("A", [1,2]), ("B", [3,4])]). */
   std::vector<std::pair<std::string,std::vector<boost::spirit::hold_any> > > m_paramValues;
 
-  /** A random number generator. */
-  mutable tvgutil::RandomNumberGenerator m_rng;
-
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs an epoch-based parameter optimiser.
    *
-   * \param costFunction  The cost function to use to evaluate the different parameter sets.
-   * \param epochCount    The number of epochs for which coordinate descent should be run.
-   * \param seed          The seed for the random number generator.
+   * \param costFunction              The cost function to use to evaluate the different parameter sets.
+   * \param epochCount                The number of epochs for which coordinate descent should be run.
+   * \param seed                      The seed for the random number generator.
+   * \param maxConcurrentEvaluations  The maximum number of evaluations of the cost function that may be in progress at any one time.
+   * \param costCacheFilename         The name of the file (if any) in which to persist the costs of the parameter sets evaluated, or the empty string otherwise.
    */
-  EpochBasedParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed);
+  EpochBasedParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed, size_t maxConcurrentEvaluations = 1, const std::string& costCacheFilename = "");
 
   //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
 private:
   /**
    * \brief Optimises an initial set of parameter value indices in order to minimise the associated cost.
    *
+   * \note  This may be called concurrently for different epochs.
+   *
    * \param initialValueIndices The initial set of parameter value indices.
+   * \param rng                 A random number generator that is specific to the current epoch.
    * \return                    An optimised set of parameter value indices and the associated cost.
    */
-  virtual std::pair<std::vector<size_t>,float> optimise_value_indices(const std::vector<size_t>& initialValueIndices) const = 0;
+  virtual std::pair<std::vector<size_t>,float> optimise_value_indices(const std::vector<size_t>& initialValueIndices, tvgutil::RandomNumberGenerator& rng) const = 0;
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -89,8 +99,10 @@ public:
   /**
    * \brief Performs an epoch-based optimisation with random restarts to try to find a parameter set with as low a cost as possible.
    *
-   * \param bestCost    A place in which to return the cost associated with the best parameter set found (may be NULL).
-   * \return            The best parameter set found during the optimisation.
+   * \param bestCost            A place in which to return the cost associated with the best parameter set found (may be NULL).
+   * \return                    The best parameter set found during the optimisation.
+   * \throws std::runtime_error If any epoch fails, or if none of the parameter sets evaluated produced a result (i.e. had a cost
+   *                            lower than the maximum possible cost).
    */
   ParamSet optimise_for_parameters(float *bestCost = NULL) const;
 
@@ -105,6 +117,14 @@ protected:
    */
   float compute_cost(const std::vector<size_t>& valueIndices) const;
 
+  /**
+   * \brief Computes the costs associated with several different settings of the parameters being optimised (in parallel where possible).
+   *
+   * \param valueIndicesList  A list of sets of parameter value indices, each denoting particular settings for the parameters.
+   * \return                  The costs associated with setting the parameters being optimised to the denoted values (in the same order).
+   */
+  std::vector<float> compute_costs(const std::vector<std::vector<size_t> >& valueIndicesList) const;
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
@@ -121,6 +141,18 @@ private:
    * \return              The corresponding parameter set.
    */
   ParamSet make_param_set(const std::vector<size_t>& valueIndices) const;
+
+  /**
+   * \brief Repeatedly claims the next unclaimed epoch and runs it, until all of the epochs have been claimed.
+   *
+   * \param initialValueIndices The initial sets of parameter value indices for the epochs.
+   * \param seeds               The seeds for the epoch-specific random number generators.
+   * \param nextEpoch           The index of the next unclaimed epoch.
+   * \param results             The optimised sets of parameter value indices and the associated costs for the epochs (written by this function).
+   * \param errors              The error messages (if any) produced by the epochs (written by this function).
+   */
+  void run_epoch_worker(const std::vector<std::vector<size_t> >& initialValueIndices, const std::vector<unsigned int>& seeds, boost::atomic<size_t>& nextEpoch,
+                        std::vector<std::pair<std::vector<size_t>,float> >& results, std::vector<std::string>& errors) const;
 };
 
 }
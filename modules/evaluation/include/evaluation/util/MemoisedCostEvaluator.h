@@ -0,0 +1,155 @@
+/**
+ * evaluation: MemoisedCostEvaluator.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_EVALUATION_MEMOISEDCOSTEVALUATOR
+#define H_EVALUATION_MEMOISEDCOSTEVALUATOR
+
+#include <set>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "../core/ParamSetUtil.h"
+
+namespace evaluation {
+
+/**
+ * \brief An instance of this class can be used to evaluate a cost function on parameter sets, possibly in parallel, remembering
+ *        the cost of each parameter set it has seen so that no parameter set ever needs to be evaluated more than once.
+ *
+ * The costs are keyed by the string representations of the parameter sets (since a parameter set is a sorted map, these are
+ * canonical). If a cache file is specified, any costs it contains are loaded on construction, and each new cost is appended
+ * to it as soon as it has been computed, so that an interrupted search can later be resumed without repeating any work. The
+ * exception is the maximum possible cost, which denotes an evaluation that produced no result (e.g. because it timed out):
+ * it is remembered for the lifetime of the evaluator, but not persisted, so that a resumed search will try it again.
+ *
+ * The evaluator is thread-safe. At most a specified number of evaluations of the underlying cost function will be in progress
+ * at any one time, however many threads are requesting costs. If several threads request the cost of the same parameter set at
+ * once, only one of them will evaluate it, and the others will wait for the result.
+ */
+class MemoisedCostEvaluator
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef boost::function<float(const ParamSet&)> CostFunction;
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of evaluations of the cost function that are currently in progress. */
+  size_t m_activeEvaluationCount;
+
+  /** The name of the file (if any) in which to persist the costs, or the empty string otherwise. */
+  std::string m_cacheFilename;
+
+  /** The cost function. */
+  CostFunction m_costFunction;
+
+  /** The costs that are currently known, keyed by the string representations of their parameter sets. */
+  std::map<std::string,float> m_costs;
+
+  /** A condition variable used to wait for an evaluation of the cost function to finish. */
+  boost::condition_variable m_evaluationFinished;
+
+  /** The maximum number of evaluations of the cost function that may be in progress at any one time. */
+  size_t m_maxConcurrentEvaluations;
+
+  /** The synchronisation mutex. */
+  mutable boost::mutex m_mutex;
+
+  /** The string representations of the parameter sets whose costs are currently being evaluated. */
+  std::set<std::string> m_pendingKeys;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a memoised cost evaluator.
+   *
+   * \param costFunction              The cost function to evaluate.
+   * \param maxConcurrentEvaluations  The maximum number of evaluations of the cost function that may be in progress at any one time.
+   * \param cacheFilename             The name of the file (if any) in which to persist the costs, or the empty string otherwise.
+   */
+  explicit MemoisedCostEvaluator(const CostFunction& costFunction, size_t maxConcurrentEvaluations = 1, const std::string& cacheFilename = "");
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  MemoisedCostEvaluator(const MemoisedCostEvaluator&);
+  MemoisedCostEvaluator& operator=(const MemoisedCostEvaluator&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of costs that are currently known.
+   *
+   * \return  The number of costs that are currently known.
+   */
+  size_t cached_cost_count() const;
+
+  /**
+   * \brief Evaluates the cost function on the specified parameter set (if its cost is not already known).
+   *
+   * \note  This blocks until the cost is available.
+   *
+   * \param paramSet  The parameter set.
+   * \return          The cost of the parameter set.
+   */
+  float evaluate(const ParamSet& paramSet);
+
+  /**
+   * \brief Evaluates the cost function on the specified parameter sets (if their costs are not already known), in parallel where possible.
+   *
+   * \note  This blocks until all of the costs are available.
+   *
+   * \param paramSets The parameter sets.
+   * \return          The costs of the parameter sets (in the same order as the parameter sets themselves).
+   * \throws std::runtime_error If any of the evaluations of the cost function throws.
+   */
+  std::vector<float> evaluate(const std::vector<ParamSet>& paramSets);
+
+  /**
+   * \brief Gets the maximum number of evaluations of the cost function that may be in progress at any one time.
+   *
+   * \return  The maximum number of evaluations of the cost function that may be in progress at any one time.
+   */
+  size_t get_max_concurrent_evaluations() const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Loads any costs that have been persisted in the cache file.
+   */
+  void load_costs();
+
+  /**
+   * \brief Appends a newly-computed cost to the cache file (if any).
+   *
+   * \pre  The caller must hold the synchronisation mutex.
+   *
+   * \param key   The string representation of the parameter set whose cost has been computed.
+   * \param cost  The cost.
+   */
+  void persist_cost(const std::string& key, float cost) const;
+
+  /**
+   * \brief Repeatedly claims the next unclaimed parameter set in a batch and evaluates its cost, until the whole batch has been claimed.
+   *
+   * \param paramSets The parameter sets in the batch.
+   * \param nextIndex The index of the next unclaimed parameter set in the batch.
+   * \param costs     The costs of the parameter sets in the batch (written by this function).
+   * \param errors    The error messages (if any) produced when evaluating the costs of the parameter sets in the batch (written by this function).
+   */
+  void run_evaluation_worker(const std::vector<ParamSet>& paramSets, boost::atomic<size_t>& nextIndex, std::vector<float>& costs, std::vector<std::string>& errors);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<MemoisedCostEvaluator> MemoisedCostEvaluator_Ptr;
+
+}
+
+#endif
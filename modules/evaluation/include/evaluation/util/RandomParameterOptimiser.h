@@ -20,16 +20,18 @@ public:
   /**
    * \brief Constructs a random parameter optimiser.
    *
-   * \param costFunction  The cost function to use to evaluate the different parameter sets.
-   * \param epochCount    The number of epochs for which the random parameter generation should be run.
-   * \param seed          The seed for the random number generator.
+   * \param costFunction              The cost function to use to evaluate the different parameter sets.
+   * \param epochCount                The number of epochs for which the random parameter generation should be run.
+   * \param seed                      The seed for the random number generator.
+   * \param maxConcurrentEvaluations  The maximum number of evaluations of the cost function that may be in progress at any one time.
+   * \param costCacheFilename         The name of the file (if any) in which to persist the costs of the parameter sets evaluated, or the empty string otherwise.
    */
-  RandomParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed);
+  RandomParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed, size_t maxConcurrentEvaluations = 1, const std::string& costCacheFilename = "");
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /** Override */
-  virtual std::pair<std::vector<size_t>,float> optimise_value_indices(const std::vector<size_t>& initialValueIndices) const;
+  virtual std::pair<std::vector<size_t>,float> optimise_value_indices(const std::vector<size_t>& initialValueIndices, tvgutil::RandomNumberGenerator& rng) const;
 };
 
 }
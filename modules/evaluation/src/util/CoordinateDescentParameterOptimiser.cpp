@@ -9,13 +9,14 @@ namespace evaluation {
 
 //#################### CONSTRUCTORS ####################
 
-CoordinateDescentParameterOptimiser::CoordinateDescentParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed)
-: EpochBasedParameterOptimiser(costFunction, epochCount, seed)
+CoordinateDescentParameterOptimiser::CoordinateDescentParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed,
+                                                                         size_t maxConcurrentEvaluations, const std::string& costCacheFilename)
+: EpochBasedParameterOptimiser(costFunction, epochCount, seed, maxConcurrentEvaluations, costCacheFilename)
 {}
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-std::pair<std::vector<size_t>,float> CoordinateDescentParameterOptimiser::optimise_value_indices(const std::vector<size_t>& initialValueIndices) const
+std::pair<std::vector<size_t>,float> CoordinateDescentParameterOptimiser::optimise_value_indices(const std::vector<size_t>& initialValueIndices, tvgutil::RandomNumberGenerator& rng) const
 {
   // Invariant: currentCost = compute_cost(currentValueIndices)
 
@@ -27,7 +28,7 @@ std::pair<std::vector<size_t>,float> CoordinateDescentParameterOptimiser::optimi
 
   // Pick the first parameter to optimise. The parameters will be optimised one-by-one, starting from this parameter.
   size_t paramCount = m_paramValues.size();
-  int startingParamIndex = m_rng.generate_int_from_uniform(0, static_cast<int>(paramCount) - 1);
+  int startingParamIndex = rng.generate_int_from_uniform(0, static_cast<int>(paramCount) - 1);
 
   // For each parameter, starting from the one just chosen:
   for(size_t k = 0; k < paramCount; ++k)
@@ -41,20 +42,30 @@ std::pair<std::vector<size_t>,float> CoordinateDescentParameterOptimiser::optimi
     // Record the parameter value for which we already have the corresponding cost so that we can avoid re-evaluating it.
     size_t originalValueIndex = currentValueIndices[paramIndex];
 
-    // For each possible new value that the parameter can take:
-    std::vector<size_t> newValueIndices = currentValueIndices;
+    // Make a list of all the possible new values that the parameter can take, and compute their costs (in parallel where possible).
+    // Note that the new values only differ from the current values in the parameter being optimised, so their costs are independent.
+    std::vector<size_t> newValues;
+    std::vector<std::vector<size_t> > newValueIndicesList;
     for(size_t valueIndex = 0; valueIndex < valueCount; ++valueIndex)
     {
       // If we already know that the cost for the new value is no better than the cost for the current value, skip it.
       if(valueIndex == originalValueIndex) continue;
 
-      // Compute the cost for the new value. If it's better than the cost for the current value, update the current value.
+      std::vector<size_t> newValueIndices = currentValueIndices;
       newValueIndices[paramIndex] = valueIndex;
-      float newCost = compute_cost(newValueIndices);
-      if(newCost < currentCost)
+      newValues.push_back(valueIndex);
+      newValueIndicesList.push_back(newValueIndices);
+    }
+
+    std::vector<float> newCosts = compute_costs(newValueIndicesList);
+
+    // For each possible new value, if its cost is better than the cost for the current value, update the current value.
+    for(size_t i = 0, size = newValues.size(); i < size; ++i)
+    {
+      if(newCosts[i] < currentCost)
       {
-        currentValueIndices[paramIndex] = valueIndex;
-        currentCost = newCost;
+        currentValueIndices[paramIndex] = newValues[i];
+        currentCost = newCosts[i];
       }
     }
 
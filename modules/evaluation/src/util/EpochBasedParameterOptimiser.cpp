@@ -5,8 +5,12 @@
 
 #include "util/EpochBasedParameterOptimiser.h"
 
+#include <algorithm>
+#include <climits>
 #include <limits>
+#include <stdexcept>
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 using boost::spirit::hold_any;
 
@@ -14,8 +18,11 @@ namespace evaluation {
 
 //#################### CONSTRUCTORS ####################
 
-EpochBasedParameterOptimiser::EpochBasedParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed)
-: m_costFunction(costFunction), m_epochCount(epochCount), m_rng(seed)
+EpochBasedParameterOptimiser::EpochBasedParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed,
+                                                           size_t maxConcurrentEvaluations, const std::string& costCacheFilename)
+: m_costEvaluator(new MemoisedCostEvaluator(costFunction, maxConcurrentEvaluations, costCacheFilename)),
+  m_epochCount(epochCount),
+  m_rng(seed)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -28,28 +35,62 @@ EpochBasedParameterOptimiser& EpochBasedParameterOptimiser::add_param(const std:
 
 ParamSet EpochBasedParameterOptimiser::optimise_for_parameters(float *bestCost) const
 {
-  std::vector<size_t> bestValueIndicesAllTime;
-  float bestCostAllTime = std::numeric_limits<float>::max();
+  // Randomly generate an initial set of parameter value indices and a random number generator seed for each epoch. We do this
+  // up-front (rather than as each epoch starts) so that the epochs can be run in parallel without affecting the results.
+  std::vector<std::vector<size_t> > initialValueIndices(m_epochCount);
+  std::vector<unsigned int> seeds(m_epochCount);
+  for(size_t i = 0; i < m_epochCount; ++i)
+  {
+    initialValueIndices[i] = generate_random_value_indices();
+    seeds[i] = static_cast<unsigned int>(m_rng.generate_int_from_uniform(0, INT_MAX));
+  }
 
-  // For each epoch:
+  // Run the epochs, using as many worker threads as can usefully run at once. If only a single worker
+  // is needed, we avoid the overhead of starting a thread and just use this one.
+  std::vector<std::pair<std::vector<size_t>,float> > results(m_epochCount);
+  std::vector<std::string> errors(m_epochCount);
+  const size_t workerCount = std::min(m_epochCount, m_costEvaluator->get_max_concurrent_evaluations());
+  boost::atomic<size_t> nextEpoch(0);
+  if(workerCount <= 1)
+  {
+    run_epoch_worker(initialValueIndices, seeds, nextEpoch, results, errors);
+  }
+  else
+  {
+    boost::thread_group workers;
+    for(size_t i = 0; i < workerCount; ++i)
+    {
+      workers.create_thread(boost::bind(&EpochBasedParameterOptimiser::run_epoch_worker, this, boost::cref(initialValueIndices), boost::cref(seeds), boost::ref(nextEpoch), boost::ref(results), boost::ref(errors)));
+    }
+    workers.join_all();
+  }
+
+  // If any epoch failed, throw.
   for(size_t i = 0; i < m_epochCount; ++i)
   {
-    // Randomly generate an initial set of parameter value indices.
-    std::vector<size_t> initialValueIndices = generate_random_value_indices();
+    if(!errors[i].empty()) throw std::runtime_error(errors[i]);
+  }
 
-    // Optimise the initial set of parameter value indices.
-    std::vector<size_t> optimisedValueIndices;
-    float optimisedCost;
-    boost::tie(optimisedValueIndices, optimisedCost) = optimise_value_indices(initialValueIndices);
+  if(m_epochCount == 0) throw std::runtime_error("Error: Cannot optimise the parameters without running at least one epoch");
 
-    // If the optimised cost is the best we've seen so far, update the best cost and best parameter value indices.
-    if(optimisedCost < bestCostAllTime)
+  // Find the best result over all of the epochs. Ties are broken in favour of the earliest epoch.
+  std::vector<size_t> bestValueIndicesAllTime = results[0].first;
+  float bestCostAllTime = results[0].second;
+  for(size_t i = 1; i < m_epochCount; ++i)
+  {
+    if(results[i].second < bestCostAllTime)
     {
-      bestCostAllTime = optimisedCost;
-      bestValueIndicesAllTime = optimisedValueIndices;
+      bestCostAllTime = results[i].second;
+      bestValueIndicesAllTime = results[i].first;
     }
   }
 
+  // If none of the parameter sets we tried produced a result (e.g. because every evaluation exceeded its time limit), throw.
+  if(bestCostAllTime == std::numeric_limits<float>::max())
+  {
+    throw std::runtime_error("Error: None of the parameter sets evaluated produced a result (did every evaluation time out?)");
+  }
+
   // Return the best parameters found and (optionally) the corresponding cost.
   if(bestCost) *bestCost = bestCostAllTime;
   return make_param_set(bestValueIndicesAllTime);
@@ -59,7 +100,19 @@ ParamSet EpochBasedParameterOptimiser::optimise_for_parameters(float *bestCost)
 
 float EpochBasedParameterOptimiser::compute_cost(const std::vector<size_t>& valueIndices) const
 {
-  return m_costFunction(make_param_set(valueIndices));
+  return m_costEvaluator->evaluate(make_param_set(valueIndices));
+}
+
+std::vector<float> EpochBasedParameterOptimiser::compute_costs(const std::vector<std::vector<size_t> >& valueIndicesList) const
+{
+  std::vector<ParamSet> paramSets;
+  paramSets.reserve(valueIndicesList.size());
+  for(size_t i = 0, size = valueIndicesList.size(); i < size; ++i)
+  {
+    paramSets.push_back(make_param_set(valueIndicesList[i]));
+  }
+
+  return m_costEvaluator->evaluate(paramSets);
 }
 
 std::vector<size_t> EpochBasedParameterOptimiser::generate_random_value_indices() const
@@ -84,4 +137,21 @@ ParamSet EpochBasedParameterOptimiser::make_param_set(const std::vector<size_t>&
   return paramSet;
 }
 
+void EpochBasedParameterOptimiser::run_epoch_worker(const std::vector<std::vector<size_t> >& initialValueIndices, const std::vector<unsigned int>& seeds, boost::atomic<size_t>& nextEpoch,
+                                                    std::vector<std::pair<std::vector<size_t>,float> >& results, std::vector<std::string>& errors) const
+{
+  for(size_t i = nextEpoch++, size = initialValueIndices.size(); i < size; i = nextEpoch++)
+  {
+    try
+    {
+      tvgutil::RandomNumberGenerator rng(seeds[i]);
+      results[i] = optimise_value_indices(initialValueIndices[i], rng);
+    }
+    catch(std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+  }
+}
+
 }
@@ -0,0 +1,185 @@
+/**
+ * evaluation: MemoisedCostEvaluator.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "util/MemoisedCostEvaluator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+namespace evaluation {
+
+//#################### CONSTRUCTORS ####################
+
+MemoisedCostEvaluator::MemoisedCostEvaluator(const CostFunction& costFunction, size_t maxConcurrentEvaluations, const std::string& cacheFilename)
+: m_activeEvaluationCount(0),
+  m_cacheFilename(cacheFilename),
+  m_costFunction(costFunction),
+  m_maxConcurrentEvaluations(std::max<size_t>(maxConcurrentEvaluations, 1))
+{
+  load_costs();
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t MemoisedCostEvaluator::cached_cost_count() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_costs.size();
+}
+
+float MemoisedCostEvaluator::evaluate(const ParamSet& paramSet)
+{
+  const std::string key = ParamSetUtil::param_set_to_string(paramSet);
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+
+    // Wait until either the cost of the parameter set is known, or nobody else is evaluating it. If the cost is known, return it.
+    for(;;)
+    {
+      std::map<std::string,float>::const_iterator it = m_costs.find(key);
+      if(it != m_costs.end()) return it->second;
+      if(m_pendingKeys.find(key) == m_pendingKeys.end()) break;
+      m_evaluationFinished.wait(lock);
+    }
+
+    // Otherwise, claim the parameter set, and wait until we're allowed to start another evaluation of the cost function.
+    m_pendingKeys.insert(key);
+    while(m_activeEvaluationCount >= m_maxConcurrentEvaluations) m_evaluationFinished.wait(lock);
+    ++m_activeEvaluationCount;
+  }
+
+  // Evaluate the cost function. If it throws, release our claim on the parameter set before propagating the exception.
+  float cost;
+  try
+  {
+    cost = m_costFunction(paramSet);
+  }
+  catch(...)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      --m_activeEvaluationCount;
+      m_pendingKeys.erase(key);
+    }
+
+    m_evaluationFinished.notify_all();
+    throw;
+  }
+
+  // Record (and persist) the cost, and wake up anyone who is waiting for it (or for the chance to start another evaluation).
+  // Note that we don't persist the maximum possible cost, which denotes an evaluation that produced no result (e.g. because
+  // it exceeded a time limit), so that a later search (e.g. with a more generous time limit) will evaluate it again.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    --m_activeEvaluationCount;
+    m_pendingKeys.erase(key);
+    m_costs.insert(std::make_pair(key, cost));
+    if(cost != std::numeric_limits<float>::max()) persist_cost(key, cost);
+  }
+
+  m_evaluationFinished.notify_all();
+  return cost;
+}
+
+std::vector<float> MemoisedCostEvaluator::evaluate(const std::vector<ParamSet>& paramSets)
+{
+  const size_t paramSetCount = paramSets.size();
+  std::vector<float> costs(paramSetCount);
+  std::vector<std::string> errors(paramSetCount);
+
+  // Evaluate the costs of the parameter sets using as many worker threads as can usefully run at once.
+  // If only a single worker is needed, we avoid the overhead of starting a thread and just use this one.
+  const size_t workerCount = std::min(paramSetCount, m_maxConcurrentEvaluations);
+  boost::atomic<size_t> nextIndex(0);
+  if(workerCount <= 1)
+  {
+    run_evaluation_worker(paramSets, nextIndex, costs, errors);
+  }
+  else
+  {
+    boost::thread_group workers;
+    for(size_t i = 0; i < workerCount; ++i)
+    {
+      workers.create_thread(boost::bind(&MemoisedCostEvaluator::run_evaluation_worker, this, boost::cref(paramSets), boost::ref(nextIndex), boost::ref(costs), boost::ref(errors)));
+    }
+    workers.join_all();
+  }
+
+  // If any of the evaluations failed, throw.
+  for(size_t i = 0; i < paramSetCount; ++i)
+  {
+    if(!errors[i].empty()) throw std::runtime_error(errors[i]);
+  }
+
+  return costs;
+}
+
+size_t MemoisedCostEvaluator::get_max_concurrent_evaluations() const
+{
+  return m_maxConcurrentEvaluations;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void MemoisedCostEvaluator::load_costs()
+{
+  if(m_cacheFilename.empty()) return;
+
+  // Note: If the cache file doesn't exist yet, there's nothing to load.
+  std::ifstream fs(m_cacheFilename.c_str());
+  if(!fs) return;
+
+  // Each line of the cache file is of the form <cost>;<parameter set string>. Any lines that are malformed
+  // (e.g. because an earlier search was interrupted whilst writing to the file) are simply skipped.
+  std::string line;
+  while(std::getline(fs, line))
+  {
+    const size_t separatorPos = line.find(';');
+    if(separatorPos == std::string::npos) continue;
+
+    std::istringstream ss(line.substr(0, separatorPos));
+    float cost;
+    if(!(ss >> cost) || cost == std::numeric_limits<float>::max()) continue;
+
+    m_costs[line.substr(separatorPos + 1)] = cost;
+  }
+}
+
+void MemoisedCostEvaluator::persist_cost(const std::string& key, float cost) const
+{
+  if(m_cacheFilename.empty()) return;
+
+  // Note: We write the cost with enough precision to be able to read back exactly the same value later.
+  std::ofstream fs(m_cacheFilename.c_str(), std::ios::app);
+  fs << std::setprecision(9) << cost << ';' << key << std::endl;
+}
+
+void MemoisedCostEvaluator::run_evaluation_worker(const std::vector<ParamSet>& paramSets, boost::atomic<size_t>& nextIndex, std::vector<float>& costs, std::vector<std::string>& errors)
+{
+  for(size_t i = nextIndex++, size = paramSets.size(); i < size; i = nextIndex++)
+  {
+    try
+    {
+      costs[i] = evaluate(paramSets[i]);
+    }
+    catch(std::exception& e)
+    {
+      errors[i] = e.what();
+    }
+    catch(...)
+    {
+      errors[i] = "Error: Unknown exception whilst evaluating the cost of " + ParamSetUtil::param_set_to_string(paramSets[i]);
+    }
+  }
+}
+
+}
@@ -9,13 +9,14 @@ namespace evaluation {
 
 //#################### CONSTRUCTORS ####################
 
-RandomParameterOptimiser::RandomParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed)
-: EpochBasedParameterOptimiser(costFunction, epochCount, seed)
+RandomParameterOptimiser::RandomParameterOptimiser(const CostFunction& costFunction, size_t epochCount, unsigned int seed,
+                                                   size_t maxConcurrentEvaluations, const std::string& costCacheFilename)
+: EpochBasedParameterOptimiser(costFunction, epochCount, seed, maxConcurrentEvaluations, costCacheFilename)
 {}
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-std::pair<std::vector<size_t>,float> RandomParameterOptimiser::optimise_value_indices(const std::vector<size_t>& initialValueIndices) const
+std::pair<std::vector<size_t>,float> RandomParameterOptimiser::optimise_value_indices(const std::vector<size_t>& initialValueIndices, tvgutil::RandomNumberGenerator& rng) const
 {
   // Don't perform any actual optimisation, just compute the cost of the initial parameters.
   return std::make_pair(initialValueIndices, compute_cost(initialValueIndices));
@@ -121,6 +121,32 @@ void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::create_selected_
   }
 }
 
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::gather_example_sets(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                                                                                    const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount)
+{
+  const int exampleSetCapacity = exampleSets->noDims.width;
+  const int *exampleSetIndicesData = exampleSetIndices->GetData(MEMORYDEVICE_CPU);
+  const ExampleType *exampleSetsData = exampleSets->GetData(MEMORYDEVICE_CPU);
+  const int *exampleSetSizesData = exampleSetSizes->GetData(MEMORYDEVICE_CPU);
+  ExampleType *gatheredExampleSets = this->m_gatheredExampleSets->GetData(MEMORYDEVICE_CPU);
+  int *gatheredExampleSetSizes = this->m_gatheredExampleSetSizes->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int gatheredSetIdx = 0; gatheredSetIdx < static_cast<int>(exampleSetCount); ++gatheredSetIdx)
+  {
+    for(int exampleIdx = 0; exampleIdx < exampleSetCapacity; ++exampleIdx)
+    {
+      gather_example(
+        gatheredSetIdx, exampleIdx, exampleSetIndicesData, exampleSetsData, exampleSetSizesData,
+        exampleSetCapacity, gatheredExampleSets, gatheredExampleSetSizes
+      );
+    }
+  }
+}
+
 template <typename ExampleType, typename ClusterType, int MaxClusters>
 typename ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::ClusterContainer *
 ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::get_pointer_to_cluster_container(const ClusterContainers_Ptr& clusterContainers, uint32_t exampleSetIdx) const
@@ -169,6 +195,23 @@ void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::reset_temporarie
   }
 }
 
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::scatter_cluster_containers(const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount,
+                                                                                           ClusterContainers_Ptr& clusterContainers) const
+{
+  const int *exampleSetIndicesData = exampleSetIndices->GetData(MEMORYDEVICE_CPU);
+  const ClusterContainer *gatheredClusterContainers = this->m_gatheredClusterContainers->GetData(MEMORYDEVICE_CPU);
+  ClusterContainer *clusterContainersData = clusterContainers->GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int gatheredSetIdx = 0; gatheredSetIdx < static_cast<int>(exampleSetCount); ++gatheredSetIdx)
+  {
+    scatter_cluster_container(gatheredSetIdx, exampleSetIndicesData, gatheredClusterContainers, clusterContainersData);
+  }
+}
+
 template <typename ExampleType, typename ClusterType, int MaxClusters>
 void ExampleClusterer_CPU<ExampleType,ClusterType,MaxClusters>::select_clusters(uint32_t exampleSetCapacity, uint32_t exampleSetCount)
 {
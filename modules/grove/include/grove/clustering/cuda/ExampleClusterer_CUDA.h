@@ -65,6 +65,10 @@ private:
   virtual void create_selected_clusters(const ExampleType *exampleSets, const int *exampleSetSizes, uint32_t exampleSetCapacity,
                                         uint32_t exampleSetCount, ClusterContainer *clusterContainers);
 
+  /** Override */
+  virtual void gather_example_sets(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                                   const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount);
+
   /** Override */
   virtual ClusterContainer *get_pointer_to_cluster_container(const ClusterContainers_Ptr& clusterContainers, uint32_t exampleSetIdx) const;
 
@@ -80,6 +84,9 @@ private:
   /** Override */
   virtual void reset_temporaries(uint32_t exampleSetCapacity, uint32_t exampleSetCount);
 
+  /** Override */
+  virtual void scatter_cluster_containers(const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers) const;
+
   /** Override */
   virtual void select_clusters(uint32_t exampleSetCapacity, uint32_t exampleSetCount);
 };
@@ -48,6 +48,7 @@ protected:
   typedef ORUtils::MemoryBlock<ClusterContainer> ClusterContainers;
   typedef boost::shared_ptr<ClusterContainers> ClusterContainers_Ptr;
   typedef ORUtils::Image<ExampleType> ExampleImage;
+  typedef boost::shared_ptr<ExampleImage> ExampleImage_Ptr;
   typedef boost::shared_ptr<const ExampleImage> ExampleImage_CPtr;
 
   //#################### PROTECTED VARIABLES ####################
@@ -94,6 +95,15 @@ protected:
   /** An image storing the density of examples around each example in the input sets. Has exampleSetCount rows and exampleSets->width columns. */
   ORFloatImage_Ptr m_densities;
 
+  /** The cluster containers computed for the gathered example sets (only used when clustering an arbitrary subset of the example sets). */
+  ClusterContainers_Ptr m_gatheredClusterContainers;
+
+  /** A compact copy of the example sets to be clustered (only used when clustering an arbitrary subset of the example sets). */
+  ExampleImage_Ptr m_gatheredExampleSets;
+
+  /** The sizes of the gathered example sets (only used when clustering an arbitrary subset of the example sets). */
+  ORIntMemoryBlock_Ptr m_gatheredExampleSetSizes;
+
   /** Stores the number of valid clusters in each example set. Has exampleSetCount elements. */
   ORIntMemoryBlock_Ptr m_nbClustersPerExampleSet;
 
@@ -142,6 +152,26 @@ public:
   void cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
                         uint32_t exampleSetStart, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers);
 
+  /**
+   * \brief Clusters an arbitrary subset of several sets of examples in parallel.
+   *
+   * \note  The example sets of interest are first gathered into a compact temporary image, then clustered, and finally the
+   *        resulting clusters are scattered back into the relevant cluster containers. The cluster containers of the other
+   *        example sets are left untouched.
+   *
+   * \param exampleSets       An image containing the sets of examples to be clustered (one set per row). The width of
+   *                          the image specifies the maximum number of examples that can be contained in each set.
+   * \param exampleSetSizes   The number of valid examples in each example set.
+   * \param exampleSetIndices The indices of the example sets for which to compute clusters (these must be distinct, and must be
+   *                          available on both the CPU and, if relevant, the GPU).
+   * \param exampleSetCount   The number of example sets for which to compute clusters (the first exampleSetCount elements of exampleSetIndices are used).
+   * \param clusterContainers Output containers that will hold the clusters computed for each example set.
+   *
+   * \throws std::invalid_argument If exampleSetIndices contains fewer than exampleSetCount elements, or if any of the example set indices is out of bounds.
+   */
+  void cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                        const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers);
+
   //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
 private:
   /**
@@ -200,6 +230,17 @@ private:
   virtual void create_selected_clusters(const ExampleType *exampleSets, const int *exampleSetSizes, uint32_t exampleSetCapacity,
                                         uint32_t exampleSetCount, ClusterContainer *clusterContainers) = 0;
 
+  /**
+   * \brief Copies the specified example sets (and their sizes) into m_gatheredExampleSets (and m_gatheredExampleSetSizes).
+   *
+   * \param exampleSets       An image containing all of the example sets (one set per row).
+   * \param exampleSetSizes   The number of valid examples in each example set.
+   * \param exampleSetIndices The indices of the example sets to gather.
+   * \param exampleSetCount   The number of example sets to gather.
+   */
+  virtual void gather_example_sets(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                                   const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount) = 0;
+
   /**
    * \brief Gets a raw pointer to the cluster container for the specified example set.
    *
@@ -244,6 +285,15 @@ private:
    */
   virtual void reset_temporaries(uint32_t exampleSetCapacity, uint32_t exampleSetCount) = 0;
 
+  /**
+   * \brief Copies the cluster containers computed for the gathered example sets into the cluster containers for the original example sets.
+   *
+   * \param exampleSetIndices The indices of the original example sets that were gathered.
+   * \param exampleSetCount   The number of example sets that were gathered.
+   * \param clusterContainers The cluster containers for the original example sets.
+   */
+  virtual void scatter_cluster_containers(const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount, ClusterContainers_Ptr& clusterContainers) const = 0;
+
   /**
    * \brief Selects the largest clusters for each example set (up to a maximum limit).
    *
@@ -254,6 +304,14 @@ private:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Reallocates the temporary variables needed to gather example sets during a cluster_examples call as necessary.
+   *
+   * \param exampleSetCapacity The maximum size of each example set.
+   * \param exampleSetCount    The number of example sets being gathered.
+   */
+  void reallocate_gathering_temporaries(uint32_t exampleSetCapacity, uint32_t exampleSetCount);
+
   /**
    * \brief Reallocates the temporary variables needed during a cluster_examples call as necessary.
    *
@@ -261,6 +319,18 @@ private:
    * \param exampleSetCount    The number of example sets being clustered.
    */
   void reallocate_temporaries(uint32_t exampleSetCapacity, uint32_t exampleSetCount);
+
+  /**
+   * \brief Clusters a contiguous range of example sets.
+   *
+   * \param exampleSetsData     A pointer to the first example of the first example set to cluster.
+   * \param exampleSetSizesData A pointer to the size of the first example set to cluster.
+   * \param exampleSetCapacity  The maximum size of each example set.
+   * \param exampleSetCount     The number of example sets to cluster.
+   * \param clusterContainers   A pointer to the cluster container for the first example set to cluster.
+   */
+  void run_clustering(const ExampleType *exampleSetsData, const int *exampleSetSizesData, uint32_t exampleSetCapacity,
+                      uint32_t exampleSetCount, ClusterContainer *clusterContainers);
 };
 
 }
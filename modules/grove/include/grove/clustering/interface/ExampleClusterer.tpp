@@ -31,6 +31,9 @@ ExampleClusterer<ExampleType, ClusterType, MaxClusters>::ExampleClusterer(float
   m_clusterSizeHistograms = mbf.make_image<int>();
   m_clusterSizes = mbf.make_image<int>();
   m_densities = mbf.make_image<float>();
+  m_gatheredClusterContainers = mbf.make_block<ClusterContainer>();
+  m_gatheredExampleSets = mbf.make_image<ExampleType>();
+  m_gatheredExampleSetSizes = mbf.make_block<int>();
   m_nbClustersPerExampleSet = mbf.make_block<int>();
   m_parents = mbf.make_image<int>();
   m_selectedClusters = mbf.make_image<int>();
@@ -61,34 +64,11 @@ void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(con
   // and the way in which cluster_examples is usually called tends not to cause this to happen.
   reallocate_temporaries(exampleSetCapacity, exampleSetCount);
 
-  // Reset the temporary variables needed for the call.
-  reset_temporaries(exampleSetCapacity, exampleSetCount);
-
-  // Reset the cluster containers for each example set of interest.
-  ClusterContainer *clusterContainersPtr = get_pointer_to_cluster_container(clusterContainers, exampleSetStart);
-  reset_cluster_containers(clusterContainersPtr, exampleSetCount);
-
-  // Compute the density of examples around each example in the example sets of interest.
+  // Cluster the example sets of interest.
   const ExampleType *exampleSetsData = get_pointer_to_example_set(exampleSets, exampleSetStart);
   const int *exampleSetSizesData = get_pointer_to_example_set_size(exampleSetSizes, exampleSetStart);
-  compute_densities(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount);
-
-  // Compute the parent and initial cluster indices to assign to each example as part of the neighbour-linking
-  // step of the really quick shift (RQS) algorithm. The algorithm links neighbouring examples in a tree structure,
-  // separating example clusters based on a distance tau.
-  compute_parents(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount, m_tau * m_tau);
-
-  // Compute the final cluster indices to assign to each example by following the parent links just computed.
-  compute_cluster_indices(exampleSetCapacity, exampleSetCount);
-
-  // Compute a histogram of the cluster sizes for each example set (these are used to select the largest clusters).
-  compute_cluster_size_histograms(exampleSetCapacity, exampleSetCount);
-
-  // Select the largest clusters for each example set (up to a maximum limit).
-  select_clusters(exampleSetCapacity, exampleSetCount);
-
-  // Finally, compute the parameters for and store each selected cluster for each example set.
-  create_selected_clusters(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount, clusterContainersPtr);
+  ClusterContainer *clusterContainersPtr = get_pointer_to_cluster_container(clusterContainers, exampleSetStart);
+  run_clustering(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount, clusterContainersPtr);
 
 #if 0
   // For debugging purposes only.
@@ -111,8 +91,68 @@ void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(con
 #endif
 }
 
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::cluster_examples(const ExampleImage_CPtr& exampleSets, const ORIntMemoryBlock_CPtr& exampleSetSizes,
+                                                                             const ORIntMemoryBlock_CPtr& exampleSetIndices, uint32_t exampleSetCount,
+                                                                             ClusterContainers_Ptr& clusterContainers)
+{
+  const uint32_t nbExampleSets = exampleSets->noDims.height;
+  const uint32_t exampleSetCapacity = exampleSets->noDims.width;
+
+  if(exampleSetCount > exampleSetIndices->dataSize)
+  {
+    throw std::invalid_argument("Error: exampleSetCount > exampleSetIndices->dataSize");
+  }
+
+  const int *exampleSetIndicesData = exampleSetIndices->GetData(MEMORYDEVICE_CPU);
+  for(uint32_t i = 0; i < exampleSetCount; ++i)
+  {
+    if(exampleSetIndicesData[i] < 0 || static_cast<uint32_t>(exampleSetIndicesData[i]) >= nbExampleSets)
+    {
+      throw std::invalid_argument("Error: exampleSetIndices contains an out-of-bounds example set index");
+    }
+  }
+
+  if(exampleSetCount == 0) return;
+
+  // Gather the example sets of interest into a compact image, so that they can be clustered as if they were contiguous.
+  reallocate_gathering_temporaries(exampleSetCapacity, exampleSetCount);
+  gather_example_sets(exampleSets, exampleSetSizes, exampleSetIndices, exampleSetCount);
+
+  // Cluster the gathered example sets.
+  reallocate_temporaries(exampleSetCapacity, exampleSetCount);
+  const ExampleType *exampleSetsData = get_pointer_to_example_set(m_gatheredExampleSets, 0);
+  const int *exampleSetSizesData = get_pointer_to_example_set_size(m_gatheredExampleSetSizes, 0);
+  ClusterContainer *clusterContainersPtr = get_pointer_to_cluster_container(m_gatheredClusterContainers, 0);
+  run_clustering(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount, clusterContainersPtr);
+
+  // Finally, copy the resulting clusters into the cluster containers for the original example sets.
+  scatter_cluster_containers(exampleSetIndices, exampleSetCount, clusterContainers);
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::reallocate_gathering_temporaries(uint32_t exampleSetCapacity, uint32_t exampleSetCount)
+{
+  // As with the other temporaries, we avoid reallocating when the existing images are already large enough. Note, however,
+  // that the width of the gathered example sets image must exactly match the capacity of the example sets being gathered,
+  // since it is used to locate the individual sets within the image.
+  const Vector2i oldImgSize = m_gatheredExampleSets->noDims;
+  const Vector2i newImgSize(static_cast<int>(exampleSetCapacity), static_cast<int>(exampleSetCount));
+
+  if(newImgSize.width != oldImgSize.width || newImgSize.height > oldImgSize.height)
+  {
+    m_gatheredExampleSets->ChangeDims(newImgSize);
+  }
+
+  if(exampleSetCount > m_gatheredExampleSetSizes->dataSize)
+  {
+    m_gatheredExampleSetSizes->Resize(exampleSetCount);
+    m_gatheredClusterContainers->Resize(exampleSetCount);
+  }
+}
+
 template <typename ExampleType, typename ClusterType, int MaxClusters>
 void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::reallocate_temporaries(uint32_t exampleSetCapacity, uint32_t exampleSetCount)
 {
@@ -146,4 +186,35 @@ void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::reallocate_temporari
   }
 }
 
+template <typename ExampleType, typename ClusterType, int MaxClusters>
+void ExampleClusterer<ExampleType,ClusterType,MaxClusters>::run_clustering(const ExampleType *exampleSetsData, const int *exampleSetSizesData, uint32_t exampleSetCapacity,
+                                                                           uint32_t exampleSetCount, ClusterContainer *clusterContainers)
+{
+  // Reset the temporary variables needed for the call.
+  reset_temporaries(exampleSetCapacity, exampleSetCount);
+
+  // Reset the cluster containers for each example set of interest.
+  reset_cluster_containers(clusterContainers, exampleSetCount);
+
+  // Compute the density of examples around each example in the example sets of interest.
+  compute_densities(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount);
+
+  // Compute the parent and initial cluster indices to assign to each example as part of the neighbour-linking
+  // step of the really quick shift (RQS) algorithm. The algorithm links neighbouring examples in a tree structure,
+  // separating example clusters based on a distance tau.
+  compute_parents(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount, m_tau * m_tau);
+
+  // Compute the final cluster indices to assign to each example by following the parent links just computed.
+  compute_cluster_indices(exampleSetCapacity, exampleSetCount);
+
+  // Compute a histogram of the cluster sizes for each example set (these are used to select the largest clusters).
+  compute_cluster_size_histograms(exampleSetCapacity, exampleSetCount);
+
+  // Select the largest clusters for each example set (up to a maximum limit).
+  select_clusters(exampleSetCapacity, exampleSetCount);
+
+  // Finally, compute the parameters for and store each selected cluster for each example set.
+  create_selected_clusters(exampleSetsData, exampleSetSizesData, exampleSetCapacity, exampleSetCount, clusterContainers);
+}
+
 }
@@ -284,6 +284,37 @@ inline void create_selected_cluster(int exampleSetIdx, int selectedClusterIdx, c
   }
 }
 
+/**
+ * \brief Copies the specified example from one of the original example sets into the corresponding gathered example set.
+ *
+ * \note  Only the valid examples in each set are copied. The size of each gathered example set is written by the thread
+ *        that copies its first example.
+ *
+ * \param gatheredSetIdx          The index of the gathered example set.
+ * \param exampleIdx              The index of the example within its example set.
+ * \param exampleSetIndices       The indices of the original example sets that are being gathered.
+ * \param exampleSets             An image containing the original example sets (one set per row).
+ * \param exampleSetSizes         The number of valid examples in each original example set.
+ * \param exampleSetCapacity      The maximum size of each example set.
+ * \param gatheredExampleSets     An image in which to store the gathered example sets (one set per row).
+ * \param gatheredExampleSetSizes An array in which to store the number of valid examples in each gathered example set.
+ */
+template <typename ExampleType>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline void gather_example(int gatheredSetIdx, int exampleIdx, const int *exampleSetIndices, const ExampleType *exampleSets, const int *exampleSetSizes,
+                           int exampleSetCapacity, ExampleType *gatheredExampleSets, int *gatheredExampleSetSizes)
+{
+  const int exampleSetIdx = exampleSetIndices[gatheredSetIdx];
+  const int exampleSetSize = exampleSetSizes[exampleSetIdx];
+
+  if(exampleIdx == 0) gatheredExampleSetSizes[gatheredSetIdx] = exampleSetSize;
+
+  if(exampleIdx < exampleSetSize)
+  {
+    gatheredExampleSets[gatheredSetIdx * exampleSetCapacity + exampleIdx] = exampleSets[exampleSetIdx * exampleSetCapacity + exampleIdx];
+  }
+}
+
 /**
  * \brief Resets a cluster container.
  *
@@ -331,6 +362,30 @@ inline void reset_temporaries_for_set(int exampleSetIdx, int exampleSetCapacity,
   clusterSizeHistograms[histogramOffset + exampleSetCapacity] = 0;
 }
 
+/**
+ * \brief Copies the cluster container for a gathered example set into the cluster container for the corresponding original example set.
+ *
+ * \param gatheredSetIdx            The index of the gathered example set.
+ * \param exampleSetIndices         The indices of the original example sets that were gathered.
+ * \param gatheredClusterContainers The cluster containers for the gathered example sets.
+ * \param clusterContainers         The cluster containers for the original example sets.
+ */
+template <typename ClusterType, int MaxClusters>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline void scatter_cluster_container(int gatheredSetIdx, const int *exampleSetIndices, const Array<ClusterType,MaxClusters> *gatheredClusterContainers,
+                                      Array<ClusterType,MaxClusters> *clusterContainers)
+{
+  const Array<ClusterType,MaxClusters>& source = gatheredClusterContainers[gatheredSetIdx];
+  Array<ClusterType,MaxClusters>& target = clusterContainers[exampleSetIndices[gatheredSetIdx]];
+
+  // Note that only the valid clusters need to be copied.
+  target.size = source.size;
+  for(int i = 0; i < source.size; ++i)
+  {
+    target.elts[i] = source.elts[i];
+  }
+}
+
 /**
  * \brief Selects the largest clusters for the specified example set and writes their indices into the selected clusters image.
  *
@@ -32,13 +32,16 @@ struct DecisionForestFactory
   /**
    * \brief Constructs a decision forest by loading the branching structure of a pre-trained forest from a file on disk.
    *
-   * \param filename   The path to the file containing the forest.
-   * \param deviceType The device on which the decision forest should operate.
-   * \return           The constructed forest.
+   * \note  The packed node layout is currently only supported on the CPU, and is ignored for other devices.
+   *
+   * \param filename        The path to the file containing the forest.
+   * \param deviceType      The device on which the decision forest should operate.
+   * \param usePackedLayout Whether or not to evaluate the forest using a packed, cache-friendly node layout.
+   * \return                The constructed forest.
    *
    * \throws std::runtime_error If the forest cannot be loaded.
    */
-  static Forest_Ptr make_forest(const std::string& filename, ORUtils::DeviceType deviceType);
+  static Forest_Ptr make_forest(const std::string& filename, ORUtils::DeviceType deviceType, bool usePackedLayout = false);
 
 #ifdef WITH_SCOREFORESTS
   /**
@@ -56,13 +59,16 @@ struct DecisionForestFactory
   /**
    * \brief Constructs a balanced decision forest with random split functions, using parameters specified by the user.
    *
-   * \param settings   The settings to use to create the forest.
-   * \param deviceType The device on which the decision forest should operate.
-   * \return           The constructed forest.
+   * \note  The packed node layout is currently only supported on the CPU, and is ignored for other devices.
+   *
+   * \param settings        The settings to use to create the forest.
+   * \param deviceType      The device on which the decision forest should operate.
+   * \param usePackedLayout Whether or not to evaluate the forest using a packed, cache-friendly node layout.
+   * \return                The constructed forest.
    *
    * \throws std::runtime_error If the forest cannot be created.
    */
-  static Forest_Ptr make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType);
+  static Forest_Ptr make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType, bool usePackedLayout = false);
 };
 
 }
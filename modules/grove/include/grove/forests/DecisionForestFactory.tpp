@@ -17,7 +17,7 @@ namespace grove {
 
 template <typename DescriptorType, int TreeCount>
 typename DecisionForestFactory<DescriptorType,TreeCount>::Forest_Ptr
-DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string& filename, ORUtils::DeviceType deviceType)
+DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string& filename, ORUtils::DeviceType deviceType, bool usePackedLayout)
 {
   Forest_Ptr forest;
 
@@ -31,7 +31,7 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const std::string&
   }
   else
   {
-    forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(filename));
+    forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(filename, usePackedLayout));
   }
 
   return forest;
@@ -63,7 +63,7 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_forest(const EnsembleLearn
 
 template <typename DescriptorType, int TreeCount>
 typename DecisionForestFactory<DescriptorType,TreeCount>::Forest_Ptr
-DecisionForestFactory<DescriptorType,TreeCount>::make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType)
+DecisionForestFactory<DescriptorType,TreeCount>::make_randomly_generated_forest(const tvgutil::SettingsContainer_CPtr& settings, ORUtils::DeviceType deviceType, bool usePackedLayout)
 {
   Forest_Ptr forest;
 
@@ -77,7 +77,7 @@ DecisionForestFactory<DescriptorType,TreeCount>::make_randomly_generated_forest(
   }
   else
   {
-    forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(settings));
+    forest.reset(new DecisionForest_CPU<DescriptorType,TreeCount>(settings, usePackedLayout));
   }
 
   return forest;
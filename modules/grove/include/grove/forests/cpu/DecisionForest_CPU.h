@@ -6,6 +6,8 @@
 #ifndef H_GROVE_DECISIONFOREST_CPU
 #define H_GROVE_DECISIONFOREST_CPU
 
+#include <vector>
+
 #include "../interface/DecisionForest.h"
 
 namespace grove {
@@ -17,6 +19,12 @@ namespace grove {
  * \note  Training is not performed by this class. We use the node indexing technique described in:
  *        "Implementing Decision Trees and Forests on a GPU" (Toby Sharp, 2008).
  *
+ * \note  Optionally, the nodes can additionally be stored in a packed, cache-friendly layout. In this layout, the nodes of
+ *        each tree are stored in breadth-first order (so that the top levels of each tree, which are visited by every
+ *        descriptor, are contiguous in memory), and the top levels of all of the trees are grouped together at the start
+ *        of the array, followed by the remaining levels of each tree in turn. When this layout is used, the descriptors
+ *        are pushed through each tree in small batches in lockstep, which amortises the cost of fetching the nodes.
+ *
  * \tparam DescriptorType The type of descriptor used to find the leaves. Must have a floating-point member array named "data".
  * \tparam TreeCount      The number of trees in the forest. Fixed at compilation time to allow the definition of a data type
  *                        representing the leaf indices.
@@ -38,39 +46,94 @@ public:
   using typename Base::LeafIndicesImage_CPtr;
   using typename Base::NodeEntry;
 
+  //#################### CONSTANTS ####################
+private:
+  /** The number of descriptors that are pushed through each tree in lockstep when using the packed layout. */
+  enum { BATCH_SIZE = 8 };
+
+  /** The number of top levels of each tree that are grouped together at the start of the packed layout. */
+  enum { HOT_LEVEL_COUNT = 6 };
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents a single node in the packed layout.
+   */
+  struct PackedNode
+  {
+    /** The threshold against which to compare the feature (0 for a leaf). */
+    float featureThreshold;
+
+    /** The index of the feature in a feature descriptor that should be compared to the threshold (0 for a leaf). */
+    uint32_t featureIdx;
+
+    /**
+     * If the node is a branch, the index of its left child in the packed layout (the right child immediately follows it).
+     * If the node is a leaf, -(leafIdx + 1).
+     */
+    int next;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The nodes of the forest in the packed layout (empty if the packed layout is not being used). */
+  std::vector<PackedNode> m_packedNodes;
+
+  /** The indices of the roots of the trees in the packed layout. */
+  std::vector<int> m_packedRootIndices;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Loads the branching structure of a pre-trained decision forest from a file on disk.
    *
-   * \param filename The path to the file containing the forest.
+   * \param filename        The path to the file containing the forest.
+   * \param usePackedLayout Whether or not to evaluate the forest using the packed node layout.
    *
    * \throws std::runtime_error If the forest cannot be loaded.
    */
-  explicit DecisionForest_CPU(const std::string& filename);
+  explicit DecisionForest_CPU(const std::string& filename, bool usePackedLayout = false);
 
   /**
    * \brief Constructs a balanced decision forest with random split functions, using parameters specified by the user.
    *
-   * \param settings  The settings to use to create the forest.
+   * \param settings        The settings to use to create the forest.
+   * \param usePackedLayout Whether or not to evaluate the forest using the packed node layout.
    */
-  explicit DecisionForest_CPU(const tvgutil::SettingsContainer_CPtr& settings);
+  explicit DecisionForest_CPU(const tvgutil::SettingsContainer_CPtr& settings, bool usePackedLayout = false);
 
 #ifdef WITH_SCOREFORESTS
   /**
    * \brief Constructs a decision forest by converting an EnsembleLearner that was pre-trained using ScoreForests.
    *
    * \param pretrainedForest The pre-trained forest to convert.
+   * \param usePackedLayout  Whether or not to evaluate the forest using the packed node layout.
    *
    * \throws std::runtime_error If the pre-trained forest cannot be converted.
    */
-  explicit DecisionForest_CPU(const EnsembleLearner& pretrainedForest);
+  explicit DecisionForest_CPU(const EnsembleLearner& pretrainedForest, bool usePackedLayout = false);
 #endif
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /** Override */
   virtual void find_leaves(const DescriptorImage_CPtr& descriptors, LeafIndicesImage_Ptr& leafIndices) const;
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Builds the packed layout from the nodes in the node image.
+   */
+  void build_packed_layout();
+
+  /**
+   * \brief Finds the leaf indices associated with a batch of (at most BATCH_SIZE) consecutive descriptors using the packed layout.
+   *
+   * \param descriptors     A pointer to the first descriptor in the batch.
+   * \param descriptorCount The number of descriptors in the batch.
+   * \param leafIndices     A pointer to the location in which to store the leaf indices for the first descriptor in the batch.
+   */
+  void find_leaves_packed(const DescriptorType *descriptors, int descriptorCount, LeafIndices *leafIndices) const;
 };
 
 }
@@ -5,6 +5,9 @@
 
 #include "DecisionForest_CPU.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "../shared/DecisionForest_Shared.h"
 
 namespace grove {
@@ -12,20 +15,26 @@ namespace grove {
 //#################### CONSTRUCTORS ####################
 
 template <typename DescriptorType, int TreeCount>
-DecisionForest_CPU<DescriptorType,TreeCount>::DecisionForest_CPU(const std::string& filename)
+DecisionForest_CPU<DescriptorType,TreeCount>::DecisionForest_CPU(const std::string& filename, bool usePackedLayout)
 : Base(filename)
-{}
+{
+  if(usePackedLayout) build_packed_layout();
+}
 
 template <typename DescriptorType, int TreeCount>
-DecisionForest_CPU<DescriptorType,TreeCount>::DecisionForest_CPU(const tvgutil::SettingsContainer_CPtr& settings)
+DecisionForest_CPU<DescriptorType,TreeCount>::DecisionForest_CPU(const tvgutil::SettingsContainer_CPtr& settings, bool usePackedLayout)
 : Base(settings)
-{}
+{
+  if(usePackedLayout) build_packed_layout();
+}
 
 #ifdef WITH_SCOREFORESTS
 template <typename DescriptorType, int TreeCount>
-DecisionForest_CPU<DescriptorType,TreeCount>::DecisionForest_CPU(const EnsembleLearner& pretrainedForest)
+DecisionForest_CPU<DescriptorType,TreeCount>::DecisionForest_CPU(const EnsembleLearner& pretrainedForest, bool usePackedLayout)
 : Base(pretrainedForest)
-{}
+{
+  if(usePackedLayout) build_packed_layout();
+}
 #endif
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -42,6 +51,24 @@ void DecisionForest_CPU<DescriptorType,TreeCount>::find_leaves(const DescriptorI
   const NodeEntry *nodeImage = this->m_nodeImage->GetData(MEMORYDEVICE_CPU);
   LeafIndices *leafIndicesPtr = leafIndices->GetData(MEMORYDEVICE_CPU);
 
+  if(!m_packedNodes.empty())
+  {
+    // If we're using the packed layout, push the descriptors through the forest in small batches of consecutive descriptors.
+    const int descriptorCount = imgSize.x * imgSize.y;
+    const int batchCount = (descriptorCount + BATCH_SIZE - 1) / BATCH_SIZE;
+
+#ifdef WITH_OPENMP
+#pragma omp parallel for
+#endif
+    for(int batchIdx = 0; batchIdx < batchCount; ++batchIdx)
+    {
+      const int firstDescriptorIdx = batchIdx * BATCH_SIZE;
+      find_leaves_packed(descriptorsPtr + firstDescriptorIdx, std::min<int>(BATCH_SIZE, descriptorCount - firstDescriptorIdx), leafIndicesPtr + firstDescriptorIdx);
+    }
+
+    return;
+  }
+
 #ifdef WITH_OPENMP
 #pragma omp parallel for
 #endif
@@ -54,4 +81,134 @@ void DecisionForest_CPU<DescriptorType,TreeCount>::find_leaves(const DescriptorI
   }
 }
 
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+template <typename DescriptorType, int TreeCount>
+void DecisionForest_CPU<DescriptorType,TreeCount>::build_packed_layout()
+{
+  const NodeEntry *nodeImage = this->m_nodeImage->GetData(MEMORYDEVICE_CPU);
+
+  // First, perform a breadth-first traversal of each tree, splitting its nodes into those that are in the top
+  // HOT_LEVEL_COUNT levels of the tree and those that are not. Note that because the children of a branch node
+  // are visited consecutively, and both children are always in the same part of the split, siblings will end up
+  // being adjacent in the packed layout, as required.
+  std::vector<std::vector<int> > hotNodes(TREE_COUNT), coldNodes(TREE_COUNT);
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    std::vector<std::pair<int,int> > queue;
+    queue.reserve(this->m_nbNodesPerTree[treeIdx]);
+    queue.push_back(std::make_pair(0, 0));
+
+    for(size_t i = 0; i < queue.size(); ++i)
+    {
+      const int nodeIdx = queue[i].first, depth = queue[i].second;
+      (depth < HOT_LEVEL_COUNT ? hotNodes : coldNodes)[treeIdx].push_back(nodeIdx);
+
+      const NodeEntry& node = nodeImage[nodeIdx * TREE_COUNT + treeIdx];
+      if(node.leafIdx < 0)
+      {
+        queue.push_back(std::make_pair(node.leftChildIdx, depth + 1));
+        queue.push_back(std::make_pair(node.leftChildIdx + 1, depth + 1));
+      }
+    }
+  }
+
+  // Next, assign each node its index in the packed layout: the hot nodes of all of the trees come first,
+  // followed by the cold nodes of each tree in turn.
+  std::vector<std::vector<int> > packedIndices(TREE_COUNT);
+  int packedNodeCount = 0;
+
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    packedIndices[treeIdx].resize(this->m_nbNodesPerTree[treeIdx], -1);
+    for(size_t i = 0, size = hotNodes[treeIdx].size(); i < size; ++i)
+    {
+      packedIndices[treeIdx][hotNodes[treeIdx][i]] = packedNodeCount++;
+    }
+  }
+
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    for(size_t i = 0, size = coldNodes[treeIdx].size(); i < size; ++i)
+    {
+      packedIndices[treeIdx][coldNodes[treeIdx][i]] = packedNodeCount++;
+    }
+  }
+
+  // Finally, write the packed nodes into the array.
+  m_packedNodes.resize(packedNodeCount);
+  m_packedRootIndices.resize(TREE_COUNT);
+
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    m_packedRootIndices[treeIdx] = packedIndices[treeIdx][0];
+
+    for(uint32_t nodeIdx = 0; nodeIdx < this->m_nbNodesPerTree[treeIdx]; ++nodeIdx)
+    {
+      const int packedIdx = packedIndices[treeIdx][nodeIdx];
+
+      // Skip any nodes that are not reachable from the root (there should not be any in a valid forest).
+      if(packedIdx < 0) continue;
+
+      const NodeEntry& node = nodeImage[nodeIdx * TREE_COUNT + treeIdx];
+      PackedNode& packedNode = m_packedNodes[packedIdx];
+
+      if(node.leafIdx >= 0)
+      {
+        packedNode.featureThreshold = 0.0f;
+        packedNode.featureIdx = 0;
+        packedNode.next = -(node.leafIdx + 1);
+      }
+      else
+      {
+        packedNode.featureThreshold = node.featureThreshold;
+        packedNode.featureIdx = node.featureIdx;
+        packedNode.next = packedIndices[treeIdx][node.leftChildIdx];
+      }
+    }
+  }
+}
+
+template <typename DescriptorType, int TreeCount>
+void DecisionForest_CPU<DescriptorType,TreeCount>::find_leaves_packed(const DescriptorType *descriptors, int descriptorCount, LeafIndices *leafIndices) const
+{
+  const PackedNode *packedNodes = &m_packedNodes[0];
+
+  // For each tree in the forest:
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    // Start all of the descriptors in the batch from the root of the tree.
+    int currentNodeIndices[BATCH_SIZE];
+    std::fill(currentNodeIndices, currentNodeIndices + descriptorCount, m_packedRootIndices[treeIdx]);
+
+    // Walk the descriptors down the tree in lockstep until they have all reached a leaf. Since the descriptors in a batch
+    // are spatially adjacent, they tend to follow similar paths, so the nodes fetched for one are often reused by the others.
+    int activeCount = descriptorCount;
+    while(activeCount > 0)
+    {
+      activeCount = 0;
+
+      for(int i = 0; i < descriptorCount; ++i)
+      {
+        // If the descriptor has already reached a leaf, skip it.
+        if(currentNodeIndices[i] < 0) continue;
+
+        const PackedNode& node = packedNodes[currentNodeIndices[i]];
+        if(node.next < 0)
+        {
+          // The descriptor has reached a leaf, so write its index into the leaf indices image.
+          leafIndices[i][treeIdx] = -(node.next + 1);
+          currentNodeIndices[i] = -1;
+        }
+        else
+        {
+          // Descend to either the left or right subtree.
+          currentNodeIndices[i] = node.next + static_cast<int>(descriptors[i].data[node.featureIdx] > node.featureThreshold);
+          ++activeCount;
+        }
+      }
+    }
+  }
+}
+
 }
@@ -198,6 +198,8 @@ public:
    *
    * \throws std::runtime_error If the forest cannot be loaded.
    *
+   * \note The file can either be a packed file (see save_structure_to_packed_file), or a text file.
+   *
    * \note File format (text mode):
    *
    * nbTrees
@@ -223,6 +225,18 @@ public:
    */
   void save_structure_to_file(const std::string& filename) const;
 
+  /**
+   * \brief Saves the branching structure of the decision forest to a packed (binary) file on disk.
+   *
+   * \note  Packed files are versioned and checksummed, and are much faster to load than text files,
+   *        since the nodes can be copied directly from the memory-mapped file into the node image.
+   *
+   * \param filename  The path to the file to which to save the forest.
+   *
+   * \throws std::runtime_error If the forest cannot be saved.
+   */
+  void save_structure_to_packed_file(const std::string& filename) const;
+
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
 #ifdef WITH_SCOREFORESTS
@@ -261,6 +275,15 @@ private:
    */
   int create_node(uint32_t treeIdx, uint32_t nbTrees, uint32_t depthLeft, uint32_t outputIdx,
                   uint32_t outputFirstFreeIdx, NodeEntry *outputNodes, uint32_t& outputNbLeaves);
+
+  /**
+   * \brief Loads the branching structure of a pre-trained decision forest from a packed file on disk.
+   *
+   * \param filename  The path to the packed file containing the forest.
+   *
+   * \throws std::runtime_error If the forest cannot be loaded.
+   */
+  void load_structure_from_packed_file(const std::string& filename);
 };
 
 }
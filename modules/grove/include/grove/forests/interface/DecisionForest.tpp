@@ -17,6 +17,9 @@
 
 #include <tvgutil/numbers/RandomNumberGenerator.h>
 
+#include "../../util/PackedFileReader.h"
+#include "../../util/PackedFileWriter.h"
+
 // Whether or not to replace the pre-computed feature indices and thresholds with random ones.
 #define RANDOM_FEATURES 0
 
@@ -221,6 +224,13 @@ uint32_t DecisionForest<DescriptorType,TreeCount>::get_nb_trees() const
 template <typename DescriptorType, int TreeCount>
 void DecisionForest<DescriptorType,TreeCount>::load_structure_from_file(const std::string& filename)
 {
+  // If the forest has been saved in a packed file, load it from that instead of parsing it.
+  if(PackedFileReader::is_packed_file(filename))
+  {
+    load_structure_from_packed_file(filename);
+    return;
+  }
+
   // Clear the current forest.
   m_nodeImage.reset();
   m_nbNodesPerTree.clear();
@@ -363,6 +373,29 @@ void DecisionForest<DescriptorType,TreeCount>::save_structure_to_file(const std:
   if(!out) throw std::runtime_error("Error saving the forest to a file: " + filename);
 }
 
+template <typename DescriptorType, int TreeCount>
+void DecisionForest<DescriptorType,TreeCount>::save_structure_to_packed_file(const std::string& filename) const
+{
+  // Record the information needed to check that the forest is compatible with the one into which it is later loaded.
+  const uint32_t info[] = { get_nb_trees(), static_cast<uint32_t>(m_nodeImage->noDims.y), static_cast<uint32_t>(sizeof(NodeEntry)) };
+
+  // Save the numbers of nodes and leaves in each tree, followed by the node image itself (which is saved as-is).
+  PackedFileWriter writer;
+  writer.add_chunk("forest.info", info, sizeof(info));
+  writer.add_chunk("forest.nbNodesPerTree", &m_nbNodesPerTree[0], m_nbNodesPerTree.size() * sizeof(uint32_t));
+  writer.add_chunk("forest.nbLeavesPerTree", &m_nbLeavesPerTree[0], m_nbLeavesPerTree.size() * sizeof(uint32_t));
+  writer.add_memory_block("forest.nodes", *m_nodeImage);
+
+  try
+  {
+    writer.write(filename);
+  }
+  catch(std::runtime_error&)
+  {
+    throw std::runtime_error("Error saving the forest to a file: " + filename);
+  }
+}
+
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
 #ifdef WITH_SCOREFORESTS
@@ -467,4 +500,59 @@ int DecisionForest<DescriptorType,TreeCount>::create_node(uint32_t treeIdx, uint
   return outputFirstFreeIdx;
 }
 
+template <typename DescriptorType, int TreeCount>
+void DecisionForest<DescriptorType,TreeCount>::load_structure_from_packed_file(const std::string& filename)
+{
+  // Clear the current forest.
+  m_nodeImage.reset();
+  m_nbNodesPerTree.clear();
+  m_nbLeavesPerTree.clear();
+  m_nbTotalLeaves = 0;
+
+  // Map the file into memory.
+  PackedFileReader reader(filename);
+
+  // Check that the forest in the file is compatible with this one.
+  size_t infoSize;
+  const uint32_t *info = reader.get_chunk_as<uint32_t>("forest.info", infoSize);
+  if(infoSize != 3) throw std::runtime_error("Error: The forest information in " + filename + " is invalid");
+
+  const uint32_t nbTrees = info[0], maxNbNodes = info[1], nodeEntrySize = info[2];
+  if(nbTrees != get_nb_trees())
+  {
+    throw std::runtime_error(
+      "Number of trees of the loaded forest is incorrect. Should be " +
+      boost::lexical_cast<std::string>(get_nb_trees()) + " - Read: " +
+      boost::lexical_cast<std::string>(nbTrees)
+    );
+  }
+
+  if(nodeEntrySize != sizeof(NodeEntry)) throw std::runtime_error("Error: The nodes in " + filename + " have an unexpected size");
+
+  // Read the numbers of nodes and leaves in each tree.
+  size_t nbNodesCount, nbLeavesCount;
+  const uint32_t *nbNodesPerTree = reader.get_chunk_as<uint32_t>("forest.nbNodesPerTree", nbNodesCount);
+  const uint32_t *nbLeavesPerTree = reader.get_chunk_as<uint32_t>("forest.nbLeavesPerTree", nbLeavesCount);
+  if(nbNodesCount != nbTrees || nbLeavesCount != nbTrees) throw std::runtime_error("Error: The tree dimensions in " + filename + " are invalid");
+
+  m_nbNodesPerTree.assign(nbNodesPerTree, nbNodesPerTree + nbTrees);
+  m_nbLeavesPerTree.assign(nbLeavesPerTree, nbLeavesPerTree + nbTrees);
+
+  std::cout << "Loading a forest with " << nbTrees << " trees.\n";
+  for(uint32_t i = 0; i < nbTrees; ++i)
+  {
+    if(m_nbNodesPerTree[i] > maxNbNodes) throw std::runtime_error("Error reading the dimensions of tree: " + boost::lexical_cast<std::string>(i));
+    m_nbTotalLeaves += m_nbLeavesPerTree[i];
+    std::cout << "\tTree " << i << ": " << m_nbNodesPerTree[i] << " nodes and " << m_nbLeavesPerTree[i] << " leaves.\n";
+  }
+
+  // Copy the nodes directly from the file into the node image.
+  const orx::MemoryBlockFactory& mbf = orx::MemoryBlockFactory::instance();
+  m_nodeImage = mbf.make_image<NodeEntry>(Vector2i(nbTrees, maxNbNodes));
+  reader.read_memory_block("forest.nodes", *m_nodeImage);
+
+  // Ensure that the node image is available on the GPU (if we're using it).
+  m_nodeImage->UpdateDeviceFromHost();
+}
+
 }
@@ -24,6 +24,9 @@ struct PreemptiveRansacFactory
   /**
    * \brief Creates an instance of preemptive RANSAC.
    *
+   * \note  On the CPU, the useVectorisedEnergyComputation setting can be used to select the vectorised implementation
+   *        of the energy computation step (see PreemptiveRansac_CPUVectorised).
+   *
    * \param settings           The settings to use to configure the instance of preemptive RANSAC.
    * \param settingsNamespace  The namespace used to read settings from the settings container.
    * \param deviceType         The device on which the instance of preemptive RANSAC should operate.
@@ -0,0 +1,105 @@
+/**
+ * grove: PreemptiveRansac_CPUVectorised.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_PREEMPTIVERANSAC_CPUVECTORISED
+#define H_GROVE_PREEMPTIVERANSAC_CPUVECTORISED
+
+#include <vector>
+
+#include "PreemptiveRansac_CPU.h"
+
+namespace grove {
+
+/**
+ * \brief An instance of this class allows the estimation of a 6DOF pose from a set of 3D keypoints and their
+ *        associated SCoRe forest predictions using the CPU, with a vectorised energy computation step.
+ *
+ * Rather than evaluating the energy of each pose candidate separately, the candidates are processed in fixed-size
+ * blocks whose poses are transposed into structure-of-arrays form. The sampled inliers and their modes are packed
+ * once per energy computation into compact arrays (with the normalisation factor of each mode's Gaussian computed
+ * up-front), which allows the energy for each (inlier, mode) pair to be evaluated for every candidate in a block
+ * at once. On x86 Linux builds using GCC, the kernels are compiled for AVX-512, AVX2 and baseline targets, and the
+ * most appropriate version is selected at runtime.
+ *
+ * The arithmetic is performed in the same order as in the scalar implementation, and without contraction into fused
+ * multiply-adds, so the computed energies (and hence the rankings of the candidates) are identical to those produced
+ * by PreemptiveRansac_CPU.
+ */
+class PreemptiveRansac_CPUVectorised : public PreemptiveRansac_CPU
+{
+  //#################### CONSTANTS ####################
+public:
+  /** The number of pose candidates whose energies are evaluated together. */
+  enum { CANDIDATE_BLOCK_SIZE = 16 };
+
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct holds the precomputed parameters of one of the modes predicted for a sampled inlier.
+   */
+  struct PackedMode
+  {
+    /** The inverse covariance matrix of the mode (stored in the same order as in Matrix3f). */
+    float invCovariance[9];
+
+    /** The number of points that belong to the mode (as a float, since it is only used in floating-point computations). */
+    float nbInliers;
+
+    /** The normalisation factor for the Gaussian associated with the mode. */
+    float normalisation;
+
+    /** The position of the mode (in world coordinates). */
+    float position[3];
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The positions (in camera space) of the sampled inliers, packed contiguously. */
+  std::vector<Vector3f> m_packedInlierPositions;
+
+  /** The offsets of the modes of each sampled inlier in m_packedModes (with an additional final entry marking the end of the array). */
+  std::vector<int> m_packedModeOffsets;
+
+  /** The modes of the sampled inliers, packed contiguously. */
+  std::vector<PackedMode> m_packedModes;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an instance of PreemptiveRansac_CPUVectorised.
+   *
+   * \param settings           The settings used to configure the algorithm.
+   * \param settingsNamespace  The namespace used to read settings from the settings container.
+   */
+  PreemptiveRansac_CPUVectorised(const tvgutil::SettingsContainer_CPtr& settings, const std::string& settingsNamespace);
+
+  //#################### PROTECTED MEMBER FUNCTIONS ####################
+protected:
+  /** Override */
+  virtual void compute_energies_and_sort();
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the energies of a block of (at most CANDIDATE_BLOCK_SIZE) pose candidates.
+   *
+   * \pre   The sampled inliers and their modes must already have been packed using pack_inliers.
+   *
+   * \param candidates    A pointer to the first pose candidate in the block.
+   * \param nbCandidates  The number of pose candidates in the block.
+   * \return              true, if the best mode found for each inlier had at least some inliers, or false otherwise
+   *                      (in which case the energies of the candidates in the block are meaningless).
+   */
+  bool compute_block_energies(PoseCandidate *candidates, int nbCandidates) const;
+
+  /**
+   * \brief Packs the positions and modes of the currently sampled inliers into contiguous arrays.
+   */
+  void pack_inliers();
+};
+
+}
+
+#endif
@@ -6,8 +6,11 @@
 #ifndef H_GROVE_SCORERELOCALISERSTATE
 #define H_GROVE_SCORERELOCALISERSTATE
 
+#include <boost/thread/shared_mutex.hpp>
+
 #include "../../keypoints/Keypoint3DColour.h"
 #include "../../reservoirs/interface/ExampleReservoirs.h"
+#include "../../scoreforests/CompactScorePredictions.h"
 #include "../../scoreforests/ScorePrediction.h"
 
 namespace grove {
@@ -19,6 +22,13 @@ namespace grove {
  *
  * - The example reservoirs used when training the relocaliser.
  * - A memory block containing the 3D modal clusters used for the actual camera relocalisation.
+ *
+ * Once training has finished, the memory block containing the clusters can optionally be replaced by a compact
+ * (variable-length) copy of the clusters, which uses much less memory (see CompactScorePredictions).
+ *
+ * Relocalisation reads the clusters whilst holding a shared lock on predictionsMutex; anything that modifies them (or
+ * replaces the memory block) must hold an exclusive lock. If the clusters are double-buffered, training writes to the
+ * back buffer without holding the lock, and only takes an exclusive lock to swap the front and back buffers.
  */
 struct ScoreRelocaliserState
 {
@@ -29,17 +39,20 @@ struct ScoreRelocaliserState
 
   //#################### PUBLIC MEMBER VARIABLES ####################
 
+  /** A back buffer for predictionsBlock, into which new clusters are written during training (null unless the clusters are double-buffered). */
+  ScorePredictionsMemoryBlock_Ptr backPredictionsBlock;
+
+  /** A compact copy of the 3D modal clusters associated with each leaf in the forest (if predictionsBlock has been compacted). */
+  CompactScorePredictions_CPtr compactPredictions;
+
   /** The example reservoirs associated with each leaf in the forest. */
   Reservoirs_Ptr exampleReservoirs;
 
-  /** The index of the first reservoir that was clustered when the train function was last called. */
-  uint32_t lastExamplesAddedStartIdx;
-
-  /** A memory block storing the 3D modal clusters associated with each leaf in the forest. */
+  /** A memory block storing the 3D modal clusters associated with each leaf in the forest (null if it has been compacted). */
   ScorePredictionsMemoryBlock_Ptr predictionsBlock;
 
-  /** The index of the first reservoir to cluster when the relocaliser is updated. */
-  uint32_t reservoirUpdateStartIdx;
+  /** The mutex used to synchronise access to the clusters between relocalisation (readers) and training (writers). */
+  mutable boost::shared_mutex predictionsMutex;
 
   //#################### CONSTRUCTORS ####################
 
@@ -47,6 +60,21 @@ struct ScoreRelocaliserState
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 
+  /**
+   * \brief Replaces the memory block storing the 3D modal clusters associated with each leaf in the forest with a compact copy.
+   *
+   * \note  This is a no-op if the clusters have already been compacted.
+   * \note  The back buffer (if any) is released, since the clusters will not change any more.
+   */
+  void compact_predictions();
+
+  /**
+   * \brief Restores the memory block storing the 3D modal clusters associated with each leaf in the forest from its compact copy.
+   *
+   * \note  This is a no-op if the clusters have not been compacted.
+   */
+  void expand_predictions();
+
   /**
    * \brief Loads the relocaliser state from a folder on disk.
    *
@@ -56,6 +84,15 @@ struct ScoreRelocaliserState
    */
   void load_from_disk(const std::string& inputFolder);
 
+  /**
+   * \brief Loads the relocaliser state from a packed file.
+   *
+   * \param filename  The name of the packed file containing the relocaliser state.
+   *
+   * \throws std::runtime_error If loading the relocaliser state fails.
+   */
+  void load_from_packed_file(const std::string& filename);
+
   /**
    * \brief Saves the relocaliser state to a folder on disk.
    *
@@ -64,6 +101,19 @@ struct ScoreRelocaliserState
    * \throws std::runtime_error If saving the relocaliser state fails.
    */
   void save_to_disk(const std::string& outputFolder) const;
+
+  /**
+   * \brief Saves the relocaliser state to a packed file.
+   *
+   * \note  A packed file contains the reservoirs, the leaf predictions, the random number generator states and the
+   *        clustering indices in a single versioned and checksummed file. Packed files are much faster to load than
+   *        the loose files written by save_to_disk, since the data can be copied directly from the memory-mapped file.
+   *
+   * \param filename  The name of the packed file to which to save the relocaliser state.
+   *
+   * \throws std::runtime_error If saving the relocaliser state fails.
+   */
+  void save_to_packed_file(const std::string& filename) const;
 };
 
 //#################### TYPEDEFS ####################
@@ -31,6 +31,9 @@ public:
 
   //#################### PROTECTED MEMBER FUNCTIONS ####################
 protected:
+  /** Override */
+  virtual void copy_predictions(const ScorePredictionsMemoryBlock& source, ScorePredictionsMemoryBlock& target, const ORIntMemoryBlock_CPtr& indices, uint32_t count) const;
+
   /** Override */
   virtual uint32_t count_valid_depths(const ORFloatImage *depthImage) const;
 
@@ -6,6 +6,8 @@
 #ifndef H_GROVE_SCORERELOCALISER
 #define H_GROVE_SCORERELOCALISER
 
+#include <vector>
+
 #include <boost/optional.hpp>
 #include <boost/thread.hpp>
 
@@ -55,22 +57,71 @@ public:
   typedef DecisionForest<DescriptorType, FOREST_TREE_COUNT> ScoreForest;
   typedef boost::shared_ptr<ScoreForest> ScoreForest_Ptr;
 
-//#################### PRIVATE VARIABLES ####################
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the scratch buffers needed by a single call to relocalise.
+   *
+   * Each call to relocalise uses its own query context (taken from a pool of idle ones), so that several
+   * threads can relocalise against the same forest at once.
+   */
+  struct QueryContext
+  {
+    /** The image containing the descriptors extracted from the RGB-D image. */
+    RGBDPatchDescriptorImage_Ptr descriptorsImage;
+
+    /** The image containing the keypoints extracted from the RGB-D image. */
+    Keypoint3DColourImage_Ptr keypointsImage;
+
+    /** The number of references to the keypoints image that were held within the relocaliser when the context was last released. */
+    long keypointsImageUseCount;
+
+    /** The image containing the indices of the forest leaves associated with the keypoint/descriptor pairs. */
+    LeafIndicesImage_Ptr leafIndicesImage;
+
+    /** The Preemptive RANSAC instance, used to estimate the 6DOF camera pose from the keypoints and their associated SCoRe forest predictions. */
+    PreemptiveRansac_Ptr preemptiveRansac;
+
+    /** The image containing the forest predictions associated with the keypoint/descriptor pairs. */
+    ScorePredictionsImage_Ptr predictionsImage;
+
+    /** The number of references to the predictions image that were held within the relocaliser when the context was last released. */
+    long predictionsImageUseCount;
+  };
+
+  typedef boost::shared_ptr<QueryContext> QueryContext_Ptr;
+
+  //#################### PRIVATE VARIABLES ####################
 private:
-  /** The image containing the descriptors extracted from the RGB-D image. */
+  /** The image containing the descriptors extracted from the RGB-D image during training. */
   RGBDPatchDescriptorImage_Ptr m_descriptorsImage;
 
-  /** The image containing the keypoints extracted from the RGB-D image. */
+  /** Whether or not to double-buffer the leaf predictions, so that training never blocks relocalisation (at the cost of twice the memory). */
+  bool m_doubleBufferPredictions;
+
+  /** The query contexts that are not currently in use by any call to relocalise. */
+  mutable std::vector<QueryContext_Ptr> m_idleQueryContexts;
+
+  /** The image containing the keypoints extracted from the RGB-D image during training. */
   Keypoint3DColourImage_Ptr m_keypointsImage;
 
-  /** The image containing the indices of the forest leaves associated with the keypoint/descriptor pairs. */
-  mutable LeafIndicesImage_Ptr m_leafIndicesImage;
+  /** The query context used by the most recently completed call to relocalise (kept aside so that its results can be inspected). */
+  mutable QueryContext_Ptr m_lastQueryContext;
+
+  /** The image containing the indices of the forest leaves associated with the keypoint/descriptor pairs during training. */
+  LeafIndicesImage_Ptr m_leafIndicesImage;
+
+  /** The mutex used to synchronise access to the pool of query contexts. */
+  mutable boost::mutex m_queryContextMutex;
+
+  /** The namespace associated with the settings that are specific to the SCoRe relocaliser. */
+  std::string m_settingsNamespace;
 
-  /** The mutex used to synchronise access to the relocaliser in a multithreaded environment. */
-  mutable boost::recursive_mutex m_mutex;
+  /** The mutex used to serialise the calls that modify the relocaliser (training, updating, resetting, etc.). Calls to relocalise do not take it. */
+  mutable boost::recursive_mutex m_trainingMutex;
 
-  /** The image containing the forest predictions associated with the keypoint/descriptor pairs. */
-  mutable ScorePredictionsImage_Ptr m_predictionsImage;
+  /** The mutex used to synchronise updates to the forest visualisation images. */
+  mutable boost::mutex m_visualisationMutex;
 
   //#################### PROTECTED VARIABLES ####################
 protected:
@@ -83,6 +134,9 @@ protected:
   /** The maximum distance there can be between two examples that are part of the same cluster (used during clustering). */
   float m_clustererTau;
 
+  /** Whether or not to replace the leaf predictions with a compact (variable-length) copy of them when training finishes. */
+  bool m_compactPredictionsAfterTraining;
+
   /** The device on which the relocaliser should operate. */
   ORUtils::DeviceType m_deviceType;
 
@@ -98,7 +152,7 @@ protected:
   /** The maximum number of relocalisations to output for each call to the relocalise function. */
   uint32_t m_maxRelocalisationsToOutput;
 
-  /** The maximum number of reservoirs to subject to clustering for each call to the update function. */
+  /** The maximum number of reservoirs to subject to clustering for each call to the train or update function. */
   uint32_t m_maxReservoirsToUpdate;
 
   /** The maximum x, y and z coordinates visited by the camera during training. */
@@ -116,21 +170,24 @@ protected:
   /** An image in which to store a visualisation of the mapping from pixels to world-space points (for debugging purposes). */
   mutable ORUChar4Image_Ptr m_pixelsToPointsImage;
 
-  /** The Preemptive RANSAC instance, used to estimate the 6DOF camera pose from a set of 3D keypoints and their associated SCoRe forest predictions. */
-  PreemptiveRansac_Ptr m_preemptiveRansac;
-
   /** The state of the relocaliser. Can be replaced at runtime to relocalise (and train) in a different environment. */
   ScoreRelocaliserState_Ptr m_relocaliserState;
 
   /** The capacity (maximum size) of each reservoir associated with a leaf in the forest. */
   uint32_t m_reservoirCapacity;
 
+  /** A memory block in which to store the indices of the reservoirs to be clustered during a train/update call. */
+  ORIntMemoryBlock_Ptr m_reservoirIndicesToCluster;
+
   /** The total number of example reservoirs used by the relocaliser (in practice, this is equal to the number of leaves in the forest). */
   uint32_t m_reservoirCount;
 
   /** The seed for the random number generators used by the example reservoirs. */
   uint32_t m_rngSeed;
 
+  /** Whether or not to save the relocaliser's state to a single packed file (rather than to a set of loose files). */
+  bool m_saveStateAsPackedFile;
+
   /** The SCoRe forest on which the relocaliser is based. */
   ScoreForest_Ptr m_scoreForest;
 
@@ -172,6 +229,16 @@ protected:
    */
   virtual uint32_t count_valid_depths(const ORFloatImage *depthImage) const = 0;
 
+  /**
+   * \brief Copies the specified leaf predictions from one memory block to another.
+   *
+   * \param source    The memory block from which to copy the predictions.
+   * \param target    The memory block into which to copy the predictions.
+   * \param indices   The indices of the predictions to copy.
+   * \param count     The number of predictions to copy (the first count elements of indices are used).
+   */
+  virtual void copy_predictions(const ScorePredictionsMemoryBlock& source, ScorePredictionsMemoryBlock& target, const ORIntMemoryBlock_CPtr& indices, uint32_t count) const = 0;
+
   /**
    * \brief Merges the SCoRe predictions (sets of clusters) associated with each keypoint to create a single
    *        SCoRe prediction (a single set of clusters) for each keypoint.
@@ -197,15 +264,18 @@ public:
    *
    * \pre   This function should only be called after a prior call to relocalise.
    * \note  The first entry of the vector will be the candidate (if any) returned by the last run of P-RANSAC.
+   * \note  If several threads are relocalising at once, "the last run" refers to the most recently completed one.
    *
    * \param poseCandidates An output array that will be filled with the candidate poses as described.
    */
   void get_best_poses(std::vector<PoseCandidate>& poseCandidates) const;
 
   /**
-   * \brief Gets the image containing the keypoints extracted from the RGB-D image.
+   * \brief Gets the image containing the keypoints extracted from the RGB-D image by the most recently completed call to relocalise.
+   *
+   * \note  The image will not be modified by later calls to relocalise for as long as the caller holds on to it.
    *
-   * \return  The image containing the keypoints extracted from the RGB-D image.
+   * \return  The image containing the keypoints extracted from the RGB-D image (or null, if relocalise has not yet been called).
    */
   Keypoint3DColourImage_CPtr get_keypoints_image() const;
 
@@ -221,9 +291,11 @@ public:
   ScorePrediction get_prediction(uint32_t treeIdx, uint32_t leafIdx) const;
 
   /**
-   * \brief Gets the image containing the forest predictions associated with the keypoint/descriptor pairs.
+   * \brief Gets the image containing the forest predictions associated with the keypoint/descriptor pairs by the most recently completed call to relocalise.
    *
-   * \return  The image containing the forest predictions associated with the keypoint/descriptor pairs.
+   * \note  The image will not be modified by later calls to relocalise for as long as the caller holds on to it.
+   *
+   * \return  The image containing the forest predictions associated with the keypoint/descriptor pairs (or null, if relocalise has not yet been called).
    */
   ScorePredictionsImage_CPtr get_predictions_image() const;
 
@@ -278,11 +350,25 @@ public:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Computes the number of reservoirs to subject to clustering during a train/update call.
+   * \brief Takes an idle query context from the pool (making a new one if there aren't any).
+   *
+   * \return  The query context.
+   */
+  QueryContext_Ptr acquire_query_context() const;
+
+  /**
+   * \brief Clusters the examples in the dirtiest reservoirs (i.e. those to which the most examples have been added since they
+   *        were last clustered), and stores the resulting clusters in the leaf predictions.
+   *
+   * \note  At most m_maxReservoirsToUpdate reservoirs are clustered.
+   * \note  If the leaf predictions are double-buffered, the clusters are written to the back buffer, which is then swapped
+   *        with the front buffer. The front buffer is only locked for the duration of the swap, so that relocalisation
+   *        is never blocked by the clustering itself. Otherwise, the clusters are written to the leaf predictions directly,
+   *        and relocalisation is blocked whilst the clustering is in progress.
    *
-   * \return  The number of reservoirs to subject to clustering during a train/update call.
+   * \return  The number of reservoirs that are still dirty after clustering.
    */
-  uint32_t compute_nb_reservoirs_to_update() const;
+  uint32_t cluster_dirty_reservoirs();
 
   /**
    * \brief Checks whether or not the specified leaf is valid, and throws if not.
@@ -295,23 +381,47 @@ private:
   void ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) const;
 
   /**
-   * \brief Updates the pixels to leaves image (for debugging purposes).
+   * \brief Makes a new query context.
    *
-   * \param depthImage  The current depth image.
+   * \return  The query context.
    */
-  void update_pixels_to_leaves_image(const ORFloatImage *depthImage) const;
+  QueryContext_Ptr make_query_context() const;
 
   /**
-   * \brief Updates the pixels to points image (for debugging purposes).
+   * \brief Returns a query context that is no longer needed by a call to relocalise.
+   *
+   * \note  The context becomes the "last" query context (whose results can be inspected via get_best_poses, etc.),
+   *        and the previous last query context (if any) is returned to the pool of idle contexts, unless any of its
+   *        images are still referenced outside the relocaliser, in which case it is discarded.
    *
-   * \param worldToCamera The relocalised pose.
+   * \param queryContext  The query context.
    */
-  void update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera) const;
+  void release_query_context(const QueryContext_Ptr& queryContext) const;
 
   /**
-   * \brief Updates the index of the first reservoir to subject to clustering during the next train/update call.
+   * \brief Makes the back buffer of the leaf predictions (if they are double-buffered) an exact copy of the front buffer.
+   *
+   * \pre   The caller must hold an exclusive lock on the predictions mutex of the relocaliser's state.
+   */
+  void synchronise_back_predictions();
+
+  /**
+   * \brief Updates the pixels to leaves image (for debugging purposes).
+   *
+   * \param depthImage        The current depth image.
+   * \param leafIndicesImage  The image containing the indices of the forest leaves associated with the keypoint/descriptor pairs.
+   */
+  void update_pixels_to_leaves_image(const ORFloatImage *depthImage, const LeafIndicesImage_CPtr& leafIndicesImage) const;
+
+  /**
+   * \brief Updates the pixels to points image (for debugging purposes).
+   *
+   * \param worldToCamera     The relocalised pose.
+   * \param keypointsImage    The image containing the keypoints extracted from the RGB-D image.
+   * \param predictionsImage  The image containing the forest predictions associated with the keypoint/descriptor pairs.
    */
-  void update_reservoir_start_idx();
+  void update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera, const Keypoint3DColourImage_CPtr& keypointsImage,
+                                     const ScorePredictionsImage_CPtr& predictionsImage) const;
 };
 
 //#################### TYPEDEFS ####################
@@ -11,41 +11,45 @@
 namespace grove {
 
 /**
- * \brief Merges the SCoRe predictions associated with the specified keypoint into a single SCoRe prediction.
- *
- * \note  Each keypoint will have a SCoRe prediction (set of clusters) from each tree in the forest, obtained by passing
- *        the keypoint's descriptor down each tree and collecting a SCoRe prediction from each resulting leaf.
- * \note  Merging is performed by taking the largest clusters from each leaf. The assumption is that the modal cluters in
- *        each leaf are already sorted in non-increasing order of size.
+ * \brief Copies the specified leaf prediction from one array of predictions to another.
  *
- * \param x                 The x coordinate of the keypoint.
- * \param y                 The y coordinate of the keypoint.
- * \param leafIndices       A pointer to the image containing the indices of the leaves (in the different trees) associated with each keypoint/descriptor pair.
- * \param predictionsBlock  A pointer to the storage area holding all of the SCoRe predictions associated with the forest leaves.
- * \param imgSize           The dimensions of the leafIndices and outputPredictions images.
- * \param maxClusterCount   The maximum number of clusters to keep for each output prediction.
- * \param outputPredictions A pointer to the image into which to store the merged SCoRe predictions.
+ * \param i       The index (within indices) of the index of the prediction to copy.
+ * \param indices The indices of the predictions to copy.
+ * \param source  The array of predictions from which to copy.
+ * \param target  The array of predictions into which to copy.
  */
-template <int TREE_COUNT>
-_CPU_AND_GPU_CODE_TEMPLATE_
-inline void merge_predictions_for_keypoint(int x, int y, const ORUtils::VectorX<int,TREE_COUNT> *leafIndices, const ScorePrediction *predictionsBlock,
-                                           Vector2i imgSize, int maxClusterCount, ScorePrediction *outputPredictions)
+_CPU_AND_GPU_CODE_
+inline void copy_prediction(int i, const int *indices, const ScorePrediction *source, ScorePrediction *target)
 {
-  typedef ORUtils::VectorX<int,TREE_COUNT> LeafIndices;
-
-  // Compute the raster index of the keypoint whose predictions we want to merge.
-  const int keypointRasterIdx = y * imgSize.width + x;
-
-  // Copy the leaf indices associated with the keypoint into a local array.
-  const LeafIndices leafIndicesForKeypoint = leafIndices[keypointRasterIdx];
+  const int predictionIdx = indices[i];
+  const ScorePrediction& sourcePrediction = source[predictionIdx];
+  ScorePrediction& targetPrediction = target[predictionIdx];
 
-  // Make an array of pointers to the input predictions associated with the keypoint's leaves (this makes indexing easier later).
-  const ScorePrediction *inputPredictions[TREE_COUNT];
-  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  // Note that only the valid clusters need to be copied.
+  targetPrediction.size = sourcePrediction.size;
+  for(int j = 0; j < sourcePrediction.size; ++j)
   {
-    inputPredictions[treeIdx] = &predictionsBlock[leafIndicesForKeypoint[treeIdx]];
+    targetPrediction.elts[j] = sourcePrediction.elts[j];
   }
+}
 
+/**
+ * \brief Merges a set of input SCoRe predictions (one per tree) into a single SCoRe prediction.
+ *
+ * \note  Merging is performed by taking the largest clusters from each input prediction. The assumption is that the
+ *        modal clusters in each input prediction are already sorted in non-increasing order of size.
+ * \note  The input predictions are specified as (modes, size) pairs so that this can be shared between the different
+ *        ways in which the leaf predictions can be stored.
+ *
+ * \param inputModes        An array of pointers to the modes of each input prediction.
+ * \param inputSizes        An array containing the number of modes in each input prediction.
+ * \param maxClusterCount   The maximum number of clusters to keep for the output prediction.
+ * \param outputPrediction  The location into which to store the merged SCoRe prediction.
+ */
+template <int TREE_COUNT>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline void merge_predictions(const Keypoint3DColourCluster *const *inputModes, const int *inputSizes, int maxClusterCount, ScorePrediction& outputPrediction)
+{
   // Make an array of indices in which each element denotes the current mode to consider in each of the input predictions.
   // Initially, this will be the first/biggest mode in each prediction. Our strategy will be to repeatedly copy the biggest
   // remaining mode (across all the input predictions) across to the output prediction until the output prediction is full.
@@ -56,8 +60,7 @@ inline void merge_predictions_for_keypoint(int x, int y, const ORUtils::VectorX<
     currentModeIndices[treeIdx] = 0;
   }
 
-  // Grab a reference to the output prediction, and set its initial size to zero.
-  ScorePrediction& outputPrediction = outputPredictions[keypointRasterIdx];
+  // Set the initial size of the output prediction to zero.
   outputPrediction.size = 0;
 
   // While the output prediction is not yet full:
@@ -73,9 +76,9 @@ inline void merge_predictions_for_keypoint(int x, int y, const ORUtils::VectorX<
       const int currentModeIdx = currentModeIndices[treeIdx];
 
       // If we've already considered all of the modes for this input prediction, skip it and continue.
-      if(currentModeIdx >= inputPredictions[treeIdx]->size) continue;
+      if(currentModeIdx >= inputSizes[treeIdx]) continue;
 
-      const Keypoint3DColourCluster& currentMode = inputPredictions[treeIdx]->elts[currentModeIdx];
+      const Keypoint3DColourCluster& currentMode = inputModes[treeIdx][currentModeIdx];
 
       // If the biggest as-yet-unprocessed mode for this input prediction has more inliers than the current best mode:
       if(currentMode.nbInliers > bestNbInliers)
@@ -90,11 +93,95 @@ inline void merge_predictions_for_keypoint(int x, int y, const ORUtils::VectorX<
     if(bestNbInliers == 0) break;
 
     // Otherwise, copy the chosen mode into the output prediction, and increment the current mode index for the associated input prediction.
-    outputPrediction.elts[outputPrediction.size++] = inputPredictions[bestTreeIdx]->elts[currentModeIndices[bestTreeIdx]];
+    outputPrediction.elts[outputPrediction.size++] = inputModes[bestTreeIdx][currentModeIndices[bestTreeIdx]];
     ++currentModeIndices[bestTreeIdx];
   }
 }
 
+/**
+ * \brief Merges the SCoRe predictions associated with the specified keypoint into a single SCoRe prediction.
+ *
+ * \note  Each keypoint will have a SCoRe prediction (set of clusters) from each tree in the forest, obtained by passing
+ *        the keypoint's descriptor down each tree and collecting a SCoRe prediction from each resulting leaf.
+ * \note  Merging is performed by taking the largest clusters from each leaf. The assumption is that the modal cluters in
+ *        each leaf are already sorted in non-increasing order of size.
+ *
+ * \param x                 The x coordinate of the keypoint.
+ * \param y                 The y coordinate of the keypoint.
+ * \param leafIndices       A pointer to the image containing the indices of the leaves (in the different trees) associated with each keypoint/descriptor pair.
+ * \param predictionsBlock  A pointer to the storage area holding all of the SCoRe predictions associated with the forest leaves.
+ * \param imgSize           The dimensions of the leafIndices and outputPredictions images.
+ * \param maxClusterCount   The maximum number of clusters to keep for each output prediction.
+ * \param outputPredictions A pointer to the image into which to store the merged SCoRe predictions.
+ */
+template <int TREE_COUNT>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline void merge_predictions_for_keypoint(int x, int y, const ORUtils::VectorX<int,TREE_COUNT> *leafIndices, const ScorePrediction *predictionsBlock,
+                                           Vector2i imgSize, int maxClusterCount, ScorePrediction *outputPredictions)
+{
+  typedef ORUtils::VectorX<int,TREE_COUNT> LeafIndices;
+
+  // Compute the raster index of the keypoint whose predictions we want to merge.
+  const int keypointRasterIdx = y * imgSize.width + x;
+
+  // Copy the leaf indices associated with the keypoint into a local array.
+  const LeafIndices leafIndicesForKeypoint = leafIndices[keypointRasterIdx];
+
+  // Look up the modes and sizes of the input predictions associated with the keypoint's leaves.
+  const Keypoint3DColourCluster *inputModes[TREE_COUNT];
+  int inputSizes[TREE_COUNT];
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    const ScorePrediction& inputPrediction = predictionsBlock[leafIndicesForKeypoint[treeIdx]];
+    inputModes[treeIdx] = inputPrediction.elts;
+    inputSizes[treeIdx] = inputPrediction.size;
+  }
+
+  // Merge the input predictions into the output prediction.
+  merge_predictions<TREE_COUNT>(inputModes, inputSizes, maxClusterCount, outputPredictions[keypointRasterIdx]);
+}
+
+/**
+ * \brief Merges the SCoRe predictions associated with the specified keypoint into a single SCoRe prediction,
+ *        reading the leaf predictions from a compact (CSR-style) store.
+ *
+ * \param x                 The x coordinate of the keypoint.
+ * \param y                 The y coordinate of the keypoint.
+ * \param leafIndices       A pointer to the image containing the indices of the leaves (in the different trees) associated with each keypoint/descriptor pair.
+ * \param leafModeOffsets   The offsets of the first mode of each leaf prediction in leafModes (see CompactScorePredictions).
+ * \param leafModes         The packed modes of all of the leaf predictions.
+ * \param imgSize           The dimensions of the leafIndices and outputPredictions images.
+ * \param maxClusterCount   The maximum number of clusters to keep for each output prediction.
+ * \param outputPredictions A pointer to the image into which to store the merged SCoRe predictions.
+ */
+template <int TREE_COUNT>
+_CPU_AND_GPU_CODE_TEMPLATE_
+inline void merge_predictions_for_keypoint(int x, int y, const ORUtils::VectorX<int,TREE_COUNT> *leafIndices, const uint32_t *leafModeOffsets,
+                                           const Keypoint3DColourCluster *leafModes, Vector2i imgSize, int maxClusterCount,
+                                           ScorePrediction *outputPredictions)
+{
+  typedef ORUtils::VectorX<int,TREE_COUNT> LeafIndices;
+
+  // Compute the raster index of the keypoint whose predictions we want to merge.
+  const int keypointRasterIdx = y * imgSize.width + x;
+
+  // Copy the leaf indices associated with the keypoint into a local array.
+  const LeafIndices leafIndicesForKeypoint = leafIndices[keypointRasterIdx];
+
+  // Look up the modes and sizes of the input predictions associated with the keypoint's leaves.
+  const Keypoint3DColourCluster *inputModes[TREE_COUNT];
+  int inputSizes[TREE_COUNT];
+  for(int treeIdx = 0; treeIdx < TREE_COUNT; ++treeIdx)
+  {
+    const int leafIdx = leafIndicesForKeypoint[treeIdx];
+    inputModes[treeIdx] = leafModes + leafModeOffsets[leafIdx];
+    inputSizes[treeIdx] = static_cast<int>(leafModeOffsets[leafIdx + 1] - leafModeOffsets[leafIdx]);
+  }
+
+  // Merge the input predictions into the output prediction.
+  merge_predictions<TREE_COUNT>(inputModes, inputSizes, maxClusterCount, outputPredictions[keypointRasterIdx]);
+}
+
 }
 
 #endif
@@ -13,6 +13,8 @@ namespace bf = boost::filesystem;
 #include <orx/base/MemoryBlockFactory.h>
 
 #include "../shared/ExampleReservoirs_Shared.h"
+#include "../../util/PackedFileReader.h"
+#include "../../util/PackedFileWriter.h"
 
 namespace grove {
 
@@ -92,6 +94,13 @@ void ExampleReservoirs_CPU<ExampleType>::load_from_disk_sub(const std::string& i
   ORUtils::MemoryBlockPersister::LoadMemoryBlock((inputPath / "reservoirRngs.bin").string(), *m_rngs, MEMORYDEVICE_CPU);
 }
 
+template<typename ExampleType>
+void ExampleReservoirs_CPU<ExampleType>::load_from_packed_file_sub(const PackedFileReader& reader)
+{
+  // Load the RNG states.
+  reader.read_memory_block("reservoirs.rngs", *m_rngs);
+}
+
 template <typename ExampleType>
 void ExampleReservoirs_CPU<ExampleType>::reinit_rngs()
 {
@@ -112,4 +121,11 @@ void ExampleReservoirs_CPU<ExampleType>::save_to_disk_sub(const std::string& out
   ORUtils::MemoryBlockPersister::SaveMemoryBlock((outputPath / "reservoirRngs.bin").string(), *m_rngs, MEMORYDEVICE_CPU);
 }
 
+template<typename ExampleType>
+void ExampleReservoirs_CPU<ExampleType>::save_to_packed_file_sub(PackedFileWriter& writer)
+{
+  // Save the RNG states.
+  writer.add_memory_block("reservoirs.rngs", *m_rngs);
+}
+
 }
@@ -58,6 +58,9 @@ private:
   /** Override */
   virtual void load_from_disk_sub(const std::string& inputFolder);
 
+  /** Override */
+  virtual void load_from_packed_file_sub(const PackedFileReader& reader);
+
   /**
    * \brief Reinitialises the random number generators using known seeds.
    */
@@ -66,6 +69,9 @@ private:
   /** Override */
   virtual void save_to_disk_sub(const std::string& outputFolder);
 
+  /** Override */
+  virtual void save_to_packed_file_sub(PackedFileWriter& writer);
+
   //#################### FRIENDS ####################
 
   friend class ExampleReservoirs<ExampleType>;
@@ -6,6 +6,8 @@
 #ifndef H_GROVE_EXAMPLERESERVOIRS
 #define H_GROVE_EXAMPLERESERVOIRS
 
+#include <vector>
+
 #include <orx/base/ORImagePtrTypes.h>
 #include <orx/base/ORMemoryBlockPtrTypes.h>
 
@@ -15,6 +17,8 @@ namespace grove {
 
 template <typename ExampleType> class ExampleReservoirs_CPU;
 template <typename ExampleType> class ExampleReservoirs_CUDA;
+class PackedFileReader;
+class PackedFileWriter;
 
 /**
  * \brief An instance of a class deriving from this one can be used to store a number of examples in a set of fixed-size reservoirs.
@@ -64,6 +68,40 @@ private:
 #endif
   };
 
+  /**
+   * \brief A comparator that orders reservoir indices by decreasing dirty count (breaking ties in favour of lower indices).
+   */
+  struct DirtierThan
+  {
+    const std::vector<uint32_t> *dirtyCounts;
+
+    explicit DirtierThan(const std::vector<uint32_t>& dirtyCounts_)
+    : dirtyCounts(&dirtyCounts_)
+    {}
+
+    bool operator()(uint32_t lhs, uint32_t rhs) const
+    {
+      const uint32_t lhsCount = (*dirtyCounts)[lhs], rhsCount = (*dirtyCounts)[rhs];
+      return lhsCount > rhsCount || (lhsCount == rhsCount && lhs < rhs);
+    }
+  };
+
+  //#################### PRIVATE MEMBER VARIABLES ####################
+private:
+  /**
+   * The number of times the insertion of an example had been attempted for each reservoir when it was last marked as clean. Has an
+   * element for each reservoir. A reservoir's dirty count is the number of insertions that have been attempted for it since then.
+   * This is maintained on the CPU, and compared with m_reservoirAddCalls (which is maintained on whichever device the reservoirs are
+   * using) only when deciding which reservoirs to recluster, so that adding examples never requires a copy from the device.
+   */
+  std::vector<int> m_cleanAddCalls;
+
+  /** The dirty count of each reservoir, as of the last call to take_dirtiest_reservoirs (used as scratch space by that function). */
+  std::vector<uint32_t> m_dirtyCounts;
+
+  /** The indices of the dirty reservoirs, as of the last call to take_dirtiest_reservoirs (used as scratch space by that function). */
+  std::vector<uint32_t> m_dirtyReservoirs;
+
   //#################### PROTECTED MEMBER VARIABLES ####################
 protected:
   /** The capacity (maximum size) of each reservoir. */
@@ -120,6 +158,15 @@ private:
    */
   virtual void load_from_disk_sub(const std::string& inputFolder) = 0;
 
+  /**
+   * \brief An overridable hook function that is called at the end of load_from_packed_file to allow subclasses to perform additional loading steps.
+   *
+   * \param reader  A reader for the packed file containing the reservoir state.
+   *
+   * \throws std::runtime_error If the loading fails.
+   */
+  virtual void load_from_packed_file_sub(const PackedFileReader& reader) = 0;
+
   /**
    * \brief An overridable hook function that is called at the end of save_to_disk to allow subclasses to perform additional saving steps.
    *
@@ -129,6 +176,13 @@ private:
    */
   virtual void save_to_disk_sub(const std::string& outputFolder) = 0;
 
+  /**
+   * \brief An overridable hook function that is called at the end of save_to_packed_file to allow subclasses to add additional chunks.
+   *
+   * \param writer  The writer for the packed file into which to save the reservoir state.
+   */
+  virtual void save_to_packed_file_sub(PackedFileWriter& writer) = 0;
+
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -196,6 +250,15 @@ public:
    */
   void load_from_disk(const std::string& inputFolder);
 
+  /**
+   * \brief Loads the reservoir state from a packed file.
+   *
+   * \param reader  A reader for the packed file containing the reservoir state.
+   *
+   * \throws std::runtime_error If the loading fails.
+   */
+  void load_from_packed_file(const PackedFileReader& reader);
+
   /**
    * \brief Clears the reservoirs, discards all examples and reinitialises the random number generators.
    */
@@ -209,6 +272,35 @@ public:
    * \throws std::runtime_error If the saving fails.
    */
   void save_to_disk(const std::string& outputFolder);
+
+  /**
+   * \brief Adds the reservoir state to a packed file that is about to be written.
+   *
+   * \note  The writer refers to the reservoirs' CPU memory, so the reservoirs must not be modified until the file has been written.
+   *
+   * \param writer  The writer for the packed file into which to save the reservoir state.
+   */
+  void save_to_packed_file(PackedFileWriter& writer);
+
+  /**
+   * \brief Marks the dirtiest reservoirs (i.e. those to which the most examples have been added since they were last marked as clean) as clean.
+   *
+   * \note  This is intended to be used to decide which reservoirs to recluster next. Ties are broken in favour of reservoirs with lower indices.
+   *        If the reservoirs are on the GPU, this copies the number of add calls for each reservoir across to the CPU (this is the only
+   *        copy from the GPU that is needed to track which reservoirs are dirty).
+   *
+   * \param maxCount  The maximum number of reservoirs to mark as clean.
+   * \param indices   A vector into which to write the indices of the reservoirs that have been marked as clean (in ascending order).
+   * \return          The number of reservoirs that are still dirty.
+   */
+  uint32_t take_dirtiest_reservoirs(uint32_t maxCount, std::vector<uint32_t>& indices);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Marks every non-empty reservoir as dirty, e.g. after the reservoirs have been loaded.
+   */
+  void mark_non_empty_reservoirs_dirty();
 };
 
 }
@@ -5,6 +5,8 @@
 
 #include "ExampleReservoirs.h"
 
+#include <algorithm>
+
 #include <boost/filesystem.hpp>
 namespace bf = boost::filesystem;
 
@@ -12,6 +14,9 @@ namespace bf = boost::filesystem;
 
 #include <orx/base/MemoryBlockFactory.h>
 
+#include "../../util/PackedFileReader.h"
+#include "../../util/PackedFileWriter.h"
+
 namespace grove {
 
 //#################### CONSTRUCTORS ####################
@@ -26,6 +31,10 @@ ExampleReservoirs<ExampleType>::ExampleReservoirs(uint32_t reservoirCount, uint3
   m_reservoirs = mbf.make_image<ExampleType>(Vector2i(reservoirCapacity, reservoirCount));
   m_reservoirAddCalls = mbf.make_block<int>(reservoirCount);
   m_reservoirSizes = mbf.make_block<int>(reservoirCount);
+
+  // Initially, none of the reservoirs is dirty.
+  m_cleanAddCalls.resize(reservoirCount, 0);
+  m_dirtyCounts.resize(reservoirCount, 0);
 }
 
 //#################### DESTRUCTOR ####################
@@ -57,6 +66,9 @@ void ExampleReservoirs<ExampleType>::add_examples(const ExampleImage_CPtr& examp
   add_examples(examples, reservoirIndicesConst);
 }
 
+  return dirtyReservoirCount;
+}
+
 template <typename ExampleType>
 uint32_t ExampleReservoirs<ExampleType>::get_reservoir_capacity() const
 {
@@ -96,16 +108,41 @@ void ExampleReservoirs<ExampleType>::load_from_disk(const std::string& inputFold
   m_reservoirAddCalls->UpdateDeviceFromHost();
   m_reservoirSizes->UpdateDeviceFromHost();
 
+  // Since we don't know which of the loaded reservoirs were clustered before they were saved, we mark them all as dirty.
+  mark_non_empty_reservoirs_dirty();
+
   // Call the overridable hook function to allow subclasses to perform additional loading steps.
   load_from_disk_sub(inputFolder);
 }
 
+template <typename ExampleType>
+void ExampleReservoirs<ExampleType>::load_from_packed_file(const PackedFileReader& reader)
+{
+  // Copy the data from the file into memory on the CPU.
+  reader.read_memory_block("reservoirs.examples", *m_reservoirs);
+  reader.read_memory_block("reservoirs.addCalls", *m_reservoirAddCalls);
+  reader.read_memory_block("reservoirs.sizes", *m_reservoirSizes);
+
+  // If we're using the GPU, copy the data across.
+  m_reservoirs->UpdateDeviceFromHost();
+  m_reservoirAddCalls->UpdateDeviceFromHost();
+  m_reservoirSizes->UpdateDeviceFromHost();
+
+  // Since we don't know which of the loaded reservoirs were clustered before they were saved, we mark them all as dirty.
+  mark_non_empty_reservoirs_dirty();
+
+  // Call the overridable hook function to allow subclasses to perform additional loading steps.
+  load_from_packed_file_sub(reader);
+}
+
 template <typename ExampleType>
 void ExampleReservoirs<ExampleType>::reset()
 {
   // Note: There is no need to clear m_reservoirs - it is sufficient to simply reset the size of each reservoir to 0.
   m_reservoirAddCalls->Clear();
   m_reservoirSizes->Clear();
+
+  std::fill(m_cleanAddCalls.begin(), m_cleanAddCalls.end(), 0);
 }
 
 template<typename ExampleType>
@@ -127,4 +164,75 @@ void ExampleReservoirs<ExampleType>::save_to_disk(const std::string& outputFolde
   save_to_disk_sub(outputFolder);
 }
 
+template <typename ExampleType>
+void ExampleReservoirs<ExampleType>::save_to_packed_file(PackedFileWriter& writer)
+{
+  // If we're using the GPU, copy the data across to the CPU so that it can be saved.
+  m_reservoirs->UpdateHostFromDevice();
+  m_reservoirAddCalls->UpdateHostFromDevice();
+  m_reservoirSizes->UpdateHostFromDevice();
+
+  // Add the data to the file.
+  writer.add_memory_block("reservoirs.examples", *m_reservoirs);
+  writer.add_memory_block("reservoirs.addCalls", *m_reservoirAddCalls);
+  writer.add_memory_block("reservoirs.sizes", *m_reservoirSizes);
+
+  // Call the overridable hook function to allow subclasses to add additional chunks.
+  save_to_packed_file_sub(writer);
+}
+
+template <typename ExampleType>
+uint32_t ExampleReservoirs<ExampleType>::take_dirtiest_reservoirs(uint32_t maxCount, std::vector<uint32_t>& indices)
+{
+  indices.clear();
+
+  // Determine the dirty count of each reservoir by comparing its current number of add calls with the number it had
+  // when it was last marked as clean, and make a list of the reservoirs that are dirty.
+  m_reservoirAddCalls->UpdateHostFromDevice();
+  const int *reservoirAddCalls = m_reservoirAddCalls->GetData(MEMORYDEVICE_CPU);
+
+  m_dirtyReservoirs.clear();
+  for(uint32_t i = 0; i < m_reservoirCount; ++i)
+  {
+    m_dirtyCounts[i] = static_cast<uint32_t>(reservoirAddCalls[i] - m_cleanAddCalls[i]);
+    if(m_dirtyCounts[i] > 0) m_dirtyReservoirs.push_back(i);
+  }
+
+  // If there are more dirty reservoirs than we need, move the dirtiest ones to the front of the list. Since the
+  // dirty counts change after every call to add_examples, a partial selection over the dirty reservoirs is cheaper
+  // than maintaining a priority queue (we have to scan all of the reservoirs to find the dirty ones in any case,
+  // since their add call counters are updated on the device on which the reservoirs are stored).
+  if(m_dirtyReservoirs.size() > maxCount)
+  {
+    std::nth_element(m_dirtyReservoirs.begin(), m_dirtyReservoirs.begin() + maxCount, m_dirtyReservoirs.end(), DirtierThan(m_dirtyCounts));
+  }
+
+  // Take the reservoirs at the front of the list and mark them as clean.
+  const size_t count = std::min<size_t>(maxCount, m_dirtyReservoirs.size());
+  indices.assign(m_dirtyReservoirs.begin(), m_dirtyReservoirs.begin() + count);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    m_cleanAddCalls[indices[i]] = reservoirAddCalls[indices[i]];
+  }
+
+  std::sort(indices.begin(), indices.end());
+
+  return static_cast<uint32_t>(m_dirtyReservoirs.size() - count);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+template <typename ExampleType>
+void ExampleReservoirs<ExampleType>::mark_non_empty_reservoirs_dirty()
+{
+  // Treat each reservoir as if it were clean before its current examples were added to it, so that its dirty count is its size.
+  const int *reservoirAddCalls = m_reservoirAddCalls->GetData(MEMORYDEVICE_CPU);
+  const int *reservoirSizes = m_reservoirSizes->GetData(MEMORYDEVICE_CPU);
+  for(uint32_t i = 0; i < m_reservoirCount; ++i)
+  {
+    m_cleanAddCalls[i] = reservoirAddCalls[i] - reservoirSizes[i];
+  }
+}
+
 }
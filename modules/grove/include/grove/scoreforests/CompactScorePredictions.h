@@ -0,0 +1,107 @@
+/**
+ * grove: CompactScorePredictions.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_COMPACTSCOREPREDICTIONS
+#define H_GROVE_COMPACTSCOREPREDICTIONS
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "ScorePrediction.h"
+
+namespace grove {
+
+/**
+ * \brief An instance of this class stores a set of SCoRe forest predictions in a compact, variable-length form.
+ *
+ * A ScorePrediction always reserves space for ScorePrediction::Capacity modes, even though most leaves in a trained
+ * forest only contain a handful of them. This class instead stores the predictions in a CSR-style layout: the modes
+ * of all of the predictions are packed contiguously, and an array of offsets records where the modes of each
+ * prediction start (with a final entry marking the end of the packed modes).
+ *
+ * \note  The modes of each prediction are stored in the same order as in the original prediction.
+ */
+class CompactScorePredictions
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The offsets of the first mode of each prediction in m_modes (with an additional final entry equal to the total number of modes). */
+  std::vector<uint32_t> m_offsets;
+
+  /** The modes of all of the predictions, packed contiguously. */
+  std::vector<Keypoint3DColourCluster> m_modes;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a compact copy of the predictions in the specified memory block.
+   *
+   * \note  The CPU copy of the memory block must be up-to-date.
+   *
+   * \param predictionsBlock  The memory block containing the predictions to pack.
+   */
+  explicit CompactScorePredictions(const ScorePredictionsMemoryBlock& predictionsBlock);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Unpacks the predictions into the specified memory block.
+   *
+   * \note  The memory block is resized if necessary. Only its CPU copy is updated.
+   *
+   * \param predictionsBlock  The memory block into which to unpack the predictions.
+   */
+  void expand(ScorePredictionsMemoryBlock& predictionsBlock) const;
+
+  /**
+   * \brief Gets the total amount of memory (in bytes) used to store the predictions.
+   *
+   * \return  The total amount of memory (in bytes) used to store the predictions.
+   */
+  size_t get_memory_usage() const;
+
+  /**
+   * \brief Gets the packed modes of all of the predictions.
+   *
+   * \return  A pointer to the packed modes of all of the predictions.
+   */
+  const Keypoint3DColourCluster *get_modes() const;
+
+  /**
+   * \brief Gets the offsets of the first mode of each prediction in the array returned by get_modes.
+   *
+   * \note  The modes of prediction i are in the range [offsets[i], offsets[i+1]).
+   *
+   * \return  A pointer to the offsets (there are get_prediction_count() + 1 of them).
+   */
+  const uint32_t *get_offsets() const;
+
+  /**
+   * \brief Gets the specified prediction in its original (fixed-capacity) form.
+   *
+   * \param predictionIdx The index of the prediction.
+   * \return              The prediction.
+   *
+   * \throws std::invalid_argument  If predictionIdx is out of range.
+   */
+  ScorePrediction get_prediction(uint32_t predictionIdx) const;
+
+  /**
+   * \brief Gets the number of predictions that are stored.
+   *
+   * \return  The number of predictions that are stored.
+   */
+  uint32_t get_prediction_count() const;
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<CompactScorePredictions> CompactScorePredictions_Ptr;
+typedef boost::shared_ptr<const CompactScorePredictions> CompactScorePredictions_CPtr;
+
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * grove: PackedFileFormat.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_PACKEDFILEFORMAT
+#define H_GROVE_PACKEDFILEFORMAT
+
+#include <boost/cstdint.hpp>
+
+namespace grove {
+
+/**
+ * \brief This struct describes the on-disk layout of a packed file.
+ *
+ * A packed file consists of a fixed-size header, followed by a table of chunk descriptors, followed by the data for
+ * each chunk. The data for each chunk starts at an offset that is a multiple of ChunkAlignment, so that a memory-mapped
+ * chunk can be accessed directly as an array of the type it stores. Each chunk is protected by a CRC-32 checksum.
+ *
+ * \note  All values are stored in the native byte order of the machine that wrote the file.
+ */
+struct PackedFileFormat
+{
+  //#################### CONSTANTS ####################
+
+  /** The alignment (in bytes) of the data for each chunk. */
+  static const boost::uint64_t ChunkAlignment = 64;
+
+  /** The maximum length of a chunk name (including the terminating null character). */
+  static const size_t MaxChunkNameLength = 32;
+
+  /** The current version of the format. */
+  static const boost::uint32_t Version = 1;
+
+  //#################### NESTED TYPES ####################
+
+  /**
+   * \brief An instance of this struct describes a single chunk in a packed file.
+   */
+  struct ChunkDescriptor
+  {
+    /** The name of the chunk (null-terminated). */
+    char name[MaxChunkNameLength];
+
+    /** The offset of the chunk data from the start of the file. */
+    boost::uint64_t offset;
+
+    /** The size of the chunk data (in bytes). */
+    boost::uint64_t size;
+
+    /** The CRC-32 checksum of the chunk data. */
+    boost::uint32_t checksum;
+
+    /** Unused (ensures that the size of the struct is the same on all platforms). */
+    boost::uint32_t reserved;
+  };
+
+  /**
+   * \brief An instance of this struct represents the header of a packed file.
+   */
+  struct Header
+  {
+    /** The magic bytes that identify a packed file ("GROVEPKD"). */
+    char magic[8];
+
+    /** The version of the format used by the file. */
+    boost::uint32_t version;
+
+    /** The number of chunks in the file. */
+    boost::uint32_t chunkCount;
+  };
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Gets the magic bytes that identify a packed file.
+   *
+   * \return  The magic bytes that identify a packed file (not null-terminated).
+   */
+  static const char *magic()
+  {
+    return "GROVEPKD";
+  }
+};
+
+}
+
+#endif
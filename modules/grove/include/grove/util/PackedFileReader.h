@@ -0,0 +1,145 @@
+/**
+ * grove: PackedFileReader.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_PACKEDFILEREADER
+#define H_GROVE_PACKEDFILEREADER
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ORUtils/MemoryBlock.h>
+
+#include "PackedFileFormat.h"
+
+namespace grove {
+
+/**
+ * \brief An instance of this class provides read-only access to the chunks stored in a packed file.
+ *
+ * The file is memory-mapped rather than read, so the chunks can be accessed in place without first being copied
+ * into memory. Pointers to chunk data remain valid for as long as the reader (or a copy of it) exists.
+ *
+ * \note  The mapping is deliberately hidden behind an opaque pointer to avoid including the Boost.Interprocess
+ *        headers here, since this header is also included by code that is compiled using NVCC.
+ */
+class PackedFileReader
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The descriptors of the chunks in the file, indexed by name. */
+  std::map<std::string,PackedFileFormat::ChunkDescriptor> m_chunks;
+
+  /** A pointer to the start of the region of memory into which the file has been mapped. */
+  const char *m_data;
+
+  /** The name of the file. */
+  std::string m_filename;
+
+  /** An opaque handle that keeps the file mapped into memory for as long as it exists. */
+  boost::shared_ptr<void> m_mapping;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Opens a packed file.
+   *
+   * \param filename        The name of the file.
+   * \param verifyChecksums Whether or not to verify the checksums of all of the chunks in the file when it is opened.
+   *
+   * \throws std::runtime_error If the file cannot be opened, is not a packed file, has an unsupported version or is corrupt.
+   */
+  explicit PackedFileReader(const std::string& filename, bool verifyChecksums = true);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Determines whether or not the specified file is a packed file (based on its magic bytes).
+   *
+   * \param filename  The name of the file.
+   * \return          true, if the file exists and is a packed file, or false otherwise.
+   */
+  static bool is_packed_file(const std::string& filename);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets a pointer to the data for the specified chunk.
+   *
+   * \param name  The name of the chunk.
+   * \param size  A location into which to write the size of the chunk data (in bytes).
+   * \return      A pointer to the chunk data.
+   *
+   * \throws std::runtime_error If the file does not contain the specified chunk.
+   */
+  const void *get_chunk(const std::string& name, size_t& size) const;
+
+  /**
+   * \brief Gets a pointer to the data for the specified chunk, interpreted as an array of elements of the specified type.
+   *
+   * \param name  The name of the chunk.
+   * \param count A location into which to write the number of elements in the chunk.
+   * \return      A pointer to the first element in the chunk.
+   *
+   * \throws std::runtime_error If the file does not contain the specified chunk, or its size is not a multiple of the element size.
+   */
+  template <typename T>
+  const T *get_chunk_as(const std::string& name, size_t& count) const
+  {
+    size_t size;
+    const void *data = get_chunk(name, size);
+    if(size % sizeof(T) != 0) throw std::runtime_error("Error: Chunk '" + name + "' in " + m_filename + " has an unexpected size");
+    count = size / sizeof(T);
+    return static_cast<const T*>(data);
+  }
+
+  /**
+   * \brief Determines whether or not the file contains the specified chunk.
+   *
+   * \param name  The name of the chunk.
+   * \return      true, if the file contains the chunk, or false otherwise.
+   */
+  bool has_chunk(const std::string& name) const;
+
+  /**
+   * \brief Copies the data for the specified chunk into the CPU copy of a memory block.
+   *
+   * \note  The memory block must already have the right size. Its device copy (if any) is not updated.
+   *
+   * \param name  The name of the chunk.
+   * \param block The memory block.
+   *
+   * \throws std::runtime_error If the file does not contain the specified chunk, or the chunk has a different size to the memory block.
+   */
+  template <typename T>
+  void read_memory_block(const std::string& name, ORUtils::MemoryBlock<T>& block) const
+  {
+    size_t count;
+    const T *data = get_chunk_as<T>(name, count);
+
+    if(count != block.dataSize)
+    {
+      throw std::runtime_error(
+        "Error: Chunk '" + name + "' in " + m_filename + " contains " + boost::lexical_cast<std::string>(count) +
+        " elements, but " + boost::lexical_cast<std::string>(block.dataSize) + " were expected"
+      );
+    }
+
+    if(count > 0) memcpy(block.GetData(MEMORYDEVICE_CPU), data, count * sizeof(T));
+  }
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<PackedFileReader> PackedFileReader_Ptr;
+typedef boost::shared_ptr<const PackedFileReader> PackedFileReader_CPtr;
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * grove: PackedFileWriter.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_GROVE_PACKEDFILEWRITER
+#define H_GROVE_PACKEDFILEWRITER
+
+#include <string>
+#include <vector>
+
+#include <ORUtils/MemoryBlock.h>
+
+namespace grove {
+
+/**
+ * \brief An instance of this class can be used to write a set of named chunks of binary data to a packed file.
+ *
+ * \note  The writer does not copy the chunk data: the caller must keep it alive until write has been called.
+ */
+class PackedFileWriter
+{
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct represents a chunk that is waiting to be written.
+   */
+  struct PendingChunk
+  {
+    /** A pointer to the chunk data. */
+    const void *data;
+
+    /** The name of the chunk. */
+    std::string name;
+
+    /** The size of the chunk data (in bytes). */
+    size_t size;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The chunks that are waiting to be written. */
+  std::vector<PendingChunk> m_chunks;
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds a chunk to the file.
+   *
+   * \param name  The name of the chunk.
+   * \param data  A pointer to the chunk data.
+   * \param size  The size of the chunk data (in bytes).
+   *
+   * \throws std::invalid_argument  If the name is too long, or a chunk with the same name has already been added.
+   */
+  void add_chunk(const std::string& name, const void *data, size_t size);
+
+  /**
+   * \brief Adds a chunk containing the CPU copy of the data in a memory block to the file.
+   *
+   * \note  The CPU copy of the memory block must be up-to-date.
+   *
+   * \param name  The name of the chunk.
+   * \param block The memory block.
+   *
+   * \throws std::invalid_argument  If the name is too long, or a chunk with the same name has already been added.
+   */
+  template <typename T>
+  void add_memory_block(const std::string& name, const ORUtils::MemoryBlock<T>& block)
+  {
+    add_chunk(name, block.GetData(MEMORYDEVICE_CPU), block.dataSize * sizeof(T));
+  }
+
+  /**
+   * \brief Writes all of the chunks that have been added to a packed file on disk.
+   *
+   * \param filename  The name of the file to write.
+   *
+   * \throws std::runtime_error If the file cannot be written.
+   */
+  void write(const std::string& filename) const;
+};
+
+}
+
+#endif
@@ -8,6 +8,7 @@ using namespace ORUtils;
 using namespace tvgutil;
 
 #include "ransac/cpu/PreemptiveRansac_CPU.h"
+#include "ransac/cpu/PreemptiveRansac_CPUVectorised.h"
 
 #ifdef WITH_CUDA
 #include "ransac/cuda/PreemptiveRansac_CUDA.h"
@@ -31,7 +32,10 @@ PreemptiveRansac_Ptr PreemptiveRansacFactory::make_preemptive_ransac(const Setti
   }
   else
   {
-    ransac.reset(new PreemptiveRansac_CPU(settings, settingsNamespace));
+    // Optionally use the vectorised energy computation, which produces the same results as the scalar one, but more quickly.
+    const bool useVectorisedEnergyComputation = settings->get_first_value<bool>(settingsNamespace + "useVectorisedEnergyComputation", false);
+    if(useVectorisedEnergyComputation) ransac.reset(new PreemptiveRansac_CPUVectorised(settings, settingsNamespace));
+    else ransac.reset(new PreemptiveRansac_CPU(settings, settingsNamespace));
   }
 
   return ransac;
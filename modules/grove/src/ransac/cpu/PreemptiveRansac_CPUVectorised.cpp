@@ -0,0 +1,269 @@
+/**
+ * grove: PreemptiveRansac_CPUVectorised.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "ransac/cpu/PreemptiveRansac_CPUVectorised.h"
+using namespace tvgutil;
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+//#################### MACROS ####################
+
+// On x86 Linux builds using GCC, compile the energy kernels for several instruction sets and let the loader pick the
+// best one at runtime. Contraction into fused multiply-adds is disabled to keep the results identical to the scalar code.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+  #define GROVE_ENERGY_KERNEL __attribute__((target_clones("avx512f","avx2","default"), optimize("fp-contract=off")))
+#else
+  #define GROVE_ENERGY_KERNEL
+#endif
+
+namespace grove {
+
+//#################### LOCAL FUNCTIONS ####################
+
+namespace {
+
+typedef PreemptiveRansac_CPUVectorised::PackedMode PackedMode;
+
+enum { BLOCK = PreemptiveRansac_CPUVectorised::CANDIDATE_BLOCK_SIZE };
+
+/**
+ * \brief Transforms a point in camera space into world space using each of the poses in a block of transposed candidate poses.
+ *
+ * \note  The operations are performed in the same order as in ORUtils' Matrix4f * Vector3f.
+ *
+ * \param poses The transposed candidate poses (element i of pose j is stored at poses[i * BLOCK + j]).
+ * \param p     The point in camera space.
+ * \param wx    An array into which to write the x coordinates of the transformed points.
+ * \param wy    An array into which to write the y coordinates of the transformed points.
+ * \param wz    An array into which to write the z coordinates of the transformed points.
+ */
+GROVE_ENERGY_KERNEL
+void transform_point(const float *poses, const Vector3f& p, float *wx, float *wy, float *wz)
+{
+  for(int j = 0; j < BLOCK; ++j)
+  {
+    wx[j] = poses[0 * BLOCK + j] * p.x + poses[4 * BLOCK + j] * p.y + poses[8 * BLOCK + j] * p.z + poses[12 * BLOCK + j];
+    wy[j] = poses[1 * BLOCK + j] * p.x + poses[5 * BLOCK + j] * p.y + poses[9 * BLOCK + j] * p.z + poses[13 * BLOCK + j];
+    wz[j] = poses[2 * BLOCK + j] * p.x + poses[6 * BLOCK + j] * p.y + poses[10 * BLOCK + j] * p.z + poses[14 * BLOCK + j];
+  }
+}
+
+/**
+ * \brief Evaluates the energy of a mode for a block of transformed points, and updates the best mode found so far for each point.
+ *
+ * \note  This mirrors the body of the loop in find_closest_mode (see ScorePrediction.h), including the order of the operations.
+ *
+ * \param mode        The mode.
+ * \param modeIdx     The index of the mode in its prediction.
+ * \param wx          The x coordinates of the points (in world space).
+ * \param wy          The y coordinates of the points (in world space).
+ * \param wz          The z coordinates of the points (in world space).
+ * \param bestEnergy  The energies of the best modes found so far for each point.
+ * \param bestModeIdx The indices of the best modes found so far for each point.
+ */
+GROVE_ENERGY_KERNEL
+void evaluate_mode(const PackedMode& mode, int modeIdx, const float *wx, const float *wy, const float *wz, float *bestEnergy, int *bestModeIdx)
+{
+  const float *m = mode.invCovariance;
+  float exponents[BLOCK];
+
+  // Compute the exponent of the Gaussian for each point (vectorised).
+  for(int j = 0; j < BLOCK; ++j)
+  {
+    const float dx = wx[j] - mode.position[0];
+    const float dy = wy[j] - mode.position[1];
+    const float dz = wz[j] - mode.position[2];
+
+    const float mx = m[0] * dx + m[3] * dy + m[6] * dz;
+    const float my = m[1] * dx + m[4] * dy + m[7] * dz;
+    const float mz = m[2] * dx + m[5] * dy + m[8] * dz;
+
+    const float mahalanobisSq = dx * mx + dy * my + dz * mz;
+    exponents[j] = -0.5f * mahalanobisSq;
+  }
+
+  // Evaluate the exponentials. This deliberately uses the same expf as the scalar code to keep the results identical.
+  for(int j = 0; j < BLOCK; ++j)
+  {
+    exponents[j] = expf(exponents[j]);
+  }
+
+  // Compute the energy of the mode for each point and keep track of the best mode (vectorised).
+  for(int j = 0; j < BLOCK; ++j)
+  {
+    const float evalGaussian = mode.normalisation * exponents[j];
+    const float energy = mode.nbInliers * evalGaussian;
+
+    if(energy > bestEnergy[j])
+    {
+      bestEnergy[j] = energy;
+      bestModeIdx[j] = modeIdx;
+    }
+  }
+}
+
+}
+
+//#################### CONSTRUCTORS ####################
+
+PreemptiveRansac_CPUVectorised::PreemptiveRansac_CPUVectorised(const SettingsContainer_CPtr& settings, const std::string& settingsNamespace)
+: PreemptiveRansac_CPU(settings, settingsNamespace)
+{
+  m_packedInlierPositions.reserve(m_nbMaxInliers);
+  m_packedModeOffsets.reserve(m_nbMaxInliers + 1);
+}
+
+//#################### PROTECTED MEMBER FUNCTIONS ####################
+
+void PreemptiveRansac_CPUVectorised::compute_energies_and_sort()
+{
+  const int nbPoseCandidates = static_cast<int>(m_poseCandidates->dataSize);
+  PoseCandidate *poseCandidates = m_poseCandidates->GetData(MEMORYDEVICE_CPU);
+
+  // Pack the sampled inliers and their modes into contiguous arrays, so that they can be shared by all of the candidates.
+  pack_inliers();
+
+  // Compute the energies for all pose candidates, one block of candidates at a time.
+  const int nbBlocks = (nbPoseCandidates + BLOCK - 1) / BLOCK;
+  int nbInvalidBlocks = 0;
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for schedule(dynamic) reduction(+:nbInvalidBlocks)
+#endif
+  for(int blockIdx = 0; blockIdx < nbBlocks; ++blockIdx)
+  {
+    const int firstCandidateIdx = blockIdx * BLOCK;
+    if(!compute_block_energies(poseCandidates + firstCandidateIdx, std::min<int>(BLOCK, nbPoseCandidates - firstCandidateIdx)))
+    {
+      ++nbInvalidBlocks;
+    }
+  }
+
+  // As in the scalar implementation, we expect the best mode for each inlier to have at least some inliers (this is
+  // guaranteed by the clustering process). If this isn't the case for some reason, defensively throw (we do this here
+  // rather than in the parallel energy computation to avoid throwing from inside an OpenMP region).
+  if(nbInvalidBlocks > 0) throw std::runtime_error("mode has no inliers");
+
+  // Sort the candidates into non-decreasing order of energy.
+  std::sort(poseCandidates, poseCandidates + nbPoseCandidates);
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+bool PreemptiveRansac_CPUVectorised::compute_block_energies(PoseCandidate *candidates, int nbCandidates) const
+{
+  bool valid = true;
+  const int nbInliers = static_cast<int>(m_packedInlierPositions.size());
+
+  // Transpose the candidate poses. Unused lanes are filled with copies of the first pose, and their results are discarded.
+  float poses[16 * BLOCK];
+  for(int j = 0; j < BLOCK; ++j)
+  {
+    const Matrix4f& pose = candidates[j < nbCandidates ? j : 0].cameraPose;
+    for(int i = 0; i < 16; ++i)
+    {
+      poses[i * BLOCK + j] = pose.m[i];
+    }
+  }
+
+  float energySums[BLOCK];
+  std::fill(energySums, energySums + BLOCK, 0.0f);
+
+  // For each sampled inlier:
+  for(int inlierIdx = 0; inlierIdx < nbInliers; ++inlierIdx)
+  {
+    // Compute the hypothesised position of the inlier in world space for each candidate.
+    float wx[BLOCK], wy[BLOCK], wz[BLOCK];
+    transform_point(poses, m_packedInlierPositions[inlierIdx], wx, wy, wz);
+
+    // Find the closest mode for each candidate (as in find_closest_mode, we default to the first mode).
+    float bestEnergies[BLOCK];
+    int bestModeIndices[BLOCK];
+    std::fill(bestEnergies, bestEnergies + BLOCK, 0.0f);
+    std::fill(bestModeIndices, bestModeIndices + BLOCK, 0);
+
+    const int modesBegin = m_packedModeOffsets[inlierIdx];
+    const int modeCount = m_packedModeOffsets[inlierIdx + 1] - modesBegin;
+    const PackedMode *modes = &m_packedModes[modesBegin];
+
+    for(int modeIdx = 0; modeIdx < modeCount; ++modeIdx)
+    {
+      evaluate_mode(modes[modeIdx], modeIdx, wx, wy, wz, bestEnergies, bestModeIndices);
+    }
+
+    // Normalise the energies and add their negative logs to the energy sums (see compute_energy_sum_for_inlier_subset).
+    for(int j = 0; j < nbCandidates; ++j)
+    {
+      const PackedMode& bestMode = modes[bestModeIndices[j]];
+      if(bestMode.nbInliers == 0.0f) valid = false;
+
+      float energy = bestEnergies[j];
+      energy /= static_cast<float>(modeCount);
+      energy /= bestMode.nbInliers;
+
+      if(energy < 1e-6f) energy = 1e-6f;
+      energy = -log10f(energy);
+
+      energySums[j] += energy;
+    }
+  }
+
+  // Write the final energies into the candidates.
+  for(int j = 0; j < nbCandidates; ++j)
+  {
+    candidates[j].energy = energySums[j] / static_cast<float>(nbInliers);
+  }
+
+  return valid;
+}
+
+void PreemptiveRansac_CPUVectorised::pack_inliers()
+{
+  const int *inlierRasterIndices = m_inlierRasterIndicesBlock->GetData(MEMORYDEVICE_CPU);
+  const Keypoint3DColour *keypoints = m_keypointsImage->GetData(MEMORYDEVICE_CPU);
+  const uint32_t nbInliers = static_cast<uint32_t>(m_inlierRasterIndicesBlock->dataSize);
+  const ScorePrediction *predictions = m_predictionsImage->GetData(MEMORYDEVICE_CPU);
+
+  // Note: This is computed in exactly the same way as in find_closest_mode, to make sure that the normalisation factors match.
+  const float exponent = powf(2.0f * static_cast<float>(M_PI), 3);
+
+  m_packedInlierPositions.clear();
+  m_packedModeOffsets.clear();
+  m_packedModes.clear();
+
+  for(uint32_t inlierIdx = 0; inlierIdx < nbInliers; ++inlierIdx)
+  {
+    const int inlierRasterIdx = inlierRasterIndices[inlierIdx];
+    const ScorePrediction& pred = predictions[inlierRasterIdx];
+
+    // We expect the inlier to have had at least one valid mode (this is guaranteed by the inlier sampling process).
+    // If this isn't the case for some reason, defensively throw.
+    if(pred.size <= 0) throw std::runtime_error("prediction has no valid modes");
+
+    m_packedInlierPositions.push_back(keypoints[inlierRasterIdx].position);
+    m_packedModeOffsets.push_back(static_cast<int>(m_packedModes.size()));
+
+    for(int i = 0; i < pred.size; ++i)
+    {
+      const Keypoint3DColourCluster& mode = pred.elts[i];
+
+      PackedMode packedMode;
+      std::copy(mode.positionInvCovariance.m, mode.positionInvCovariance.m + 9, packedMode.invCovariance);
+      packedMode.nbInliers = static_cast<float>(mode.nbInliers);
+      packedMode.normalisation = 1.0f / sqrtf(mode.determinant * exponent);
+      packedMode.position[0] = mode.position.x;
+      packedMode.position[1] = mode.position.y;
+      packedMode.position[2] = mode.position.z;
+
+      m_packedModes.push_back(packedMode);
+    }
+  }
+
+  m_packedModeOffsets.push_back(static_cast<int>(m_packedModes.size()));
+}
+
+}
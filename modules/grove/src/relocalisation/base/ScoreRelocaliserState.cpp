@@ -11,20 +11,50 @@ namespace bf = boost::filesystem;
 #include <ORUtils/MemoryBlockPersister.h>
 using namespace ORUtils;
 
+#include <orx/base/MemoryBlockFactory.h>
+using namespace orx;
+
+#include "util/PackedFileReader.h"
+#include "util/PackedFileWriter.h"
+
 namespace grove {
 
 //#################### CONSTRUCTORS ####################
 
 ScoreRelocaliserState::ScoreRelocaliserState()
-: lastExamplesAddedStartIdx(0), reservoirUpdateStartIdx(0)
 {}
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
+void ScoreRelocaliserState::compact_predictions()
+{
+  if(compactPredictions) return;
+
+  // Make sure that the CPU copy of the predictions is up-to-date, pack them and then release the original memory block.
+  predictionsBlock->UpdateHostFromDevice();
+  compactPredictions.reset(new CompactScorePredictions(*predictionsBlock));
+  predictionsBlock.reset();
+  backPredictionsBlock.reset();
+}
+
+void ScoreRelocaliserState::expand_predictions()
+{
+  if(!compactPredictions) return;
+
+  // Unpack the predictions into a newly-allocated memory block (copying them across to the GPU if necessary).
+  predictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(compactPredictions->get_prediction_count());
+  compactPredictions->expand(*predictionsBlock);
+  predictionsBlock->UpdateDeviceFromHost();
+  compactPredictions.reset();
+}
+
 void ScoreRelocaliserState::load_from_disk(const std::string& inputFolder)
 {
   const bf::path inputPath(inputFolder);
 
+  // If the predictions were compacted, restore the original memory block so that they can be loaded into it.
+  expand_predictions();
+
   // Load the reservoirs.
   exampleReservoirs->load_from_disk(inputFolder);
 
@@ -34,13 +64,36 @@ void ScoreRelocaliserState::load_from_disk(const std::string& inputFolder)
   // If we're using the GPU, copy the predictions across.
   predictionsBlock->UpdateDeviceFromHost();
 
-  // Load the rest of the data.
+  // Load the rest of the data. Note that the file contains two reservoir indices that are no longer used (the reservoirs that need
+  // clustering are now determined by the reservoirs themselves), but we still check that they are present to validate the file.
   const std::string dataFile = (inputPath / "scoreState.txt").string();
   std::ifstream inFile(dataFile.c_str());
-  inFile >> lastExamplesAddedStartIdx >> reservoirUpdateStartIdx;
+  uint32_t unusedIndices[2];
+  inFile >> unusedIndices[0] >> unusedIndices[1];
   if(!inFile) throw std::runtime_error("Error: Couldn't load relocaliser data from " + dataFile);
 }
 
+void ScoreRelocaliserState::load_from_packed_file(const std::string& filename)
+{
+  // Map the file into memory.
+  PackedFileReader reader(filename);
+
+  // If the predictions were compacted, restore the original memory block so that they can be loaded into it.
+  expand_predictions();
+
+  // Load the reservoirs.
+  exampleReservoirs->load_from_packed_file(reader);
+
+  // Load the predictions, and if we're using the GPU, copy them across.
+  reader.read_memory_block("state.predictions", *predictionsBlock);
+  predictionsBlock->UpdateDeviceFromHost();
+
+  // Check the rest of the data. As with load_from_disk, the reservoir indices it contains are no longer used.
+  size_t indexCount;
+  reader.get_chunk_as<uint32_t>("state.indices", indexCount);
+  if(indexCount != 2) throw std::runtime_error("Error: Couldn't load relocaliser data from " + filename);
+}
+
 void ScoreRelocaliserState::save_to_disk(const std::string& outputFolder) const
 {
   const bf::path outputPath(outputFolder);
@@ -48,17 +101,55 @@ void ScoreRelocaliserState::save_to_disk(const std::string& outputFolder) const
   // Save the reservoirs.
   exampleReservoirs->save_to_disk(outputFolder);
 
-  // If we're using the GPU, copy the predictions across to the CPU so that they can be saved.
-  predictionsBlock->UpdateHostFromDevice();
-
-  // Save the predictions.
-  MemoryBlockPersister::SaveMemoryBlock((outputPath / "scorePredictions.bin").string(), *predictionsBlock, MEMORYDEVICE_CPU);
-
-  // Save the rest of the data.
+  // Save the predictions (if they have been compacted, we temporarily unpack them so that the file format stays the same).
+  if(compactPredictions)
+  {
+    ScorePredictionsMemoryBlock_Ptr expandedPredictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(compactPredictions->get_prediction_count());
+    compactPredictions->expand(*expandedPredictionsBlock);
+    MemoryBlockPersister::SaveMemoryBlock((outputPath / "scorePredictions.bin").string(), *expandedPredictionsBlock, MEMORYDEVICE_CPU);
+  }
+  else
+  {
+    // If we're using the GPU, copy the predictions across to the CPU so that they can be saved.
+    predictionsBlock->UpdateHostFromDevice();
+    MemoryBlockPersister::SaveMemoryBlock((outputPath / "scorePredictions.bin").string(), *predictionsBlock, MEMORYDEVICE_CPU);
+  }
+
+  // Save the rest of the data. For compatibility with the existing file format, we write two (now unused) reservoir indices.
   const std::string dataFile = (outputPath / "scoreState.txt").string();
   std::ofstream outFile(dataFile.c_str());
-  outFile << lastExamplesAddedStartIdx << ' ' << reservoirUpdateStartIdx;
+  outFile << 0 << ' ' << 0;
   if(!outFile) throw std::runtime_error("Error: Couldn't save relocaliser data in " + dataFile);
 }
 
+void ScoreRelocaliserState::save_to_packed_file(const std::string& filename) const
+{
+  PackedFileWriter writer;
+
+  // Add the reservoirs.
+  exampleReservoirs->save_to_packed_file(writer);
+
+  // Add the predictions (if they have been compacted, we temporarily unpack them so that the file format stays the same).
+  ScorePredictionsMemoryBlock_Ptr expandedPredictionsBlock;
+  if(compactPredictions)
+  {
+    expandedPredictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(compactPredictions->get_prediction_count());
+    compactPredictions->expand(*expandedPredictionsBlock);
+    writer.add_memory_block("state.predictions", *expandedPredictionsBlock);
+  }
+  else
+  {
+    // If we're using the GPU, copy the predictions across to the CPU so that they can be saved.
+    predictionsBlock->UpdateHostFromDevice();
+    writer.add_memory_block("state.predictions", *predictionsBlock);
+  }
+
+  // Add the rest of the data. For compatibility with the existing file format, we write two (now unused) reservoir indices.
+  const uint32_t indices[] = { 0, 0 };
+  writer.add_chunk("state.indices", indices, sizeof(indices));
+
+  // Write the file.
+  writer.write(filename);
+}
+
 }
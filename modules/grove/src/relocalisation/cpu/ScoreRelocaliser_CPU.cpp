@@ -7,6 +7,8 @@
 using namespace ORUtils;
 using namespace tvgutil;
 
+#include <algorithm>
+
 #include "relocalisation/shared/ScoreRelocaliser_Shared.h"
 
 namespace grove {
@@ -19,6 +21,21 @@ ScoreRelocaliser_CPU::ScoreRelocaliser_CPU(const std::string& forestFilename, co
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
+void ScoreRelocaliser_CPU::copy_predictions(const ScorePredictionsMemoryBlock& source, ScorePredictionsMemoryBlock& target, const ORIntMemoryBlock_CPtr& indices, uint32_t count) const
+{
+  const int *indicesPtr = indices->GetData(MEMORYDEVICE_CPU);
+  const ScorePrediction *sourcePtr = source.GetData(MEMORYDEVICE_CPU);
+  ScorePrediction *targetPtr = target.GetData(MEMORYDEVICE_CPU);
+
+#ifdef WITH_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < static_cast<int>(count); ++i)
+  {
+    copy_prediction(i, indicesPtr, sourcePtr, targetPtr);
+  }
+}
+
 uint32_t ScoreRelocaliser_CPU::count_valid_depths(const ORFloatImage *depthImage) const
 {
   uint32_t validDepths = 0;
@@ -47,6 +64,28 @@ void ScoreRelocaliser_CPU::merge_predictions_for_keypoints(const LeafIndicesImag
 
   const LeafIndices *leafIndicesPtr = leafIndices->GetData(MEMORYDEVICE_CPU);
   ScorePrediction *outputPredictionsPtr = outputPredictions->GetData(MEMORYDEVICE_CPU);
+
+  // If the leaf predictions have been compacted, merge them directly from the compact store.
+  const CompactScorePredictions_CPtr& compactPredictions = m_relocaliserState->compactPredictions;
+  if(compactPredictions)
+  {
+    const uint32_t *leafModeOffsets = compactPredictions->get_offsets();
+    const Keypoint3DColourCluster *leafModes = compactPredictions->get_modes();
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for
+#endif
+    for(int y = 0; y < imgSize.y; ++y)
+    {
+      for(int x = 0; x < imgSize.x; ++x)
+      {
+        merge_predictions_for_keypoint(x, y, leafIndicesPtr, leafModeOffsets, leafModes, imgSize, m_maxClusterCount, outputPredictionsPtr);
+      }
+    }
+
+    return;
+  }
+
   const ScorePrediction *predictionsBlockPtr = m_relocaliserState->predictionsBlock->GetData(MEMORYDEVICE_CPU);
 
 #ifdef WITH_OPENMP
@@ -36,6 +36,15 @@ namespace grove {
 
 //#################### CUDA KERNELS ####################
 
+__global__ void ck_copy_predictions(const int *indices, uint32_t count, const ScorePrediction *source, ScorePrediction *target)
+{
+  const uint32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if(i < count)
+  {
+    copy_prediction(i, indices, source, target);
+  }
+}
+
 template <int TREE_COUNT>
 __global__ void ck_merge_predictions_for_keypoints(const ORUtils::VectorX<int,TREE_COUNT> *leafIndices, const ScorePrediction *predictionsBlock,
                                                    Vector2i imgSize, int maxClusterCount, ScorePrediction *outputPredictions)
@@ -57,6 +66,16 @@ ScoreRelocaliser_CUDA::ScoreRelocaliser_CUDA(const std::string& forestFilename,
 
 //#################### PROTECTED MEMBER FUNCTIONS ####################
 
+void ScoreRelocaliser_CUDA::copy_predictions(const ScorePredictionsMemoryBlock& source, ScorePredictionsMemoryBlock& target, const ORIntMemoryBlock_CPtr& indices, uint32_t count) const
+{
+  // Launch one thread per prediction to copy.
+  dim3 blockSize(256);
+  dim3 gridSize((count + blockSize.x - 1) / blockSize.x);
+
+  ck_copy_predictions<<<gridSize,blockSize>>>(indices->GetData(MEMORYDEVICE_CUDA), count, source.GetData(MEMORYDEVICE_CUDA), target.GetData(MEMORYDEVICE_CUDA));
+  ORcudaKernelCheck;
+}
+
 uint32_t ScoreRelocaliser_CUDA::count_valid_depths(const ORFloatImage *depthImage) const
 {
   const float *depths = depthImage->GetData(MEMORYDEVICE_CUDA);
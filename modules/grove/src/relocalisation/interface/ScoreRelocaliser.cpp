@@ -6,6 +6,8 @@
 #include "relocalisation/interface/ScoreRelocaliser.h"
 using namespace ORUtils;
 
+#include <algorithm>
+
 #include <boost/filesystem.hpp>
 namespace bf = boost::filesystem;
 
@@ -38,10 +40,14 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
   m_minX(static_cast<float>(INT_MAX)),
   m_minY(static_cast<float>(INT_MAX)),
   m_minZ(static_cast<float>(INT_MAX)),
-  m_settings(settings)
+  m_settings(settings),
+  m_settingsNamespace(settingsNamespace)
 {
   // Determine the top-level parameters for the relocaliser.
+  m_compactPredictionsAfterTraining = m_settings->get_first_value<bool>(settingsNamespace + "compactPredictionsAfterTraining", false);
+  m_doubleBufferPredictions = m_settings->get_first_value<bool>(settingsNamespace + "doubleBufferPredictions", false);
   m_maxRelocalisationsToOutput = m_settings->get_first_value<uint32_t>(settingsNamespace + "maxRelocalisationsToOutput", 1);
+  m_saveStateAsPackedFile = m_settings->get_first_value<bool>(settingsNamespace + "saveStateAsPackedFile", false);
   m_visualiseForest = m_settings->get_first_value<bool>(settingsNamespace + "visualiseForest", false);
 
   // Determine the reservoir-related parameters.
@@ -61,22 +67,33 @@ ScoreRelocaliser::ScoreRelocaliser(const std::string& forestFilename, const Sett
     throw std::invalid_argument(settingsNamespace + "maxClusterCount > ScorePrediction::Capacity");
   }
 
-  // Allocate the internal images.
+  // Check that we're not trying to compact the leaf predictions on the GPU (the compact predictions are only supported on the CPU).
+  if(m_compactPredictionsAfterTraining && deviceType == DEVICE_CUDA)
+  {
+    throw std::invalid_argument(settingsNamespace + "compactPredictionsAfterTraining is only supported on the CPU");
+  }
+
+  // Allocate the internal images used during training.
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
   m_descriptorsImage = mbf.make_image<DescriptorType>();
   m_keypointsImage = mbf.make_image<ExampleType>();
   m_leafIndicesImage = mbf.make_image<LeafIndices>();
-  m_predictionsImage = mbf.make_image<ScorePrediction>();
 
   // Instantiate the sub-components.
   m_featureCalculator = FeatureCalculatorFactory::make_da_rgbd_patch_feature_calculator(deviceType);
-  m_preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(settings, settingsNamespace + "PreemptiveRansac.", deviceType);
 
+  // Make an initial query context for relocalisation (more will be made on demand if several threads relocalise at once).
+  // Note that doing this here means that any problems with the P-RANSAC settings are reported straight away.
+  m_idleQueryContexts.push_back(make_query_context());
+
+  // Note: The packed forest layout is only used on the CPU (it is ignored by the CUDA implementation).
+  const bool usePackedForestLayout = m_settings->get_first_value<bool>(settingsNamespace + "usePackedForestLayout", false);
   m_scoreForest = m_settings->get_first_value<bool>(settingsNamespace + "randomlyGenerateForest", false)
-    ? DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_randomly_generated_forest(m_settings, deviceType)
-    : DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_forest(forestFilename, deviceType);
+    ? DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_randomly_generated_forest(m_settings, deviceType, usePackedForestLayout)
+    : DecisionForestFactory<DescriptorType,FOREST_TREE_COUNT>::make_forest(forestFilename, deviceType, usePackedForestLayout);
 
   m_reservoirCount = m_scoreForest->get_nb_leaves();
+  m_reservoirIndicesToCluster = mbf.make_block<int>(std::min(m_maxReservoirsToUpdate, m_reservoirCount));
 
   // Set up the relocaliser's internal state.
   m_relocaliserState.reset(new ScoreRelocaliserState);
@@ -94,28 +111,36 @@ void ScoreRelocaliser::finish_training()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
 
   // First update all of the clusters.
   update_all_clusters();
 
   // Then kill the contents of the reservoirs (we won't need them any more).
   m_relocaliserState->exampleReservoirs.reset();
-  m_relocaliserState->lastExamplesAddedStartIdx = 0;
-  m_relocaliserState->reservoirUpdateStartIdx = 0;
 
-  // Finally, release the example clusterer.
+  // Then release the example clusterer.
   m_exampleClusterer.reset();
+
+  // Finally, if desired, replace the leaf predictions with a compact copy of them (they won't change any more).
+  if(m_compactPredictionsAfterTraining)
+  {
+    boost::unique_lock<boost::shared_mutex> predictionsLock(m_relocaliserState->predictionsMutex);
+    m_relocaliserState->compact_predictions();
+  }
 }
 
 void ScoreRelocaliser::get_best_poses(std::vector<PoseCandidate>& poseCandidates) const
 {
-  m_preemptiveRansac->get_best_poses(poseCandidates);
+  boost::lock_guard<boost::mutex> lock(m_queryContextMutex);
+  if(m_lastQueryContext) m_lastQueryContext->preemptiveRansac->get_best_poses(poseCandidates);
+  else poseCandidates.clear();
 }
 
 Keypoint3DColourImage_CPtr ScoreRelocaliser::get_keypoints_image() const
 {
-  return m_keypointsImage;
+  boost::lock_guard<boost::mutex> lock(m_queryContextMutex);
+  return m_lastQueryContext ? m_lastQueryContext->keypointsImage : Keypoint3DColourImage_CPtr();
 }
 
 ScorePrediction ScoreRelocaliser::get_prediction(uint32_t treeIdx, uint32_t leafIdx) const
@@ -124,13 +149,18 @@ ScorePrediction ScoreRelocaliser::get_prediction(uint32_t treeIdx, uint32_t leaf
   ensure_valid_leaf(treeIdx, leafIdx);
 
   // Look up the prediction associated with the leaf and return it.
+  boost::shared_lock<boost::shared_mutex> predictionsLock(m_relocaliserState->predictionsMutex);
+  const uint32_t linearLeafIdx = leafIdx * m_scoreForest->get_nb_trees() + treeIdx;
+  if(m_relocaliserState->compactPredictions) return m_relocaliserState->compactPredictions->get_prediction(linearLeafIdx);
+
   const MemoryDeviceType memoryType = m_deviceType == DEVICE_CUDA ? MEMORYDEVICE_CUDA : MEMORYDEVICE_CPU;
-  return m_relocaliserState->predictionsBlock->GetElement(leafIdx * m_scoreForest->get_nb_trees() + treeIdx, memoryType);
+  return m_relocaliserState->predictionsBlock->GetElement(linearLeafIdx, memoryType);
 }
 
 ScorePredictionsImage_CPtr ScoreRelocaliser::get_predictions_image() const
 {
-  return m_predictionsImage;
+  boost::lock_guard<boost::mutex> lock(m_queryContextMutex);
+  return m_lastQueryContext ? m_lastQueryContext->predictionsImage : ScorePredictionsImage_CPtr();
 }
 
 std::vector<Keypoint3DColour> ScoreRelocaliser::get_reservoir_contents(uint32_t treeIdx, uint32_t leafIdx) const
@@ -161,6 +191,7 @@ std::vector<Keypoint3DColour> ScoreRelocaliser::get_reservoir_contents(uint32_t
 
 ORUChar4Image_CPtr ScoreRelocaliser::get_visualisation_image(const std::string& key) const
 {
+  boost::lock_guard<boost::mutex> lock(m_visualisationMutex);
   if(key == "leaves") return m_pixelsToLeavesImage;
   else if(key == "points") return m_pixelsToPointsImage;
   else return ORUChar4Image_CPtr();
@@ -171,31 +202,44 @@ void ScoreRelocaliser::load_from_disk(const std::string& inputFolder)
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  // Otherwise, load its internal state from disk.
-  m_relocaliserState->load_from_disk(inputFolder);
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
+  boost::unique_lock<boost::shared_mutex> predictionsLock(m_relocaliserState->predictionsMutex);
+
+  // Otherwise, load its internal state from disk (preferring the packed file, if there is one).
+  const bf::path packedStatePath = bf::path(inputFolder) / "scoreState.pkd";
+  if(bf::exists(packedStatePath)) m_relocaliserState->load_from_packed_file(packedStatePath.string());
+  else m_relocaliserState->load_from_disk(inputFolder);
+
+  // If the leaf predictions are double-buffered, make sure that the back buffer matches the newly-loaded predictions.
+  synchronise_back_predictions();
 }
 
 std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise(const ORUChar4Image *colourImage, const ORFloatImage *depthImage, const Vector4f& depthIntrinsics) const
 {
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
-
   std::vector<Result> results;
 
+  // Take a query context to hold the scratch buffers for this call (this allows several threads to relocalise at once).
+  QueryContext_Ptr queryContext = acquire_query_context();
+
   // Iff we have enough valid depth values, try to estimate the camera pose:
-  if(count_valid_depths(depthImage) > m_preemptiveRansac->get_min_nb_required_points())
+  if(count_valid_depths(depthImage) > queryContext->preemptiveRansac->get_min_nb_required_points())
   {
     // Step 1: Extract keypoints from the RGB-D image and compute descriptors for them.
-    m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, depthIntrinsics, m_keypointsImage.get(), m_descriptorsImage.get());
+    m_featureCalculator->compute_keypoints_and_features(colourImage, depthImage, depthIntrinsics, queryContext->keypointsImage.get(), queryContext->descriptorsImage.get());
 
     // Step 2: Find all of the leaves in the forest that are associated with the descriptors for the keypoints.
-    m_scoreForest->find_leaves(m_descriptorsImage, m_leafIndicesImage);
+    m_scoreForest->find_leaves(queryContext->descriptorsImage, queryContext->leafIndicesImage);
 
     // Step 3: Merge the SCoRe predictions (sets of clusters) associated with each keypoint to create a single
-    //         SCoRe prediction (a single set of clusters) for each keypoint.
-    merge_predictions_for_keypoints(m_leafIndicesImage, m_predictionsImage);
+    //         SCoRe prediction (a single set of clusters) for each keypoint. Note that this is the only step
+    //         that reads the leaf predictions, so it is the only one that needs to be synchronised with training.
+    {
+      boost::shared_lock<boost::shared_mutex> predictionsLock(m_relocaliserState->predictionsMutex);
+      merge_predictions_for_keypoints(queryContext->leafIndicesImage, queryContext->predictionsImage);
+    }
 
     // Step 4: Perform P-RANSAC to try to estimate the camera pose.
-    boost::optional<PoseCandidate> poseCandidate = m_preemptiveRansac->estimate_pose(m_keypointsImage, m_predictionsImage);
+    boost::optional<PoseCandidate> poseCandidate = queryContext->preemptiveRansac->estimate_pose(queryContext->keypointsImage, queryContext->predictionsImage);
 
     // Step 5: If we succeeded in estimated a camera pose:
     if(poseCandidate)
@@ -212,7 +256,7 @@ std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise(const ORUChar4Imag
       {
         // Get all of the candidates that survived the initial culling process during P-RANSAC.
         std::vector<PoseCandidate> candidates;
-        m_preemptiveRansac->get_best_poses(candidates);
+        queryContext->preemptiveRansac->get_best_poses(candidates);
 
         // Add the best candidates to the results (skipping the first one, since it's the same one returned by estimate_pose above).
         const size_t maxElements = std::min<size_t>(candidates.size(), m_maxRelocalisationsToOutput);
@@ -231,12 +275,17 @@ std::vector<Relocaliser::Result> ScoreRelocaliser::relocalise(const ORUChar4Imag
   // If forest visualisation is enabled and we relocalised successfully, update the forest visualisation images (for debugging purposes).
   if(m_visualiseForest && !results.empty())
   {
-    update_pixels_to_leaves_image(depthImage);
+    boost::lock_guard<boost::mutex> lock(m_visualisationMutex);
+
+    update_pixels_to_leaves_image(depthImage, queryContext->leafIndicesImage);
 
     // Note: We use the "best" pose here as a default, even though this may later be either refined by ICP or discarded in favour of a different pose.
-    update_pixels_to_points_image(results[0].pose);
+    update_pixels_to_points_image(results[0].pose, queryContext->keypointsImage, queryContext->predictionsImage);
   }
 
+  // Return the query context, so that its results can be inspected and it can be reused by a later call.
+  release_query_context(queryContext);
+
   return results;
 }
 
@@ -245,7 +294,8 @@ void ScoreRelocaliser::reset()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
+  boost::unique_lock<boost::shared_mutex> predictionsLock(m_relocaliserState->predictionsMutex);
 
   // Set up the clusterer if it hasn't been allocated yet.
   if(!m_exampleClusterer)
@@ -261,16 +311,18 @@ void ScoreRelocaliser::reset()
     m_relocaliserState->exampleReservoirs = ExampleReservoirsFactory<ExampleType>::make_reservoirs(m_reservoirCount, m_reservoirCapacity, m_deviceType, m_rngSeed);
   }
 
-  // Set up the predictions block if it hasn't been allocated yet.
+  // Set up the predictions block if it hasn't been allocated yet (or if it was previously compacted).
+  m_relocaliserState->compactPredictions.reset();
   if(!m_relocaliserState->predictionsBlock)
   {
     m_relocaliserState->predictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(m_reservoirCount);
   }
 
   m_relocaliserState->exampleReservoirs->reset();
-  m_relocaliserState->lastExamplesAddedStartIdx = 0;
   m_relocaliserState->predictionsBlock->Clear();
-  m_relocaliserState->reservoirUpdateStartIdx = 0;
+
+  // If the leaf predictions are double-buffered, make sure that the back buffer is cleared as well.
+  synchronise_back_predictions();
 }
 
 void ScoreRelocaliser::save_to_disk(const std::string& outputFolder) const
@@ -278,11 +330,23 @@ void ScoreRelocaliser::save_to_disk(const std::string& outputFolder) const
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
+
   // First make sure that the output folder exists.
   bf::create_directories(outputFolder);
 
-  // Then save the relocaliser's internal state to disk.
-  m_relocaliserState->save_to_disk(outputFolder);
+  // Then save the relocaliser's internal state to disk. If we're saving it as a set of loose files, we also remove
+  // any existing packed file, since otherwise it would take precedence over the loose files on loading.
+  const bf::path packedStatePath = bf::path(outputFolder) / "scoreState.pkd";
+  if(m_saveStateAsPackedFile)
+  {
+    m_relocaliserState->save_to_packed_file(packedStatePath.string());
+  }
+  else
+  {
+    bf::remove(packedStatePath);
+    m_relocaliserState->save_to_disk(outputFolder);
+  }
 }
 
 void ScoreRelocaliser::set_backing_relocaliser(const ScoreRelocaliser_Ptr& backingRelocaliser)
@@ -294,7 +358,7 @@ void ScoreRelocaliser::set_backing_relocaliser(const ScoreRelocaliser_Ptr& backi
 void ScoreRelocaliser::train(const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
                              const Vector4f& depthIntrinsics, const ORUtils::SE3Pose& cameraPose)
 {
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
 
   // If forest visualisation is enabled, update the maximum and minimum x, y and z coordinates visited by the camera during training.
   if(m_visualiseForest)
@@ -325,18 +389,8 @@ void ScoreRelocaliser::train(const ORUChar4Image *colourImage, const ORFloatImag
   // Step 3: Add the keypoints to the relevant reservoirs.
   m_relocaliserState->exampleReservoirs->add_examples(m_keypointsImage, m_leafIndicesImage);
 
-  // Step 4: Cluster some of the reservoirs.
-  const uint32_t nbReservoirsToUpdate = compute_nb_reservoirs_to_update();
-  m_exampleClusterer->cluster_examples(
-    m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
-    m_relocaliserState->reservoirUpdateStartIdx, nbReservoirsToUpdate, m_relocaliserState->predictionsBlock
-  );
-
-  // Step 5: Store the index of the first reservoir that was just updated so that we can tell when there are no more clusters to update.
-  m_relocaliserState->lastExamplesAddedStartIdx = m_relocaliserState->reservoirUpdateStartIdx;
-
-  // Step 6: Update the index of the first reservoir to subject to clustering during the next train/update call.
-  update_reservoir_start_idx();
+  // Step 4: Cluster the reservoirs that have changed the most (any remaining dirty reservoirs will be clustered by later train/update calls).
+  cluster_dirty_reservoirs();
 }
 
 void ScoreRelocaliser::update()
@@ -344,27 +398,16 @@ void ScoreRelocaliser::update()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
 
   if(!m_relocaliserState->exampleReservoirs)
   {
     throw std::runtime_error("Error: finish_training() has been called; the relocaliser cannot be updated again until reset() is called");
   }
 
-  // If we are back to the first reservoir that was updated when the last batch of examples were added to the
-  // forest, there is no need to perform further updates, since we would get the same clusters. Note that this
-  // check only works if the m_maxReservoirsToUpdate quantity remains constant throughout the whole program.
-  if(m_relocaliserState->reservoirUpdateStartIdx == m_relocaliserState->lastExamplesAddedStartIdx) return;
-
-  // Otherwise, cluster the next batch of reservoirs, and update the index of the first reservoir to subject to
-  // clustering during the next train/update call.
-  const uint32_t updateCount = compute_nb_reservoirs_to_update();
-  m_exampleClusterer->cluster_examples(
-    m_relocaliserState->exampleReservoirs->get_reservoirs(), m_relocaliserState->exampleReservoirs->get_reservoir_sizes(),
-    m_relocaliserState->reservoirUpdateStartIdx, updateCount, m_relocaliserState->predictionsBlock
-  );
-
-  update_reservoir_start_idx();
+  // Cluster the next batch of dirty reservoirs (if there are no dirty reservoirs, this is a no-op, since
+  // reclustering the reservoirs would just give us the same clusters as before).
+  cluster_dirty_reservoirs();
 }
 
 void ScoreRelocaliser::update_all_clusters()
@@ -372,21 +415,83 @@ void ScoreRelocaliser::update_all_clusters()
   // If this relocaliser is "backed" by another one, early out.
   if(m_backed) return;
 
-  boost::lock_guard<boost::recursive_mutex> lock(m_mutex);
+  boost::lock_guard<boost::recursive_mutex> lock(m_trainingMutex);
+
+  if(!m_relocaliserState->exampleReservoirs)
+  {
+    throw std::runtime_error("Error: finish_training() has been called; the relocaliser cannot be updated again until reset() is called");
+  }
 
-  // Repeatedly call update until we get back to the batch of reservoirs that was updated last time train() was called.
-  while(m_relocaliserState->reservoirUpdateStartIdx != m_relocaliserState->lastExamplesAddedStartIdx)
+  // Repeatedly cluster the dirtiest reservoirs until all of the reservoirs have been clustered since examples were last added to them.
+  uint32_t dirtyReservoirCount;
+  do
   {
-    update();
+    dirtyReservoirCount = cluster_dirty_reservoirs();
   }
+  while(dirtyReservoirCount > 0);
 }
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-uint32_t ScoreRelocaliser::compute_nb_reservoirs_to_update() const
+ScoreRelocaliser::QueryContext_Ptr ScoreRelocaliser::acquire_query_context() const
 {
-  // Either the standard number of reservoirs to update, or the number remaining before the end of the memory block.
-  return std::min(m_maxReservoirsToUpdate, m_reservoirCount - m_relocaliserState->reservoirUpdateStartIdx);
+  {
+    boost::lock_guard<boost::mutex> lock(m_queryContextMutex);
+    if(!m_idleQueryContexts.empty())
+    {
+      QueryContext_Ptr queryContext = m_idleQueryContexts.back();
+      m_idleQueryContexts.pop_back();
+      return queryContext;
+    }
+  }
+
+  // If there are no idle query contexts, make a new one (we do this without holding the lock, since it involves allocating memory).
+  return make_query_context();
+}
+
+uint32_t ScoreRelocaliser::cluster_dirty_reservoirs()
+{
+  ScoreRelocaliserState& state = *m_relocaliserState;
+
+  // Decide which reservoirs to cluster. Prioritising the reservoirs that have changed the most since they were last
+  // clustered means that the leaves that matter most for the current scene are brought up to date first, and that
+  // no work is wasted on reclustering reservoirs that haven't changed at all.
+  std::vector<uint32_t> reservoirIndices;
+  const uint32_t dirtyReservoirCount = state.exampleReservoirs->take_dirtiest_reservoirs(m_maxReservoirsToUpdate, reservoirIndices);
+
+  const uint32_t count = static_cast<uint32_t>(reservoirIndices.size());
+  if(count == 0) return dirtyReservoirCount;
+
+  // Upload the indices of the reservoirs to cluster to the device on which the relocaliser is running.
+  int *reservoirIndicesToCluster = m_reservoirIndicesToCluster->GetData(MEMORYDEVICE_CPU);
+  std::copy(reservoirIndices.begin(), reservoirIndices.end(), reservoirIndicesToCluster);
+  m_reservoirIndicesToCluster->UpdateDeviceFromHost();
+
+  // If the leaf predictions are not double-buffered, cluster the examples directly into them, making sure that no relocalisation is in progress.
+  if(!state.backPredictionsBlock)
+  {
+    boost::unique_lock<boost::shared_mutex> predictionsLock(state.predictionsMutex);
+    m_exampleClusterer->cluster_examples(
+      state.exampleReservoirs->get_reservoirs(), state.exampleReservoirs->get_reservoir_sizes(), m_reservoirIndicesToCluster, count, state.predictionsBlock
+    );
+    return dirtyReservoirCount;
+  }
+
+  // Otherwise, cluster the examples into the back buffer (which no relocalisation can be reading), and then swap the buffers.
+  m_exampleClusterer->cluster_examples(
+    state.exampleReservoirs->get_reservoirs(), state.exampleReservoirs->get_reservoir_sizes(), m_reservoirIndicesToCluster, count, state.backPredictionsBlock
+  );
+
+  {
+    boost::unique_lock<boost::shared_mutex> predictionsLock(state.predictionsMutex);
+    std::swap(state.predictionsBlock, state.backPredictionsBlock);
+  }
+
+  // Finally, bring the new back buffer up to date. Any relocalisation that was reading it finished before the swap, and any
+  // that has started since then is reading the new front buffer, so it is safe to do this without holding the lock.
+  copy_predictions(*state.predictionsBlock, *state.backPredictionsBlock, m_reservoirIndicesToCluster, count);
+
+  return dirtyReservoirCount;
 }
 
 void ScoreRelocaliser::ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) const
@@ -397,29 +502,90 @@ void ScoreRelocaliser::ensure_valid_leaf(uint32_t treeIdx, uint32_t leafIdx) con
   }
 }
 
-void ScoreRelocaliser::update_pixels_to_leaves_image(const ORFloatImage *depthImage) const
+ScoreRelocaliser::QueryContext_Ptr ScoreRelocaliser::make_query_context() const
+{
+  MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
+
+  QueryContext_Ptr queryContext(new QueryContext);
+  queryContext->descriptorsImage = mbf.make_image<DescriptorType>();
+  queryContext->keypointsImage = mbf.make_image<ExampleType>();
+  queryContext->keypointsImageUseCount = 1;
+  queryContext->leafIndicesImage = mbf.make_image<LeafIndices>();
+  queryContext->predictionsImage = mbf.make_image<ScorePrediction>();
+  queryContext->predictionsImageUseCount = 1;
+  queryContext->preemptiveRansac = PreemptiveRansacFactory::make_preemptive_ransac(m_settings, m_settingsNamespace + "PreemptiveRansac.", m_deviceType);
+
+  return queryContext;
+}
+
+void ScoreRelocaliser::release_query_context(const QueryContext_Ptr& queryContext) const
+{
+  boost::lock_guard<boost::mutex> lock(m_queryContextMutex);
+
+  // Note: If a caller still holds the keypoints or predictions image of the previous last query context (obtained via
+  //       get_keypoints_image or get_predictions_image), recycling the context would allow a later call to relocalise
+  //       to overwrite the image whilst it is in use. In that case, we simply discard the context instead (the images
+  //       will be freed once the caller is done with them, and a new context will be made on demand if needed). We can
+  //       tell whether this is the case by comparing the numbers of references to the images with the numbers that were
+  //       held internally (e.g. by the context's P-RANSAC instance) when the context was released.
+  if(m_lastQueryContext &&
+     m_lastQueryContext->keypointsImage.use_count() == m_lastQueryContext->keypointsImageUseCount &&
+     m_lastQueryContext->predictionsImage.use_count() == m_lastQueryContext->predictionsImageUseCount)
+  {
+    m_idleQueryContexts.push_back(m_lastQueryContext);
+  }
+
+  queryContext->keypointsImageUseCount = queryContext->keypointsImage.use_count();
+  queryContext->predictionsImageUseCount = queryContext->predictionsImage.use_count();
+  m_lastQueryContext = queryContext;
+}
+
+void ScoreRelocaliser::synchronise_back_predictions()
+{
+  ScoreRelocaliserState& state = *m_relocaliserState;
+
+  // If the leaf predictions aren't double-buffered (or have been compacted, and so won't change any more), there's no back buffer to synchronise.
+  if(!m_doubleBufferPredictions || !state.predictionsBlock)
+  {
+    state.backPredictionsBlock.reset();
+    return;
+  }
+
+  // Otherwise, allocate the back buffer if necessary, and copy the front buffer into it.
+  if(!state.backPredictionsBlock || state.backPredictionsBlock->dataSize != state.predictionsBlock->dataSize)
+  {
+    state.backPredictionsBlock = MemoryBlockFactory::instance().make_block<ScorePrediction>(state.predictionsBlock->dataSize);
+  }
+
+  // Note: We copy the whole block directly rather than via copy_predictions, since this is called (via reset) from the constructor,
+  //       at which point the derived class that implements copy_predictions has not yet been constructed.
+  const ScorePredictionsMemoryBlock::MemoryCopyDirection copyDirection = m_deviceType == DEVICE_CUDA ? ScorePredictionsMemoryBlock::CUDA_TO_CUDA : ScorePredictionsMemoryBlock::CPU_TO_CPU;
+  state.backPredictionsBlock->SetFrom(state.predictionsBlock.get(), copyDirection);
+}
+
+void ScoreRelocaliser::update_pixels_to_leaves_image(const ORFloatImage *depthImage, const LeafIndicesImage_CPtr& leafIndicesImage) const
 {
 #ifdef WITH_OPENCV
   // Ensure that the depth image and leaf indices are available on the CPU.
   depthImage->UpdateHostFromDevice();
-  m_leafIndicesImage->UpdateHostFromDevice();
+  leafIndicesImage->UpdateHostFromDevice();
 
   // Make a map showing which pixels are in which leaves (for the first tree).
   std::map<int,std::vector<int> > leafToRegionMap;
-  for(int i = 0, pixelCount = static_cast<int>(m_leafIndicesImage->dataSize); i < pixelCount; ++i)
+  for(int i = 0, pixelCount = static_cast<int>(leafIndicesImage->dataSize); i < pixelCount; ++i)
   {
-    const ORUtils::VectorX<int,ScoreRelocaliser::FOREST_TREE_COUNT>& elt = m_leafIndicesImage->GetData(MEMORYDEVICE_CPU)[i];
+    const ORUtils::VectorX<int,ScoreRelocaliser::FOREST_TREE_COUNT>& elt = leafIndicesImage->GetData(MEMORYDEVICE_CPU)[i];
     leafToRegionMap[elt[0]].push_back(i);
   }
 
   // Make greyscale and colour images showing which pixels are in which leaves (for the first tree).
-  cv::Mat1b imageG = cv::Mat1b::zeros(m_leafIndicesImage->noDims.y, m_leafIndicesImage->noDims.x);
+  cv::Mat1b imageG = cv::Mat1b::zeros(leafIndicesImage->noDims.y, leafIndicesImage->noDims.x);
   const uint32_t featureStep = m_featureCalculator->get_feature_step();
   for(std::map<int,std::vector<int> >::const_iterator jt = leafToRegionMap.begin(), jend = leafToRegionMap.end(); jt != jend; ++jt)
   {
     for(std::vector<int>::const_iterator kt = jt->second.begin(), kend = jt->second.end(); kt != kend; ++kt)
     {
-      int x = *kt % m_leafIndicesImage->noDims.x, y = *kt / m_leafIndicesImage->noDims.x;
+      int x = *kt % leafIndicesImage->noDims.x, y = *kt / leafIndicesImage->noDims.x;
       if(depthImage->GetData(MEMORYDEVICE_CPU)[y * featureStep * depthImage->noDims.x + x * featureStep] > 0.0f)
       {
         imageG(y,x) = jt->first % 256;
@@ -454,14 +620,15 @@ void ScoreRelocaliser::update_pixels_to_leaves_image(const ORFloatImage *depthIm
 #endif
 }
 
-void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera) const
+void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& worldToCamera, const Keypoint3DColourImage_CPtr& keypointsImage,
+                                                     const ScorePredictionsImage_CPtr& predictionsImage) const
 {
   // Ensure that the keypoints and SCoRe predictions are available on the CPU.
-  m_keypointsImage->UpdateHostFromDevice();
-  m_predictionsImage->UpdateHostFromDevice();
+  keypointsImage->UpdateHostFromDevice();
+  predictionsImage->UpdateHostFromDevice();
 
   // If the pixels to points image hasn't been allocated yet, allocate it now.
-  if(!m_pixelsToPointsImage) m_pixelsToPointsImage.reset(new ORUChar4Image(m_leafIndicesImage->noDims, true, true));
+  if(!m_pixelsToPointsImage) m_pixelsToPointsImage.reset(new ORUChar4Image(keypointsImage->noDims, true, true));
 
   // For each pixel:
   Vector4u *p = m_pixelsToPointsImage->GetData(MEMORYDEVICE_CPU);
@@ -471,9 +638,9 @@ void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& wor
     p->a = 255;
 
     // If the pixel has a valid keypoint, look up the position of the cluster (if any) in the corresponding prediction that is closest to it.
-    const ExampleType& keypoint = m_keypointsImage->GetData(MEMORYDEVICE_CPU)[i];
+    const ExampleType& keypoint = keypointsImage->GetData(MEMORYDEVICE_CPU)[i];
     if(!keypoint.valid) continue;
-    const PredictionType& prediction = m_predictionsImage->GetData(MEMORYDEVICE_CPU)[i];
+    const PredictionType& prediction = predictionsImage->GetData(MEMORYDEVICE_CPU)[i];
     const int closestModeIdx = find_closest_mode(worldToCamera.GetInvM() * keypoint.position, prediction);
     if(closestModeIdx == -1) continue;
     const Vector3f& clusterPos = prediction.elts[closestModeIdx].position;
@@ -495,15 +662,4 @@ void ScoreRelocaliser::update_pixels_to_points_image(const ORUtils::SE3Pose& wor
   m_pixelsToPointsImage->UpdateDeviceFromHost();
 }
 
-void ScoreRelocaliser::update_reservoir_start_idx()
-{
-  m_relocaliserState->reservoirUpdateStartIdx += m_maxReservoirsToUpdate;
-
-  // If we go past the end of the list of reservoirs, loop back round.
-  if(m_relocaliserState->reservoirUpdateStartIdx >= m_reservoirCount)
-  {
-    m_relocaliserState->reservoirUpdateStartIdx = 0;
-  }
-}
-
 }
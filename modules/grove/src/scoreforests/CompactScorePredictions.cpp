@@ -0,0 +1,87 @@
+/**
+ * grove: CompactScorePredictions.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "scoreforests/CompactScorePredictions.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace grove {
+
+//#################### CONSTRUCTORS ####################
+
+CompactScorePredictions::CompactScorePredictions(const ScorePredictionsMemoryBlock& predictionsBlock)
+{
+  const ScorePrediction *predictions = predictionsBlock.GetData(MEMORYDEVICE_CPU);
+  const size_t predictionCount = predictionsBlock.dataSize;
+
+  // First, count the modes so that the packed array can be allocated exactly once.
+  size_t modeCount = 0;
+  for(size_t i = 0; i < predictionCount; ++i)
+  {
+    modeCount += predictions[i].size;
+  }
+
+  m_offsets.reserve(predictionCount + 1);
+  m_modes.reserve(modeCount);
+
+  // Then, copy the modes of each prediction across, recording the offset at which each prediction starts.
+  for(size_t i = 0; i < predictionCount; ++i)
+  {
+    m_offsets.push_back(static_cast<uint32_t>(m_modes.size()));
+    m_modes.insert(m_modes.end(), predictions[i].elts, predictions[i].elts + predictions[i].size);
+  }
+
+  m_offsets.push_back(static_cast<uint32_t>(m_modes.size()));
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void CompactScorePredictions::expand(ScorePredictionsMemoryBlock& predictionsBlock) const
+{
+  const uint32_t predictionCount = get_prediction_count();
+  if(predictionsBlock.dataSize != predictionCount) predictionsBlock.Resize(predictionCount);
+
+  ScorePrediction *predictions = predictionsBlock.GetData(MEMORYDEVICE_CPU);
+  for(uint32_t i = 0; i < predictionCount; ++i)
+  {
+    predictions[i] = get_prediction(i);
+  }
+}
+
+size_t CompactScorePredictions::get_memory_usage() const
+{
+  return m_offsets.capacity() * sizeof(uint32_t) + m_modes.capacity() * sizeof(Keypoint3DColourCluster);
+}
+
+const Keypoint3DColourCluster *CompactScorePredictions::get_modes() const
+{
+  return m_modes.empty() ? NULL : &m_modes[0];
+}
+
+const uint32_t *CompactScorePredictions::get_offsets() const
+{
+  return &m_offsets[0];
+}
+
+ScorePrediction CompactScorePredictions::get_prediction(uint32_t predictionIdx) const
+{
+  if(predictionIdx >= get_prediction_count())
+  {
+    throw std::invalid_argument("Error: Invalid prediction index");
+  }
+
+  ScorePrediction prediction;
+  prediction.size = static_cast<int>(m_offsets[predictionIdx + 1] - m_offsets[predictionIdx]);
+  std::copy(m_modes.begin() + m_offsets[predictionIdx], m_modes.begin() + m_offsets[predictionIdx + 1], prediction.elts);
+  return prediction;
+}
+
+uint32_t CompactScorePredictions::get_prediction_count() const
+{
+  return static_cast<uint32_t>(m_offsets.size() - 1);
+}
+
+}
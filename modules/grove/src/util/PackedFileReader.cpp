@@ -0,0 +1,125 @@
+/**
+ * grove: PackedFileReader.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "util/PackedFileReader.h"
+
+#include <fstream>
+
+#include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+using namespace boost::interprocess;
+
+namespace grove {
+
+//#################### LOCAL TYPES ####################
+
+namespace {
+
+/**
+ * \brief An instance of this struct keeps a file mapped into memory for as long as it exists.
+ */
+struct MappedFile
+{
+  /** The mapping associated with the file. */
+  file_mapping mapping;
+
+  /** The region of memory into which the file has been mapped. */
+  mapped_region region;
+
+  explicit MappedFile(const std::string& filename)
+  : mapping(filename.c_str(), read_only), region(mapping, read_only)
+  {}
+};
+
+}
+
+//#################### CONSTRUCTORS ####################
+
+PackedFileReader::PackedFileReader(const std::string& filename, bool verifyChecksums)
+: m_data(NULL), m_filename(filename)
+{
+  if(!is_packed_file(filename)) throw std::runtime_error("Error: " + filename + " is not a packed file");
+
+  // Map the file into memory.
+  boost::shared_ptr<MappedFile> mappedFile;
+  try
+  {
+    mappedFile.reset(new MappedFile(filename));
+  }
+  catch(interprocess_exception& e)
+  {
+    throw std::runtime_error("Error: Couldn't map " + filename + " into memory: " + e.what());
+  }
+
+  m_mapping = mappedFile;
+  m_data = static_cast<const char*>(mappedFile->region.get_address());
+
+  const char *base = m_data;
+  const boost::uint64_t fileSize = mappedFile->region.get_size();
+
+  // Check the header.
+  const PackedFileFormat::Header *header = reinterpret_cast<const PackedFileFormat::Header*>(base);
+  const boost::uint32_t supportedVersion = PackedFileFormat::Version;
+  if(header->version != supportedVersion)
+  {
+    throw std::runtime_error(
+      "Error: " + filename + " has version " + boost::lexical_cast<std::string>(header->version) +
+      ", but only version " + boost::lexical_cast<std::string>(supportedVersion) + " is supported"
+    );
+  }
+
+  const boost::uint64_t tableEnd = sizeof(PackedFileFormat::Header) + header->chunkCount * static_cast<boost::uint64_t>(sizeof(PackedFileFormat::ChunkDescriptor));
+  if(tableEnd > fileSize) throw std::runtime_error("Error: " + filename + " is truncated");
+
+  // Read the chunk table, checking that each chunk lies within the file (and, if requested, that its checksum is valid).
+  const PackedFileFormat::ChunkDescriptor *descriptors = reinterpret_cast<const PackedFileFormat::ChunkDescriptor*>(base + sizeof(PackedFileFormat::Header));
+  for(boost::uint32_t i = 0; i < header->chunkCount; ++i)
+  {
+    const PackedFileFormat::ChunkDescriptor& descriptor = descriptors[i];
+    const std::string name(descriptor.name, strnlen(descriptor.name, PackedFileFormat::MaxChunkNameLength));
+
+    if(descriptor.offset < tableEnd || descriptor.offset > fileSize || descriptor.size > fileSize - descriptor.offset)
+    {
+      throw std::runtime_error("Error: Chunk '" + name + "' in " + filename + " is truncated");
+    }
+
+    if(verifyChecksums)
+    {
+      boost::crc_32_type crc;
+      crc.process_bytes(base + descriptor.offset, static_cast<size_t>(descriptor.size));
+      if(crc.checksum() != descriptor.checksum) throw std::runtime_error("Error: Chunk '" + name + "' in " + filename + " is corrupt");
+    }
+
+    m_chunks[name] = descriptor;
+  }
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+bool PackedFileReader::is_packed_file(const std::string& filename)
+{
+  std::ifstream fs(filename.c_str(), std::ios::binary);
+  PackedFileFormat::Header header;
+  return fs.read(reinterpret_cast<char*>(&header), sizeof(PackedFileFormat::Header)) && memcmp(header.magic, PackedFileFormat::magic(), sizeof(header.magic)) == 0;
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const void *PackedFileReader::get_chunk(const std::string& name, size_t& size) const
+{
+  std::map<std::string,PackedFileFormat::ChunkDescriptor>::const_iterator it = m_chunks.find(name);
+  if(it == m_chunks.end()) throw std::runtime_error("Error: " + m_filename + " does not contain a chunk called '" + name + "'");
+
+  size = static_cast<size_t>(it->second.size);
+  return m_data + it->second.offset;
+}
+
+bool PackedFileReader::has_chunk(const std::string& name) const
+{
+  return m_chunks.find(name) != m_chunks.end();
+}
+
+}
@@ -0,0 +1,91 @@
+/**
+ * grove: PackedFileWriter.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "util/PackedFileWriter.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/crc.hpp>
+
+#include "util/PackedFileFormat.h"
+
+namespace grove {
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+void PackedFileWriter::add_chunk(const std::string& name, const void *data, size_t size)
+{
+  if(name.empty() || name.length() >= PackedFileFormat::MaxChunkNameLength)
+  {
+    throw std::invalid_argument("Error: Invalid chunk name '" + name + "'");
+  }
+
+  for(size_t i = 0, chunkCount = m_chunks.size(); i < chunkCount; ++i)
+  {
+    if(m_chunks[i].name == name) throw std::invalid_argument("Error: Duplicate chunk name '" + name + "'");
+  }
+
+  PendingChunk chunk;
+  chunk.data = data;
+  chunk.name = name;
+  chunk.size = size;
+  m_chunks.push_back(chunk);
+}
+
+void PackedFileWriter::write(const std::string& filename) const
+{
+  const boost::uint32_t chunkCount = static_cast<boost::uint32_t>(m_chunks.size());
+  const boost::uint64_t alignment = PackedFileFormat::ChunkAlignment;
+
+  // Fill in the header.
+  PackedFileFormat::Header header;
+  memcpy(header.magic, PackedFileFormat::magic(), sizeof(header.magic));
+  header.version = PackedFileFormat::Version;
+  header.chunkCount = chunkCount;
+
+  // Fill in the chunk descriptors, laying out the chunk data (suitably aligned) after the chunk table.
+  std::vector<PackedFileFormat::ChunkDescriptor> descriptors(chunkCount);
+  boost::uint64_t offset = sizeof(PackedFileFormat::Header) + chunkCount * sizeof(PackedFileFormat::ChunkDescriptor);
+
+  for(boost::uint32_t i = 0; i < chunkCount; ++i)
+  {
+    const PendingChunk& chunk = m_chunks[i];
+    PackedFileFormat::ChunkDescriptor& descriptor = descriptors[i];
+
+    memset(&descriptor, 0, sizeof(PackedFileFormat::ChunkDescriptor));
+    strncpy(descriptor.name, chunk.name.c_str(), PackedFileFormat::MaxChunkNameLength - 1);
+
+    offset = (offset + alignment - 1) / alignment * alignment;
+    descriptor.offset = offset;
+    descriptor.size = chunk.size;
+
+    boost::crc_32_type crc;
+    crc.process_bytes(chunk.data, chunk.size);
+    descriptor.checksum = crc.checksum();
+
+    offset += chunk.size;
+  }
+
+  // Write the header, the chunk table and then the chunk data.
+  std::ofstream fs(filename.c_str(), std::ios::binary);
+  if(!fs) throw std::runtime_error("Error: Couldn't open " + filename + " for writing");
+
+  fs.write(reinterpret_cast<const char*>(&header), sizeof(PackedFileFormat::Header));
+  if(chunkCount > 0) fs.write(reinterpret_cast<const char*>(&descriptors[0]), chunkCount * sizeof(PackedFileFormat::ChunkDescriptor));
+
+  const char padding[PackedFileFormat::ChunkAlignment] = { 0 };
+  for(boost::uint32_t i = 0; i < chunkCount; ++i)
+  {
+    const boost::uint64_t position = static_cast<boost::uint64_t>(fs.tellp());
+    fs.write(padding, static_cast<std::streamsize>(descriptors[i].offset - position));
+    fs.write(static_cast<const char*>(m_chunks[i].data), static_cast<std::streamsize>(m_chunks[i].size));
+  }
+
+  if(!fs) throw std::runtime_error("Error: Couldn't write to " + filename);
+}
+
+}
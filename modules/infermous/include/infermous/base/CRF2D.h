@@ -6,8 +6,12 @@
 #ifndef H_INFERMOUS_CRF2D
 #define H_INFERMOUS_CRF2D
 
+#include <algorithm>
+#include <cmath>
 #include <map>
 #include <ostream>
+#include <set>
+#include <vector>
 
 #include "CRFUtil.h"
 #include "PairwisePotentialCalculator.h"
@@ -16,6 +20,14 @@ namespace infermous {
 
 /**
  * \brief An instance of an instantiation of this class template represents a 2D conditional random field.
+ *
+ * Internally, the unaries and marginals of the CRF are stored as dense, pixel-major tensors of floats: the values for
+ * pixel (x,y) are stored contiguously, one per label, starting at index ((y * width) + x) * labelCount. The labels are
+ * those that appear in the unaries grid passed to the constructor, sorted in ascending order. A label that does not
+ * appear in the unaries for a particular pixel is treated as having a unary probability of zero at that pixel.
+ *
+ * The pairwise potentials between every pair of labels are evaluated once, on construction, and stored in a dense,
+ * row-major matrix, so that inference does not need to call the pairwise potential calculator at all.
  */
 template <typename Label>
 class CRF2D
@@ -32,14 +44,23 @@ private:
   /** The height of the CRF. */
   int m_height;
 
-  /** The grid of marginal probabilities that will be updated at each time step. */
-  ProbabilitiesGrid_Ptr m_marginals;
+  /** The labels used by the CRF, in ascending order. */
+  std::vector<Label> m_labels;
+
+  /** The marginal probabilities that will be updated at each time step (stored as a pixel-major tensor). */
+  std::vector<float> m_marginals;
 
   /** The pairwise potential calculator. */
   PairwisePotentialCalculator_CPtr m_pairwisePotentialCalculator;
 
-  /** The grid of unary probabilities. */
-  ProbabilitiesGrid_Ptr m_unaries;
+  /** The pairwise potentials between every pair of labels (stored as a row-major labelCount x labelCount matrix). */
+  std::vector<float> m_pairwisePotentials;
+
+  /** The unary potentials, i.e. the negative logs of the unary probabilities (stored as a pixel-major tensor). */
+  std::vector<float> m_unaryPotentials;
+
+  /** The unary probabilities (stored as a pixel-major tensor). */
+  std::vector<float> m_unaries;
 
   /** The width of the CRF. */
   int m_width;
@@ -55,10 +76,57 @@ public:
   CRF2D(const ProbabilitiesGrid_Ptr& unaries, const PairwisePotentialCalculator_CPtr& pairwisePotentialCalculator)
   : m_height(static_cast<int>(unaries->rows())),
     m_pairwisePotentialCalculator(pairwisePotentialCalculator),
-    m_unaries(unaries),
     m_width(static_cast<int>(unaries->cols()))
   {
-    m_marginals.reset(new ProbabilitiesGrid(*unaries));
+    // Determine the set of labels used by the CRF.
+    std::set<Label> labels;
+    for(int y = 0; y < m_height; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        const std::map<Label,float>& psi = (*unaries)(y, x);
+        for(typename std::map<Label,float>::const_iterator kt = psi.begin(), kend = psi.end(); kt != kend; ++kt)
+        {
+          labels.insert(kt->first);
+        }
+      }
+    }
+    m_labels.assign(labels.begin(), labels.end());
+
+    // Convert the unaries into a dense tensor, and precompute the corresponding unary potentials.
+    const size_t labelCount = m_labels.size();
+    m_unaries.resize(get_pixel_count() * labelCount, 0.0f);
+    m_unaryPotentials.resize(m_unaries.size());
+    for(int y = 0; y < m_height; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        float *psi_i = &m_unaries[get_offset(x, y)];
+        const std::map<Label,float>& psi = (*unaries)(y, x);
+        for(typename std::map<Label,float>::const_iterator kt = psi.begin(), kend = psi.end(); kt != kend; ++kt)
+        {
+          psi_i[get_label_index(kt->first)] = kt->second;
+        }
+      }
+    }
+
+    for(size_t i = 0, size = m_unaries.size(); i < size; ++i)
+    {
+      m_unaryPotentials[i] = -logf(m_unaries[i]);
+    }
+
+    // Precompute the pairwise potentials between every pair of labels.
+    m_pairwisePotentials.resize(labelCount * labelCount);
+    for(size_t k = 0; k < labelCount; ++k)
+    {
+      for(size_t kDash = 0; kDash < labelCount; ++kDash)
+      {
+        m_pairwisePotentials[k * labelCount + kDash] = pairwisePotentialCalculator->calculate_potential(m_labels[k], m_labels[kDash]);
+      }
+    }
+
+    // Initialise the marginals to the unaries.
+    m_marginals = m_unaries;
   }
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -73,15 +141,57 @@ public:
     return m_height;
   }
 
+  /**
+   * \brief Gets the number of labels used by the CRF.
+   *
+   * \return  The number of labels used by the CRF.
+   */
+  size_t get_label_count() const
+  {
+    return m_labels.size();
+  }
+
+  /**
+   * \brief Gets the labels used by the CRF.
+   *
+   * \return  The labels used by the CRF, in ascending order (the order in which their values are stored for each pixel).
+   */
+  const std::vector<Label>& get_labels() const
+  {
+    return m_labels;
+  }
+
+  /**
+   * \brief Gets the marginal probabilities for every pixel in the CRF.
+   *
+   * \return  A pointer to the pixel-major tensor of marginal probabilities.
+   */
+  const float *get_marginals() const
+  {
+    return m_marginals.empty() ? NULL : &m_marginals[0];
+  }
+
   /**
    * \brief Gets the marginal probabilities for the specified location.
    *
    * \param loc The location whose marginal probabilities we want to get.
    * \return    The marginal probabilities for the specified location.
    */
-  const std::map<Label,float>& get_marginals_at(const Eigen::Vector2i& loc) const
+  std::map<Label,float> get_marginals_at(const Eigen::Vector2i& loc) const
   {
-    return (*m_marginals)(loc.y(), loc.x());
+    return make_probabilities(&m_marginals[get_offset(loc.x(), loc.y())]);
+  }
+
+  /**
+   * \brief Gets the offset of the values for the specified pixel in the pixel-major tensors used by the CRF.
+   *
+   * \param x The x coordinate of the pixel.
+   * \param y The y coordinate of the pixel.
+   * \return  The offset of the values for the pixel.
+   */
+  size_t get_offset(int x, int y) const
+  {
+    return (static_cast<size_t>(y) * m_width + x) * m_labels.size();
   }
 
   /**
@@ -94,15 +204,47 @@ public:
     return m_pairwisePotentialCalculator;
   }
 
+  /**
+   * \brief Gets the precomputed pairwise potentials between every pair of labels.
+   *
+   * \note  The potential between the labels with indices k and k' is stored at index k * get_label_count() + k'.
+   *
+   * \return  A pointer to the row-major matrix of pairwise potentials.
+   */
+  const float *get_pairwise_potentials() const
+  {
+    return m_pairwisePotentials.empty() ? NULL : &m_pairwisePotentials[0];
+  }
+
+  /**
+   * \brief Gets the number of pixels in the CRF.
+   *
+   * \return  The number of pixels in the CRF.
+   */
+  size_t get_pixel_count() const
+  {
+    return static_cast<size_t>(m_width) * m_height;
+  }
+
+  /**
+   * \brief Gets the unary potentials (the negative logs of the unary probabilities) for every pixel in the CRF.
+   *
+   * \return  A pointer to the pixel-major tensor of unary potentials.
+   */
+  const float *get_unary_potentials() const
+  {
+    return m_unaryPotentials.empty() ? NULL : &m_unaryPotentials[0];
+  }
+
   /**
    * \brief Gets the unary probabilities for the specified location.
    *
    * \param loc The location whose unary probabilities we want to get.
    * \return    The unary probabilities for the specified location.
    */
-  const std::map<Label,float>& get_unaries_at(const Eigen::Vector2i& loc) const
+  std::map<Label,float> get_unaries_at(const Eigen::Vector2i& loc) const
   {
-    return (*m_unaries)(loc.y(), loc.x());
+    return make_probabilities(&m_unaries[get_offset(loc.x(), loc.y())]);
   }
 
   /**
@@ -118,23 +260,37 @@ public:
   /**
    * \brief Predicts the labels for each pixel in the CRF.
    *
+   * If there are several labels with the highest probability for a pixel, the smallest of them is chosen.
+   *
    * return The grid of predicted labels.
    */
   Grid<Label> predict_labels() const
   {
-    return CRFUtil::predict_labels(*m_marginals);
+    Grid<Label> result(m_height, m_width);
+    if(m_labels.empty()) return result;
+
+    for(int y = 0; y < m_height; ++y)
+    {
+      for(int x = 0; x < m_width; ++x)
+      {
+        const float *Q_i = &m_marginals[get_offset(x, y)];
+        result(y, x) = m_labels[std::max_element(Q_i, Q_i + m_labels.size()) - Q_i];
+      }
+    }
+
+    return result;
   }
 
   /**
-   * \brief Swaps the current grid of marginal probabilities with a new grid.
+   * \brief Swaps the current marginal probabilities with a new set of marginal probabilities.
    *
-   * This is useful for implementing a "double-buffering" update approach in which we update a new grid and then swap it with the old one at each time step.
+   * This is useful for implementing a "double-buffering" update approach in which we update a new tensor and then swap it with the old one at each time step.
    *
-   * \param marginals The new grid of marginal probabilities.
+   * \param marginals The new marginal probabilities (a pixel-major tensor of the same size as the existing one).
    */
-  void swap_marginals(ProbabilitiesGrid_Ptr& marginals)
+  void swap_marginals(std::vector<float>& marginals)
   {
-    std::swap(m_marginals, marginals);
+    m_marginals.swap(marginals);
   }
 
   /**
@@ -148,6 +304,35 @@ public:
     return 0 <= loc.x() && loc.x() < m_width && 0 <= loc.y() && loc.y() < m_height;
   }
 
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Gets the index of the specified label in the (sorted) list of labels used by the CRF.
+   *
+   * \param label The label.
+   * \return      The index of the label.
+   */
+  size_t get_label_index(const Label& label) const
+  {
+    return std::lower_bound(m_labels.begin(), m_labels.end(), label) - m_labels.begin();
+  }
+
+  /**
+   * \brief Makes a label -> probability map from the values for a pixel in one of the pixel-major tensors used by the CRF.
+   *
+   * \param values  A pointer to the values for the pixel (one per label).
+   * \return        The corresponding label -> probability map.
+   */
+  std::map<Label,float> make_probabilities(const float *values) const
+  {
+    std::map<Label,float> result;
+    for(size_t k = 0, labelCount = m_labels.size(); k < labelCount; ++k)
+    {
+      result.insert(result.end(), std::make_pair(m_labels[k], values[k]));
+    }
+    return result;
+  }
+
   //#################### STREAM OPERATORS ####################
 
   /**
@@ -159,7 +344,16 @@ public:
    */
   friend std::ostream& operator<<(std::ostream& os, const CRF2D& rhs)
   {
-    os << *rhs.m_marginals;
+    ProbabilitiesGrid marginals(rhs.m_height, rhs.m_width);
+    for(int y = 0; y < rhs.m_height; ++y)
+    {
+      for(int x = 0; x < rhs.m_width; ++x)
+      {
+        marginals(y, x) = rhs.get_marginals_at(Eigen::Vector2i(x, y));
+      }
+    }
+
+    os << marginals;
     return os;
   }
 };
@@ -6,6 +6,8 @@
 #ifndef H_INFERMOUS_MEANFIELDINFERENCEENGINE
 #define H_INFERMOUS_MEANFIELDINFERENCEENGINE
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "../base/CRF2D.h"
@@ -22,8 +24,6 @@ class MeanFieldInferenceEngine
 public:
   typedef infermous::CRF2D_Ptr<Label> CRF2D_Ptr;
   typedef infermous::CRF2D_CPtr<Label> CRF2D_CPtr;
-  typedef infermous::ProbabilitiesGrid<Label> ProbabilitiesGrid;
-  typedef infermous::ProbabilitiesGrid_Ptr<Label> ProbabilitiesGrid_Ptr;
 
   //#################### PRIVATE VARIABLES ####################
 private:
@@ -33,11 +33,8 @@ private:
   /** A list of offsets used to specify the neighbours of each pixel. */
   std::vector<Eigen::Vector2i> m_neighbourOffsets;
 
-  /** A grid of updated marginal probabilities that will be swapped with the grid in the CRF at the end of each time step. */
-  ProbabilitiesGrid_Ptr m_newMarginals;
-
-  /** The pairwise potential calculator. */
-  PairwisePotentialCalculator_CPtr<Label> m_pairwisePotentialCalculator;
+  /** The updated marginal probabilities that will be swapped with those in the CRF at the end of each time step. */
+  std::vector<float> m_newMarginals;
 
   //#################### CONSTRUCTORS ####################
 public:
@@ -50,8 +47,7 @@ public:
   MeanFieldInferenceEngine(const CRF2D_Ptr& crf, const std::vector<Eigen::Vector2i>& neighbourOffsets)
   : m_crf(crf),
     m_neighbourOffsets(neighbourOffsets),
-    m_newMarginals(new ProbabilitiesGrid(crf->get_height(), crf->get_width())),
-    m_pairwisePotentialCalculator(crf->get_pairwise_potential_calculator())
+    m_newMarginals(crf->get_pixel_count() * crf->get_label_count())
   {}
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
@@ -69,17 +65,34 @@ public:
   /**
    * \brief Updates the CRF on which the mean-field inference engine works.
    *
+   * The pixels are updated in parallel (when OpenMP is available), since each of them only depends on the marginals from the previous iteration.
+   *
    * \param iterations  The number of update iterations to run.
    */
   void update_crf(size_t iterations)
   {
+    const int height = m_crf->get_height();
+    const int labelCount = static_cast<int>(m_crf->get_label_count());
+    if(labelCount == 0) return;
+
     for(size_t i = 0; i < iterations; ++i)
     {
-      for(int y = 0, height = m_crf->get_height(); y < height; ++y)
+#ifdef WITH_OPENMP
+      #pragma omp parallel
+#endif
       {
-        for(int x = 0, width = m_crf->get_width(); x < width; ++x)
+        // Allocate the scratch space needed to update a pixel (once per thread, rather than once per pixel).
+        std::vector<float> Q_N_i(labelCount), M_i(labelCount);
+
+#ifdef WITH_OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for(int y = 0; y < height; ++y)
         {
-          compute_updated_pixel(Eigen::Vector2i(x, y));
+          for(int x = 0, width = m_crf->get_width(); x < width; ++x)
+          {
+            compute_updated_pixel(Eigen::Vector2i(x, y), &Q_N_i[0], &M_i[0]);
+          }
         }
       }
 
@@ -91,78 +104,74 @@ public:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Computes the value of M_i(L), for pixel i and label L.
+   * \brief Computes the updated version of the specified pixel in the CRF.
    *
-   * See p.6 of the original SemanticPaint paper for details - essentially, this is the new marginal potential (not the probability!) for the pixel.
+   * See p.6 of the original SemanticPaint paper for details. For each label L, we compute the new marginal potential
+   * M_i(L) = phi_i(L) + \sum_{j in N(i)} \sum_{L'} Q_j^{t-1}(L') * phi_ij(L,L'), and then set Q_i^t(L) = 1/Z_i * e^-M_i(L).
+   * Since the pairwise potentials depend only on the labels, we reorder the sums to first accumulate the marginals of
+   * the neighbours, Q_N(i)(L') = \sum_{j in N(i)} Q_j^{t-1}(L'), and then multiply them by the pairwise potential matrix.
+   * This makes no difference to the result (up to floating-point rounding), but reduces the cost of the update from
+   * O(|N| * |L|^2) to O(|N| * |L| + |L|^2) per pixel.
    *
-   * \param i       The location of the pixel.
-   * \param L       The label.
-   * \param phi_i_L The unary potential, phi_i(L), for the specified pixel and label (we pass this in to avoid having to recalculate it).
-   * \return        The value of M_i(L) for the specified pixel and label.
+   * \param i     The location of the pixel whose updated version we want to compute.
+   * \param Q_N_i Scratch space (one float per label) in which to accumulate the marginals of the pixel's neighbours.
+   * \param M_i   Scratch space (one float per label) in which to compute the new marginal potentials for the pixel.
    */
-  float compute_M_i_L(const Eigen::Vector2i& i, const Label& L, float phi_i_L) const
+  void compute_updated_pixel(const Eigen::Vector2i& i, float *Q_N_i, float *M_i)
   {
-    float result = phi_i_L;
+    const int labelCount = static_cast<int>(m_crf->get_label_count());
+    const float *Q = m_crf->get_marginals();
+    const float *phi_ij = m_crf->get_pairwise_potentials();
+    const float *phi_i = m_crf->get_unary_potentials() + m_crf->get_offset(i.x(), i.y());
 
-    // Note that we have reordered the sums presented in the paper so as to iterate over the neighbours first.
-    // This makes no difference to the result, but allows us to avoid lookups of Q_j^{t-1}(L').
+    // Calculate \sum_{j in N(i)} Q_j^{t-1}(L') for every L'.
+    std::fill(Q_N_i, Q_N_i + labelCount, 0.0f);
     for(std::vector<Eigen::Vector2i>::const_iterator nt = m_neighbourOffsets.begin(), nend = m_neighbourOffsets.end(); nt != nend; ++nt)
     {
       // Calculate the location of the possible neighbour and check whether or not it is within the CRF. If not, skip it.
       Eigen::Vector2i j = i + *nt;
       if(!m_crf->within_bounds(j)) continue;
 
-      // Calculate \sum_{L'} (Q_j^{t-1}(L') * phi_ij(L,L')).
-      const std::map<Label,float>& Q_j = m_crf->get_marginals_at(j);
-      for(typename std::map<Label,float>::const_iterator kt = Q_j.begin(), kend = Q_j.end(); kt != kend; ++kt)
+      const float *Q_j = Q + m_crf->get_offset(j.x(), j.y());
+      for(int kDash = 0; kDash < labelCount; ++kDash)
       {
-        const Label& LDash = kt->first;
-        float Q_j_LDash = kt->second;
-        float phi_i_j_L_LDash = m_pairwisePotentialCalculator->calculate_potential(L, LDash);
-        result += Q_j_LDash * phi_i_j_L_LDash;
+        Q_N_i[kDash] += Q_j[kDash];
       }
     }
 
-    return result;
-  }
+    // Calculate M_i(L) for every L, keeping track of the smallest one.
+    float minM_i = std::numeric_limits<float>::max();
+    for(int k = 0; k < labelCount; ++k)
+    {
+      const float *phi_ij_L = phi_ij + k * labelCount;
+      float sum = 0.0f;
+      for(int kDash = 0; kDash < labelCount; ++kDash)
+      {
+        sum += Q_N_i[kDash] * phi_ij_L[kDash];
+      }
 
-  /**
-   * \brief Computes the updated version of the specified pixel in the CRF.
-   *
-   * \param i The location of the pixel whose updated version we want to compute.
-   */
-  void compute_updated_pixel(const Eigen::Vector2i& i)
-  {
-    // Get the unary probabilities for the pixel.
-    const std::map<Label,float>& psi_i = m_crf->get_unaries_at(i);
+      M_i[k] = phi_i[k] + sum;
+      if(M_i[k] < minM_i) minM_i = M_i[k];
+    }
 
-    // Calculate the unnormalised new probabilities for the pixel, together with the normalisation constant.
-    // (In other words, compute e^-M_i(L) for every L, and Z_i, as per the original SemanticPaint paper.)
-    std::map<Label,float> oneOverE_M_i;
+    // Calculate the normalised new probabilities for the pixel, i.e. Q_i^t(L) = 1/Z_i * e^-M_i(L).
+    // Note that we subtract the smallest M_i(L) from each M_i(L) before exponentiating: this cancels out
+    // when we normalise, but prevents all of the exponentials from underflowing for large potentials.
     float Z_i = 0.0f;
-    for(typename std::map<Label,float>::const_iterator kt = psi_i.begin(), kend = psi_i.end(); kt != kend; ++kt)
+    for(int k = 0; k < labelCount; ++k)
     {
-      const Label& L = kt->first;
-      float psi_i_L = kt->second;
-      float phi_i_L = -logf(psi_i_L);
-      float oneOverE_M_i_L = expf(-compute_M_i_L(i, L, phi_i_L));
-      oneOverE_M_i[L] = oneOverE_M_i_L;
-      Z_i += oneOverE_M_i_L;
+      M_i[k] = expf(minM_i - M_i[k]);
+      Z_i += M_i[k];
     }
 
-    // Calculate the normalised new probabilities for the pixel by dividing through by the normalisation constant.
-    // (In other words, compute Q_i^t(L) = 1/Z_i * e^-M_i(L), as per the paper.)
     float oneOverZ_i = 1.0f / Z_i;
-    std::map<Label,float>& Q_i = (*m_newMarginals)(i.y(), i.x());
-    for(typename std::map<Label,float>::const_iterator kt = oneOverE_M_i.begin(), kend = oneOverE_M_i.end(); kt != kend; ++kt)
+    float *Q_i = &m_newMarginals[m_crf->get_offset(i.x(), i.y())];
+    for(int k = 0; k < labelCount; ++k)
     {
-      const Label& L = kt->first;
-      float oneOverE_M_i_L = kt->second;
-      Q_i[L] = oneOverZ_i * oneOverE_M_i_L;
+      Q_i[k] = oneOverZ_i * M_i[k];
     }
   }
 };
-
 }
 
 #endif
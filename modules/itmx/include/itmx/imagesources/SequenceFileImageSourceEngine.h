@@ -0,0 +1,185 @@
+/**
+ * itmx: SequenceFileImageSourceEngine.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCEFILEIMAGESOURCEENGINE
+#define H_ITMX_SEQUENCEFILEIMAGESOURCEENGINE
+
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "../base/ITMObjectPtrTypes.h"
+#include "../persistence/SequenceFileReader.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to read RGB-D images from a sequence file.
+ *
+ * The frames are uncompressed on a pool of worker threads, each of which decodes a different frame of a sliding
+ * prefetch window that starts at the next frame to be returned. Since the sequence file is indexed, it is also
+ * possible to seek to any frame in the sequence, in which case the prefetch window is restarted from that frame.
+ */
+class SequenceFileImageSourceEngine : public InputSource::ImageSourceEngine
+{
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief The possible states of a slot in the prefetch window.
+   */
+  enum SlotState
+  {
+    /** The slot is not in use. */
+    SS_EMPTY,
+
+    /** A worker is uncompressing a frame into the slot. */
+    SS_DECODING,
+
+    /** The slot contains an uncompressed frame that is ready to be returned. */
+    SS_READY
+  };
+
+  /**
+   * \brief An instance of this struct represents a slot in the prefetch window.
+   */
+  struct Slot
+  {
+    /** An error message describing why the frame could not be uncompressed (empty if it was uncompressed successfully). */
+    std::string error;
+
+    /** The uncompressed frame stored in the slot. */
+    RGBDFrameMessage_Ptr frame;
+
+    /** The position in the file of the frame stored in the slot. */
+    size_t position;
+
+    /** The state of the slot. */
+    SlotState state;
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of workers that are currently uncompressing a frame. */
+  size_t m_decodesInProgress;
+
+  /** The camera pose for the frame most recently returned by getImages. */
+  ORUtils::SE3Pose m_lastPose;
+
+  /** The synchronisation mutex. */
+  mutable boost::mutex m_mutex;
+
+  /** The position in the file of the next frame to be uncompressed. */
+  size_t m_nextPositionToDecode;
+
+  /** The position in the file of the next frame to be returned by getImages. */
+  size_t m_nextPositionToReturn;
+
+  /** The reader used to access the sequence file. */
+  SequenceFileReader_CPtr m_reader;
+
+  /** The slots in the prefetch window (the frame at position p is uncompressed into slot p % m_slots.size()). */
+  std::vector<Slot> m_slots;
+
+  /** A condition variable used to wait for a slot to become ready or for all decodes to finish. */
+  mutable boost::condition_variable m_slotReady;
+
+  /** A condition variable used to wait for work to become available to the workers. */
+  boost::condition_variable m_workAvailable;
+
+  /** A flag indicating whether or not the workers should avoid starting to uncompress new frames (e.g. during a seek). */
+  bool m_workersPaused;
+
+  /** A flag set in the destructor to indicate that the workers should terminate. */
+  bool m_workersShouldTerminate;
+
+  /** The worker threads that uncompress the frames. */
+  boost::thread_group m_workers;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a sequence file image source engine.
+   *
+   * \param filename        The name of the sequence file.
+   * \param initialPosition The position in the file of the first frame to return.
+   * \param prefetchCount   The maximum number of frames to uncompress ahead of the frame that will next be returned.
+   * \param workerCount     The number of worker threads to use to uncompress the frames (0 means one per hardware thread).
+   *
+   * \throws std::runtime_error If the sequence file cannot be read.
+   */
+  explicit SequenceFileImageSourceEngine(const std::string& filename, size_t initialPosition = 0, size_t prefetchCount = 60, size_t workerCount = 0);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the image source engine.
+   */
+  virtual ~SequenceFileImageSourceEngine();
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual ITMLib::ITMRGBDCalib getCalib() const;
+
+  /** Override */
+  virtual Vector2i getDepthImageSize() const;
+
+  /** Override */
+  virtual void getImages(ORUChar4Image *rgb, ORShortImage *rawDepth);
+
+  /** Override */
+  virtual Vector2i getRGBImageSize() const;
+
+  /** Override */
+  virtual bool hasMoreImages() const;
+
+  /**
+   * \brief Gets the camera pose for the frame most recently returned by getImages.
+   *
+   * \return  The camera pose for the frame most recently returned by getImages.
+   */
+  ORUtils::SE3Pose get_last_pose() const;
+
+  /**
+   * \brief Gets the position in the file of the frame that will next be returned by getImages.
+   *
+   * \return  The position in the file of the frame that will next be returned by getImages.
+   */
+  size_t get_position() const;
+
+  /**
+   * \brief Gets the reader used to access the sequence file.
+   *
+   * \return  The reader used to access the sequence file.
+   */
+  const SequenceFileReader_CPtr& get_reader() const;
+
+  /**
+   * \brief Seeks to the specified position in the file, so that the frame at that position will next be returned by getImages.
+   *
+   * \note  Any frames that have already been prefetched from the old position are discarded.
+   *
+   * \param position  The position in the file of the frame that should next be returned (if this is past the end
+   *                  of the sequence, hasMoreImages will subsequently return false).
+   */
+  void seek(size_t position);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs a worker that uncompresses frames in the prefetch window.
+   */
+  void run_worker();
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SequenceFileImageSourceEngine> SequenceFileImageSourceEngine_Ptr;
+typedef boost::shared_ptr<const SequenceFileImageSourceEngine> SequenceFileImageSourceEngine_CPtr;
+
+}
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * itmx: SequenceFileConverter.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCEFILECONVERTER
+#define H_ITMX_SEQUENCEFILECONVERTER
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+namespace itmx {
+
+/**
+ * \brief This class contains utility functions for converting sequence files to other formats.
+ */
+class SequenceFileConverter
+{
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Converts a sequence file into a directory of individual frame files.
+   *
+   * The output uses the same layout as sequences recorded directly to disk, i.e. a calib.txt file, together with
+   * a frame-%06i.color.png, frame-%06i.depth.png and frame-%06i.pose.txt file for each frame (the pose files contain
+   * the camera -> world transformations). The frames are numbered consecutively from zero, even if some frames were
+   * dropped during recording. If the sequence only contains RGB images, no depth files are written.
+   *
+   * \param sequenceFilename    The name of the sequence file.
+   * \param outputDir           The directory into which to write the frame files (will be created if necessary).
+   * \throws std::runtime_error If the sequence file cannot be read, or the frame files cannot be written.
+   */
+  static void convert_to_frame_files(const std::string& sequenceFilename, const boost::filesystem::path& outputDir);
+};
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * itmx: SequenceFileFormat.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCEFILEFORMAT
+#define H_ITMX_SEQUENCEFILEFORMAT
+
+#include <boost/cstdint.hpp>
+
+namespace itmx {
+
+/**
+ * \brief This struct describes the on-disk layout of a sequence file.
+ *
+ * A sequence file stores an RGB-D sequence (RGB image, depth image and pose for each frame) in a single, append-only file.
+ * It consists of a fixed-size header, followed by an RGB-D calibration message (which also specifies the types of compression
+ * used for the images), followed by one record per frame, followed by an index of the frame records and a fixed-size footer.
+ * Each frame record consists of a compressed RGB-D frame header message followed by the corresponding compressed RGB-D frame
+ * message, exactly as they would be sent to a mapping server.
+ *
+ * The index and footer are only written when the file is closed. If a recording is interrupted before this happens, the
+ * frame records can still be recovered by scanning the file from the first record onwards.
+ *
+ * \note  All values are stored in the native byte order of the machine that wrote the file.
+ */
+struct SequenceFileFormat
+{
+  //#################### CONSTANTS ####################
+
+  /** The current version of the format. */
+  static const boost::uint32_t Version = 1;
+
+  //#################### NESTED TYPES ####################
+
+  /**
+   * \brief An instance of this struct represents the footer of a sequence file.
+   */
+  struct Footer
+  {
+    /** The offset of the index from the start of the file. */
+    boost::uint64_t indexOffset;
+
+    /** The number of frames in the file. */
+    boost::uint64_t frameCount;
+
+    /** The magic bytes that identify a complete sequence file ("ITMXSIDX"). */
+    char magic[8];
+  };
+
+  /**
+   * \brief An instance of this struct represents the header of a sequence file.
+   */
+  struct Header
+  {
+    /** The magic bytes that identify a sequence file ("ITMXSEQF"). */
+    char magic[8];
+
+    /** The version of the format used by the file. */
+    boost::uint32_t version;
+
+    /** The size (in bytes) of the calibration message that immediately follows the header. */
+    boost::uint32_t calibSize;
+  };
+
+  /**
+   * \brief An instance of this struct represents an entry in the index of a sequence file.
+   */
+  struct IndexEntry
+  {
+    /** The offset of the frame record from the start of the file. */
+    boost::uint64_t offset;
+
+    /** The index of the frame within the recorded sequence. */
+    boost::int32_t frameIndex;
+
+    /** Unused (ensures that the size of the struct is the same on all platforms). */
+    boost::uint32_t reserved;
+  };
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+  /**
+   * \brief Gets the magic bytes that identify a complete sequence file (stored in its footer).
+   *
+   * \return  The magic bytes that identify a complete sequence file (not null-terminated).
+   */
+  static const char *footer_magic()
+  {
+    return "ITMXSIDX";
+  }
+
+  /**
+   * \brief Gets the magic bytes that identify a sequence file (stored in its header).
+   *
+   * \return  The magic bytes that identify a sequence file (not null-terminated).
+   */
+  static const char *magic()
+  {
+    return "ITMXSEQF";
+  }
+};
+
+}
+
+#endif
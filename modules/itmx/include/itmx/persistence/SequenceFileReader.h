@@ -0,0 +1,193 @@
+/**
+ * itmx: SequenceFileReader.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCEFILEREADER
+#define H_ITMX_SEQUENCEFILEREADER
+
+#include <vector>
+
+#include <ITMLib/Objects/Camera/ITMRGBDCalib.h>
+
+#include "SequenceFileFormat.h"
+#include "../remotemapping/RGBDFrameCompressor.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to read the frames of an RGB-D sequence from a sequence file.
+ *
+ * The file is mapped into memory rather than read via a stream, so any frame can be accessed in constant time. The const
+ * member functions can safely be called from several threads at once, provided that each thread uses its own frame
+ * compressor (see make_frame_compressor), which makes it possible to decode several frames in parallel.
+ *
+ * \note  If the file has no index (e.g. because the recording was interrupted), the frame records are recovered by scanning the file.
+ */
+class SequenceFileReader
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The calibration for the camera that produced the RGB-D images. */
+  ITMLib::ITMRGBDCalib m_calib;
+
+  /** A pointer to the start of the memory into which the file has been mapped. */
+  const char *m_data;
+
+  /** The compression type used for the depth images. */
+  DepthCompressionType m_depthCompressionType;
+
+  /** The name of the sequence file. */
+  std::string m_filename;
+
+  /** The compressor used to uncompress the frames in the convenience version of read_frame. */
+  RGBDFrameCompressor_Ptr m_frameCompressor;
+
+  /** The index of the frame records in the file. */
+  std::vector<SequenceFileFormat::IndexEntry> m_index;
+
+  /** The mapping that keeps the file mapped into memory for as long as the reader exists. */
+  boost::shared_ptr<void> m_mapping;
+
+  /** The compression type used for the RGB images. */
+  RGBCompressionType m_rgbCompressionType;
+
+  /** The size of the file (in bytes). */
+  boost::uint64_t m_size;
+
+  /** A message into which to uncompress the frames. */
+  RGBDFrameMessage_Ptr m_uncompressedFrame;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a sequence file reader.
+   *
+   * \param filename  The name of the sequence file.
+   *
+   * \throws std::runtime_error If the file cannot be opened, or is not a valid sequence file.
+   */
+  explicit SequenceFileReader(const std::string& filename);
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Determines whether or not the specified file is a sequence file.
+   *
+   * \param filename  The name of the file.
+   * \return          true, if the file exists and starts with the magic bytes that identify a sequence file, or false otherwise.
+   */
+  static bool is_sequence_file(const std::string& filename);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the calibration for the camera that produced the RGB-D images.
+   *
+   * \return  The calibration for the camera that produced the RGB-D images.
+   */
+  const ITMLib::ITMRGBDCalib& get_calib() const;
+
+  /**
+   * \brief Gets the size of the depth images in the sequence (this will be zero if only RGB images were recorded).
+   *
+   * \return  The size of the depth images in the sequence.
+   */
+  Vector2i get_depth_image_size() const;
+
+  /**
+   * \brief Gets the number of frames in the sequence.
+   *
+   * \return  The number of frames in the sequence.
+   */
+  size_t get_frame_count() const;
+
+  /**
+   * \brief Gets the size of the RGB images in the sequence.
+   *
+   * \return  The size of the RGB images in the sequence.
+   */
+  Vector2i get_rgb_image_size() const;
+
+  /**
+   * \brief Makes a frame compressor that can be used to uncompress the frames in the sequence.
+   *
+   * \return  The frame compressor.
+   */
+  RGBDFrameCompressor_Ptr make_frame_compressor() const;
+
+  /**
+   * \brief Reads the specified frame from the sequence into an uncompressed frame message.
+   *
+   * \param i                 The position of the frame in the file (between 0 and get_frame_count() - 1).
+   * \param frameCompressor   The compressor to use to uncompress the frame (see make_frame_compressor).
+   * \param uncompressedFrame The message into which to uncompress the frame (must have the sizes of the images in the sequence).
+   *
+   * \throws std::runtime_error If the frame cannot be read.
+   */
+  void read_frame(size_t i, RGBDFrameCompressor& frameCompressor, RGBDFrameMessage& uncompressedFrame) const;
+
+  /**
+   * \brief Reads the specified frame from the sequence.
+   *
+   * \param i           The position of the frame in the file (between 0 and get_frame_count() - 1).
+   * \param rgbImage    An image into which to write the RGB image for the frame (will be resized as necessary).
+   * \param depthImage  An image into which to write the depth image for the frame (will be resized as necessary; may be NULL).
+   * \param pose        A pose into which to write the camera pose for the frame.
+   *
+   * \throws std::runtime_error If the frame cannot be read.
+   */
+  void read_frame(size_t i, ORUChar4Image *rgbImage, ORShortImage *depthImage, ORUtils::SE3Pose& pose);
+
+  /**
+   * \brief Reads the camera pose for the specified frame from the sequence, without uncompressing the frame's images.
+   *
+   * \param i The position of the frame in the file (between 0 and get_frame_count() - 1).
+   * \return  The camera pose for the frame.
+   *
+   * \throws std::runtime_error If the frame cannot be read.
+   */
+  ORUtils::SE3Pose read_pose(size_t i) const;
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Computes the size of the frame record that starts with the specified compressed frame header.
+   *
+   * \note  The size is computed from the raw values in the header, without sizing a compressed frame message to match them,
+   *        so that a record can be checked against the size of the file before any memory is allocated for it.
+   *
+   * \param headerMsg The compressed frame header.
+   * \return          The size (in bytes) of the frame record, including the header.
+   */
+  static boost::uint64_t compute_record_size(const CompressedRGBDFrameHeaderMessage& headerMsg);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Reads the compressed frame record at the specified position in the file.
+   *
+   * \param i         The position of the frame in the file (between 0 and get_frame_count() - 1).
+   * \param headerMsg The message into which to copy the compressed frame header.
+   * \param frameMsg  The message into which to copy the compressed frame (will be resized as necessary).
+   *
+   * \throws std::runtime_error If the frame cannot be read.
+   */
+  void read_compressed_frame(size_t i, CompressedRGBDFrameHeaderMessage& headerMsg, CompressedRGBDFrameMessage& frameMsg) const;
+
+  /**
+   * \brief Rebuilds the index of the frame records by scanning the file.
+   *
+   * \param firstRecordOffset The offset of the first frame record from the start of the file.
+   */
+  void rebuild_index(boost::uint64_t firstRecordOffset);
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SequenceFileReader> SequenceFileReader_Ptr;
+typedef boost::shared_ptr<const SequenceFileReader> SequenceFileReader_CPtr;
+
+}
+
+#endif
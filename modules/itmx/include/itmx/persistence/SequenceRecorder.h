@@ -0,0 +1,161 @@
+/**
+ * itmx: SequenceRecorder.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCERECORDER
+#define H_ITMX_SEQUENCERECORDER
+
+#include <deque>
+#include <fstream>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <ITMLib/Objects/Camera/ITMRGBDCalib.h>
+
+#include <tvgutil/containers/PooledQueue.h>
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+
+#include "SequenceFileFormat.h"
+#include "../remotemapping/RGBDFrameCompressor.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to record an RGB-D sequence to a sequence file asynchronously.
+ *
+ * Frames are copied into reusable frame messages from a fixed-size pool and queued. A separate writer thread compresses the
+ * queued frames and appends them to the file. The pool bounds the amount of memory the recorder can use: a pool empty strategy
+ * specifies what should happen when a frame is recorded while all of the messages in the pool are waiting to be written (e.g.
+ * discarding the new frame, or blocking the caller until the writer has caught up).
+ */
+class SequenceRecorder
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The compressor used to compress the frames before they are written. */
+  RGBDFrameCompressor_Ptr m_frameCompressor;
+
+  /** The number of frames that have been discarded because the pool was empty. */
+  size_t m_framesDropped;
+
+  /** The number of frames that have been recorded so far (including any that were subsequently dropped). */
+  int m_framesRecorded;
+
+  /** The index of the frame records that have been written to the file so far. */
+  std::vector<SequenceFileFormat::IndexEntry> m_index;
+
+  /** The synchronisation mutex. */
+  mutable boost::mutex m_mutex;
+
+  /** A pool of reusable frame messages. */
+  std::deque<RGBDFrameMessage_Ptr> m_pool;
+
+  /** A strategy specifying what should happen when a frame is recorded while the pool is empty. */
+  tvgutil::pooled_queue::PoolEmptyStrategy m_poolEmptyStrategy;
+
+  /** A condition variable used to wait for the pool to become non-empty. */
+  boost::condition_variable m_poolNonEmpty;
+
+  /** A queue of frame messages that are waiting to be written. */
+  std::deque<RGBDFrameMessage_Ptr> m_queue;
+
+  /** A condition variable used to wait for the queue to become non-empty. */
+  boost::condition_variable m_queueNonEmpty;
+
+  /** The random number generator to use if using the random replacement pool empty strategy. */
+  boost::shared_ptr<tvgutil::RandomNumberGenerator> m_rng;
+
+  /** The size of the depth images in the sequence. */
+  Vector2i m_depthImageSize;
+
+  /** The size of the RGB images in the sequence. */
+  Vector2i m_rgbImageSize;
+
+  /** The stream to which the sequence file is written. */
+  std::ofstream m_stream;
+
+  /** The thread on which frames are compressed and written to the file. */
+  boost::thread m_writer;
+
+  /** A flag set in the destructor to indicate that the writer should terminate once the queue is empty. */
+  bool m_writerShouldTerminate;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a sequence recorder.
+   *
+   * \note  The sizes of the RGB and depth images are taken from the calibration. If the depth image size is zero, only
+   *        RGB images will be recorded (this is useful for recording videos).
+   *
+   * \param filename              The name of the sequence file to which to record.
+   * \param calib                 The calibration for the camera that produced the RGB-D images.
+   * \param rgbCompressionType    The type of compression to apply to the RGB images.
+   * \param depthCompressionType  The type of compression to apply to the depth images.
+   * \param capacity              The number of frames that can be waiting to be written at any one time (must be at least one).
+   * \param poolEmptyStrategy     A strategy specifying what should happen when a frame is recorded while the pool is empty.
+   *
+   * \throws std::invalid_argument  If the capacity is zero, or if the specified compression types cannot be used (e.g. when building without OpenCV).
+   * \throws std::runtime_error     If the sequence file cannot be opened for writing.
+   */
+  SequenceRecorder(const std::string& filename, const ITMLib::ITMRGBDCalib& calib,
+                   RGBCompressionType rgbCompressionType = RGB_COMPRESSION_NONE,
+                   DepthCompressionType depthCompressionType = DEPTH_COMPRESSION_NONE,
+                   size_t capacity = 60, tvgutil::pooled_queue::PoolEmptyStrategy poolEmptyStrategy = tvgutil::pooled_queue::PES_WAIT);
+
+  //#################### DESTRUCTOR ####################
+public:
+  /**
+   * \brief Destroys the sequence recorder.
+   *
+   * This waits for all of the queued frames to be written, and then writes the index to finish the file.
+   */
+  ~SequenceRecorder();
+
+  //#################### COPY CONSTRUCTOR & ASSIGNMENT OPERATOR ####################
+private:
+  // Deliberately private and unimplemented.
+  SequenceRecorder(const SequenceRecorder&);
+  SequenceRecorder& operator=(const SequenceRecorder&);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the number of frames that have been discarded because the pool was empty.
+   *
+   * \return  The number of frames that have been discarded because the pool was empty.
+   */
+  size_t get_frames_dropped() const;
+
+  /**
+   * \brief Records a frame of the sequence.
+   *
+   * The images are copied before this function returns, so the caller is free to reuse them immediately.
+   *
+   * \param rgbImage    The RGB image for the frame.
+   * \param depthImage  The depth image for the frame (may be NULL if the recorder is only recording RGB images).
+   * \param pose        The camera pose for the frame.
+   * \return            true, if the frame was queued for writing, or false if it was discarded.
+   *
+   * \throws std::invalid_argument If the images do not have the sizes specified when the recorder was constructed.
+   */
+  bool record_frame(const ORUChar4Image_CPtr& rgbImage, const ORShortImage_CPtr& depthImage, const ORUtils::SE3Pose& pose);
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Runs the writer thread, which compresses the queued frames and appends them to the file.
+   */
+  void run_writer();
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<SequenceRecorder> SequenceRecorder_Ptr;
+typedef boost::shared_ptr<const SequenceRecorder> SequenceRecorder_CPtr;
+
+}
+
+#endif
@@ -6,6 +6,8 @@
 #ifndef H_ITMX_ICPREFININGRELOCALISER
 #define H_ITMX_ICPREFININGRELOCALISER
 
+#include <vector>
+
 #include <boost/optional.hpp>
 
 #ifdef WITH_OPENCV
@@ -43,14 +45,40 @@ private:
   typedef ITMLib::ITMVisualisationEngine<VoxelType,IndexType> VisualisationEngine;
   typedef boost::shared_ptr<const VisualisationEngine> VisualisationEngine_CPtr;
 
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the state needed to refine a single initial pose. Each refinement worker has its own
+   *        instance, so that the initial poses produced by the inner relocaliser can be refined independently of each other.
+   */
+  struct RefinementWorker
+  {
+    /** The dense mapper used to find visible blocks in the voxel scene. */
+    DenseMapper_Ptr denseVoxelMapper;
+
+    /** The ICP tracker used to refine the relocalised poses. */
+    Tracker_Ptr tracker;
+
+    /** The tracking controller used to set up and perform the actual refinement. */
+    TrackingController_Ptr trackingController;
+
+    /** The tracking state used to hold the refinement results. */
+    TrackingState_Ptr trackingState;
+
+    /** The visualisation engine used to perform the raycasting. */
+    VisualisationEngine_CPtr visualisationEngine;
+
+    /** The voxel render state used to hold the raycasting results. */
+    VoxelRenderState_Ptr voxelRenderState;
+  };
+
+  typedef boost::shared_ptr<RefinementWorker> RefinementWorker_Ptr;
+
   //#################### PRIVATE MEMBER VARIABLES ####################
 private:
   /** Whether or not to choose the best result. */
   bool m_chooseBestResult;
 
-  /** The dense mapper used to find visible blocks in the voxel scene. */
-  DenseMapper_Ptr m_denseVoxelMapper;
-
   /** The depth visualiser. */
   DepthVisualiser_CPtr m_depthVisualiser;
 
@@ -63,6 +91,9 @@ private:
   /** The path generator used when saving the relocalised poses. */
   mutable boost::optional<tvgutil::SequentialPathGenerator> m_posePathGenerator;
 
+  /** The workers used to refine the initial poses produced by the inner relocaliser (these are used concurrently when running on the CPU). */
+  std::vector<RefinementWorker_Ptr> m_refinementWorkers;
+
   /** Whether or not to save the images rendered from the relocalised poses. */
   bool m_saveImages;
 
@@ -75,6 +106,12 @@ private:
   /** The scene being viewed from the camera. */
   Scene_Ptr m_scene;
 
+  /**
+   * When choosing the best result, the score at or below which a good refined result is accepted straight away, without refining
+   * any of the remaining initial poses (a non-positive threshold means that all of the initial poses are always refined).
+   */
+  float m_scoreAcceptanceThreshold;
+
   /** The settings to use for InfiniTAM. */
   Settings_CPtr m_settings;
 
@@ -96,39 +133,29 @@ private:
   /** The timer used to profile the update calls. */
   AverageTimer m_timerUpdate;
 
-  /** The ICP tracker used to refine the relocalised poses. */
-  Tracker_Ptr m_tracker;
-
-  /** The tracking controller used to set up and perform the actual refinement. */
-  TrackingController_Ptr m_trackingController;
-
-  /** The tracking state used to hold the refinement results. */
-  TrackingState_Ptr m_trackingState;
-
   /** The visualisation engine used to perform the raycasting. */
   VisualisationEngine_CPtr m_visualisationEngine;
 
   /** The current view of the scene. */
   View_Ptr m_view;
 
-  /** The voxel render state used to hold the raycasting results. */
-  mutable VoxelRenderState_Ptr m_voxelRenderState;
-
   //#################### CONSTRUCTORS ####################
 public:
   /**
    * \brief Constructs an ICP-based refining relocaliser.
    *
    * \param innerRelocaliser    The relocaliser whose results are being refined using ICP.
-   * \param tracker             The ICP tracker.
+   * \param trackers            The ICP trackers (one per refinement worker, so at least one must be provided).
    * \param rgbImageSize        The size of the colour images produced by the camera.
    * \param depthImageSize      The size of the depth images produced by the camera.
    * \param calib               The calibration parameters of the camera whose pose is to be estimated.
    * \param scene               The scene being viewed from the camera.
-   * \param denseVoxelMapper    The dense mapper used to find visible blocks in the voxel scene.
+   * \param denseVoxelMapper    The dense mapper used to find visible blocks in the voxel scene (used by the first refinement worker).
    * \param settings            The settings to use for InfiniTAM.
+   *
+   * \throws std::runtime_error If no trackers are provided.
    */
-  ICPRefiningRelocaliser(const orx::Relocaliser_Ptr& innerRelocaliser, const Tracker_Ptr& tracker,
+  ICPRefiningRelocaliser(const orx::Relocaliser_Ptr& innerRelocaliser, const std::vector<Tracker_Ptr>& trackers,
                          const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
                          const ITMLib::ITMRGBDCalib& calib, const Scene_Ptr& scene,
                          const DenseMapper_Ptr& denseVoxelMapper, const Settings_CPtr& settings);
@@ -202,6 +229,17 @@ private:
   void save_colourised_depth(const ORFloatImage *depthF, const ORUChar4Image_Ptr& depthU, const std::string& pattern) const;
 #endif
 
+  /**
+   * \brief Attempts to refine an initial pose using ICP.
+   *
+   * \note  The depth and colour images to use must already have been copied into the view.
+   *
+   * \param initialPose The initial pose.
+   * \param worker      The refinement worker to use.
+   * \return            The refined result, if tracking succeeded, or boost::none otherwise.
+   */
+  boost::optional<Result> refine_pose(const ORUtils::SE3Pose& initialPose, RefinementWorker& worker) const;
+
   /**
    * \brief Saves the relocalised and refined poses in text files so that they can be used later (e.g. for evaluation).
    *
@@ -216,10 +254,13 @@ private:
    * \brief Scores a proposed camera pose by computing the mean depth difference between the real depth image
    *        and a synthetic depth image rendered from it.
    *
-   * \param pose  The pose to score.
-   * \return      The score computed for the pose.
+   * \note  The host copy of the depth image in the view must be up to date.
+   *
+   * \param pose    The pose to score.
+   * \param worker  The refinement worker whose render state and visualisation engine should be used to render the synthetic depth image.
+   * \return        The score computed for the pose.
    */
-  float score_pose(const ORUtils::SE3Pose& pose) const;
+  float score_pose(const ORUtils::SE3Pose& pose, RefinementWorker& worker) const;
 };
 
 }
@@ -5,9 +5,14 @@
 
 #include "ICPRefiningRelocaliser.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include <ITMLib/Core/ITMTrackingController.h>
 #include <ITMLib/Engines/Visualisation/ITMVisualisationEngineFactory.h>
 #include <ITMLib/Objects/RenderStates/ITMRenderStateFactory.h>
@@ -32,12 +37,11 @@ namespace itmx {
 //#################### CONSTRUCTORS ####################
 
 template <typename VoxelType, typename IndexType>
-ICPRefiningRelocaliser<VoxelType,IndexType>::ICPRefiningRelocaliser(const orx::Relocaliser_Ptr& innerRelocaliser, const Tracker_Ptr& tracker,
+ICPRefiningRelocaliser<VoxelType,IndexType>::ICPRefiningRelocaliser(const orx::Relocaliser_Ptr& innerRelocaliser, const std::vector<Tracker_Ptr>& trackers,
                                                                     const Vector2i& rgbImageSize, const Vector2i& depthImageSize,
                                                                     const ITMLib::ITMRGBDCalib& calib, const Scene_Ptr& scene,
                                                                     const DenseMapper_Ptr& denseVoxelMapper, const Settings_CPtr& settings)
 : RefiningRelocaliser(innerRelocaliser),
-  m_denseVoxelMapper(denseVoxelMapper),
   m_depthVisualiser(DepthVisualiserFactory::make_depth_visualiser(settings->deviceType)),
   m_scene(scene),
   m_settings(settings),
@@ -46,18 +50,30 @@ ICPRefiningRelocaliser<VoxelType,IndexType>::ICPRefiningRelocaliser(const orx::R
   m_timerRelocalisation("Relocalisation"),
   m_timerTraining("Training"),
   m_timerUpdate("Update"),
-  m_tracker(tracker),
   m_visualisationEngine(ITMVisualisationEngineFactory::MakeVisualisationEngine<VoxelType,IndexType>(settings->deviceType))
 {
-  // Construct the tracking controller, tracking state, view and render state.
-  m_trackingController.reset(new ITMLib::ITMTrackingController(m_tracker.get(), m_settings.get()));
-  m_trackingState.reset(new ITMLib::ITMTrackingState(depthImageSize, m_settings->GetMemoryType()));
+  if(trackers.empty()) throw std::runtime_error("Error: At least one tracker must be provided to refine the relocalised poses");
+
+  // Construct the view.
   m_view.reset(new ITMLib::ITMView(calib, rgbImageSize, depthImageSize, m_settings->deviceType == ORUtils::DEVICE_CUDA));
-  m_voxelRenderState.reset(ITMLib::ITMRenderStateFactory<IndexType>::CreateRenderState(
-    m_trackingController->GetTrackedImageSize(rgbImageSize, depthImageSize),
-    m_scene->sceneParams,
-    m_settings->GetMemoryType()
-  ));
+
+  // Construct the refinement workers (one per tracker). The first worker uses the dense mapper and visualisation engine that
+  // we were given or constructed above; the others each get their own, since these are not safe to share between threads.
+  for(size_t i = 0, size = trackers.size(); i < size; ++i)
+  {
+    RefinementWorker_Ptr worker(new RefinementWorker);
+    worker->denseVoxelMapper = i == 0 ? denseVoxelMapper : DenseMapper_Ptr(new DenseMapper(m_settings.get()));
+    worker->tracker = trackers[i];
+    worker->trackingController.reset(new ITMLib::ITMTrackingController(worker->tracker.get(), m_settings.get()));
+    worker->trackingState.reset(new ITMLib::ITMTrackingState(depthImageSize, m_settings->GetMemoryType()));
+    worker->visualisationEngine = i == 0 ? m_visualisationEngine : VisualisationEngine_CPtr(ITMVisualisationEngineFactory::MakeVisualisationEngine<VoxelType,IndexType>(m_settings->deviceType));
+    worker->voxelRenderState.reset(ITMLib::ITMRenderStateFactory<IndexType>::CreateRenderState(
+      worker->trackingController->GetTrackedImageSize(rgbImageSize, depthImageSize),
+      m_scene->sceneParams,
+      m_settings->GetMemoryType()
+    ));
+    m_refinementWorkers.push_back(worker);
+  }
 
   // Configure the relocaliser based on the settings that have been passed in.
   const static std::string settingsNamespace = "ICPRefiningRelocaliser.";
@@ -65,6 +81,7 @@ ICPRefiningRelocaliser<VoxelType,IndexType>::ICPRefiningRelocaliser(const orx::R
   m_saveImages = m_settings->get_first_value<bool>(settingsNamespace + "saveRelocalisationImages", false);
   m_savePoses = m_settings->get_first_value<bool>(settingsNamespace + "saveRelocalisationPoses", false);
   m_saveTimes = m_settings->get_first_value<bool>(settingsNamespace + "saveRelocalisationTimes", false);
+  m_scoreAcceptanceThreshold = m_settings->get_first_value<float>(settingsNamespace + "scoreAcceptanceThreshold", 0.0f);
   m_timersEnabled = m_settings->get_first_value<bool>(settingsNamespace + "timersEnabled", false);
 
   // Get the (global) experiment tag.
@@ -207,54 +224,60 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
 
   start_timer_nosync(m_timerRefinement); // No need to synchronize the GPU again.
 
-  // Reset the render state before raycasting (we do this once for each relocalisation attempt).
-  // FIXME: It would be nicer to simply create the render state once and then reuse it, but unfortunately this leads
-  //        to the program randomly crashing after a while. The crash may be occurring because we don't use this render
-  //        state to integrate frames into the scene, but we haven't been able to pin this down yet. As a result, we
-  //        currently reset the render state each time as a workaround. A mildly less costly alternative might
-  //        be to pass in a render state that is being used elsewhere and reuse it here, but that feels messier.
-  m_voxelRenderState->Reset();
-
-  // For each initial result from the inner relocaliser:
-  for(size_t resultIdx = 0; resultIdx < initialResults.size(); ++resultIdx)
-  {
-    // Get the suggested pose.
-    const ORUtils::SE3Pose initialPose = initialResults[resultIdx].pose;
+  // Copy the depth and RGB images into the view. We only need to do this once, since the view is only read during refinement.
+  m_view->depth->SetFrom(depthImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORFloatImage::CUDA_TO_CUDA : ORFloatImage::CPU_TO_CPU);
+  m_view->rgb->SetFrom(colourImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORUChar4Image::CUDA_TO_CUDA : ORUChar4Image::CPU_TO_CPU);
 
-    // Copy the depth and RGB images into the view.
-    m_view->depth->SetFrom(depthImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORFloatImage::CUDA_TO_CUDA : ORFloatImage::CPU_TO_CPU);
-    m_view->rgb->SetFrom(colourImage, m_settings->deviceType == ORUtils::DEVICE_CUDA ? ORUChar4Image::CUDA_TO_CUDA : ORUChar4Image::CPU_TO_CPU);
+  // If we're going to score the refined poses, make sure that the host copy of the depth image is up to date. We do this
+  // here rather than in score_pose, since the poses may be scored concurrently.
+  if(m_chooseBestResult) m_view->depth->UpdateHostFromDevice();
 
-    // Set up the tracking state using the initial pose.
-    m_trackingState->pose_d->SetFrom(&initialPose);
+  // Reset the render states before raycasting (we do this once for each relocalisation attempt).
+  // FIXME: It would be nicer to simply create the render states once and then reuse them, but unfortunately this leads
+  //        to the program randomly crashing after a while. The crash may be occurring because we don't use these render
+  //        states to integrate frames into the scene, but we haven't been able to pin this down yet. As a result, we
+  //        currently reset the render states each time as a workaround. A mildly less costly alternative might
+  //        be to pass in a render state that is being used elsewhere and reuse it here, but that feels messier.
+  for(size_t i = 0, size = m_refinementWorkers.size(); i < size; ++i)
+  {
+    m_refinementWorkers[i]->voxelRenderState->Reset();
+  }
 
-    // Update the list of visible blocks.
-    const bool resetVisibleList = true;
-    m_denseVoxelMapper->UpdateVisibleList(m_view.get(), m_trackingState.get(), m_scene.get(), m_voxelRenderState.get(), resetVisibleList);
+  // Refine the initial results from the inner relocaliser in batches, one initial result per refinement worker. On the CPU,
+  // the results in each batch are refined concurrently. (On the GPU, the trackers share a low-level engine whose scratch
+  // buffers are not safe to use from several threads at once, so we refine the results one at a time.)
+  const int initialResultCount = static_cast<int>(initialResults.size());
+  const int workerCount = static_cast<int>(m_refinementWorkers.size());
+  const bool refineConcurrently = m_settings->deviceType == ORUtils::DEVICE_CPU;
+  std::vector<boost::optional<Result> > batchResults(workerCount);
+  bool accepted = false;
 
-    // Raycast from the initial pose to prepare for tracking.
-    m_trackingController->Prepare(m_trackingState.get(), m_scene.get(), m_view.get(), m_visualisationEngine.get(), m_voxelRenderState.get());
+  for(int batchStart = 0; batchStart < initialResultCount && !accepted; batchStart += workerCount)
+  {
+    const int batchSize = std::min(workerCount, initialResultCount - batchStart);
 
-    // Run the tracker to refine the initial pose.
-    m_trackingController->Track(m_trackingState.get(), m_view.get());
+#ifdef WITH_OPENMP
+    #pragma omp parallel for num_threads(batchSize) if(refineConcurrently && batchSize > 1)
+#endif
+    for(int i = 0; i < batchSize; ++i)
+    {
+      batchResults[i] = refine_pose(initialResults[batchStart + i].pose, *m_refinementWorkers[i]);
+    }
 
-    // If tracking succeeded:
-    if(m_trackingState->trackerResult != ITMLib::ITMTrackingState::TRACKING_FAILED)
+    // Process the refined results in the batch in order, exactly as if they had been produced one at a time.
+    for(int i = 0; i < batchSize && !accepted; ++i)
     {
-      // Set up the refined result.
-      Result refinedResult;
-      refinedResult.pose.SetFrom(m_trackingState->pose_d);
-      refinedResult.quality = m_trackingState->trackerResult == ITMLib::ITMTrackingState::TRACKING_GOOD ? RELOCALISATION_GOOD : RELOCALISATION_POOR;
-      refinedResult.score = m_trackingState->trackerScore;
+      // If tracking failed, ignore the result.
+      if(!batchResults[i]) continue;
+
+      const ORUtils::SE3Pose& initialPose = initialResults[batchStart + i].pose;
+      const Result& refinedResult = *batchResults[i];
 
       // If we're trying to choose the best relocalisation after refinement:
       if(m_chooseBestResult)
       {
-        // Score the refined result.
-        refinedResult.score = score_pose(refinedResult.pose);
-
 #if DEBUGGING
-        std::cout << resultIdx << ": " << refinedResult.score << '\n';
+        std::cout << batchStart + i << ": " << refinedResult.score << '\n';
 #endif
 
         // If the score is better than the current best score, update the current best score and result.
@@ -266,6 +289,14 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
           refinedResults.clear();
           refinedResults.push_back(refinedResult);
         }
+
+        // If the result is good enough to accept straight away, don't bother considering any further initial results.
+        // Note that we also ignore any later results in the current batch, so that the outcome does not depend on the
+        // number of refinement workers.
+        if(m_scoreAcceptanceThreshold > 0.0f && refinedResult.quality == RELOCALISATION_GOOD && refinedResult.score <= m_scoreAcceptanceThreshold)
+        {
+          accepted = true;
+        }
       }
       else
       {
@@ -332,7 +363,7 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
 
     // Step 2: Render a synthetic depth image of the scene from the ground truth pose, and save it to disk.
     DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(
-      synthDepthF, m_scene, gtPose, m_view->calib.intrinsics_d, m_voxelRenderState,
+      synthDepthF, m_scene, gtPose, m_view->calib.intrinsics_d, m_refinementWorkers[0]->voxelRenderState,
       DepthVisualiser::DT_ORTHOGRAPHIC, m_visualisationEngine, m_depthVisualiser, m_settings
     );
 
@@ -344,7 +375,7 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
 
     // Step 4: Render a synthetic depth image of the scene from the initial relocalised pose (which is always valid if we got here), and save it to disk.
     DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(
-      synthDepthF, m_scene, initialResults[0].pose, m_view->calib.intrinsics_d, m_voxelRenderState,
+      synthDepthF, m_scene, initialResults[0].pose, m_view->calib.intrinsics_d, m_refinementWorkers[0]->voxelRenderState,
       DepthVisualiser::DT_ORTHOGRAPHIC, m_visualisationEngine, m_depthVisualiser, m_settings
     );
 
@@ -358,7 +389,7 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
     // Step 6: Compute the "score" for the ground truth pose and save it to disk.
     {
       std::ofstream fs(m_imagePathGenerator->make_path("image-%06i.gtScore.txt").string().c_str());
-      fs << score_pose(gtPose) << "\n";
+      fs << score_pose(gtPose, *m_refinementWorkers[0]) << "\n";
     }
 
     // Step 7: Compute the difference between the input depth image and the rendering from the initial relocalised pose, and save it to disk.
@@ -368,7 +399,7 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
     // Step 8: Compute the "score" for the initial relocalised pose and save it to disk.
     {
       std::ofstream fs(m_imagePathGenerator->make_path("image-%06i.relocScore.txt").string().c_str());
-      fs << score_pose(initialResults[0].pose) << "\n";
+      fs << score_pose(initialResults[0].pose, *m_refinementWorkers[0]) << "\n";
     }
 
     // If there is a refined pose:
@@ -376,7 +407,7 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
     {
       // Step 9: Render a synthetic depth image of the scene from the refined pose (which is always valid if we got here), and save it to disk.
       DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(
-        synthDepthF, m_scene, refinedResults[0].pose, m_view->calib.intrinsics_d, m_voxelRenderState,
+        synthDepthF, m_scene, refinedResults[0].pose, m_view->calib.intrinsics_d, m_refinementWorkers[0]->voxelRenderState,
         DepthVisualiser::DT_ORTHOGRAPHIC, m_visualisationEngine, m_depthVisualiser, m_settings
       );
 
@@ -389,7 +420,7 @@ ICPRefiningRelocaliser<VoxelType, IndexType>::relocalise(const ORUChar4Image *co
       // Step 11: Compute the "score" for the refined pose and save it to disk.
       {
         std::ofstream fs(m_imagePathGenerator->make_path("image-%06i.icpScore.txt").string().c_str());
-        fs << score_pose(refinedResults[0].pose) << "\n";
+        fs << score_pose(refinedResults[0].pose, *m_refinementWorkers[0]) << "\n";
       }
     }
 #endif
@@ -457,6 +488,37 @@ void ICPRefiningRelocaliser<VoxelType,IndexType>::save_colourised_depth(const OR
 }
 #endif
 
+template <typename VoxelType, typename IndexType>
+boost::optional<orx::Relocaliser::Result> ICPRefiningRelocaliser<VoxelType,IndexType>::refine_pose(const ORUtils::SE3Pose& initialPose, RefinementWorker& worker) const
+{
+  // Set up the tracking state using the initial pose.
+  worker.trackingState->pose_d->SetFrom(&initialPose);
+
+  // Update the list of visible blocks.
+  const bool resetVisibleList = true;
+  worker.denseVoxelMapper->UpdateVisibleList(m_view.get(), worker.trackingState.get(), m_scene.get(), worker.voxelRenderState.get(), resetVisibleList);
+
+  // Raycast from the initial pose to prepare for tracking.
+  worker.trackingController->Prepare(worker.trackingState.get(), m_scene.get(), m_view.get(), worker.visualisationEngine.get(), worker.voxelRenderState.get());
+
+  // Run the tracker to refine the initial pose.
+  worker.trackingController->Track(worker.trackingState.get(), m_view.get());
+
+  // If tracking failed, early out.
+  if(worker.trackingState->trackerResult == ITMLib::ITMTrackingState::TRACKING_FAILED) return boost::none;
+
+  // Otherwise, set up the refined result.
+  Result refinedResult;
+  refinedResult.pose.SetFrom(worker.trackingState->pose_d);
+  refinedResult.quality = worker.trackingState->trackerResult == ITMLib::ITMTrackingState::TRACKING_GOOD ? RELOCALISATION_GOOD : RELOCALISATION_POOR;
+  refinedResult.score = worker.trackingState->trackerScore;
+
+  // If we're trying to choose the best relocalisation after refinement, score the refined result.
+  if(m_chooseBestResult) refinedResult.score = score_pose(refinedResult.pose, worker);
+
+  return refinedResult;
+}
+
 template <typename VoxelType, typename IndexType>
 void ICPRefiningRelocaliser<VoxelType,IndexType>::save_poses(const Matrix4f& relocalisedPose, const Matrix4f& refinedPose) const
 {
@@ -468,18 +530,17 @@ void ICPRefiningRelocaliser<VoxelType,IndexType>::save_poses(const Matrix4f& rel
 }
 
 template <typename VoxelType, typename IndexType>
-float ICPRefiningRelocaliser<VoxelType,IndexType>::score_pose(const ORUtils::SE3Pose& pose) const
+float ICPRefiningRelocaliser<VoxelType,IndexType>::score_pose(const ORUtils::SE3Pose& pose, RefinementWorker& worker) const
 {
 #ifdef WITH_OPENCV
   // Make an OpenCV wrapper of the current depth image.
-  m_view->depth->UpdateHostFromDevice();
   cv::Mat cvRealDepth(m_view->depth->noDims.y, m_view->depth->noDims.x, CV_32FC1, m_view->depth->GetData(MEMORYDEVICE_CPU));
 
   // Render a synthetic depth image of the scene from the suggested pose.
   ORFloatImage_Ptr synthDepth(new ORFloatImage(m_view->depth->noDims, true, true));
   DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(
-    synthDepth, m_scene, pose, m_view->calib.intrinsics_d, m_voxelRenderState,
-    DepthVisualiser::DT_ORTHOGRAPHIC, m_visualisationEngine, m_depthVisualiser, m_settings
+    synthDepth, m_scene, pose, m_view->calib.intrinsics_d, worker.voxelRenderState,
+    DepthVisualiser::DT_ORTHOGRAPHIC, worker.visualisationEngine, m_depthVisualiser, m_settings
   );
 
   // Make an OpenCV wrapper of the synthetic depth image.
@@ -6,6 +6,12 @@
 #ifndef H_ITMX_DEPTHCOMPRESSIONTYPE
 #define H_ITMX_DEPTHCOMPRESSIONTYPE
 
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/algorithm/string.hpp>
+
 namespace itmx {
 
 /**
@@ -22,6 +28,40 @@ enum DepthCompressionType
   DEPTH_COMPRESSION_PNG = 1,
 };
 
+//#################### STREAM OPERATORS ####################
+
+inline std::ostream& operator<<(std::ostream& os, DepthCompressionType rhs)
+{
+  switch(rhs)
+  {
+    case DEPTH_COMPRESSION_NONE:  os << "none"; break;
+    case DEPTH_COMPRESSION_PNG:   os << "png"; break;
+    default:
+    {
+      // This should never happen.
+      throw std::runtime_error("Error: Unknown depth compression type");
+    }
+  }
+
+  return os;
+}
+
+inline std::istream& operator>>(std::istream& is, DepthCompressionType& rhs)
+{
+  std::string temp;
+  is >> temp;
+  if(!is) return is;
+
+  boost::trim(temp);
+  boost::to_lower(temp);
+
+  if(temp == "none") rhs = DEPTH_COMPRESSION_NONE;
+  else if(temp == "png") rhs = DEPTH_COMPRESSION_PNG;
+  else throw std::runtime_error("Error: Unknown depth compression type '" + temp + "'");
+
+  return is;
+}
+
 }
 
 #endif
@@ -0,0 +1,70 @@
+/**
+ * itmx: FrameAckMessage.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ITMX_FRAMEACKMESSAGE
+#define H_ITMX_FRAMEACKMESSAGE
+
+#include "MappingMessage.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class represents a cumulative acknowledgement sent by a mapping server in response to pipelined RGB-D frames.
+ *
+ * Rather than acknowledging a specific frame, the message records the total number of pipelined frames the server has received from
+ * the client so far, together with the number of free slots in the server's frame message queue. The client can use the latter to
+ * avoid sending frames faster than the server can consume them.
+ */
+class FrameAckMessage : public MappingMessage
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The byte segment within the message data that corresponds to the number of frames the server has received. */
+  Segment m_frameCountSegment;
+
+  /** The byte segment within the message data that corresponds to the number of free slots in the server's frame message queue. */
+  Segment m_freeSlotCountSegment;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a frame acknowledgement message.
+   */
+  FrameAckMessage();
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Extracts the number of frames the server has received from the message.
+   *
+   * \return  The number of frames the server has received.
+   */
+  int extract_frame_count() const;
+
+  /**
+   * \brief Extracts the number of free slots in the server's frame message queue from the message.
+   *
+   * \return  The number of free slots in the server's frame message queue.
+   */
+  int extract_free_slot_count() const;
+
+  /**
+   * \brief Sets the number of frames the server has received.
+   *
+   * \param frameCount  The number of frames the server has received.
+   */
+  void set_frame_count(int frameCount);
+
+  /**
+   * \brief Sets the number of free slots in the server's frame message queue.
+   *
+   * \param freeSlotCount The number of free slots in the server's frame message queue.
+   */
+  void set_free_slot_count(int freeSlotCount);
+};
+
+}
+
+#endif
@@ -30,6 +30,9 @@ enum InteractionType
 
   /** An interaction in which the client sends a new rendering request to the server. */
   IT_UPDATERENDERINGREQUEST = 3,
+
+  /** An interaction in which the client sends a single RGB-D frame to the server without waiting for the server to acknowledge it individually. */
+  IT_SENDFRAMEPIPELINED = 4,
 };
 
 //#################### TYPES ####################
@@ -32,12 +32,24 @@ private:
   /** A queue containing the RGB-D frame messages to be sent to the server. */
   RGBDFrameMessageQueue m_frameMessageQueue;
 
+  /** The number of pipelined frames that the server has acknowledged so far. */
+  mutable int m_framesAcked;
+
+  /** The number of pipelined frames that have been sent to the server so far. */
+  int m_framesSent;
+
   /** A mutex used to synchronise interactions with the server to avoid overlaps. */
   mutable boost::mutex m_interactionMutex;
 
+  /** The maximum number of frames that can be sent to the server without having been acknowledged (1 means that each frame must be acknowledged before the next is sent). */
+  int m_maxFramesInFlight;
+
   /** The image in which remote scene renderings retrieved from the server are stored. */
   mutable ORUChar4Image_Ptr m_remoteImage;
 
+  /** The number of free slots in the server's frame message queue, as of the most recent acknowledgement received from the server. */
+  mutable int m_serverFreeSlotCount;
+
   /** The TCP stream used as a wrapper around the connection to the server. */
   mutable boost::asio::ip::tcp::iostream m_stream;
 
@@ -49,8 +61,12 @@ public:
    * \param host              The mapping host to which to connect.
    * \param port              The port on the mapping host to which to connect.
    * \param poolEmptyStrategy A strategy specifying what should happen when a push is attempted while the frame message queue's pool is empty.
+   * \param maxFramesInFlight The maximum number of frames that can be sent to the server without having been acknowledged.
+   *                          If this is greater than 1, frames are pipelined and the server acknowledges them cumulatively,
+   *                          which stops the frame rate from being limited by the latency of the connection.
    */
-  explicit MappingClient(const std::string& host = "localhost", const std::string& port = "7851", tvgutil::pooled_queue::PoolEmptyStrategy poolEmptyStrategy = tvgutil::pooled_queue::PES_DISCARD);
+  explicit MappingClient(const std::string& host = "localhost", const std::string& port = "7851", tvgutil::pooled_queue::PoolEmptyStrategy poolEmptyStrategy = tvgutil::pooled_queue::PES_DISCARD,
+                         int maxFramesInFlight = 1);
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -84,6 +100,34 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Determines whether or not another pipelined frame can currently be sent to the server.
+   *
+   * This is the case if both the number of unacknowledged frames is below the maximum allowed and there is space for the frame in the
+   * server's frame message queue (as of the most recent acknowledgement, allowing for any frames sent since then). To ensure progress,
+   * a single unacknowledged frame is always allowed.
+   *
+   * \return  true, if another pipelined frame can currently be sent to the server, or false otherwise.
+   */
+  bool can_send_pipelined_frame() const;
+
+  /**
+   * \brief Waits until all pipelined frames that have been sent to the server have been acknowledged.
+   *
+   * \note  This must be called (with the interaction mutex held) before starting any other interaction with the server,
+   *        since otherwise the acknowledgements would be confused with the server's responses to that interaction.
+   *
+   * \return  true, if all pipelined frames were successfully acknowledged, or false if the connection failed.
+   */
+  bool drain_frame_acks() const;
+
+  /**
+   * \brief Reads a cumulative frame acknowledgement from the server (this is blocking, unless the connection fails).
+   *
+   * \return  true, if an acknowledgement was successfully read, or false otherwise.
+   */
+  bool read_frame_ack() const;
+
   /**
    * \brief Sends frame messages from the message queue across to the server.
    */
@@ -50,6 +50,9 @@ private:
   /** A flag indicating whether or not the images associated with the first message in the queue have already been read. */
   bool m_imagesDirty;
 
+  /** The number of pipelined frames that have been received from the client so far. */
+  int m_pipelinedFrameCount;
+
   /** A flag indicating whether or not the pose associated with the first message in the queue has already been read. */
   bool m_poseDirty;
 
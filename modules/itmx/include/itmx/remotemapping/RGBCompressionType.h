@@ -6,6 +6,12 @@
 #ifndef H_ITMX_RGBCOMPRESSIONTYPE
 #define H_ITMX_RGBCOMPRESSIONTYPE
 
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/algorithm/string.hpp>
+
 namespace itmx {
 
 /**
@@ -25,6 +31,42 @@ enum RGBCompressionType
   RGB_COMPRESSION_PNG = 2,
 };
 
+//#################### STREAM OPERATORS ####################
+
+inline std::ostream& operator<<(std::ostream& os, RGBCompressionType rhs)
+{
+  switch(rhs)
+  {
+    case RGB_COMPRESSION_JPG:   os << "jpg"; break;
+    case RGB_COMPRESSION_NONE:  os << "none"; break;
+    case RGB_COMPRESSION_PNG:   os << "png"; break;
+    default:
+    {
+      // This should never happen.
+      throw std::runtime_error("Error: Unknown RGB compression type");
+    }
+  }
+
+  return os;
+}
+
+inline std::istream& operator>>(std::istream& is, RGBCompressionType& rhs)
+{
+  std::string temp;
+  is >> temp;
+  if(!is) return is;
+
+  boost::trim(temp);
+  boost::to_lower(temp);
+
+  if(temp == "jpg") rhs = RGB_COMPRESSION_JPG;
+  else if(temp == "none") rhs = RGB_COMPRESSION_NONE;
+  else if(temp == "png") rhs = RGB_COMPRESSION_PNG;
+  else throw std::runtime_error("Error: Unknown RGB compression type '" + temp + "'");
+
+  return is;
+}
+
 }
 
 #endif
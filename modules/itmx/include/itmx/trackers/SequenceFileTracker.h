@@ -0,0 +1,60 @@
+/**
+ * itmx: SequenceFileTracker.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#ifndef H_ITMX_SEQUENCEFILETRACKER
+#define H_ITMX_SEQUENCEFILETRACKER
+
+#include <ITMLib/Trackers/Interface/ITMTracker.h>
+
+#include "../persistence/SequenceFileReader.h"
+
+namespace itmx {
+
+/**
+ * \brief An instance of this class can be used to yield the camera poses that were recorded in a sequence file.
+ *
+ * Each call to TrackCamera yields the pose of the next frame in the file, in the same way as InfiniTAM's file-based
+ * tracker does for a sequence stored as individual pose files. The poses are read without uncompressing the images.
+ */
+class SequenceFileTracker : public ITMLib::ITMTracker
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The position in the file of the frame whose pose will be yielded next. */
+  size_t m_position;
+
+  /** The reader used to access the sequence file. */
+  SequenceFileReader_CPtr m_reader;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a sequence file tracker.
+   *
+   * \param filename        The name of the sequence file.
+   * \param initialPosition The position in the file of the frame whose pose should be yielded first.
+   *
+   * \throws std::runtime_error If the sequence file cannot be read.
+   */
+  explicit SequenceFileTracker(const std::string& filename, size_t initialPosition = 0);
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /** Override */
+  virtual bool requiresColourRendering() const;
+
+  /** Override */
+  virtual bool requiresDepthReliability() const;
+
+  /** Override */
+  virtual bool requiresPointCloudRendering() const;
+
+  /** Override */
+  virtual void TrackCamera(ITMLib::ITMTrackingState *trackingState, const ITMLib::ITMView *view);
+};
+
+}
+
+#endif
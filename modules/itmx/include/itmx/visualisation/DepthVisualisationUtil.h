@@ -14,7 +14,7 @@
 namespace itmx {
 
 /**
- * \brief This struct provides a utility function that can render a synthetic depth image of a voxel scene.
+ * \brief This struct provides utility functions that can render a synthetic depth image of a voxel scene.
  */
 template <typename VoxelType, typename IndexType>
 struct DepthVisualisationUtil
@@ -27,6 +27,22 @@ struct DepthVisualisationUtil
 
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+  /**
+   * \brief Generates a synthetic depth image of a voxel scene from the raycast result already stored in a render state.
+   *
+   * \note  This avoids the need to raycast the scene again if it has just been raycast from the same pose using the same render state
+   *        (e.g. in order to generate a colour visualisation of it).
+   *
+   * \param output          The location into which to put the output image.
+   * \param pose            The pose from which the scene was raycast.
+   * \param renderState     The render state containing the raycast result.
+   * \param depthType       The type of depth calculation to use.
+   * \param depthVisualiser The depth visualiser.
+   * \param settings        The settings to use for InfiniTAM.
+   */
+  static void generate_depth_from_raycast(const ORFloatImage_Ptr& output, const ORUtils::SE3Pose& pose, const VoxelRenderState_CPtr& renderState,
+                                          DepthVisualiser::DepthType depthType, const itmx::DepthVisualiser_CPtr& depthVisualiser, const Settings_CPtr& settings);
+
   /**
    * \brief Generates a synthetic depth image of a voxel scene from the specified pose.
    *
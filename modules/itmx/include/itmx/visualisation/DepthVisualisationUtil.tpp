@@ -15,6 +15,20 @@ namespace itmx {
 
 //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 
+template <typename VoxelType, typename IndexType>
+void DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_raycast(const ORFloatImage_Ptr& output, const ORUtils::SE3Pose& pose,
+                                                                              const VoxelRenderState_CPtr& renderState, DepthVisualiser::DepthType depthType,
+                                                                              const itmx::DepthVisualiser_CPtr& depthVisualiser, const Settings_CPtr& settings)
+{
+  const rigging::SimpleCamera camera = CameraPoseConverter::pose_to_camera(pose);
+  depthVisualiser->render_depth(
+    depthType, orx::GeometryUtil::to_itm(camera.p()), orx::GeometryUtil::to_itm(camera.n()),
+    renderState.get(), settings->sceneParams.voxelSize, -1.0f, output
+  );
+
+  if(settings->deviceType == ORUtils::DEVICE_CUDA) output->UpdateHostFromDevice();
+}
+
 template <typename VoxelType, typename IndexType>
 void DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(const ORFloatImage_Ptr& output, const Scene_CPtr& scene, const ORUtils::SE3Pose& pose,
                                                                              const ITMLib::ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState,
@@ -33,13 +47,7 @@ void DepthVisualisationUtil<VoxelType,IndexType>::generate_depth_from_voxels(con
   voxelVisualisationEngine->CreateExpectedDepths(scene.get(), &pose, &intrinsics, renderState.get());
   voxelVisualisationEngine->FindSurface(scene.get(), &pose, &intrinsics, renderState.get());
 
-  const rigging::SimpleCamera camera = CameraPoseConverter::pose_to_camera(pose);
-  depthVisualiser->render_depth(
-    depthType, orx::GeometryUtil::to_itm(camera.p()), orx::GeometryUtil::to_itm(camera.n()),
-    renderState.get(), settings->sceneParams.voxelSize, -1.0f, output
-  );
-
-  if(settings->deviceType == ORUtils::DEVICE_CUDA) output->UpdateHostFromDevice();
+  generate_depth_from_raycast(output, pose, renderState, depthType, depthVisualiser, settings);
 }
 
 }
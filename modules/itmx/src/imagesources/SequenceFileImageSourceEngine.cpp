@@ -0,0 +1,223 @@
+/**
+ * itmx: SequenceFileImageSourceEngine.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "imagesources/SequenceFileImageSourceEngine.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+SequenceFileImageSourceEngine::SequenceFileImageSourceEngine(const std::string& filename, size_t initialPosition, size_t prefetchCount, size_t workerCount)
+: m_decodesInProgress(0),
+  m_reader(new SequenceFileReader(filename)),
+  m_workersPaused(false),
+  m_workersShouldTerminate(false)
+{
+  const size_t frameCount = m_reader->get_frame_count();
+  m_nextPositionToDecode = m_nextPositionToReturn = std::min(initialPosition, frameCount);
+
+  // Allocate the slots in the prefetch window up-front, to avoid allocating memory at runtime. There is no point
+  // in having more slots than there are frames in the sequence, but we always need at least one slot.
+  const size_t slotCount = std::max<size_t>(std::min(prefetchCount, frameCount), 1);
+  m_slots.resize(slotCount);
+  for(size_t i = 0; i < slotCount; ++i)
+  {
+    m_slots[i].frame = RGBDFrameMessage::make(m_reader->get_rgb_image_size(), m_reader->get_depth_image_size());
+    m_slots[i].position = 0;
+    m_slots[i].state = SS_EMPTY;
+  }
+
+  // Start the workers (there is no point in having more workers than slots, since the extra workers would never have anything to do).
+  if(workerCount == 0) workerCount = std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+  workerCount = std::min(workerCount, slotCount);
+  for(size_t i = 0; i < workerCount; ++i)
+  {
+    m_workers.create_thread(boost::bind(&SequenceFileImageSourceEngine::run_worker, this));
+  }
+}
+
+//#################### DESTRUCTOR ####################
+
+SequenceFileImageSourceEngine::~SequenceFileImageSourceEngine()
+{
+  // Set the flag that informs the workers that they should terminate.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_workersShouldTerminate = true;
+  }
+
+  // Wake the workers (they might be waiting for work) and wait for them to terminate gracefully.
+  m_workAvailable.notify_all();
+  m_workers.join_all();
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+ITMLib::ITMRGBDCalib SequenceFileImageSourceEngine::getCalib() const
+{
+  return m_reader->get_calib();
+}
+
+Vector2i SequenceFileImageSourceEngine::getDepthImageSize() const
+{
+  return m_reader->get_depth_image_size();
+}
+
+void SequenceFileImageSourceEngine::getImages(ORUChar4Image *rgb, ORShortImage *rawDepth)
+{
+  Slot *slot = NULL;
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+
+    // If there are no more images available, early out.
+    if(m_nextPositionToReturn >= m_reader->get_frame_count())
+    {
+      throw std::runtime_error("Error: No more images to get. Make sure to call hasMoreImages before calling getImages.");
+    }
+
+    // Otherwise, wait for the next frame to be uncompressed.
+    slot = &m_slots[m_nextPositionToReturn % m_slots.size()];
+    while(slot->state != SS_READY || slot->position != m_nextPositionToReturn) m_slotReady.wait(lock);
+  }
+
+  // Copy the images and pose out of the slot. We can do this without holding the lock, since the workers
+  // will not reuse the slot until we have moved the prefetch window past it.
+  const std::string error = slot->error;
+  if(error.empty())
+  {
+    rgb->ChangeDims(m_reader->get_rgb_image_size());
+    slot->frame->extract_rgb_image(rgb);
+
+    const Vector2i depthImageSize = m_reader->get_depth_image_size();
+    if(depthImageSize.x * depthImageSize.y > 0)
+    {
+      rawDepth->ChangeDims(depthImageSize);
+      slot->frame->extract_depth_image(rawDepth);
+    }
+
+    m_lastPose = slot->frame->extract_pose();
+  }
+
+  // Release the slot, move the prefetch window on by one frame, and inform the workers that there is more work to do.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    slot->state = SS_EMPTY;
+    ++m_nextPositionToReturn;
+  }
+
+  m_workAvailable.notify_one();
+
+  if(!error.empty()) throw std::runtime_error(error);
+}
+
+Vector2i SequenceFileImageSourceEngine::getRGBImageSize() const
+{
+  return m_reader->get_rgb_image_size();
+}
+
+bool SequenceFileImageSourceEngine::hasMoreImages() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_nextPositionToReturn < m_reader->get_frame_count();
+}
+
+ORUtils::SE3Pose SequenceFileImageSourceEngine::get_last_pose() const
+{
+  return m_lastPose;
+}
+
+size_t SequenceFileImageSourceEngine::get_position() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_nextPositionToReturn;
+}
+
+const SequenceFileReader_CPtr& SequenceFileImageSourceEngine::get_reader() const
+{
+  return m_reader;
+}
+
+void SequenceFileImageSourceEngine::seek(size_t position)
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+
+    // Prevent the workers from starting to uncompress any more frames, and wait for any frames they are currently uncompressing.
+    m_workersPaused = true;
+    while(m_decodesInProgress > 0) m_slotReady.wait(lock);
+
+    // Discard any frames that have already been prefetched, and restart the prefetch window from the specified position.
+    for(size_t i = 0, size = m_slots.size(); i < size; ++i)
+    {
+      m_slots[i].state = SS_EMPTY;
+    }
+
+    m_nextPositionToDecode = m_nextPositionToReturn = std::min(position, m_reader->get_frame_count());
+    m_workersPaused = false;
+  }
+
+  m_workAvailable.notify_all();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SequenceFileImageSourceEngine::run_worker()
+{
+  // Each worker uses its own frame compressor, so that the workers can uncompress frames in parallel.
+  RGBDFrameCompressor_Ptr frameCompressor = m_reader->make_frame_compressor();
+  const size_t frameCount = m_reader->get_frame_count();
+
+  for(;;)
+  {
+    Slot *slot = NULL;
+    size_t position;
+
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+
+      // Wait until either there is a frame in the prefetch window that no worker has yet started to uncompress, or termination is requested.
+      while(!m_workersShouldTerminate && (m_workersPaused || m_nextPositionToDecode >= frameCount || m_nextPositionToDecode >= m_nextPositionToReturn + m_slots.size()))
+      {
+        m_workAvailable.wait(lock);
+      }
+
+      // If we were asked to terminate, do so.
+      if(m_workersShouldTerminate) return;
+
+      // Claim the next frame to uncompress.
+      position = m_nextPositionToDecode++;
+      slot = &m_slots[position % m_slots.size()];
+      slot->position = position;
+      slot->state = SS_DECODING;
+      ++m_decodesInProgress;
+    }
+
+    // Uncompress the frame into the slot. We do this without holding the lock, so that other workers can uncompress frames at the same time.
+    slot->error.clear();
+    try
+    {
+      m_reader->read_frame(position, *frameCompressor, *slot->frame);
+    }
+    catch(std::exception& e)
+    {
+      slot->error = e.what();
+    }
+
+    // Mark the slot as ready, and inform anyone waiting for it (or for all decodes to finish) that it is.
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      slot->state = SS_READY;
+      --m_decodesInProgress;
+    }
+
+    m_slotReady.notify_all();
+  }
+}
+
+}
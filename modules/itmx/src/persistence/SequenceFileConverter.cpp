@@ -0,0 +1,50 @@
+/**
+ * itmx: SequenceFileConverter.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "persistence/SequenceFileConverter.h"
+
+#include <ITMLib/Objects/Camera/ITMCalibIO.h>
+
+#include <tvgutil/filesystem/SequentialPathGenerator.h>
+using namespace tvgutil;
+
+#include "persistence/ImagePersister.h"
+#include "persistence/PosePersister.h"
+#include "persistence/SequenceFileReader.h"
+
+namespace bf = boost::filesystem;
+
+namespace itmx {
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+void SequenceFileConverter::convert_to_frame_files(const std::string& sequenceFilename, const bf::path& outputDir)
+{
+  SequenceFileReader reader(sequenceFilename);
+  bf::create_directories(outputDir);
+
+  // Write the calibration.
+  const bf::path calibrationFile = outputDir / "calib.txt";
+  ITMLib::writeRGBDCalib(calibrationFile.string().c_str(), reader.get_calib());
+
+  // Write the frames.
+  const Vector2i depthImageSize = reader.get_depth_image_size();
+  const bool hasDepth = depthImageSize.x * depthImageSize.y > 0;
+  ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+  ORUChar4Image_Ptr rgbImage(new ORUChar4Image(reader.get_rgb_image_size(), true, false));
+  ORUtils::SE3Pose pose;
+
+  SequentialPathGenerator pathGenerator(outputDir);
+  for(size_t i = 0, frameCount = reader.get_frame_count(); i < frameCount; ++i, pathGenerator.increment_index())
+  {
+    reader.read_frame(i, rgbImage.get(), hasDepth ? depthImage.get() : NULL, pose);
+
+    ImagePersister::save_image(rgbImage, pathGenerator.make_path("frame-%06i.color.png").string());
+    if(hasDepth) ImagePersister::save_image(depthImage, pathGenerator.make_path("frame-%06i.depth.png").string());
+    PosePersister::save_pose(pose.GetInvM(), pathGenerator.make_path("frame-%06i.pose.txt"));
+  }
+}
+
+}
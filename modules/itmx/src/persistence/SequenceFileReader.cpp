@@ -0,0 +1,265 @@
+/**
+ * itmx: SequenceFileReader.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "persistence/SequenceFileReader.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/lexical_cast.hpp>
+using namespace boost::interprocess;
+
+#include "remotemapping/RGBDCalibrationMessage.h"
+
+namespace itmx {
+
+//#################### LOCAL TYPES ####################
+
+namespace {
+
+/**
+ * \brief An instance of this struct keeps a file mapped into memory for as long as it exists.
+ */
+struct MappedFile
+{
+  /** The mapping associated with the file. */
+  file_mapping mapping;
+
+  /** The region of memory into which the file has been mapped. */
+  mapped_region region;
+
+  explicit MappedFile(const std::string& filename)
+  : mapping(filename.c_str(), read_only), region(mapping, read_only)
+  {}
+};
+
+}
+
+//#################### CONSTRUCTORS ####################
+
+SequenceFileReader::SequenceFileReader(const std::string& filename)
+: m_data(NULL), m_filename(filename), m_size(0)
+{
+  if(!is_sequence_file(filename)) throw std::runtime_error("Error: " + filename + " is not a sequence file");
+
+  // Map the file into memory.
+  boost::shared_ptr<MappedFile> mappedFile;
+  try
+  {
+    mappedFile.reset(new MappedFile(filename));
+  }
+  catch(interprocess_exception& e)
+  {
+    throw std::runtime_error("Error: Couldn't map " + filename + " into memory: " + e.what());
+  }
+
+  m_mapping = mappedFile;
+  m_data = static_cast<const char*>(mappedFile->region.get_address());
+  m_size = mappedFile->region.get_size();
+
+  // Check the header.
+  if(m_size < sizeof(SequenceFileFormat::Header)) throw std::runtime_error("Error: " + filename + " is truncated");
+
+  SequenceFileFormat::Header header;
+  memcpy(&header, m_data, sizeof(header));
+
+  const boost::uint32_t supportedVersion = SequenceFileFormat::Version;
+  if(header.version != supportedVersion)
+  {
+    throw std::runtime_error(
+      "Error: " + filename + " has version " + boost::lexical_cast<std::string>(header.version) +
+      ", but only version " + boost::lexical_cast<std::string>(supportedVersion) + " is supported"
+    );
+  }
+
+  // Read the calibration message, and use it to set up the frame compressor.
+  RGBDCalibrationMessage calibMsg;
+  const boost::uint64_t firstRecordOffset = sizeof(SequenceFileFormat::Header) + header.calibSize;
+  if(header.calibSize != calibMsg.get_size() || firstRecordOffset > m_size)
+  {
+    throw std::runtime_error("Error: Could not read the calibration from " + filename);
+  }
+
+  memcpy(calibMsg.get_data_ptr(), m_data + sizeof(SequenceFileFormat::Header), calibMsg.get_size());
+  m_calib = calibMsg.extract_calib();
+  m_depthCompressionType = calibMsg.extract_depth_compression_type();
+  m_rgbCompressionType = calibMsg.extract_rgb_compression_type();
+  m_frameCompressor = make_frame_compressor();
+  m_uncompressedFrame = RGBDFrameMessage::make(get_rgb_image_size(), get_depth_image_size());
+
+  // If the file has a valid footer, read the index. If not, recover the frame records by scanning the file.
+  SequenceFileFormat::Footer footer;
+  bool hasIndex = false;
+  if(m_size >= firstRecordOffset + sizeof(footer))
+  {
+    memcpy(&footer, m_data + m_size - sizeof(footer), sizeof(footer));
+    hasIndex = memcmp(footer.magic, SequenceFileFormat::footer_magic(), sizeof(footer.magic)) == 0
+      && footer.indexOffset >= firstRecordOffset
+      && footer.indexOffset + footer.frameCount * sizeof(SequenceFileFormat::IndexEntry) + sizeof(footer) == m_size;
+  }
+
+  if(hasIndex)
+  {
+    m_index.resize(static_cast<size_t>(footer.frameCount));
+    if(!m_index.empty()) memcpy(&m_index[0], m_data + footer.indexOffset, m_index.size() * sizeof(SequenceFileFormat::IndexEntry));
+  }
+  else
+  {
+    std::cerr << "Warning: " << filename << " has no index (the recording may have been interrupted); scanning the file to recover the frames\n";
+    rebuild_index(firstRecordOffset);
+  }
+}
+
+//#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+
+bool SequenceFileReader::is_sequence_file(const std::string& filename)
+{
+  std::ifstream fs(filename.c_str(), std::ios_base::binary);
+  char magic[sizeof(SequenceFileFormat::Header().magic)];
+  return fs.read(magic, sizeof(magic)) && memcmp(magic, SequenceFileFormat::magic(), sizeof(magic)) == 0;
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+const ITMLib::ITMRGBDCalib& SequenceFileReader::get_calib() const
+{
+  return m_calib;
+}
+
+Vector2i SequenceFileReader::get_depth_image_size() const
+{
+  return m_calib.intrinsics_d.imgSize;
+}
+
+size_t SequenceFileReader::get_frame_count() const
+{
+  return m_index.size();
+}
+
+Vector2i SequenceFileReader::get_rgb_image_size() const
+{
+  return m_calib.intrinsics_rgb.imgSize;
+}
+
+RGBDFrameCompressor_Ptr SequenceFileReader::make_frame_compressor() const
+{
+  return RGBDFrameCompressor_Ptr(new RGBDFrameCompressor(get_rgb_image_size(), get_depth_image_size(), m_rgbCompressionType, m_depthCompressionType));
+}
+
+void SequenceFileReader::read_frame(size_t i, RGBDFrameCompressor& frameCompressor, RGBDFrameMessage& uncompressedFrame) const
+{
+  CompressedRGBDFrameHeaderMessage headerMsg;
+  CompressedRGBDFrameMessage frameMsg(headerMsg);
+  read_compressed_frame(i, headerMsg, frameMsg);
+  frameCompressor.uncompress_rgbd_frame(frameMsg, uncompressedFrame);
+}
+
+void SequenceFileReader::read_frame(size_t i, ORUChar4Image *rgbImage, ORShortImage *depthImage, ORUtils::SE3Pose& pose)
+{
+  // Uncompress the frame and copy its contents into the output images and pose.
+  read_frame(i, *m_frameCompressor, *m_uncompressedFrame);
+
+  rgbImage->ChangeDims(get_rgb_image_size());
+  m_uncompressedFrame->extract_rgb_image(rgbImage);
+
+  if(depthImage)
+  {
+    depthImage->ChangeDims(get_depth_image_size());
+    m_uncompressedFrame->extract_depth_image(depthImage);
+  }
+
+  pose = m_uncompressedFrame->extract_pose();
+}
+
+ORUtils::SE3Pose SequenceFileReader::read_pose(size_t i) const
+{
+  if(i >= m_index.size()) throw std::runtime_error("Error: Frame " + boost::lexical_cast<std::string>(i) + " is not in " + m_filename);
+
+  // The pose is stored uncompressed just after the frame index, at the start of the compressed frame message.
+  // A compressed frame message whose images are empty spans only the frame index and pose, so we can copy just
+  // that prefix out of the mapped file, rather than copying the compressed images as well.
+  CompressedRGBDFrameHeaderMessage emptyHeaderMsg;
+  CompressedRGBDFrameMessage poseMsg(emptyHeaderMsg);
+  const boost::uint64_t offset = m_index[i].offset + emptyHeaderMsg.get_size();
+  if(offset + poseMsg.get_size() > m_size)
+  {
+    throw std::runtime_error("Error: Could not read frame " + boost::lexical_cast<std::string>(i) + " from " + m_filename);
+  }
+
+  memcpy(poseMsg.get_data_ptr(), m_data + offset, poseMsg.get_size());
+  return poseMsg.extract_pose();
+}
+
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+boost::uint64_t SequenceFileReader::compute_record_size(const CompressedRGBDFrameHeaderMessage& headerMsg)
+{
+  // A compressed frame message whose images are empty spans only the frame index and pose.
+  CompressedRGBDFrameHeaderMessage emptyHeaderMsg;
+  CompressedRGBDFrameMessage emptyFrameMsg(emptyHeaderMsg);
+
+  return static_cast<boost::uint64_t>(headerMsg.get_size()) + emptyFrameMsg.get_size() +
+         headerMsg.extract_depth_image_byte_size() + headerMsg.extract_rgb_image_byte_size();
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SequenceFileReader::read_compressed_frame(size_t i, CompressedRGBDFrameHeaderMessage& headerMsg, CompressedRGBDFrameMessage& frameMsg) const
+{
+  if(i >= m_index.size()) throw std::runtime_error("Error: Frame " + boost::lexical_cast<std::string>(i) + " is not in " + m_filename);
+
+  // Copy the compressed frame header message out of the mapped file, and use it to size the compressed frame message.
+  const boost::uint64_t offset = m_index[i].offset;
+  if(offset + headerMsg.get_size() > m_size)
+  {
+    throw std::runtime_error("Error: Could not read frame " + boost::lexical_cast<std::string>(i) + " from " + m_filename);
+  }
+
+  memcpy(headerMsg.get_data_ptr(), m_data + offset, headerMsg.get_size());
+
+  // Check that the whole record lies within the file before sizing the compressed frame message (the image sizes
+  // in a corrupt header could be arbitrarily large), and then copy the message itself out of the mapped file.
+  if(offset + compute_record_size(headerMsg) > m_size)
+  {
+    throw std::runtime_error("Error: Could not read frame " + boost::lexical_cast<std::string>(i) + " from " + m_filename);
+  }
+
+  frameMsg.set_compressed_image_sizes(headerMsg);
+  memcpy(frameMsg.get_data_ptr(), m_data + offset + headerMsg.get_size(), frameMsg.get_size());
+}
+
+void SequenceFileReader::rebuild_index(boost::uint64_t firstRecordOffset)
+{
+  // Note: Only the frame index is needed for each record, so rather than copying each compressed frame message in its entirety,
+  //       we use a message whose images are empty (and which thus spans only the frame index and pose) to copy just its prefix.
+  CompressedRGBDFrameHeaderMessage headerMsg, emptyHeaderMsg;
+  CompressedRGBDFrameMessage prefixMsg(emptyHeaderMsg);
+  boost::uint64_t offset = firstRecordOffset;
+
+  // Walk the frame records one at a time, stopping at the first record that is incomplete.
+  for(;;)
+  {
+    if(offset + headerMsg.get_size() > m_size) break;
+    memcpy(headerMsg.get_data_ptr(), m_data + offset, headerMsg.get_size());
+
+    const boost::uint64_t recordSize = compute_record_size(headerMsg);
+    if(offset + recordSize > m_size) break;
+    memcpy(prefixMsg.get_data_ptr(), m_data + offset + headerMsg.get_size(), prefixMsg.get_size());
+
+    SequenceFileFormat::IndexEntry entry;
+    entry.offset = offset;
+    entry.frameIndex = prefixMsg.extract_frame_index();
+    entry.reserved = 0;
+    m_index.push_back(entry);
+
+    offset += recordSize;
+  }
+}
+
+}
@@ -0,0 +1,237 @@
+/**
+ * itmx: SequenceRecorder.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "persistence/SequenceRecorder.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "remotemapping/RGBDCalibrationMessage.h"
+using namespace tvgutil;
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+SequenceRecorder::SequenceRecorder(const std::string& filename, const ITMLib::ITMRGBDCalib& calib, RGBCompressionType rgbCompressionType,
+                                   DepthCompressionType depthCompressionType, size_t capacity, pooled_queue::PoolEmptyStrategy poolEmptyStrategy)
+: m_framesDropped(0),
+  m_framesRecorded(0),
+  m_poolEmptyStrategy(poolEmptyStrategy),
+  m_depthImageSize(calib.intrinsics_d.imgSize),
+  m_rgbImageSize(calib.intrinsics_rgb.imgSize),
+  m_writerShouldTerminate(false)
+{
+  // Note: A capacity of zero would leave the pool permanently empty, so that recording a frame would either block forever or drop it.
+  if(capacity == 0) throw std::invalid_argument("Error: The capacity of a sequence recorder must be at least one frame");
+
+  m_stream.open(filename.c_str(), std::ios_base::binary);
+  if(!m_stream) throw std::runtime_error("Error: Could not open sequence file for writing: " + filename);
+
+  // If we're not recording depth images, there's nothing to compress, so avoid requiring support for depth compression.
+  if(m_depthImageSize.x * m_depthImageSize.y == 0) depthCompressionType = DEPTH_COMPRESSION_NONE;
+
+  // Set up the frame compressor (this will throw if the specified compression types cannot be used).
+  m_frameCompressor.reset(new RGBDFrameCompressor(m_rgbImageSize, m_depthImageSize, rgbCompressionType, depthCompressionType));
+
+  // Fill the pool, so as to avoid allocating memory while recording.
+  for(size_t i = 0; i < capacity; ++i)
+  {
+    m_pool.push_back(RGBDFrameMessage::make(m_rgbImageSize, m_depthImageSize));
+  }
+
+  if(poolEmptyStrategy == pooled_queue::PES_REPLACE_RANDOM)
+  {
+    m_rng.reset(new RandomNumberGenerator(12345));
+  }
+
+  // Write the header, followed by a calibration message that also records the compression types.
+  RGBDCalibrationMessage calibMsg;
+  calibMsg.set_calib(calib);
+  calibMsg.set_depth_compression_type(depthCompressionType);
+  calibMsg.set_rgb_compression_type(rgbCompressionType);
+
+  SequenceFileFormat::Header header;
+  memcpy(header.magic, SequenceFileFormat::magic(), sizeof(header.magic));
+  header.version = SequenceFileFormat::Version;
+  header.calibSize = static_cast<boost::uint32_t>(calibMsg.get_size());
+
+  m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  m_stream.write(calibMsg.get_data_ptr(), calibMsg.get_size());
+  if(!m_stream) throw std::runtime_error("Error: Could not write header to sequence file: " + filename);
+
+  // Start the writer thread.
+  m_writer = boost::thread(boost::bind(&SequenceRecorder::run_writer, this));
+}
+
+//#################### DESTRUCTOR ####################
+
+SequenceRecorder::~SequenceRecorder()
+{
+  // Set the flag that informs the writer that it should terminate once it has written the remaining frames.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_writerShouldTerminate = true;
+  }
+
+  // Wake the writer (it might be waiting on an empty queue).
+  m_queueNonEmpty.notify_one();
+
+  // Wait for the writer to finish.
+  m_writer.join();
+
+  if(m_framesDropped > 0)
+  {
+    std::cout << "Warning: " << m_framesDropped << " of " << m_framesRecorded << " frames were dropped while recording the sequence\n";
+  }
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+size_t SequenceRecorder::get_frames_dropped() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_framesDropped;
+}
+
+bool SequenceRecorder::record_frame(const ORUChar4Image_CPtr& rgbImage, const ORShortImage_CPtr& depthImage, const ORUtils::SE3Pose& pose)
+{
+  using namespace pooled_queue;
+
+  if(rgbImage->noDims != m_rgbImageSize || (depthImage && m_depthImageSize.x * m_depthImageSize.y > 0 && depthImage->noDims != m_depthImageSize))
+  {
+    throw std::invalid_argument("Error: The images to record do not have the sizes specified when the sequence recorder was constructed");
+  }
+
+  RGBDFrameMessage_Ptr msg;
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    const int frameIndex = m_framesRecorded++;
+
+    // If the pool is empty (i.e. the writer has fallen behind), decide what to do based on the pool empty strategy.
+    if(m_pool.empty())
+    {
+      switch(m_poolEmptyStrategy)
+      {
+        case PES_DISCARD:
+        {
+          ++m_framesDropped;
+          return false;
+        }
+        case PES_GROW:
+        {
+          m_pool.push_back(RGBDFrameMessage::make(m_rgbImageSize, m_depthImageSize));
+          break;
+        }
+        case PES_REPLACE_RANDOM:
+        {
+          // If every message is currently being written (e.g. if the capacity is one), there is nothing to replace.
+          if(m_queue.empty())
+          {
+            ++m_framesDropped;
+            return false;
+          }
+
+          const int offset = m_rng->generate_int_from_uniform(0, static_cast<int>(m_queue.size()) - 1);
+          m_pool.push_back(m_queue[offset]);
+          m_queue.erase(m_queue.begin() + offset);
+          ++m_framesDropped;
+          break;
+        }
+        case PES_WAIT:
+        {
+          while(m_pool.empty()) m_poolNonEmpty.wait(lock);
+          break;
+        }
+      }
+    }
+
+    msg = m_pool.front();
+    m_pool.pop_front();
+    msg->set_frame_index(frameIndex);
+  }
+
+  // Copy the frame into the message. We do this without holding the lock, since the message is not yet visible to the writer.
+  msg->set_pose(pose);
+  msg->set_rgb_image(rgbImage);
+  if(depthImage && m_depthImageSize.x * m_depthImageSize.y > 0) msg->set_depth_image(depthImage);
+
+  // Queue the message for writing.
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_queue.push_back(msg);
+  }
+
+  m_queueNonEmpty.notify_one();
+  return true;
+}
+
+//#################### PRIVATE MEMBER FUNCTIONS ####################
+
+void SequenceRecorder::run_writer()
+{
+  CompressedRGBDFrameHeaderMessage headerMsg;
+  CompressedRGBDFrameMessage frameMsg(headerMsg);
+  bool streamOk = true;
+
+  for(;;)
+  {
+    RGBDFrameMessage_Ptr msg;
+
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+
+      // Wait until either there is a frame to write or termination is requested. Note that we only
+      // terminate once the queue is empty, so that every queued frame makes it into the file.
+      while(m_queue.empty() && !m_writerShouldTerminate) m_queueNonEmpty.wait(lock);
+      if(m_queue.empty()) break;
+
+      msg = m_queue.front();
+      m_queue.pop_front();
+    }
+
+    // Compress the frame and append it to the file, recording its offset in the index.
+    if(streamOk)
+    {
+      m_frameCompressor->compress_rgbd_frame(*msg, headerMsg, frameMsg);
+
+      SequenceFileFormat::IndexEntry entry;
+      entry.offset = static_cast<boost::uint64_t>(m_stream.tellp());
+      entry.frameIndex = msg->extract_frame_index();
+      entry.reserved = 0;
+
+      streamOk = m_stream.write(headerMsg.get_data_ptr(), headerMsg.get_size()) && m_stream.write(frameMsg.get_data_ptr(), frameMsg.get_size());
+
+      if(streamOk) m_index.push_back(entry);
+      else std::cerr << "Error: Could not write frame " << entry.frameIndex << " to sequence file; the remaining frames will be dropped\n";
+    }
+
+    // Return the message to the pool and inform anyone waiting for space that it is available.
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_pool.push_back(msg);
+    }
+
+    m_poolNonEmpty.notify_one();
+  }
+
+  // Finish the file by writing the index, followed by the footer.
+  if(streamOk)
+  {
+    SequenceFileFormat::Footer footer;
+    footer.indexOffset = static_cast<boost::uint64_t>(m_stream.tellp());
+    footer.frameCount = m_index.size();
+    memcpy(footer.magic, SequenceFileFormat::footer_magic(), sizeof(footer.magic));
+
+    if(!m_index.empty()) m_stream.write(reinterpret_cast<const char*>(&m_index[0]), m_index.size() * sizeof(SequenceFileFormat::IndexEntry));
+    m_stream.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+  }
+
+  m_stream.close();
+}
+
+}
@@ -0,0 +1,41 @@
+/**
+ * itmx: FrameAckMessage.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#include "remotemapping/FrameAckMessage.h"
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+FrameAckMessage::FrameAckMessage()
+{
+  m_frameCountSegment = std::make_pair(0, sizeof(int));
+  m_freeSlotCountSegment = std::make_pair(end_of(m_frameCountSegment), sizeof(int));
+  m_data.resize(end_of(m_freeSlotCountSegment));
+}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+int FrameAckMessage::extract_frame_count() const
+{
+  return read_simple<int>(m_frameCountSegment);
+}
+
+int FrameAckMessage::extract_free_slot_count() const
+{
+  return read_simple<int>(m_freeSlotCountSegment);
+}
+
+void FrameAckMessage::set_frame_count(int frameCount)
+{
+  write_simple(frameCount, m_frameCountSegment);
+}
+
+void FrameAckMessage::set_free_slot_count(int freeSlotCount)
+{
+  write_simple(freeSlotCount, m_freeSlotCountSegment);
+}
+
+}
@@ -5,6 +5,7 @@
 
 #include "remotemapping/MappingClient.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <tvgutil/boost/WrappedAsio.h>
@@ -12,6 +13,7 @@
 using boost::asio::ip::tcp;
 using namespace tvgutil;
 
+#include "remotemapping/FrameAckMessage.h"
 #include "remotemapping/InteractionTypeMessage.h"
 #include "remotemapping/RenderingRequestMessage.h"
 
@@ -19,8 +21,13 @@ namespace itmx {
 
 //#################### CONSTRUCTORS ####################
 
-MappingClient::MappingClient(const std::string& host, const std::string& port, pooled_queue::PoolEmptyStrategy poolEmptyStrategy)
-: m_frameMessageQueue(poolEmptyStrategy), m_stream(host, port)
+MappingClient::MappingClient(const std::string& host, const std::string& port, pooled_queue::PoolEmptyStrategy poolEmptyStrategy, int maxFramesInFlight)
+: m_frameMessageQueue(poolEmptyStrategy),
+  m_framesAcked(0),
+  m_framesSent(0),
+  m_maxFramesInFlight(std::max(maxFramesInFlight, 1)),
+  m_serverFreeSlotCount(m_maxFramesInFlight),
+  m_stream(host, port)
 {
   if(!m_stream) throw std::runtime_error("Error: Could not connect to server");
 }
@@ -39,8 +46,8 @@ ORUChar4Image_CPtr MappingClient::get_remote_image() const
 
   boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
-  // Ask the server whether it has ever rendered an RGB-D image for this client.
-  if(m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size()))
+  // Ask the server whether it has ever rendered an RGB-D image for this client (after first waiting for any pipelined frames to be acknowledged).
+  if(drain_frame_acks() && m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size()))
   {
     SimpleMessage<bool> flag;
     if(m_stream.read(flag.get_data_ptr(), flag.get_size()) && m_stream.write(ackMsg.get_data_ptr(), ackMsg.get_size()) && flag.extract_value())
@@ -122,9 +129,10 @@ void MappingClient::update_rendering_request(const Vector2i& imgSize, const ORUt
 
   boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
-  // First send the interaction type message, then send the rendering request message,
-  // then wait for an acknowledgement from the server. We chain all of these with &&
-  // so as to early out in case of failure.
+  // First wait for any pipelined frames to be acknowledged, then send the interaction type message,
+  // then send the rendering request message, then wait for an acknowledgement from the server.
+  // We chain all of these with && so as to early out in case of failure.
+  drain_frame_acks() &&
   m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size()) &&
   m_stream.write(requestMsg.get_data_ptr(), requestMsg.get_size()) && 
   m_stream.read(ackMsg.get_data_ptr(), ackMsg.get_size());
@@ -132,12 +140,41 @@ void MappingClient::update_rendering_request(const Vector2i& imgSize, const ORUt
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+bool MappingClient::can_send_pipelined_frame() const
+{
+  const int framesInFlight = m_framesSent - m_framesAcked;
+  const int window = std::min(m_maxFramesInFlight, std::max(m_serverFreeSlotCount, 1));
+  return framesInFlight < window;
+}
+
+bool MappingClient::drain_frame_acks() const
+{
+  bool connectionOk = true;
+  while(connectionOk && m_framesAcked != m_framesSent)
+  {
+    connectionOk = read_frame_ack();
+  }
+  return connectionOk;
+}
+
+bool MappingClient::read_frame_ack() const
+{
+  FrameAckMessage frameAckMsg;
+  if(!m_stream.read(frameAckMsg.get_data_ptr(), frameAckMsg.get_size())) return false;
+
+  // Since the acknowledgements are cumulative, the most recent one tells us everything we need to know.
+  m_framesAcked = frameAckMsg.extract_frame_count();
+  m_serverFreeSlotCount = frameAckMsg.extract_free_slot_count();
+  return true;
+}
+
 void MappingClient::run_message_sender()
 {
   AckMessage ackMsg;
   CompressedRGBDFrameHeaderMessage headerMsg;
   CompressedRGBDFrameMessage frameMsg(headerMsg);
-  InteractionTypeMessage interactionTypeMsg(IT_SENDFRAME);
+  const bool pipelined = m_maxFramesInFlight > 1;
+  InteractionTypeMessage interactionTypeMsg(pipelined ? IT_SENDFRAMEPIPELINED : IT_SENDFRAME);
 
   bool connectionOk = true;
 
@@ -151,6 +188,26 @@ void MappingClient::run_message_sender()
     // the actual frame data.
     m_frameCompressor->compress_rgbd_frame(*msg, headerMsg, frameMsg);
 
+    if(pipelined)
+    {
+      boost::lock_guard<boost::mutex> lock(m_interactionMutex);
+
+      // If too many frames are already in flight, wait for the server to acknowledge some of them.
+      while(connectionOk && !can_send_pipelined_frame())
+      {
+        connectionOk = read_frame_ack();
+      }
+
+      // Then send the interaction type message, the frame header message and the frame message itself,
+      // without waiting for an acknowledgement (this will be read later, when it's actually needed).
+      connectionOk = connectionOk
+        && m_stream.write(interactionTypeMsg.get_data_ptr(), interactionTypeMsg.get_size())
+        && m_stream.write(headerMsg.get_data_ptr(), headerMsg.get_size())
+        && m_stream.write(frameMsg.get_data_ptr(), frameMsg.get_size());
+
+      if(connectionOk) ++m_framesSent;
+    }
+    else
     {
       boost::lock_guard<boost::mutex> lock(m_interactionMutex);
 
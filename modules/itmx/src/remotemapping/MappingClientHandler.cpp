@@ -12,6 +12,7 @@ using namespace tvgutil;
 #include "ocv/OpenCVUtil.h"
 #endif
 
+#include "remotemapping/FrameAckMessage.h"
 #include "remotemapping/InteractionTypeMessage.h"
 #include "remotemapping/RenderingRequestMessage.h"
 #include "remotemapping/RGBDCalibrationMessage.h"
@@ -27,6 +28,7 @@ MappingClientHandler::MappingClientHandler(int clientID, const boost::shared_ptr
 : ClientHandler(clientID, sock, shouldTerminate),
   m_frameMessageQueue(new RGBDFrameMessageQueue(tvgutil::pooled_queue::PES_DISCARD)),
   m_imagesDirty(false),
+  m_pipelinedFrameCount(0),
   m_poseDirty(false)
 {
   m_frameMessage.reset(new CompressedRGBDFrameMessage(m_headerMessage));
@@ -88,7 +90,8 @@ void MappingClientHandler::run_iter()
   if((m_connectionOk = read_message(interactionTypeMsg)))
   {
     // If that succeeds, determine the type of interaction the client wants to have with the server and proceed accordingly.
-    switch(interactionTypeMsg.extract_value())
+    const InteractionType interactionType = interactionTypeMsg.extract_value();
+    switch(interactionType)
     {
       case IT_GETRENDEREDIMAGE:
       {
@@ -133,6 +136,7 @@ void MappingClientHandler::run_iter()
         break;
       }
       case IT_SENDFRAME:
+      case IT_SENDFRAMEPIPELINED:
       {
 #if DEBUGGING
         std::cout << "Receiving frame from client" << std::endl;
@@ -147,29 +151,40 @@ void MappingClientHandler::run_iter()
           // Now, read the frame message itself.
           if((m_connectionOk = read_message(*m_frameMessage)))
           {
-            // If that succeeds, uncompress the images, store them on the frame message queue and send an acknowledgement to the client.
+            // If that succeeds, uncompress the images and store them on the frame message queue.
 #if DEBUGGING
             std::cout << "Message queue size (" << m_clientID << "): " << m_frameMessageQueue->size() << std::endl;
 #endif
 
-            RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
-            boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
-            RGBDFrameMessage& msg = elt ? **elt : *m_dummyFrameMessage;
-            m_frameCompressor->uncompress_rgbd_frame(*m_frameMessage, msg);
-
-            m_connectionOk = write_message(AckMessage());
+            {
+              RGBDFrameMessageQueue::PushHandler_Ptr pushHandler = m_frameMessageQueue->begin_push();
+              boost::optional<RGBDFrameMessage_Ptr&> elt = pushHandler->get();
+              RGBDFrameMessage& msg = elt ? **elt : *m_dummyFrameMessage;
+              m_frameCompressor->uncompress_rgbd_frame(*m_frameMessage, msg);
 
 #if DEBUGGING
-            std::cout << "Got message: " << msg.extract_frame_index() << std::endl;
-
-          #ifdef WITH_OPENCV
-            static ORUChar4Image_Ptr rgbImage(new ORUChar4Image(get_rgb_image_size(), true, false));
-            msg.extract_rgb_image(rgbImage.get());
-            cv::Mat3b cvRGB = OpenCVUtil::make_rgb_image(rgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->noDims.x, rgbImage->noDims.y);
-            cv::imshow("RGB", cvRGB);
-            cv::waitKey(1);
-          #endif
+              std::cout << "Got message: " << msg.extract_frame_index() << std::endl;
+
+            #ifdef WITH_OPENCV
+              static ORUChar4Image_Ptr rgbImage(new ORUChar4Image(get_rgb_image_size(), true, false));
+              msg.extract_rgb_image(rgbImage.get());
+              cv::Mat3b cvRGB = OpenCVUtil::make_rgb_image(rgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->noDims.x, rgbImage->noDims.y);
+              cv::imshow("RGB", cvRGB);
+              cv::waitKey(1);
+            #endif
 #endif
+            }
+
+            // Finally, send an acknowledgement to the client. Pipelined frames receive a cumulative acknowledgement that also tells
+            // the client how much space is left in the frame message queue (which it uses to limit the number of frames in flight).
+            if(interactionType == IT_SENDFRAMEPIPELINED)
+            {
+              FrameAckMessage frameAckMsg;
+              frameAckMsg.set_frame_count(++m_pipelinedFrameCount);
+              frameAckMsg.set_free_slot_count(static_cast<int>(m_frameMessageQueue->pool_size()));
+              m_connectionOk = write_message(frameAckMsg);
+            }
+            else m_connectionOk = write_message(AckMessage());
           }
         }
 
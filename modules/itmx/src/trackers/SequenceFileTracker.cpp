@@ -0,0 +1,48 @@
+/**
+ * itmx: SequenceFileTracker.cpp
+ * Copyright (c) Torr Vision Group, University of Oxford, 2017. All rights reserved.
+ */
+
+#include "trackers/SequenceFileTracker.h"
+using namespace ITMLib;
+
+namespace itmx {
+
+//#################### CONSTRUCTORS ####################
+
+SequenceFileTracker::SequenceFileTracker(const std::string& filename, size_t initialPosition)
+: m_position(initialPosition), m_reader(new SequenceFileReader(filename))
+{}
+
+//#################### PUBLIC MEMBER FUNCTIONS ####################
+
+bool SequenceFileTracker::requiresColourRendering() const
+{
+  return false;
+}
+
+bool SequenceFileTracker::requiresDepthReliability() const
+{
+  return false;
+}
+
+bool SequenceFileTracker::requiresPointCloudRendering() const
+{
+  return false;
+}
+
+void SequenceFileTracker::TrackCamera(ITMTrackingState *trackingState, const ITMView *view)
+{
+  // If we've run out of poses, report a tracking failure (this should only happen if the tracker
+  // is being used with an image source that has more frames than the sequence file).
+  if(m_position >= m_reader->get_frame_count())
+  {
+    trackingState->trackerResult = ITMTrackingState::TRACKING_FAILED;
+    return;
+  }
+
+  *trackingState->pose_d = m_reader->read_pose(m_position++);
+  trackingState->trackerResult = ITMTrackingState::TRACKING_GOOD;
+}
+
+}
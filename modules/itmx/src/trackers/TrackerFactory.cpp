@@ -5,9 +5,12 @@
 
 #include "trackers/TrackerFactory.h"
 
+#include <map>
+
 #include <boost/serialization/extended_type_info.hpp>
 #include <boost/serialization/singleton.hpp>
 #include <boost/serialization/shared_ptr.hpp>
+#include <boost/tokenizer.hpp>
 
 #include <ITMLib/Trackers/ITMTrackerFactory.h>
 using namespace ITMLib;
@@ -21,6 +24,7 @@ using namespace tvgutil;
 
 #include "trackers/GlobalTracker.h"
 #include "trackers/RemoteTracker.h"
+#include "trackers/SequenceFileTracker.h"
 
 #ifdef WITH_OVR
 #include "trackers/RiftTracker.h"
@@ -97,6 +101,27 @@ Tracker_Ptr TrackerFactory::make_simple_tracker(const std::string& trackerType,
   {
     tracker = new RemoteTracker(mappingServer, boost::lexical_cast<int>(trackerParams));
   }
+  else if(trackerType == "sequencefile")
+  {
+    // The parameters are of the form "file=<filename>[,initialFrameNo=<n>]", by analogy with InfiniTAM's file-based tracker.
+    std::map<std::string,std::string> params;
+    typedef boost::char_separator<char> sep;
+    typedef boost::tokenizer<sep> tokenizer;
+    tokenizer tok(trackerParams.begin(), trackerParams.end(), sep(","));
+    for(tokenizer::const_iterator it = tok.begin(), iend = tok.end(); it != iend; ++it)
+    {
+      const size_t equalsPos = it->find('=');
+      if(equalsPos != std::string::npos) params[it->substr(0, equalsPos)] = it->substr(equalsPos + 1);
+    }
+
+    std::map<std::string,std::string>::const_iterator fileIt = params.find("file");
+    if(fileIt == params.end()) throw std::runtime_error("Error: No sequence file was specified for the sequence file tracker");
+
+    std::map<std::string,std::string>::const_iterator initialFrameIt = params.find("initialFrameNo");
+    const size_t initialFrameNo = initialFrameIt != params.end() ? boost::lexical_cast<size_t>(initialFrameIt->second) : 0;
+
+    tracker = new SequenceFileTracker(fileIt->second, initialFrameNo);
+  }
   else if(trackerType == "rift")
   {
 #ifdef WITH_OVR
@@ -0,0 +1,296 @@
+/**
+ * orx: PoseIndex.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2018. All rights reserved.
+ */
+
+#ifndef H_ORX_POSEINDEX
+#define H_ORX_POSEINDEX
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+namespace orx {
+
+/**
+ * \brief An instance of an instantiation of this class template can be used to find those poses in a fixed set
+ *        that are close to a query pose, in terms of both their translations and their rotations.
+ *
+ *        The translations of the poses are stored in a k-d tree, which is used to prune the search. Only the poses
+ *        whose translations are sufficiently close to that of the query pose have their rotations compared with it.
+ *        The index is immutable once constructed, so it can be queried from several threads at once.
+ *
+ *        Each pose is a 4x4 rigid-body transformation matrix. The poses need not be in any particular form
+ *        (e.g. camera -> world or world -> camera), so long as the query poses are in the same form.
+ */
+template <typename T>
+class PoseIndex
+{
+  //#################### TYPEDEFS ####################
+public:
+  typedef Eigen::Matrix<T,3,3> Matrix3;
+  typedef Eigen::Matrix<T,4,4> Pose;
+  typedef Eigen::Matrix<T,3,1> Vector3;
+
+private:
+  /** A (translation distance, pose index) pair, used to rank the poses found by a nearest neighbour search. */
+  typedef std::pair<T,size_t> Neighbour;
+
+  /** A max-heap of the nearest neighbours found so far (the furthest of them is at the top). */
+  typedef std::priority_queue<Neighbour> NeighbourHeap;
+
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct can be used to compare poses based on one component of their translations.
+   */
+  struct TranslationComparator
+  {
+    /** The component of the translations to compare. */
+    int axis;
+
+    /** The translations of the poses. */
+    const std::vector<Vector3> *translations;
+
+    TranslationComparator(int axis_, const std::vector<Vector3> *translations_)
+    : axis(axis_), translations(translations_)
+    {}
+
+    bool operator()(size_t i, size_t j) const
+    {
+      return (*translations)[i](axis) < (*translations)[j](axis);
+    }
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /**
+   * The indices of the poses, arranged as an implicit k-d tree. The root of the tree for the range [begin,end) is
+   * the pose at the midpoint of the range, the left subtree is [begin,mid) and the right subtree is [mid+1,end).
+   */
+  std::vector<size_t> m_order;
+
+  /** The rotation components of the poses. */
+  std::vector<Matrix3> m_rotations;
+
+  /** The axis along which each node of the k-d tree splits its subtrees (indexed by the node's position in m_order). */
+  std::vector<int> m_splitAxes;
+
+  /** The translation components of the poses. */
+  std::vector<Vector3> m_translations;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs a pose index.
+   *
+   * \param poses The poses to index.
+   */
+  explicit PoseIndex(const std::vector<Pose>& poses)
+  : m_order(poses.size()), m_splitAxes(poses.size(), 0)
+  {
+    m_rotations.reserve(poses.size());
+    m_translations.reserve(poses.size());
+    for(size_t i = 0, size = poses.size(); i < size; ++i)
+    {
+      m_order[i] = i;
+      m_rotations.push_back(poses[i].template block<3,3>(0,0));
+      m_translations.push_back(poses[i].template block<3,1>(0,3));
+    }
+
+    build_tree(0, m_order.size());
+  }
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Computes the angle of the rotation that maps one rotation matrix to another.
+   *
+   * \param r1  The first rotation matrix.
+   * \param r2  The second rotation matrix.
+   * \return    The angle (in radians, in the range [0,pi]) of the rotation that maps r1 to r2.
+   */
+  static T angular_separation(const Matrix3& r1, const Matrix3& r2)
+  {
+    const Matrix3 dr = r2 * r1.transpose();
+    Eigen::AngleAxis<T> aa(dr);
+    return aa.angle();
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Finds the k poses whose translations are closest to that of a query pose, considering only those poses
+   *        that are within the specified translation distance and rotation angle of the query pose.
+   *
+   * \param query           The query pose.
+   * \param k               The maximum number of poses to find.
+   * \param maxTranslation  The maximum distance between the translation of a pose and that of the query pose.
+   * \param maxAngle        The maximum angle (in radians) between the rotation of a pose and that of the query pose.
+   * \return                The indices of the poses found, in increasing order of translation distance from the query pose.
+   */
+  std::vector<size_t> find_nearest_poses(const Pose& query, size_t k, T maxTranslation = std::numeric_limits<T>::max(),
+                                         T maxAngle = std::numeric_limits<T>::max()) const
+  {
+    NeighbourHeap neighbours;
+    if(k > 0) find_nearest_poses_sub(0, m_order.size(), query.template block<3,3>(0,0), query.template block<3,1>(0,3), k, maxTranslation, maxAngle, neighbours);
+
+    std::vector<size_t> result(neighbours.size());
+    for(size_t i = result.size(); i > 0; --i)
+    {
+      result[i - 1] = neighbours.top().second;
+      neighbours.pop();
+    }
+
+    return result;
+  }
+
+  /**
+   * \brief Finds all of the poses that are within the specified translation distance and rotation angle of a query pose.
+   *
+   * \param query           The query pose.
+   * \param maxTranslation  The maximum distance between the translation of a pose and that of the query pose.
+   * \param maxAngle        The maximum angle (in radians) between the rotation of a pose and that of the query pose.
+   * \return                The indices of the poses found, in increasing order (i.e. in the order in which the poses were
+   *                        originally specified, so that callers can process them exactly as they would with a linear scan).
+   */
+  std::vector<size_t> find_poses_within(const Pose& query, T maxTranslation, T maxAngle) const
+  {
+    std::vector<size_t> result;
+    find_poses_within_sub(0, m_order.size(), query.template block<3,3>(0,0), query.template block<3,1>(0,3), maxTranslation, maxAngle, result);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  /**
+   * \brief Gets the number of poses in the index.
+   *
+   * \return  The number of poses in the index.
+   */
+  size_t size() const
+  {
+    return m_order.size();
+  }
+
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Builds the k-d tree for the specified range of m_order.
+   *
+   * \param begin The start of the range.
+   * \param end   The end of the range (exclusive).
+   */
+  void build_tree(size_t begin, size_t end)
+  {
+    if(end - begin <= 1) return;
+
+    // Split along the axis in which the translations in the range are most spread out.
+    Vector3 lo = m_translations[m_order[begin]], hi = lo;
+    for(size_t i = begin + 1; i < end; ++i)
+    {
+      lo = lo.cwiseMin(m_translations[m_order[i]]);
+      hi = hi.cwiseMax(m_translations[m_order[i]]);
+    }
+
+    int axis;
+    (hi - lo).maxCoeff(&axis);
+
+    // Partition the range about its median along that axis, and recursively build the subtrees.
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end, TranslationComparator(axis, &m_translations));
+    m_splitAxes[mid] = axis;
+
+    build_tree(begin, mid);
+    build_tree(mid + 1, end);
+  }
+
+  /**
+   * \brief Finds the nearest poses to a query pose within the specified subtree of the k-d tree.
+   *
+   * \param begin           The start of the range of m_order corresponding to the subtree.
+   * \param end             The end of the range (exclusive).
+   * \param r               The rotation component of the query pose.
+   * \param t               The translation component of the query pose.
+   * \param k               The maximum number of poses to find.
+   * \param maxTranslation  The maximum distance between the translation of a pose and that of the query pose.
+   * \param maxAngle        The maximum angle (in radians) between the rotation of a pose and that of the query pose.
+   * \param neighbours      The nearest neighbours found so far (will be updated).
+   */
+  void find_nearest_poses_sub(size_t begin, size_t end, const Matrix3& r, const Vector3& t, size_t k,
+                              T maxTranslation, T maxAngle, NeighbourHeap& neighbours) const
+  {
+    if(begin >= end) return;
+
+    // Check whether the pose at the root of the subtree is closer than the furthest neighbour found so far.
+    const size_t mid = begin + (end - begin) / 2;
+    const size_t i = m_order[mid];
+    const T dist = (m_translations[i] - t).norm();
+    if(dist <= maxTranslation && (neighbours.size() < k || dist < neighbours.top().first) && angular_separation(m_rotations[i], r) <= maxAngle)
+    {
+      neighbours.push(std::make_pair(dist, i));
+      if(neighbours.size() > k) neighbours.pop();
+    }
+
+    // Search the subtree on the same side of the splitting plane as the query first, since it is the more likely to contain
+    // close poses, and then search the other subtree if it could still contain a pose that is closer than the furthest so far.
+    const int axis = m_splitAxes[mid];
+    const T diff = t(axis) - m_translations[i](axis);
+    const bool queryIsLeft = diff <= 0;
+
+    if(queryIsLeft) find_nearest_poses_sub(begin, mid, r, t, k, maxTranslation, maxAngle, neighbours);
+    else find_nearest_poses_sub(mid + 1, end, r, t, k, maxTranslation, maxAngle, neighbours);
+
+    const T bound = neighbours.size() < k ? maxTranslation : neighbours.top().first;
+    if(std::abs(diff) <= bound)
+    {
+      if(queryIsLeft) find_nearest_poses_sub(mid + 1, end, r, t, k, maxTranslation, maxAngle, neighbours);
+      else find_nearest_poses_sub(begin, mid, r, t, k, maxTranslation, maxAngle, neighbours);
+    }
+  }
+
+  /**
+   * \brief Finds all of the poses within the specified subtree of the k-d tree that are close to a query pose.
+   *
+   * \param begin           The start of the range of m_order corresponding to the subtree.
+   * \param end             The end of the range (exclusive).
+   * \param r               The rotation component of the query pose.
+   * \param t               The translation component of the query pose.
+   * \param maxTranslation  The maximum distance between the translation of a pose and that of the query pose.
+   * \param maxAngle        The maximum angle (in radians) between the rotation of a pose and that of the query pose.
+   * \param result          The vector to which to add the indices of any poses found.
+   */
+  void find_poses_within_sub(size_t begin, size_t end, const Matrix3& r, const Vector3& t, T maxTranslation, T maxAngle, std::vector<size_t>& result) const
+  {
+    if(begin >= end) return;
+
+    // Check the pose at the root of the subtree (the rotation check is more expensive, so only do it if the translation check passes).
+    const size_t mid = begin + (end - begin) / 2;
+    const size_t i = m_order[mid];
+    if((m_translations[i] - t).norm() <= maxTranslation && angular_separation(m_rotations[i], r) <= maxAngle)
+    {
+      result.push_back(i);
+    }
+
+    // Search any subtree that could contain poses within range of the query. The translations in the left subtree
+    // are no greater than that of the root along the splitting axis, and those in the right subtree are no less.
+    const int axis = m_splitAxes[mid];
+    const T diff = t(axis) - m_translations[i](axis);
+    if(diff <= maxTranslation) find_poses_within_sub(begin, mid, r, t, maxTranslation, maxAngle, result);
+    if(-diff <= maxTranslation) find_poses_within_sub(mid + 1, end, r, t, maxTranslation, maxAngle, result);
+  }
+};
+
+//#################### TYPEDEFS ####################
+
+typedef PoseIndex<double> PoseIndexd;
+typedef PoseIndex<float> PoseIndexf;
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * rafl: DescriptorMatrix.h
+ * Copyright (c) Torr Vision Group, University of Oxford, 2015. All rights reserved.
+ */
+
+#ifndef H_RAFL_DESCRIPTORMATRIX
+#define H_RAFL_DESCRIPTORMATRIX
+
+#include <vector>
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace rafl {
+
+/**
+ * \brief An instance of this class stores a set of feature descriptors of the same size contiguously, one descriptor per row.
+ *
+ * Storing descriptors in this way avoids the need for a separate heap allocation per descriptor, and means that examples
+ * whose descriptors are stored in the same matrix refer to adjacent areas of memory. Examples refer to the descriptors in
+ * a matrix by row index (see Example), so rows can be appended to a matrix freely until it is shared with examples, but a
+ * matrix must not be modified thereafter.
+ */
+class DescriptorMatrix
+{
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The features of all of the descriptors, stored in row-major order. */
+  std::vector<float> m_data;
+
+  /** The number of features in each descriptor. */
+  size_t m_featureCount;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty descriptor matrix.
+   *
+   * \param featureCount  The number of features in each descriptor.
+   * \param rowCapacity   The number of descriptors for which to reserve space up-front.
+   */
+  explicit DescriptorMatrix(size_t featureCount, size_t rowCapacity = 0)
+  : m_featureCount(featureCount)
+  {
+    m_data.reserve(rowCapacity * featureCount);
+  }
+
+  /**
+   * \brief Constructs a descriptor matrix by copying descriptors that are stored contiguously in an array.
+   *
+   * \param data          The array containing the descriptors.
+   * \param rowCount      The number of descriptors in the array.
+   * \param featureCount  The number of features in each descriptor.
+   */
+  DescriptorMatrix(const float *data, size_t rowCount, size_t featureCount)
+  : m_data(data, data + rowCount * featureCount), m_featureCount(featureCount)
+  {}
+
+private:
+  /**
+   * \brief Constructs a descriptor matrix.
+   *
+   * Note: This constructor is needed for serialization and should not be used otherwise.
+   */
+  DescriptorMatrix() : m_featureCount(0) {}
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Appends a descriptor to the matrix.
+   *
+   * \param descriptor  A pointer to the features of the descriptor (there must be get_feature_count() of them).
+   * \return            The index of the row containing the new descriptor.
+   */
+  size_t add_row(const float *descriptor)
+  {
+    size_t rowIndex = get_row_count();
+    m_data.insert(m_data.end(), descriptor, descriptor + m_featureCount);
+    return rowIndex;
+  }
+
+  /**
+   * \brief Gets the number of features in each descriptor.
+   *
+   * \return  The number of features in each descriptor.
+   */
+  size_t get_feature_count() const
+  {
+    return m_featureCount;
+  }
+
+  /**
+   * \brief Gets the specified descriptor.
+   *
+   * \param rowIndex  The index of the row containing the descriptor.
+   * \return          A pointer to the features of the descriptor.
+   */
+  const float *get_row(size_t rowIndex) const
+  {
+    return &m_data[rowIndex * m_featureCount];
+  }
+
+  /**
+   * \brief Gets the number of descriptors in the matrix.
+   *
+   * \return  The number of descriptors in the matrix.
+   */
+  size_t get_row_count() const
+  {
+    return m_featureCount != 0 ? m_data.size() / m_featureCount : 0;
+  }
+
+  //#################### SERIALIZATION ####################
+private:
+  /**
+   * \brief Serializes the descriptor matrix to/from an archive.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void serialize(Archive& ar, const unsigned int version)
+  {
+    ar & m_data;
+    ar & m_featureCount;
+  }
+
+  friend class boost::serialization::access;
+};
+
+//#################### TYPEDEFS ####################
+
+typedef boost::shared_ptr<DescriptorMatrix> DescriptorMatrix_Ptr;
+typedef boost::shared_ptr<const DescriptorMatrix> DescriptorMatrix_CPtr;
+
+}
+
+#endif
@@ -6,9 +6,14 @@
 #ifndef H_RAFL_DECISIONTREE
 #define H_RAFL_DECISIONTREE
 
+#include <climits>
 #include <set>
 #include <stdexcept>
 
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
 #include <tvgutil/containers/PriorityQueue.h>
 #include <tvgutil/persistence/PropertyUtil.h>
 
@@ -262,6 +267,7 @@ public:
 private:
   typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
   typedef boost::shared_ptr<Node> Node_Ptr;
+  typedef typename DecisionFunctionGenerator<Label>::Split_CPtr Split_CPtr;
   typedef tvgutil::PriorityQueue<int,float,signed char,std::greater<float> > SplittabilityQueue;
 
   //#################### PRIVATE VARIABLES ####################
@@ -319,6 +325,56 @@ private:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Adds the probability masses for the leaf to which an example with the specified descriptor would be added to a set of masses.
+   *
+   * This is equivalent to adding the masses from the PMF returned by lookup_pmf, but computes the masses directly from the
+   * histogram of the leaf rather than constructing a PMF, and so does not allocate any memory once the set of masses has
+   * grown to contain all of the labels concerned.
+   *
+   * \param descriptor          A pointer to the features of the descriptor.
+   * \param masses              The set of masses, stored in increasing order of label (any new labels are inserted in order).
+   * \throws std::runtime_error If the histogram of the leaf is empty (as lookup_pmf would).
+   */
+  void accumulate_masses(const float *descriptor, std::vector<std::pair<Label,float> >& masses) const
+  {
+    const tvgutil::Histogram<Label>& histogram = *m_nodes[find_leaf(descriptor)]->m_reservoir.get_histogram();
+    const typename tvgutil::Histogram<Label>::Bins& bins = histogram.get_bins();
+    const size_t count = histogram.get_count();
+    if(count == 0) throw std::runtime_error("Cannot make a probability mass function from an empty histogram");
+
+    // Note: The masses are calculated in the same way (and in the same order) as in the ProbabilityMassFunction constructor.
+    float sum = 0.0f;
+    for(typename tvgutil::Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    {
+      float mass = static_cast<float>(it->second) / count;
+      if(m_inverseClassWeights)
+      {
+        typename std::map<Label,float>::const_iterator jt = m_inverseClassWeights->find(it->first);
+        if(jt != m_inverseClassWeights->end()) mass *= jt->second;
+      }
+      sum += mass;
+    }
+
+    for(typename tvgutil::Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    {
+      float mass = static_cast<float>(it->second) / count;
+      if(m_inverseClassWeights)
+      {
+        typename std::map<Label,float>::const_iterator jt = m_inverseClassWeights->find(it->first);
+        if(jt != m_inverseClassWeights->end()) mass *= jt->second;
+
+        // If the masses were reweighted, they need to be renormalised.
+        mass /= sum;
+      }
+
+      typename std::vector<std::pair<Label,float> >::iterator kt = masses.begin(), kend = masses.end();
+      while(kt != kend && kt->first < it->first) ++kt;
+      if(kt != kend && kt->first == it->first) kt->second += mass;
+      else masses.insert(kt, std::make_pair(it->first, mass));
+    }
+  }
+
   /**
    * \brief Adds new training examples to the decision tree.
    *
@@ -430,7 +486,18 @@ public:
    */
   tvgutil::ProbabilityMassFunction<Label> lookup_pmf(const Descriptor_CPtr& descriptor) const
   {
-    int leafIndex = find_leaf(*descriptor);
+    return lookup_pmf(&(*descriptor)[0]);
+  }
+
+  /**
+   * \brief Looks up the probability mass function for the leaf to which an example with the specified descriptor would be added.
+   *
+   * \param descriptor  A pointer to the features of the descriptor (e.g. a row of a descriptor matrix).
+   * \return            The probability mass function for the leaf to which an example with that descriptor would be added.
+   */
+  tvgutil::ProbabilityMassFunction<Label> lookup_pmf(const float *descriptor) const
+  {
+    int leafIndex = find_leaf(descriptor);
     return make_pmf(leafIndex);
   }
 
@@ -455,16 +522,36 @@ public:
     return lookup_pmf(descriptor).calculate_best_label();
   }
 
+  /**
+   * \brief Predicts a label for the specified descriptor.
+   *
+   * \param descriptor  A pointer to the features of the descriptor (e.g. a row of a descriptor matrix).
+   * \return            The predicted label.
+   */
+  Label predict(const float *descriptor) const
+  {
+    return lookup_pmf(descriptor).calculate_best_label();
+  }
+
   /**
    * \brief Trains the tree by splitting a number of suitable nodes.
    *
    * The number of nodes that are split in each training step is limited to ensure that a step is not overly costly.
    *
-   * \param splitBudget The maximum number of nodes that may be split in this training step.
-   * \return            The number of nodes that have been split.
+   * If parallel splitting is enabled, the nodes are split in rounds: in each round, the most splittable nodes (up to
+   * the remaining budget) are removed from the queue, the best splits for them are computed in parallel (as OpenMP
+   * tasks, which will be executed by the enclosing thread team if there is one), and the successful splits are then
+   * applied serially in priority order. Each split is given its own random number generator, seeded from the tree's
+   * generator in priority order, so the results do not depend on the order in which the tasks are scheduled.
+   *
+   * \param splitBudget     The maximum number of nodes that may be split in this training step.
+   * \param parallelSplits  Whether or not to compute the splits for multiple nodes in parallel.
+   * \return                The number of nodes that have been split.
    */
-  size_t train(size_t splitBudget)
+  size_t train(size_t splitBudget, bool parallelSplits = false)
   {
+    if(parallelSplits) return train_parallel(splitBudget);
+
     size_t nodesSplit = 0;
 
     // Keep splitting nodes until we either run out of nodes to split or exceed the split budget. In practice,
@@ -503,7 +590,7 @@ private:
   void add_example(const Example_CPtr& example)
   {
     // Find the leaf to which to add the new example.
-    int leafIndex = find_leaf(*example->get_descriptor());
+    int leafIndex = find_leaf(example->get_descriptor_data());
 
     // Add the example to the leaf's reservoir.
     m_nodes[leafIndex]->m_reservoir.add_example(example);
@@ -534,6 +621,122 @@ private:
     return id;
   }
 
+  /**
+   * \brief Splits the node with the specified index using a previously-computed split.
+   *
+   * \param nodeIndex The index of the node to split.
+   * \param split     The split to use.
+   */
+  void apply_split(int nodeIndex, const Split_CPtr& split)
+  {
+    Node& n = *m_nodes[nodeIndex];
+
+    // Set the decision function of the node to be split.
+    n.m_splitter = split->m_decisionFunction;
+
+    // Add left and right child nodes and populate their example reservoirs based on the chosen split.
+    size_t childDepth = n.m_depth + 1;
+    n.m_leftChildIndex = add_node(childDepth);
+    n.m_rightChildIndex = add_node(childDepth);
+    std::map<Label,float> multipliers = n.m_reservoir.get_class_multipliers();
+    fill_reservoir(split->m_leftExamples, multipliers, m_nodes[n.m_leftChildIndex]->m_reservoir);
+    fill_reservoir(split->m_rightExamples, multipliers, m_nodes[n.m_rightChildIndex]->m_reservoir);
+
+    // Update the splittability for the child nodes.
+    update_splittability(n.m_leftChildIndex);
+    update_splittability(n.m_rightChildIndex);
+
+    // Clear the example reservoir in the node that was split.
+    n.m_reservoir.clear();
+  }
+
+  /**
+   * \brief Computes the best split for the node with the specified index.
+   *
+   * \param nodeIndex             The index of the node.
+   * \param randomNumberGenerator The random number generator to use when generating candidate decision functions.
+   * \return                      The best split for the node, if one was suitable, or NULL otherwise.
+   */
+  Split_CPtr compute_split(int nodeIndex, const tvgutil::RandomNumberGenerator_Ptr& randomNumberGenerator) const
+  {
+    return m_settings.decisionFunctionGenerator->split_examples(
+      m_nodes[nodeIndex]->m_reservoir,
+      m_settings.candidateCount,
+      m_settings.gainThreshold,
+      m_inverseClassWeights,
+      randomNumberGenerator
+    );
+  }
+
+  /**
+   * \brief Computes the best splits for the specified nodes in parallel.
+   *
+   * \param nodeIndices The indices of the nodes for which to compute splits.
+   * \param rngs        The random number generators to use for the splits (one per node).
+   * \param splits      An array into which to write the splits (one per node, NULL if a node could not be split).
+   *
+   * \throws std::runtime_error If the split for any of the nodes could not be computed.
+   */
+  void compute_splits(const std::vector<int>& nodeIndices, const std::vector<tvgutil::RandomNumberGenerator_Ptr>& rngs, std::vector<Split_CPtr>& splits) const
+  {
+    // Note: Since exceptions must not escape from an OpenMP task, any errors are recorded and rethrown once all of the tasks have finished.
+    std::vector<std::string> errors(nodeIndices.size());
+
+#ifdef WITH_OPENMP
+    // If we're not already inside a parallel region (e.g. one created by the forest), create one so that the tasks can be executed in parallel.
+    // Note that we check the nesting level rather than using omp_in_parallel, since the latter returns false inside an inactive (e.g.
+    // single-threaded) region.
+    if(omp_get_level() == 0)
+    {
+      #pragma omp parallel
+      #pragma omp single
+      compute_splits_sub(nodeIndices, rngs, splits, errors);
+    }
+    else
+#endif
+    compute_splits_sub(nodeIndices, rngs, splits, errors);
+
+    for(size_t i = 0, size = errors.size(); i < size; ++i)
+    {
+      if(!errors[i].empty()) throw std::runtime_error(errors[i]);
+    }
+  }
+
+  /**
+   * \brief Computes the best splits for the specified nodes, using a separate OpenMP task for each node.
+   *
+   * \param nodeIndices The indices of the nodes for which to compute splits.
+   * \param rngs        The random number generators to use for the splits (one per node).
+   * \param splits      An array into which to write the splits (one per node, NULL if a node could not be split).
+   * \param errors      An array into which to write any errors that occur (one per node, empty if the split was computed successfully).
+   */
+  void compute_splits_sub(const std::vector<int>& nodeIndices, const std::vector<tvgutil::RandomNumberGenerator_Ptr>& rngs,
+                          std::vector<Split_CPtr>& splits, std::vector<std::string>& errors) const
+  {
+    const int nodeCount = static_cast<int>(nodeIndices.size());
+
+    for(int i = 0; i < nodeCount; ++i)
+    {
+#ifdef WITH_OPENMP
+      #pragma omp task firstprivate(i) shared(nodeIndices, rngs, splits, errors)
+#endif
+      {
+        try
+        {
+          splits[i] = compute_split(nodeIndices[i], rngs[i]);
+        }
+        catch(std::exception& e)
+        {
+          errors[i] = e.what();
+        }
+      }
+    }
+
+#ifdef WITH_OPENMP
+    #pragma omp taskwait
+#endif
+  }
+
   /**
    * \brief Fills the specified reservoir with examples sampled from an input set of examples.
    *
@@ -578,10 +781,10 @@ private:
   /**
    * \brief Finds the index of the leaf to which an example with the specified descriptor would currently be added.
    *
-   * \param descriptor  The descriptor.
+   * \param descriptor  A pointer to the features of the descriptor.
    * \return            The index of the leaf to which an example with the descriptor would currently be added.
    */
-  int find_leaf(const Descriptor& descriptor) const
+  int find_leaf(const float *descriptor) const
   {
     int curIndex = m_rootIndex;
     while(!is_leaf(curIndex))
@@ -663,35 +866,69 @@ private:
    */
   bool split_node(int nodeIndex)
   {
-    Node& n = *m_nodes[nodeIndex];
-    typename DecisionFunctionGenerator<Label>::Split_CPtr split = m_settings.decisionFunctionGenerator->split_examples(
-      n.m_reservoir,
-      m_settings.candidateCount,
-      m_settings.gainThreshold,
-      m_inverseClassWeights,
-      m_settings.randomNumberGenerator
-    );
+    Split_CPtr split = compute_split(nodeIndex, m_settings.randomNumberGenerator);
     if(!split) return false;
 
-    // Set the decision function of the node to be split.
-    n.m_splitter = split->m_decisionFunction;
+    apply_split(nodeIndex, split);
+    return true;
+  }
 
-    // Add left and right child nodes and populate their example reservoirs based on the chosen split.
-    size_t childDepth = n.m_depth + 1;
-    n.m_leftChildIndex = add_node(childDepth);
-    n.m_rightChildIndex = add_node(childDepth);
-    std::map<Label,float> multipliers = n.m_reservoir.get_class_multipliers();
-    fill_reservoir(split->m_leftExamples, multipliers, m_nodes[n.m_leftChildIndex]->m_reservoir);
-    fill_reservoir(split->m_rightExamples, multipliers, m_nodes[n.m_rightChildIndex]->m_reservoir);
+  /**
+   * \brief Trains the tree by splitting a number of suitable nodes, computing the splits for multiple nodes in parallel.
+   *
+   * \param splitBudget The maximum number of nodes that may be split in this training step.
+   * \return            The number of nodes that have been split.
+   */
+  size_t train_parallel(size_t splitBudget)
+  {
+    size_t nodesSplit = 0;
+    std::vector<typename SplittabilityQueue::Element> elementsToReAdd;
 
-    // Update the splittability for the child nodes.
-    update_splittability(n.m_leftChildIndex);
-    update_splittability(n.m_rightChildIndex);
+    while(nodesSplit < splitBudget)
+    {
+      // Remove the most splittable nodes (up to the remaining budget) from the queue.
+      std::vector<typename SplittabilityQueue::Element> elements;
+      while(!m_splittabilityQueue.empty() && elements.size() < splitBudget - nodesSplit && m_splittabilityQueue.top().key() >= m_settings.splittabilityThreshold)
+      {
+        elements.push_back(m_splittabilityQueue.top());
+        m_splittabilityQueue.pop();
+      }
 
-    // Clear the example reservoir in the node that was split.
-    n.m_reservoir.clear();
+      if(elements.empty()) break;
 
-    return true;
+      // Give each node its own random number generator, seeded deterministically from the tree's generator.
+      const size_t elementCount = elements.size();
+      std::vector<int> nodeIndices(elementCount);
+      std::vector<tvgutil::RandomNumberGenerator_Ptr> rngs(elementCount);
+      for(size_t i = 0; i < elementCount; ++i)
+      {
+        nodeIndices[i] = elements[i].id();
+        rngs[i].reset(new tvgutil::RandomNumberGenerator(m_settings.randomNumberGenerator->generate_int_from_uniform(0, INT_MAX)));
+      }
+
+      // Compute the splits in parallel.
+      std::vector<Split_CPtr> splits(elementCount);
+      compute_splits(nodeIndices, rngs, splits);
+
+      // Apply the successful splits in priority order, and set aside any nodes that could not be split to be re-added at the end.
+      for(size_t i = 0; i < elementCount; ++i)
+      {
+        if(splits[i])
+        {
+          apply_split(nodeIndices[i], splits[i]);
+          ++nodesSplit;
+        }
+        else elementsToReAdd.push_back(elements[i]);
+      }
+    }
+
+    // Re-add any elements corresponding to nodes that could not be successfully split in this training step.
+    for(typename std::vector<typename SplittabilityQueue::Element>::iterator it = elementsToReAdd.begin(), iend = elementsToReAdd.end(); it != iend; ++it)
+    {
+      m_splittabilityQueue.insert(it->id(), it->key(), it->data());
+    }
+
+    return nodesSplit;
   }
 
   /**
@@ -740,8 +977,8 @@ private:
 
     float count = static_cast<float>(m_classFrequencies.get_count());
 
-    const std::map<Label,size_t>& bins = m_classFrequencies.get_bins();
-    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    const typename tvgutil::Histogram<Label>::Bins& bins = m_classFrequencies.get_bins();
+    for(typename tvgutil::Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
     {
       (*m_inverseClassWeights)[it->first] = count / it->second;
     }
@@ -6,6 +6,10 @@
 #ifndef H_RAFL_RANDOMFOREST
 #define H_RAFL_RANDOMFOREST
 
+#include <climits>
+
+#include <boost/serialization/version.hpp>
+
 #include "DecisionTree.h"
 
 namespace rafl {
@@ -25,6 +29,9 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** Whether or not to train the trees (and split the nodes within each tree) in parallel. */
+  bool m_parallelTraining;
+
   /** The settings needed to configure the decision trees. */
   typename DT::Settings m_settings;
 
@@ -36,15 +43,19 @@ public:
   /**
    * \brief Constructs a random forest.
    *
-   * \param treeCount The number of decision trees to use in the random forest.
-   * \param settings  The settings needed to configure the decision trees.
+   * Each tree is given its own random number generator, seeded deterministically from the generator in the settings,
+   * so that the trees can be trained independently (and reproducibly), whether or not they are trained in parallel.
+   *
+   * \param treeCount         The number of decision trees to use in the random forest.
+   * \param settings          The settings needed to configure the decision trees.
+   * \param parallelTraining  Whether or not to train the trees (and split the nodes within each tree) in parallel.
    */
-  RandomForest(size_t treeCount, const typename DT::Settings& settings)
-  : m_settings(settings)
+  RandomForest(size_t treeCount, const typename DT::Settings& settings, bool parallelTraining = false)
+  : m_parallelTraining(parallelTraining), m_settings(settings)
   {
     for(size_t i = 0; i < treeCount; ++i)
     {
-      m_trees.push_back(DT_Ptr(new DT(settings)));
+      m_trees.push_back(DT_Ptr(new DT(make_tree_settings())));
     }
   }
 
@@ -54,7 +65,7 @@ private:
    *
    * Note: This constructor is needed for serialization and should not be used otherwise.
    */
-  RandomForest() {}
+  RandomForest() : m_parallelTraining(false) {}
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
@@ -65,11 +76,12 @@ public:
    */
   void add_examples(const std::vector<Example_CPtr>& examples)
   {
-    // Add the new examples to the different trees.
-    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
-    {
-      (*it)->add_examples(examples);
-    }
+    // Create a vector of indices indicating that all the examples should be added to the forest.
+    size_t size = examples.size();
+    std::vector<size_t> indices(size);
+    for(size_t i = 0; i < size; ++i) indices[i] = i;
+
+    add_examples(examples, indices);
   }
 
   /**
@@ -81,10 +93,21 @@ public:
    */
   void add_examples(const std::vector<Example_CPtr>& examples, const std::vector<size_t>& indices)
   {
+    // Check the indices up-front (the trees cannot throw if they are being updated in parallel).
+    for(size_t i = 0, size = indices.size(); i < size; ++i)
+    {
+      if(indices[i] >= examples.size()) throw std::out_of_range("Bad example index");
+    }
+
     // Add the new examples to the different trees.
-    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    const int treeCount = static_cast<int>(m_trees.size());
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel for schedule(dynamic) if(m_parallelTraining)
+#endif
+    for(int i = 0; i < treeCount; ++i)
     {
-      (*it)->add_examples(examples, indices);
+      m_trees[i]->add_examples(examples, indices);
     }
   }
 
@@ -97,6 +120,19 @@ public:
    * \return            The PMF.
    */
   tvgutil::ProbabilityMassFunction<Label> calculate_pmf(const Descriptor_CPtr& descriptor) const
+  {
+    return calculate_pmf(&(*descriptor)[0]);
+  }
+
+  /**
+   * \brief Calculates an overall forest PMF for the specified descriptor.
+   *
+   * This is simply the average of the PMFs for the specified descriptor in the various decision trees.
+   *
+   * \param descriptor  A pointer to the features of the descriptor (e.g. a row of a descriptor matrix).
+   * \return            The PMF.
+   */
+  tvgutil::ProbabilityMassFunction<Label> calculate_pmf(const float *descriptor) const
   {
     // Sum the masses from the individual tree PMFs for the descriptor.
     std::map<Label,float> masses;
@@ -198,6 +234,98 @@ public:
     return calculate_pmf(descriptor).calculate_best_label();
   }
 
+  /**
+   * \brief Predicts a label for the specified descriptor.
+   *
+   * \param descriptor  A pointer to the features of the descriptor (e.g. a row of a descriptor matrix).
+   * \return            The predicted label.
+   */
+  Label predict(const float *descriptor) const
+  {
+    return calculate_pmf(descriptor).calculate_best_label();
+  }
+
+  /**
+   * \brief Predicts labels for a batch of descriptors that are stored contiguously, one descriptor per row.
+   *
+   * The labels predicted are the same as those that would be predicted by calling predict on each descriptor separately.
+   * However, the descriptors are processed in parallel, and rather than constructing a PMF for each descriptor in each
+   * tree, the masses from the trees are accumulated directly into a buffer that is reused for all of the descriptors
+   * processed by a thread, so no memory is allocated per descriptor.
+   *
+   * \param descriptors         A pointer to the descriptors (descriptor i starts at descriptors + i * featureCount).
+   * \param descriptorCount     The number of descriptors.
+   * \param featureCount        The number of features in each descriptor.
+   * \param labels              An array into which to write the predicted labels (one per descriptor).
+   * \throws std::runtime_error If a label cannot be predicted for any of the descriptors (e.g. because one of the leaves
+   *                            reached is empty), in which case the contents of labels are unspecified.
+   */
+  void predict_batch(const float *descriptors, size_t descriptorCount, size_t featureCount, Label *labels) const
+  {
+    const int count = static_cast<int>(descriptorCount);
+    std::string error;
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<std::pair<Label,float> > masses;
+
+#ifdef WITH_OPENMP
+      #pragma omp for
+#endif
+      for(int i = 0; i < count; ++i)
+      {
+        // Sum the masses from the individual trees for the descriptor. Since exceptions must not escape from
+        // an OpenMP region, we record the first error (if any) and rethrow it once the region has finished.
+        masses.clear();
+        try
+        {
+          for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+          {
+            (*it)->accumulate_masses(descriptors + i * featureCount, masses);
+          }
+        }
+        catch(std::exception& e)
+        {
+#ifdef WITH_OPENMP
+          #pragma omp critical(rafl_RandomForest_predict_batch)
+#endif
+          if(error.empty()) error = e.what();
+
+          continue;
+        }
+
+        // If there are no masses (e.g. because the forest contains no trees), no label can be predicted.
+        if(masses.empty()) continue;
+
+        // Pick the label with the largest mass (as in ArgUtil::argmax, ties are resolved in favour of the smallest label).
+        typename std::vector<std::pair<Label,float> >::const_iterator best = masses.begin();
+        for(typename std::vector<std::pair<Label,float> >::const_iterator jt = masses.begin(), jend = masses.end(); jt != jend; ++jt)
+        {
+          if(jt->second > best->second) best = jt;
+        }
+
+        labels[i] = best->first;
+      }
+    }
+
+    if(!error.empty()) throw std::runtime_error(error);
+    if(count > 0 && m_trees.empty()) throw std::runtime_error("Cannot predict labels using a forest that contains no trees");
+  }
+
+  /**
+   * \brief Predicts labels for a batch of descriptors that are stored in a descriptor matrix.
+   *
+   * \param descriptors The descriptor matrix.
+   * \param labels      An array into which to write the predicted labels (one per row of the matrix).
+   */
+  void predict_batch(const DescriptorMatrix& descriptors, Label *labels) const
+  {
+    if(descriptors.get_row_count() == 0) return;
+    predict_batch(descriptors.get_row(0), descriptors.get_row_count(), descriptors.get_feature_count(), labels);
+  }
+
   /**
    * \brief Resets the specified tree.
    *
@@ -206,7 +334,7 @@ public:
    */
   void reset_tree(size_t treeIndex)
   {
-    if(treeIndex < m_trees.size()) m_trees[treeIndex].reset(new DT(m_settings));
+    if(treeIndex < m_trees.size()) m_trees[treeIndex].reset(new DT(make_tree_settings()));
     else throw std::runtime_error("Bad tree index whilst trying to reset tree");
   }
 
@@ -215,19 +343,78 @@ public:
    *
    * The number of nodes that are split in each training step is limited to ensure that a step is not overly costly.
    *
+   * Each tree is trained in a separate OpenMP task, and the node splits within each tree are themselves computed
+   * in nested tasks. If parallel training is enabled, the tasks are executed by a team of threads, so the work is
+   * balanced dynamically across the threads in the team; otherwise, they are executed one at a time by the calling
+   * thread. Since each tree has its own random number generator, and the splits within each tree are seeded from it
+   * in priority order, the trees produced are the same in either case.
+   *
    * \param splitBudget The maximum number of nodes per tree that may be split in this training step.
    * \return            The total number of nodes that have been split across all the trees.
+   *
+   * \throws std::runtime_error If any of the trees could not be trained.
    */
   size_t train(size_t splitBudget)
   {
+    const int treeCount = static_cast<int>(m_trees.size());
+    std::vector<size_t> nodesSplitPerTree(treeCount, 0);
+
+    // Note: Since exceptions must not escape from an OpenMP task, any errors are recorded and rethrown once all of the trees have been trained.
+    std::vector<std::string> errors(treeCount);
+
+#ifdef WITH_OPENMP
+    #pragma omp parallel if(m_parallelTraining)
+    #pragma omp single
+#endif
+    {
+      for(int i = 0; i < treeCount; ++i)
+      {
+#ifdef WITH_OPENMP
+        #pragma omp task firstprivate(i) shared(nodesSplitPerTree, errors)
+#endif
+        {
+          try
+          {
+            nodesSplitPerTree[i] = m_trees[i]->train(splitBudget, true);
+          }
+          catch(std::exception& e)
+          {
+            errors[i] = e.what();
+          }
+        }
+      }
+
+#ifdef WITH_OPENMP
+      #pragma omp taskwait
+#endif
+    }
+
     size_t nodesSplit = 0;
-    for(typename std::vector<DT_Ptr>::const_iterator it = m_trees.begin(), iend = m_trees.end(); it != iend; ++it)
+    for(int i = 0; i < treeCount; ++i)
     {
-      nodesSplit += (*it)->train(splitBudget);
+      if(!errors[i].empty()) throw std::runtime_error(errors[i]);
+      nodesSplit += nodesSplitPerTree[i];
     }
     return nodesSplit;
   }
 
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Makes the settings for a new tree in the forest.
+   *
+   * \return  The settings for the new tree.
+   */
+  typename DT::Settings make_tree_settings() const
+  {
+    typename DT::Settings treeSettings = m_settings;
+
+    // Give the tree its own random number generator, so that it can be trained independently of the other trees.
+    treeSettings.randomNumberGenerator.reset(new tvgutil::RandomNumberGenerator(m_settings.randomNumberGenerator->generate_int_from_uniform(0, INT_MAX)));
+
+    return treeSettings;
+  }
+
   //#################### SERIALIZATION ####################
 private:
   /**
@@ -241,6 +428,12 @@ private:
   {
     ar & m_settings;
     ar & m_trees;
+
+    // The parallel training flag was introduced in version 1 of the file format (older forests are trained serially).
+    if(version >= 1)
+    {
+      ar & m_parallelTraining;
+    }
   }
 
   friend class boost::serialization::access;
@@ -248,4 +441,21 @@ private:
 
 }
 
+//#################### SERIALIZATION VERSIONS ####################
+
+namespace boost { namespace serialization {
+
+/**
+ * \brief Specifies the current file format version number for random forests.
+ */
+template <typename Label>
+struct version<rafl::RandomForest<Label> >
+{
+  typedef mpl::int_<1> type;
+  typedef mpl::integral_c_tag tag;
+  BOOST_STATIC_CONSTANT(int, value = version::type::value);
+};
+
+}}
+
 #endif
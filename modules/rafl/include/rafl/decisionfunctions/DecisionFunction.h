@@ -54,10 +54,10 @@ public:
   /**
    * \brief Classifies the specified descriptor using the decision function.
    *
-   * \param descriptor  The descriptor to classify.
+   * \param descriptor  A pointer to the features of the descriptor to classify (e.g. a row of a descriptor matrix).
    * \return            DC_LEFT, if the descriptor should be sent down the left subtree of the node, or DC_RIGHT otherwise.
    */
-  virtual DescriptorClassification classify_descriptor(const Descriptor& descriptor) const = 0;
+  virtual DescriptorClassification classify_descriptor(const float *descriptor) const = 0;
 
   /**
    * \brief Outputs the decision function to the specified stream.
@@ -66,6 +66,19 @@ public:
    */
   virtual void output(std::ostream& os) const = 0;
 
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Classifies the specified descriptor using the decision function.
+   *
+   * \param descriptor  The descriptor to classify.
+   * \return            DC_LEFT, if the descriptor should be sent down the left subtree of the node, or DC_RIGHT otherwise.
+   */
+  DescriptorClassification classify_descriptor(const Descriptor& descriptor) const
+  {
+    return classify_descriptor(&descriptor[0]);
+  }
+
   //#################### SERIALIZATION #################### 
 private:
   /**
@@ -52,11 +52,6 @@ public:
   typedef boost::shared_ptr<Split> Split_Ptr;
   typedef boost::shared_ptr<const Split> Split_CPtr;
 
-  //#################### PRIVATE VARIABLES ####################
-private:
-  /* The split candidates. */
-  mutable std::vector<Split> m_splitCandidates;
-
   //#################### DESTRUCTOR ####################
 public:
   /**
@@ -94,6 +89,9 @@ public:
   /**
    * \brief Tries to pick an appropriate way in which to split the specified reservoir of examples.
    *
+   * \note  This function can safely be called concurrently (e.g. when training multiple trees in parallel), provided
+   *        that each caller passes in its own random number generator.
+   *
    * \param reservoir             The reservoir of examples to split.
    * \param candidateCount        The number of candidates to evaluate.
    * \param gainThreshold         The minimum information gain that must be obtained from a split to make it worthwhile.
@@ -111,14 +109,19 @@ public:
     std::cout << "\nP: " << *reservoir.get_histogram() << ' ' << initialEntropy << '\n';
 #endif
 
-    // Generate the split candidates.
-    if(static_cast<int>(m_splitCandidates.size()) != candidateCount) m_splitCandidates.resize(candidateCount);
+    // Generate the candidate decision functions.
+    std::vector<DecisionFunction_Ptr> candidates(candidateCount);
     for(int i = 0; i < candidateCount; ++i)
     {
-      m_splitCandidates[i].m_decisionFunction = generate_candidate_decision_function(examples, randomNumberGenerator);
+      candidates[i] = generate_candidate_decision_function(examples, randomNumberGenerator);
     }
 
-    // Pick the best split candidate and return it.
+    // Determine the multipliers to use when calculating the entropies of the two halves of each split (these are the same for all of the candidates).
+    // Note: These are wrapped in an optional up-front to avoid the need to copy them for every entropy calculation.
+    boost::optional<std::map<Label,float> > multipliers = reservoir.get_class_multipliers();
+    if(inverseClassWeights) multipliers = combine_multipliers(*multipliers, *inverseClassWeights);
+
+    // Pick the best candidate.
     float bestGain = static_cast<float>(INT_MIN);
     int bestIndex = -1;
 
@@ -134,34 +137,35 @@ public:
 #endif
 
 #if 0
-      std::cout << *splitCandidate->m_decisionFunction << '\n';
+      std::cout << *candidates[i] << '\n';
 #endif
 
-      // Partition the examples using the split candidate's decision function.
-      m_splitCandidates[i].m_leftExamples.clear();
-      m_splitCandidates[i].m_rightExamples.clear();
+      // Make histograms of the labels of the examples that the candidate's decision function would send left and right.
+      // Note: Only the label distributions are needed to score a candidate, so there is no need to partition the examples themselves at this stage.
+      tvgutil::Histogram<Label> leftHistogram, rightHistogram;
       for(size_t j = 0, size = examples.size(); j < size; ++j)
       {
-        if(m_splitCandidates[i].m_decisionFunction->classify_descriptor(*examples[j]->get_descriptor()) == DecisionFunction::DC_LEFT)
+        if(candidates[i]->classify_descriptor(examples[j]->get_descriptor_data()) == DecisionFunction::DC_LEFT)
         {
-          m_splitCandidates[i].m_leftExamples.push_back(examples[j]);
+          leftHistogram.add(examples[j]->get_label());
         }
         else
         {
-          m_splitCandidates[i].m_rightExamples.push_back(examples[j]);
+          rightHistogram.add(examples[j]->get_label());
         }
       }
 
       // Calculate the information gain we would obtain from this split.
-      float gain = calculate_information_gain(reservoir, initialEntropy, m_splitCandidates[i].m_leftExamples, m_splitCandidates[i].m_rightExamples, inverseClassWeights);
+      float gain = calculate_information_gain(reservoir, initialEntropy, leftHistogram, rightHistogram, multipliers);
 
 #ifdef WITH_OPENMP
       #pragma omp critical
 #endif
       {
-        if(gain > bestGain)
+        // Note: Ties are broken in favour of the candidate with the lowest index, so that the result does not depend on the thread scheduling.
+        if(gain > bestGain || (gain == bestGain && i < bestIndex))
         {
-          if(gain > gainThreshold && !m_splitCandidates[i].m_leftExamples.empty() && !m_splitCandidates[i].m_rightExamples.empty())
+          if(gain > gainThreshold && !leftHistogram.empty() && !rightHistogram.empty())
           {
             bestGain = gain;
             bestIndex = i;
@@ -170,11 +174,25 @@ public:
       }
     }
 
-    Split_Ptr bestSplitCandidate;
-    if(bestIndex != -1) bestSplitCandidate.reset(new Split(m_splitCandidates[bestIndex]));
+    // If no candidate had a high enough gain, early out.
+    if(bestIndex == -1) return Split_CPtr();
+
+    // Otherwise, partition the examples using the decision function of the best candidate, and return the resulting split.
+    Split_Ptr bestSplit(new Split);
+    bestSplit->m_decisionFunction = candidates[bestIndex];
+    for(size_t j = 0, size = examples.size(); j < size; ++j)
+    {
+      if(bestSplit->m_decisionFunction->classify_descriptor(examples[j]->get_descriptor_data()) == DecisionFunction::DC_LEFT)
+      {
+        bestSplit->m_leftExamples.push_back(examples[j]);
+      }
+      else
+      {
+        bestSplit->m_rightExamples.push_back(examples[j]);
+      }
+    }
 
-    // Return a split candidate that had maximum gain (note that this may be NULL if no split had a high enough gain).
-    return bestSplitCandidate;
+    return bestSplit;
   }
 
   //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
@@ -182,27 +200,26 @@ private:
   /**
    * \brief Calculates the information gain that results from splitting an example reservoir in a particular way.
    *
-   * \param reservoir           The reservoir.
-   * \param initialEntropy      The entropy of the example set before the split.
-   * \param leftExamples        The examples that end up in the left half of the split.
-   * \param rightExamples       The examples that end up in the right half of the split.
-   * \param inverseClassWeights The (optional) inverses of the L1-normalised class frequencies observed in the training data.
-   * \return                    The information gain resulting from the split.
+   * \param reservoir       The reservoir.
+   * \param initialEntropy  The entropy of the example set before the split.
+   * \param leftHistogram   A histogram of the labels of the examples that end up in the left half of the split.
+   * \param rightHistogram  A histogram of the labels of the examples that end up in the right half of the split.
+   * \param multipliers     The per-class ratios to use to scale the probabilities for the different labels.
+   * \return                The information gain resulting from the split.
    */
-  static float calculate_information_gain(const ExampleReservoir<Label>& reservoir, float initialEntropy, const std::vector<Example_CPtr>& leftExamples, const std::vector<Example_CPtr>& rightExamples, const boost::optional<std::map<Label,float> >& inverseClassWeights)
+  static float calculate_information_gain(const ExampleReservoir<Label>& reservoir, float initialEntropy, const tvgutil::Histogram<Label>& leftHistogram, const tvgutil::Histogram<Label>& rightHistogram,
+                                          const boost::optional<std::map<Label,float> >& multipliers)
   {
     float exampleCount = static_cast<float>(reservoir.current_size());
-    std::map<Label,float> multipliers = reservoir.get_class_multipliers();
-    if(inverseClassWeights) multipliers = combine_multipliers(multipliers, *inverseClassWeights);
 
-    float leftEntropy = ExampleUtil::calculate_entropy(leftExamples, multipliers);
-    float rightEntropy = ExampleUtil::calculate_entropy(rightExamples, multipliers);
-    float leftWeight = leftExamples.size() / exampleCount;
-    float rightWeight = rightExamples.size() / exampleCount;
+    float leftEntropy = ExampleUtil::calculate_entropy(leftHistogram, multipliers);
+    float rightEntropy = ExampleUtil::calculate_entropy(rightHistogram, multipliers);
+    float leftWeight = leftHistogram.get_count() / exampleCount;
+    float rightWeight = rightHistogram.get_count() / exampleCount;
 
 #if 0
-    std::cout << "L: " << ExampleUtil::make_histogram(leftExamples) << ' ' << leftEntropy << '\n';
-    std::cout << "R: " << ExampleUtil::make_histogram(rightExamples) << ' ' << rightEntropy << '\n';
+    std::cout << "L: " << leftHistogram << ' ' << leftEntropy << '\n';
+    std::cout << "R: " << rightHistogram << ' ' << rightEntropy << '\n';
 #endif
 
     float gain = initialEntropy - (leftWeight * leftEntropy + rightWeight * rightEntropy);
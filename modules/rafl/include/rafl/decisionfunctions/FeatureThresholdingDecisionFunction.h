@@ -45,8 +45,10 @@ private:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  using DecisionFunction::classify_descriptor;
+
   /** Override */
-  virtual DescriptorClassification classify_descriptor(const Descriptor& descriptor) const;
+  virtual DescriptorClassification classify_descriptor(const float *descriptor) const;
 
   /** Override */
   virtual void output(std::ostream& os) const;
@@ -69,7 +69,7 @@ public:
   {
     assert(!examples.empty());
 
-    int descriptorSize = static_cast<int>(examples[0]->get_descriptor()->size());
+    int descriptorSize = static_cast<int>(examples[0]->get_descriptor_size());
 
     // Pick a random feature in the descriptor to threshold.
     std::pair<int,int> featureIndexRange = this->get_feature_index_range(descriptorSize);
@@ -78,7 +78,7 @@ public:
     // Select an appropriate threshold by picking a random example and using
     // the value of the chosen feature from that example as the threshold.
     int exampleIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(examples.size()) - 1);
-    float threshold = (*examples[exampleIndex]->get_descriptor())[featureIndex];
+    float threshold = examples[exampleIndex]->get_descriptor_data()[featureIndex];
 
     return DecisionFunction_Ptr(new FeatureThresholdingDecisionFunction(featureIndex, threshold));
   }
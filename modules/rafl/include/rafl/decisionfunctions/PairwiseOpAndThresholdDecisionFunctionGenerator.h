@@ -69,7 +69,7 @@ public:
   {
     assert(!examples.empty());
 
-    int descriptorSize = static_cast<int>(examples[0]->get_descriptor()->size());
+    int descriptorSize = static_cast<int>(examples[0]->get_descriptor_size());
     std::pair<int,int> featureIndexRange = this->get_feature_index_range(descriptorSize);
 
     // Pick the first random feature in the descriptor.
@@ -86,7 +86,7 @@ public:
     // the result of applying the pairwise operation to the chosen features
     // from that example as the threshold.
     int exampleIndex = randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(examples.size()) - 1);
-    const Descriptor& descriptor = (*examples[exampleIndex]->get_descriptor());
+    const float *descriptor = examples[exampleIndex]->get_descriptor_data();
     float threshold = PairwiseOpAndThresholdDecisionFunction::apply_op(op, descriptor[firstFeatureIndex], descriptor[secondFeatureIndex]);
 
     return DecisionFunction_Ptr(new PairwiseOpAndThresholdDecisionFunction(
@@ -7,29 +7,45 @@
 #define H_RAFL_EXAMPLE
 
 #include <ostream>
+#include <stdexcept>
 
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <tvgutil/containers/LimitedContainer.h>
 
 #include "../base/Descriptor.h"
+#include "../base/DescriptorMatrix.h"
 
 namespace rafl {
 
 /**
  * \brief An instance of an instantiation of this class template represents a training example for a random forest.
+ *
+ * The feature descriptor for an example is either stored separately, or as a row of a descriptor matrix that is shared
+ * with other examples. The latter avoids the need for a separate heap allocation per descriptor when a large number of
+ * examples are made at once from descriptors that are already stored contiguously. However, an example that refers to
+ * a descriptor matrix keeps the whole matrix alive, so examples that need to be kept for a long time (e.g. in reservoirs)
+ * should first be converted to standalone examples (see make_standalone).
  */
 template <typename Label>
 class Example
 {
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The feature descriptor for the example. */
+  /** The feature descriptor for the example (if it is stored separately). */
   Descriptor_CPtr m_descriptor;
 
+  /** The descriptor matrix containing the feature descriptor for the example (if it is stored in a matrix). */
+  DescriptorMatrix_CPtr m_descriptorMatrix;
+
   /** The label for the example. */
   Label m_label;
 
+  /** The index of the row of the descriptor matrix that contains the feature descriptor for the example (if it is stored in a matrix). */
+  size_t m_rowIndex;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -39,7 +55,18 @@ public:
    * \param label       The label for the example.
    */
   Example(const Descriptor_CPtr& descriptor, const Label& label)
-  : m_descriptor(descriptor), m_label(label)
+  : m_descriptor(descriptor), m_label(label), m_rowIndex(0)
+  {}
+
+  /**
+   * \brief Constructs an example whose feature descriptor is stored in a descriptor matrix.
+   *
+   * \param descriptorMatrix  The descriptor matrix containing the feature descriptor for the example.
+   * \param rowIndex          The index of the row of the matrix that contains the feature descriptor for the example.
+   * \param label             The label for the example.
+   */
+  Example(const DescriptorMatrix_CPtr& descriptorMatrix, size_t rowIndex, const Label& label)
+  : m_descriptorMatrix(descriptorMatrix), m_label(label), m_rowIndex(rowIndex)
   {}
 
 private:
@@ -48,20 +75,60 @@ private:
    *
    * Note: This constructor is needed for serialization and should not be used otherwise.
    */
-  Example() {}
+  Example() : m_rowIndex(0) {}
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Makes a standalone version of an example, i.e. one whose feature descriptor is stored separately.
+   *
+   * \param example The example.
+   * \return        The example itself, if its feature descriptor is already stored separately, or a copy of it
+   *                whose feature descriptor has been copied out of its descriptor matrix otherwise.
+   */
+  static boost::shared_ptr<const Example> make_standalone(const boost::shared_ptr<const Example>& example)
+  {
+    if(!example->m_descriptorMatrix) return example;
+    return boost::shared_ptr<const Example>(new Example(example->make_descriptor(), example->m_label));
+  }
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
   /**
    * \brief Gets the feature descriptor for the example.
    *
+   * \note  This is only available if the feature descriptor for the example is stored separately. In general,
+   *        get_descriptor_data and get_descriptor_size should be preferred.
+   *
    * \return  The feature descriptor for the example.
+   * \throws std::runtime_error If the feature descriptor for the example is stored in a descriptor matrix.
    */
   const Descriptor_CPtr& get_descriptor() const
   {
+    if(!m_descriptor) throw std::runtime_error("Error: The example's descriptor is stored in a descriptor matrix");
     return m_descriptor;
   }
 
+  /**
+   * \brief Gets the features of the feature descriptor for the example.
+   *
+   * \return  A pointer to the features of the feature descriptor for the example.
+   */
+  const float *get_descriptor_data() const
+  {
+    return m_descriptorMatrix ? m_descriptorMatrix->get_row(m_rowIndex) : &(*m_descriptor)[0];
+  }
+
+  /**
+   * \brief Gets the number of features in the feature descriptor for the example.
+   *
+   * \return  The number of features in the feature descriptor for the example.
+   */
+  size_t get_descriptor_size() const
+  {
+    return m_descriptorMatrix ? m_descriptorMatrix->get_feature_count() : m_descriptor->size();
+  }
+
   /**
    * \brief Gets the label for the example.
    *
@@ -72,21 +139,67 @@ public:
     return m_label;
   }
 
+  //#################### PRIVATE MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Makes a separately-stored copy of the feature descriptor for the example.
+   *
+   * \return  A separately-stored copy of the feature descriptor for the example.
+   */
+  Descriptor_CPtr make_descriptor() const
+  {
+    const float *descriptorData = get_descriptor_data();
+    return Descriptor_CPtr(new Descriptor(descriptorData, descriptorData + get_descriptor_size()));
+  }
+
   //#################### SERIALIZATION ####################
 private:
   /**
-   * \brief Serializes the example to/from an archive.
+   * \brief Loads the example from an archive.
    *
    * \param ar      The archive.
    * \param version The file format version number.
    */
   template <typename Archive>
-  void serialize(Archive& ar, const unsigned int version)
+  void load(Archive& ar, const unsigned int version)
   {
     ar & m_descriptor;
     ar & m_label;
+
+    // In version 1 of the file format (only), examples could refer to descriptor matrices. We load any such matrix,
+    // but only keep a copy of the example's own descriptor, since the matrix may contain many other descriptors.
+    if(version == 1)
+    {
+      ar & m_descriptorMatrix;
+      ar & m_rowIndex;
+
+      if(m_descriptorMatrix)
+      {
+        m_descriptor = make_descriptor();
+        m_descriptorMatrix.reset();
+        m_rowIndex = 0;
+      }
+    }
+  }
+
+  /**
+   * \brief Saves the example to an archive.
+   *
+   * Only the example's own descriptor is saved, even if it is stored in a descriptor matrix.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void save(Archive& ar, const unsigned int version) const
+  {
+    Descriptor_CPtr descriptor = m_descriptorMatrix ? make_descriptor() : m_descriptor;
+    ar & descriptor;
+    ar & m_label;
   }
 
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   friend class boost::serialization::access;
 };
 
@@ -103,10 +216,29 @@ template <typename Label>
 std::ostream& operator<<(std::ostream& os, const Example<Label>& rhs)
 {
   const size_t ELEMENT_DISPLAY_LIMIT = 5;
-  os << tvgutil::make_limited_container(*rhs.get_descriptor(), ELEMENT_DISPLAY_LIMIT) << ' ' << rhs.get_label();
+  const float *descriptorData = rhs.get_descriptor_data();
+  Descriptor descriptor(descriptorData, descriptorData + rhs.get_descriptor_size());
+  os << tvgutil::make_limited_container(descriptor, ELEMENT_DISPLAY_LIMIT) << ' ' << rhs.get_label();
   return os;
 }
 
 }
 
+//#################### SERIALIZATION VERSIONS ####################
+
+namespace boost { namespace serialization {
+
+/**
+ * \brief Specifies the current file format version number for examples.
+ */
+template <typename Label>
+struct version<rafl::Example<Label> >
+{
+  typedef mpl::int_<2> type;
+  typedef mpl::integral_c_tag tag;
+  BOOST_STATIC_CONSTANT(int, value = version::type::value);
+};
+
+}}
+
 #endif
@@ -90,22 +90,24 @@ public:
   {
     bool changed = false;
 
+    // Note: Any example that is stored in the reservoir is first made standalone, since otherwise it might keep alive a
+    //       descriptor matrix containing the descriptors of many other examples that have long since been discarded.
     std::vector<Example_CPtr>& examplesForClass = m_examples[example->get_label()];
     if(examplesForClass.size() < m_maxClassSize)
     {
       // If we haven't yet reached the maximum number of examples for this class, simply add the new one.
-      examplesForClass.push_back(example);
+      examplesForClass.push_back(Example<Label>::make_standalone(example));
       ++m_curSize;
       changed = true;
     }
     else
     {
       // Otherwise, randomly decide whether or not to replace one of the existing examples for this class with the new one.
-      size_t binSize = m_histogram->get_bins().find(example->get_label())->second;
+      size_t binSize = m_histogram->get_bin(example->get_label());
       size_t k = m_randomNumberGenerator->generate_int_from_uniform(0, static_cast<int>(binSize) - 1);
       if(k < examplesForClass.size())
       {
-        examplesForClass[k] = example;
+        examplesForClass[k] = Example<Label>::make_standalone(example);
         changed = true;
       }
     }
@@ -144,9 +146,9 @@ public:
   {
     std::map<Label,float> result;
 
-    const std::map<Label,size_t>& bins = m_histogram->get_bins();
+    const typename tvgutil::Histogram<Label>::Bins& bins = m_histogram->get_bins();
     typename std::map<Label,std::vector<Example_CPtr> >::const_iterator it = m_examples.begin(), iend = m_examples.end();
-    typename std::map<Label,size_t>::const_iterator jt = bins.begin();
+    typename tvgutil::Histogram<Label>::Bins::const_iterator jt = bins.begin();
     for(; it != iend; ++it, ++jt)
     {
       assert(it->first == jt->first);
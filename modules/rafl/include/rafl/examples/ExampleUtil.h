@@ -6,6 +6,7 @@
 #ifndef H_RAFL_EXAMPLEUTIL
 #define H_RAFL_EXAMPLEUTIL
 
+#include <algorithm>
 #include <fstream>
 
 #include <tvgutil/persistence/LineUtil.h>
@@ -20,6 +21,11 @@ namespace rafl {
  */
 class ExampleUtil
 {
+  //#################### CONSTANTS ####################
+private:
+  /** The maximum number of bins in a dense histogram (single-byte labels can take at most 256 distinct values). */
+  enum { MAX_DENSE_BINS = 256 };
+
   //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
 public:
   /**
@@ -33,7 +39,7 @@ public:
   static float calculate_entropy(const std::vector<boost::shared_ptr<const Example<Label> > >& examples,
                                  const typename boost::mpl::identity<boost::optional<std::map<Label,float> > >::type& multipliers = boost::none)
   {
-    return examples.empty() ? 0.0f : make_pmf(examples, multipliers).calculate_entropy();
+    return calculate_entropy(examples, multipliers, typename tvgutil::UseDenseHistogram<Label>::type());
   }
 
   /**
@@ -47,7 +53,7 @@ public:
   static float calculate_entropy(const tvgutil::Histogram<Label>& histogram,
                                  const typename boost::mpl::identity<boost::optional<std::map<Label,float> > >::type& multipliers = boost::none)
   {
-    return histogram.empty() ? 0.0f : tvgutil::ProbabilityMassFunction<Label>(histogram, multipliers).calculate_entropy();
+    return calculate_entropy(histogram, multipliers, typename tvgutil::UseDenseHistogram<Label>::type());
   }
 
   /**
@@ -120,6 +126,122 @@ public:
   {
     return tvgutil::ProbabilityMassFunction<Label>(make_histogram(examples), multipliers);
   }
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Calculates the entropy of the label distribution of a set of examples whose labels do not have a dense histogram representation.
+   */
+  template <typename Label>
+  static float calculate_entropy(const std::vector<boost::shared_ptr<const Example<Label> > >& examples, const boost::optional<std::map<Label,float> >& multipliers, boost::mpl::false_)
+  {
+    return examples.empty() ? 0.0f : make_pmf(examples, multipliers).calculate_entropy();
+  }
+
+  /**
+   * \brief Calculates the entropy of the label distribution of a set of examples whose labels have a dense histogram representation.
+   *
+   * The labels are counted in a fixed-capacity array on the stack, so no memory is allocated.
+   */
+  template <typename Label>
+  static float calculate_entropy(const std::vector<boost::shared_ptr<const Example<Label> > >& examples, const boost::optional<std::map<Label,float> >& multipliers, boost::mpl::true_)
+  {
+    typedef boost::shared_ptr<const Example<Label> > Example_CPtr;
+    typedef tvgutil::Histogram<Label> Histogram;
+
+    if(examples.empty()) return 0.0f;
+
+    size_t counts[MAX_DENSE_BINS];
+    size_t binCount = 0;
+    std::fill(counts, counts + Histogram::capacity(), 0);
+    for(typename std::vector<Example_CPtr>::const_iterator it = examples.begin(), iend = examples.end(); it != iend; ++it)
+    {
+      size_t index = Histogram::label_to_index((*it)->get_label());
+      ++counts[index];
+      if(index >= binCount) binCount = index + 1;
+    }
+
+    return calculate_dense_entropy<Label>(counts, binCount, examples.size(), multipliers);
+  }
+
+  /**
+   * \brief Calculates the entropy of a label distribution represented by a histogram that does not use dense storage.
+   */
+  template <typename Label>
+  static float calculate_entropy(const tvgutil::Histogram<Label>& histogram, const boost::optional<std::map<Label,float> >& multipliers, boost::mpl::false_)
+  {
+    return histogram.empty() ? 0.0f : tvgutil::ProbabilityMassFunction<Label>(histogram, multipliers).calculate_entropy();
+  }
+
+  /**
+   * \brief Calculates the entropy of a label distribution represented by a histogram that uses dense storage.
+   */
+  template <typename Label>
+  static float calculate_entropy(const tvgutil::Histogram<Label>& histogram, const boost::optional<std::map<Label,float> >& multipliers, boost::mpl::true_)
+  {
+    if(histogram.empty()) return 0.0f;
+    const std::vector<size_t>& counts = histogram.get_dense_bins();
+    return calculate_dense_entropy<Label>(&counts[0], counts.size(), histogram.get_count(), multipliers);
+  }
+
+  /**
+   * \brief Calculates the entropy of a label distribution represented by an array of bin counts indexed by label.
+   *
+   * The masses are calculated in the same way (and in the same order) as when constructing a ProbabilityMassFunction
+   * from a histogram, so the result is identical to that obtained via a PMF. However, the masses are stored in a dense
+   * array on the stack (with empty bins given a mass of 0), and each step is a simple loop over that array that the
+   * compiler can vectorise.
+   *
+   * \param counts      The bin counts, indexed by label (see tvgutil::Histogram::label_to_index).
+   * \param binCount    The number of bins.
+   * \param totalCount  The sum of the bin counts (must be > 0).
+   * \param multipliers Optional per-class ratios that can be used to scale the probabilities for the different labels.
+   * \return            The entropy of the label distribution.
+   */
+  template <typename Label>
+  static float calculate_dense_entropy(const size_t *counts, size_t binCount, size_t totalCount, const boost::optional<std::map<Label,float> >& multipliers)
+  {
+    typedef tvgutil::Histogram<Label> Histogram;
+    const int n = static_cast<int>(binCount);
+
+    // Look up the multipliers for the bins (a multiplier of 1 leaves a mass unchanged, so it can be used for labels without one).
+    float binMultipliers[MAX_DENSE_BINS];
+    std::fill(binMultipliers, binMultipliers + n, 1.0f);
+    if(multipliers)
+    {
+      for(typename std::map<Label,float>::const_iterator it = multipliers->begin(), iend = multipliers->end(); it != iend; ++it)
+      {
+        size_t index = Histogram::label_to_index(it->first);
+        if(index < binCount) binMultipliers[index] = it->second;
+      }
+    }
+
+    // Calculate the masses.
+    float masses[MAX_DENSE_BINS];
+    for(int i = 0; i < n; ++i)
+    {
+      masses[i] = static_cast<float>(counts[i]) / totalCount * binMultipliers[i];
+    }
+
+    // If the masses have been scaled, renormalise them.
+    if(multipliers)
+    {
+      float sum = 0.0f;
+      for(int i = 0; i < n; ++i) sum += masses[i];
+      if(fabs(sum) < tvgutil::SMALL_EPSILON) throw std::runtime_error("Cannot normalise the probability mass function: denominator too small");
+      for(int i = 0; i < n; ++i) masses[i] /= sum;
+    }
+
+    // Calculate the entropy (empty bins make no contribution).
+    float entropy = 0.0f;
+    for(int i = 0; i < n; ++i)
+    {
+      float mass = masses[i];
+      entropy += mass > 0 ? mass * log2(mass) : 0.0f;
+    }
+
+    return -entropy;
+  }
 };
 
 }
@@ -17,7 +17,7 @@ FeatureThresholdingDecisionFunction::FeatureThresholdingDecisionFunction(size_t
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-DecisionFunction::DescriptorClassification FeatureThresholdingDecisionFunction::classify_descriptor(const Descriptor& descriptor) const
+DecisionFunction::DescriptorClassification FeatureThresholdingDecisionFunction::classify_descriptor(const float *descriptor) const
 {
   return descriptor[m_featureIndex] < m_threshold ? DC_LEFT : DC_RIGHT;
 }
@@ -23,7 +23,7 @@ PairwiseOpAndThresholdDecisionFunction::PairwiseOpAndThresholdDecisionFunction()
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
-DecisionFunction::DescriptorClassification PairwiseOpAndThresholdDecisionFunction::classify_descriptor(const Descriptor& descriptor) const
+DecisionFunction::DescriptorClassification PairwiseOpAndThresholdDecisionFunction::classify_descriptor(const float *descriptor) const
 {
   float result = apply_op(m_op, descriptor[m_firstFeatureIndex], descriptor[m_secondFeatureIndex]);
   return result < m_threshold ? DC_LEFT : DC_RIGHT;
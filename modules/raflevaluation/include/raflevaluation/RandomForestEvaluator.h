@@ -36,6 +36,12 @@ private:
 
   //#################### PRIVATE VARIABLES ####################
 private:
+  /** Whether or not to train the trees of the random forest in parallel. */
+  bool m_parallelTraining;
+
+  /** The seed from which the seeds for the random number generators used to train the forests for the different splits are derived. */
+  unsigned int m_randomSeed;
+
   /** The settings to use for the random forest. */
   std::map<std::string,std::string> m_settings;
 
@@ -52,14 +58,27 @@ public:
    *
    * \param splitGenerator  The generator to use to split the example set.
    * \param settings        The settings to use for the random forest.
+   *
+   * \note  The "parallelTraining" setting is optional (if it is absent, the forest is trained serially).
+   * \note  The "randomSeed" setting is optional (if it is absent, a seed of 0 is used).
    */
   explicit RandomForestEvaluator(const evaluation::SplitGenerator_Ptr& splitGenerator, const std::map<std::string,std::string>& settings)
-  : Base(splitGenerator), m_settings(settings)
+  : Base(splitGenerator), m_parallelTraining(false), m_randomSeed(0), m_settings(settings)
   {
     #define GET_SETTING(param) tvgutil::MapUtil::typed_lookup(settings, #param, m_##param);
       GET_SETTING(splitBudget);
       GET_SETTING(treeCount);
     #undef GET_SETTING
+
+    if(settings.find("parallelTraining") != settings.end())
+    {
+      tvgutil::MapUtil::typed_lookup(settings, "parallelTraining", m_parallelTraining);
+    }
+
+    if(settings.find("randomSeed") != settings.end())
+    {
+      tvgutil::MapUtil::typed_lookup(settings, "randomSeed", m_randomSeed);
+    }
   }
 
   //#################### PROTECTED MEMBER FUNCTIONS ####################
@@ -71,10 +90,17 @@ protected:
   }
 
   /** Override */
-  virtual ResultType evaluate_on_split(const std::vector<Example_CPtr>& examples, const evaluation::SplitGenerator::Split& split) const
+  virtual ResultType evaluate_on_split(const std::vector<Example_CPtr>& examples, const evaluation::SplitGenerator::Split& split, size_t splitIndex) const
   {
-    // Make a random forest using the specified settings and add the examples in the training set to it.
-    RandomForest_Ptr randomForest(new RandomForest(m_treeCount, typename DecisionTree::Settings(m_settings)));
+    // Make the settings for the random forest. Since the splits may be evaluated in parallel, each split is given its own
+    // random number generator, seeded deterministically from the split index (this also ensures that the forests for the
+    // different splits do not all make the same random choices).
+    typename DecisionTree::Settings treeSettings(m_settings);
+    treeSettings.randomNumberGenerator.reset(new tvgutil::RandomNumberGenerator(m_randomSeed + static_cast<unsigned int>(splitIndex)));
+
+    // Make a random forest using the settings and add the examples in the training set to it. Note that the forest
+    // only stores pointers to the shared examples, so the examples themselves are never copied.
+    RandomForest_Ptr randomForest(new RandomForest(m_treeCount, treeSettings, m_parallelTraining));
     randomForest->add_examples(examples, split.first);
 
     // Train the forest.
@@ -96,7 +122,6 @@ private:
    */
   static ResultType do_evaluation(const RandomForest_Ptr& randomForest, const std::vector<Example_CPtr>& examples, const std::vector<size_t>& indices)
   {
-    std::set<Label> classLabels;
     int indicesSize = static_cast<int>(indices.size());
     std::vector<Label> expectedLabels(indicesSize), predictedLabels(indicesSize);
 
@@ -106,15 +131,13 @@ private:
     for(int i = 0; i < indicesSize; ++i)
     {
       const Example_CPtr& example = examples[indices[i]];
-      predictedLabels[i] = randomForest->predict(example->get_descriptor());
+      predictedLabels[i] = randomForest->predict(example->get_descriptor_data());
       expectedLabels[i] = example->get_label();
-
-#ifdef WITH_OPENMP
-      #pragma omp critical
-#endif
-      classLabels.insert(expectedLabels[i]);
     }
 
+    // Note: We collect the class labels after the parallel loop to avoid contention on a critical section within it.
+    std::set<Label> classLabels(expectedLabels.begin(), expectedLabels.end());
+
     Eigen::MatrixXf confusionMatrix = ConfusionMatrixUtil::make_confusion_matrix(classLabels, expectedLabels, predictedLabels);
     return boost::assign::map_list_of("Accuracy", ConfusionMatrixUtil::calculate_accuracy(ConfusionMatrixUtil::normalise_rows_L1(confusionMatrix)));
   }
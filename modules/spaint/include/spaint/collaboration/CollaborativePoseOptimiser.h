@@ -6,10 +6,12 @@
 #ifndef H_SPAINT_COLLABORATIVEPOSEOPTIMISER
 #define H_SPAINT_COLLABORATIVEPOSEOPTIMISER
 
+#include <map>
 #include <set>
 
 #include <boost/atomic.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 #include <ORUtils/SE3Pose.h>
@@ -28,11 +30,40 @@ public:
   typedef std::pair<std::string,std::string> SceneIDPair;
   typedef std::vector<ORUtils::SE3Pose> SE3PoseCluster;
 
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this struct represents an immutable snapshot of the estimated global poses of the different scenes.
+   *
+   * A new snapshot is published every time the pose graph optimiser updates its estimates. Since snapshots are never modified
+   * after they have been published, readers can hold on to one for as long as they like without locking the optimiser.
+   */
+  struct GlobalPoseSnapshot
+  {
+    /** Estimates of the poses of the different scenes in the global coordinate system. */
+    std::map<std::string,ORUtils::SE3Pose> m_estimatedGlobalPoses;
+
+    /** The version of the snapshot (this increases by one each time a new snapshot is published). */
+    size_t m_version;
+
+    /**
+     * \brief Constructs an empty snapshot.
+     */
+    GlobalPoseSnapshot()
+    : m_version(0)
+    {}
+  };
+
+  typedef boost::shared_ptr<const GlobalPoseSnapshot> GlobalPoseSnapshot_CPtr;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** Estimates of the poses of the different scenes in the global coordinate system. */
   std::map<std::string,ORUtils::SE3Pose> m_estimatedGlobalPoses;
 
+  /** The most recently published snapshot of the estimated global poses (this must only be accessed atomically). */
+  GlobalPoseSnapshot_CPtr m_globalPoseSnapshot;
+
   /** The global poses specifier (if any), or the empty string otherwise. */
   std::string m_globalPosesSpecifier;
 
@@ -103,6 +134,16 @@ public:
    */
   void add_relative_transform_sample(const std::string& sceneI, const std::string& sceneJ, const ORUtils::SE3Pose& sample, CollaborationMode mode);
 
+  /**
+   * \brief Gets the most recently published snapshot of the estimated global poses of the different scenes.
+   *
+   * \note  This does not need to lock the optimiser, so it can cheaply be called every frame (e.g. by a renderer).
+   *        The version of the snapshot can be used to tell whether or not the poses have changed since an earlier call.
+   *
+   * \return  The most recently published snapshot of the estimated global poses.
+   */
+  GlobalPoseSnapshot_CPtr get_global_pose_snapshot() const;
+
   /**
    * \brief Starts the pose graph optimiser.
    *
@@ -118,6 +159,8 @@ public:
   /**
    * \brief Attempts to get the estimated global pose (if any) of the specified scene.
    *
+   * \note  This reads from the most recently published snapshot of the estimated global poses, and so does not lock the optimiser.
+   *
    * \param sceneID The scene whose estimated global pose we want to get.
    * \return        The estimated global pose (if any) of the specified scene, or boost::none otherwise.
    */
@@ -166,6 +209,30 @@ private:
    */
   bool add_relative_transform_sample_sub(const std::string& sceneI, const std::string& sceneJ, const ORUtils::SE3Pose& sample, CollaborationMode mode);
 
+  /**
+   * \brief Optimises the global poses of the scenes in a pose graph, updating only those that can have been affected by the changes since the previous optimisation.
+   *
+   * If the only changes since the previous optimisation are the attachment of new scenes to the graph via edges that do not close
+   * any loops, the optimal poses of the existing scenes cannot have changed, so we hold them fixed and only optimise the poses of
+   * the new scenes. Otherwise, we optimise the whole graph, using the previous estimates (and estimates for any new scenes that are
+   * obtained by chaining relative transforms from scenes with known poses) to initialise it, so that it converges more quickly.
+   *
+   * \param edges           The confident edges in the current pose graph. The value for (scene i, scene j) is the relative transform from scene j to scene i.
+   * \param previousEdges   The confident edges that were used for the previous optimisation.
+   * \param changedPairs    The (unordered) pairs of scenes whose edges have changed since the previous optimisation.
+   * \param previousPoses   The global poses that were estimated by previous optimisations.
+   * \return                The global poses that have been updated by this optimisation.
+   */
+  std::map<std::string,ORUtils::SE3Pose> optimise_global_poses(const std::map<SceneIDPair,ORUtils::SE3Pose>& edges, const std::map<SceneIDPair,ORUtils::SE3Pose>& previousEdges,
+                                                               const std::set<SceneIDPair>& changedPairs, const std::map<std::string,ORUtils::SE3Pose>& previousPoses) const;
+
+  /**
+   * \brief Publishes a new snapshot of the estimated global poses.
+   *
+   * \pre  The caller must hold the synchronisation mutex.
+   */
+  void publish_global_pose_snapshot();
+
   /**
    * \brief Optimises the relative transformations between the different scenes.
    */
@@ -195,6 +262,17 @@ private:
    *                together with the number of samples it is based on, if possible, or boost::none otherwise.
    */
   boost::optional<std::pair<ORUtils::SE3Pose,size_t> > try_get_relative_transform_sub(const std::string& sceneI, const std::string& sceneJ) const;
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Finds the (unordered) pairs of scenes whose edges differ between two sets of pose graph edges.
+   *
+   * \param edges         The first set of edges.
+   * \param previousEdges The second set of edges.
+   * \return              The pairs of scenes whose edges differ (each pair is stored with the smaller scene ID first).
+   */
+  static std::set<SceneIDPair> find_changed_pairs(const std::map<SceneIDPair,ORUtils::SE3Pose>& edges, const std::map<SceneIDPair,ORUtils::SE3Pose>& previousEdges);
 };
 
 //#################### TYPEDEFS ####################
@@ -6,6 +6,8 @@
 #ifndef H_SPAINT_VOPFEATURECALCULATOR_CPU
 #define H_SPAINT_VOPFEATURECALCULATOR_CPU
 
+#include <vector>
+
 #include "../interface/VOPFeatureCalculator.h"
 
 namespace spaint {
@@ -48,6 +50,20 @@ private:
 
   /** Override */
   virtual void update_coordinate_systems(int voxelLocationCount, const ORUtils::MemoryBlock<float>& featuresMB) const;
+
+  //#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+private:
+  /**
+   * \brief Determines an order in which to process the specified voxel locations so that voxels in the same voxel block are processed consecutively.
+   *
+   * Processing the voxels in this order means that the voxel lookups made by each thread tend to access the same voxel blocks
+   * (and hash entries) as the lookups it has just made, which makes much better use of the CPU's caches than processing the
+   * voxels in the (essentially random) order in which they were sampled.
+   *
+   * \param voxelLocationsMB  A memory block containing the voxel locations.
+   * \return                  The indices of the voxel locations, sorted by the voxel blocks that contain them.
+   */
+  static std::vector<int> make_block_order(const ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB);
 };
 
 }
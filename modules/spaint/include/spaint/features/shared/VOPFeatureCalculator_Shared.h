@@ -112,6 +112,38 @@ inline void compute_intensities_for_patch(int tid, const float *features, int fe
   intensityPatch[indexInPatch] = itmx::convert_rgb_to_grey(r, g, b);
 }
 
+/**
+ * \brief Computes the surface normal at the specified voxel from the central differences of the SDF around it.
+ *
+ * This gives the same result as InfiniTAM's computeSingleNormalFromSDF when evaluated at an integer location (at which all of its
+ * trilinear interpolation weights are either 0 or 1), but only reads the six voxels that actually contribute to the result, and
+ * reads them via an index cache, so that voxels in the same voxel block only need a single hash table lookup.
+ *
+ * \param loc         The location of the voxel.
+ * \param voxelData   The scene's voxel data.
+ * \param indexData   The scene's index data.
+ * \return            The (unnormalised) surface normal at the voxel.
+ */
+_CPU_AND_GPU_CODE_
+inline Vector3f compute_surface_normal(const Vector3i& loc, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData)
+{
+  bool isFound;
+  ITMVoxelIndex::IndexCache cache;
+
+  const float xMinus = readVoxel(voxelData, indexData, loc + Vector3i(-1,0,0), isFound, cache).sdf;
+  const float xPlus = readVoxel(voxelData, indexData, loc + Vector3i(1,0,0), isFound, cache).sdf;
+  const float yMinus = readVoxel(voxelData, indexData, loc + Vector3i(0,-1,0), isFound, cache).sdf;
+  const float yPlus = readVoxel(voxelData, indexData, loc + Vector3i(0,1,0), isFound, cache).sdf;
+  const float zMinus = readVoxel(voxelData, indexData, loc + Vector3i(0,0,-1), isFound, cache).sdf;
+  const float zPlus = readVoxel(voxelData, indexData, loc + Vector3i(0,0,1), isFound, cache).sdf;
+
+  return Vector3f(
+    SpaintVoxel::valueToFloat(xPlus - xMinus),
+    SpaintVoxel::valueToFloat(yPlus - yMinus),
+    SpaintVoxel::valueToFloat(zPlus - zMinus)
+  );
+}
+
 /**
  * \brief Writes the height of the specified voxel into the corresponding feature vector for use as an extra feature.
  *
@@ -179,6 +211,11 @@ inline void generate_coordinate_system(int voxelLocationIndex, const Vector3f *s
  *
  * The RGB patches will be stored as the patch segments of the feature descriptors for the various voxels.
  *
+ * Neighbouring samples in the patch usually fall within the same voxel block, so we look them up via an index cache that
+ * remembers the most recently accessed block, and thereby avoid a full hash table lookup for most of the samples. To make
+ * the most of the cache, we visit the rows of the patch in alternating directions, so that consecutive samples are always
+ * adjacent to each other in the patch.
+ *
  * \param voxelLocationIndex  The index of the voxel for which to generate an RGB patch.
  * \param voxelLocations      The locations of the voxels for which to generate RGB patches.
  * \param xAxes               The x axes of the coordinate systems in the tangent planes to the surfaces at the voxel locations.
@@ -201,28 +238,31 @@ inline void generate_rgb_patch(int voxelLocationIndex, const Vector3s *voxelLoca
   // Generate an RGB patch around the voxel on a patchSize * patchSize grid aligned with the voxel's x and y axes.
   int halfPatchSize = static_cast<int>(patchSize - 1) / 2;
   bool isFound;
+  ITMVoxelIndex::IndexCache cache;
   Vector3f xAxis = xAxes[voxelLocationIndex] * patchSpacing;
   Vector3f yAxis = yAxes[voxelLocationIndex] * patchSpacing;
 
-  // For each pixel in the patch:
-  size_t offset = voxelLocationIndex * featureCount;
+  // For each pixel in the patch (visiting even rows from left to right and odd rows from right to left):
+  float *patch = features + voxelLocationIndex * featureCount;
   for(int y = -halfPatchSize; y <= halfPatchSize; ++y)
   {
     Vector3f yLoc = centre + static_cast<float>(y) * yAxis;
-    for(int x = -halfPatchSize; x <= halfPatchSize; ++x)
+    const int xStep = (y + halfPatchSize) % 2 == 0 ? 1 : -1;
+    for(int i = 0, x = -halfPatchSize * xStep; i < static_cast<int>(patchSize); ++i, x += xStep)
     {
       // Compute the location of the pixel in world space.
       Vector3i loc = (yLoc + static_cast<float>(x) * xAxis).toIntRound();
 
       // If there is a voxel at that location, get its colour; otherwise, default to magenta.
       Vector3u clr(255, 0, 255);
-      SpaintVoxel voxel = readVoxel(voxelData, indexData, loc, isFound);
+      SpaintVoxel voxel = readVoxel(voxelData, indexData, loc, isFound, cache);
       if(isFound) clr = VoxelColourReader<SpaintVoxel::hasColorInformation>::read(voxel);
 
       // Write the colour values into the relevant places in the features array.
-      features[offset++] = clr.r;
-      features[offset++] = clr.g;
-      features[offset++] = clr.b;
+      float *pixel = patch + ((y + halfPatchSize) * patchSize + (x + halfPatchSize)) * 3;
+      pixel[0] = clr.r;
+      pixel[1] = clr.g;
+      pixel[2] = clr.b;
     }
   }
 }
@@ -290,7 +330,7 @@ inline void write_surface_normal(int voxelLocationIndex, const Vector3s *voxelLo
                                  Vector3f *surfaceNormals, size_t featureCount, float *features)
 {
   // Compute the voxel's surface normal.
-  Vector3f n = computeSingleNormalFromSDF(voxelData, indexData, voxelLocations[voxelLocationIndex].toFloat());
+  Vector3f n = compute_surface_normal(voxelLocations[voxelLocationIndex].toInt(), voxelData, indexData);
 
   // Write the normal into the surface normals array.
   surfaceNormals[voxelLocationIndex] = n;
@@ -26,10 +26,39 @@ namespace spaint {
  */
 class CollaborativeComponent
 {
+  //#################### NESTED TYPES ####################
+private:
+  /**
+   * \brief An instance of this struct holds the resources used by a single relocalisation worker.
+   *
+   * Each worker has its own visualisation generator, render states and image buffers, so that several workers can attempt
+   * relocalisations at the same time. The render states and images are keyed by the ID of the scene against which we are
+   * relocalising (since their sizes depend on that scene), and are reused from one relocalisation attempt to the next.
+   */
+  struct RelocalisationWorker
+  {
+    /** The images into which to render synthetic depth images during relocalisation. */
+    std::map<std::string,ORFloatImage_Ptr> m_depthImages;
+
+    /** Render states used when rendering synthetic depth images during relocalisation. */
+    std::map<std::string,VoxelRenderState_Ptr> m_depthRenderStates;
+
+    /** The images into which to render synthetic colour images during relocalisation. */
+    std::map<std::string,ORUChar4Image_Ptr> m_rgbImages;
+
+    /** Render states used when rendering synthetic colour images during relocalisation. */
+    std::map<std::string,VoxelRenderState_Ptr> m_rgbRenderStates;
+
+    /** A visualisation generator that is specific to this worker. We avoid sharing one with other workers or components for thread-safety reasons. */
+    VisualisationGenerator_CPtr m_visualisationGenerator;
+  };
+
+  typedef boost::shared_ptr<RelocalisationWorker> RelocalisationWorker_Ptr;
+
   //#################### PRIVATE VARIABLES ####################
 private:
-  /** The best relocalisation candidate, as chosen by the scheduler. This will be the next relocalisation attempted. */
-  boost::shared_ptr<CollaborativeRelocalisation> m_bestCandidate;
+  /** The number of relocalisations that are currently being attempted by the relocalisation workers. */
+  int m_activeRelocalisationCount;
 
   /** The timer used to compute the time spent collaborating. */
   boost::optional<boost::timer::cpu_timer> m_collaborationTimer;
@@ -40,9 +69,6 @@ private:
   /** The shared context needed for collaborative SLAM. */
   CollaborativeContext_Ptr m_context;
 
-  /** Render states used when rendering synthetic depth images during relocalisation. */
-  std::map<std::string, VoxelRenderState_Ptr> m_depthRenderStates;
-
   /** The current frame index (in practice, the number of times that run_collaborative_pose_estimation has been called). */
   int m_frameIndex;
 
@@ -52,29 +78,38 @@ private:
   /** The mutex used to synchronise scheduling and relocalisation. */
   boost::mutex m_mutex;
 
-  /** A condition variable used to tell the relocalisation thread when a candidate relocalisation has been scheduled. */
+  /** A condition variable used to tell the relocalisation workers when candidate relocalisations have been scheduled. */
   boost::condition_variable m_readyToRelocalise;
 
   /** Whether or not the current reconstruction is consistent (i.e. all scenes are connected to the primary one). */
   bool m_reconstructionIsConsistent;
 
-  /** The thread on which relocalisations should be attempted. */
-  boost::thread m_relocalisationThread;
+  /** The threads on which the relocalisation workers attempt relocalisations. */
+  boost::thread_group m_relocalisationThreads;
+
+  /** The relocalisation workers (one per relocalisation thread). */
+  std::vector<RelocalisationWorker_Ptr> m_relocalisationWorkers;
+
+  /**
+   * Mutexes used to ensure that only one worker at a time uses the relocaliser for any given scene
+   * (not all relocalisers can safely be used from several threads at once).
+   */
+  std::map<std::string,boost::shared_ptr<boost::mutex> > m_relocaliserMutexes;
 
   /** The results of every relocalisation that has been attempted. */
   std::deque<CollaborativeRelocalisation> m_results;
 
-  /** Render states used when rendering synthetic colour images during relocalisation. */
-  std::map<std::string, VoxelRenderState_Ptr> m_rgbRenderStates;
-
   /** A random number generator. */
   mutable tvgutil::RandomNumberGenerator m_rng;
 
+  /** The candidate relocalisations that have been chosen by the scheduler, but not yet picked up by a relocalisation worker. */
+  std::deque<CollaborativeRelocalisation> m_scheduledCandidates;
+
   /** Whether or not to stop at the first consistent reconstruction. */
   bool m_stopAtFirstConsistentReconstruction;
 
-  /** A flag used to ensure that the relocalisation thread terminates cleanly when the collaborative component is destroyed. */
-  boost::atomic<bool> m_stopRelocalisationThread;
+  /** A flag used to ensure that the relocalisation threads terminate cleanly when the collaborative component is destroyed. */
+  boost::atomic<bool> m_stopRelocalisationThreads;
 
   /** Whether or not to compute the time spent collaborating. */
   bool m_timeCollaboration;
@@ -85,9 +120,6 @@ private:
   /** The indices of the frames that have already been tried when attempting to relocalise one scene against another. */
   std::map<std::pair<std::string,std::string>,std::set<int> > m_triedFrameIndices;
 
-  /** A visualisation generator that is specific to this collaborative component. We avoid sharing one with other components for thread-safety reasons. */
-  VisualisationGenerator_CPtr m_visualisationGenerator;
-
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -114,6 +146,16 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Attempts the specified candidate relocalisation, and adds a sample of the resulting relative transform to the pose graph optimiser if it can be verified.
+   *
+   * \note  This is called concurrently by the relocalisation workers.
+   *
+   * \param candidate The candidate relocalisation (its results will be written into it).
+   * \param worker    The relocalisation worker whose resources should be used.
+   */
+  void attempt_relocalisation(CollaborativeRelocalisation& candidate, RelocalisationWorker& worker);
+
   /**
    * \brief Randomly generates at most the specified number of candidate relocalisations.
    *
@@ -146,9 +188,11 @@ private:
   void output_results() const;
 
   /**
-   * \brief Runs the relocalisation thread, repeatedly attempting scheduled relocalisations until the collaborative component is destroyed.
+   * \brief Runs a relocalisation thread, repeatedly attempting scheduled relocalisations until the collaborative component is destroyed.
+   *
+   * \param workerIndex The index of the relocalisation worker whose resources should be used by the thread.
    */
-  void run_relocalisation();
+  void run_relocalisation(size_t workerIndex);
 
   /**
    * \brief Scores all of the specified candidate relocalisations to allow one of them to be chosen for a relocalisation attempt.
@@ -158,9 +202,9 @@ private:
   void score_candidates(std::list<CollaborativeRelocalisation>& candidates) const;
 
   /**
-   * \brief Tries to schedule a candidate relocalisation.
+   * \brief Tries to schedule the best candidate relocalisations, one for each relocalisation worker that is currently free.
    *
-   * \note  If an existing relocalisation attempt is in progress, this will early out and do nothing.
+   * \note  If all of the relocalisation workers are busy, this will early out and do nothing.
    */
   void try_schedule_relocalisation();
 
@@ -25,7 +25,9 @@ class SLAMComponent
 private:
   typedef boost::shared_ptr<ITMLib::ITMDenseMapper<SpaintVoxel,ITMVoxelIndex> > DenseMapper_Ptr;
   typedef boost::shared_ptr<ITMLib::ITMDenseSurfelMapper<SpaintSurfel> > DenseSurfelMapper_Ptr;
+  typedef boost::shared_ptr<const ITMLib::ITMSurfelVisualisationEngine<SpaintSurfel> > SurfelVisualisationEngine_CPtr;
   typedef ITMLib::ITMTrackingState::TrackingResult TrackingResult;
+  typedef boost::shared_ptr<const ITMLib::ITMVisualisationEngine<SpaintVoxel,ITMVoxelIndex> > VoxelVisualisationEngine_CPtr;
 
   //#################### ENUMERATIONS ####################
 public:
@@ -125,6 +127,12 @@ private:
   /** The namespace associated with the settings that are specific to SLAM components. */
   std::string m_settingsNamespace;
 
+  /**
+   * The InfiniTAM engine used to render the surfel scene when preparing for tracking. This is owned by the component
+   * rather than shared via the context, so that the frames for different scenes can safely be processed concurrently.
+   */
+  SurfelVisualisationEngine_CPtr m_surfelVisualisationEngine;
+
   /** The tracker. */
   Tracker_Ptr m_tracker;
 
@@ -140,6 +148,12 @@ private:
   /** The view builder. */
   ViewBuilder_Ptr m_viewBuilder;
 
+  /**
+   * The InfiniTAM engine used to render the voxel scene when preparing for tracking. This is owned by the component
+   * rather than shared via the context, so that the frames for different scenes can safely be processed concurrently.
+   */
+  VoxelVisualisationEngine_CPtr m_voxelVisualisationEngine;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -165,6 +179,13 @@ public:
    */
   bool get_fusion_enabled() const;
 
+  /**
+   * \brief Gets the ID of the scene (if any) whose pose is being mirrored by this SLAM component.
+   *
+   * \return  The ID of the scene (if any) whose pose is being mirrored by this SLAM component, or the empty string otherwise.
+   */
+  const std::string& get_mirror_scene_id() const;
+
   /**
    * \brief Gets the ID of the scene being reconstructed by this SLAM component.
    *
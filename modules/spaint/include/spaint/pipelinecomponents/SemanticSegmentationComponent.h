@@ -47,6 +47,9 @@ private:
   /** A memory block in which to store the feature vectors computed for the various voxels during prediction. */
   boost::shared_ptr<ORUtils::MemoryBlock<float> > m_predictionFeaturesMB;
 
+  /** A buffer in which to store the labels predicted by the random forest for the various voxels (prior to packing). */
+  std::vector<SpaintVoxel::Label> m_predictionForestLabels;
+
   /** A memory block in which to store the labels predicted for the various voxels. */
   boost::shared_ptr<ORUtils::MemoryBlock<SpaintVoxel::PackedLabel> > m_predictionLabelsMB;
 
@@ -6,6 +6,8 @@
 #ifndef H_SPAINT_FORESTUTIL
 #define H_SPAINT_FORESTUTIL
 
+#include <boost/make_shared.hpp>
+
 #include <ORUtils/MemoryBlock.h>
 
 #include <rafl/examples/Example.h>
@@ -35,7 +37,10 @@ struct ForestUtil
    * The memory block contains feature descriptors that are grouped by the label that should be assigned to them. In particular,
    * the block is divided into equally-sized segments, each of which contains maxDescriptorsPerLabel feature descriptors. Within
    * segment i, the first descriptorCounts[i] (<= maxDescriptorsPerLabel) feature descriptors are valid and can be used to make
-   * examples. Each feature descriptor in segment i is assigned label i when making examples.
+   * examples. Each feature descriptor in segment i is assigned label i when making examples. The valid feature descriptors
+   * are copied into a single descriptor matrix that is shared by all of the examples. (Any examples that are subsequently
+   * stored in the reservoirs of a forest are given their own copies of their descriptors, so the matrix does not outlive
+   * the call that trains on the examples.)
    *
    * \param featuresMB              The InfiniTAM memory block containing the feature descriptors.
    * \param descriptorCountsMB      An InfiniTAM memory block containing the numbers of descriptors in each label segment that are valid.
@@ -60,21 +65,26 @@ struct ForestUtil
       exampleCount += descriptorCounts[i];
     }
 
-    // Make the examples.
+    // Copy the valid feature descriptors into a descriptor matrix that can be shared by all of the examples.
     featuresMB.UpdateHostFromDevice();
     const float *features = featuresMB.GetData(MEMORYDEVICE_CPU);
-    std::vector<Example_CPtr> examples(exampleCount);
-    size_t exampleIndex = 0;
+    rafl::DescriptorMatrix_Ptr descriptorMatrix(new rafl::DescriptorMatrix(featureCount, exampleCount));
     for(Label label = 0; label < static_cast<Label>(labelCount); ++label)
     {
       for(size_t i = 0; i < descriptorCounts[label]; ++i)
       {
-        // Copy the features for the example into a descriptor.
-        const float *featuresForExample = features + (label * maxDescriptorsPerLabel + i) * featureCount;
-        rafl::Descriptor_Ptr descriptor(new rafl::Descriptor(featuresForExample, featuresForExample + featureCount));
+        descriptorMatrix->add_row(features + (label * maxDescriptorsPerLabel + i) * featureCount);
+      }
+    }
 
-        // Make the example and add it.
-        examples[exampleIndex++] = Example_CPtr(new rafl::Example<Label>(descriptor, label));
+    // Make the examples.
+    std::vector<Example_CPtr> examples(exampleCount);
+    size_t exampleIndex = 0;
+    for(Label label = 0; label < static_cast<Label>(labelCount); ++label)
+    {
+      for(size_t i = 0; i < descriptorCounts[label]; ++i, ++exampleIndex)
+      {
+        examples[exampleIndex] = boost::make_shared<rafl::Example<Label> >(descriptorMatrix, exampleIndex, label);
       }
     }
 
@@ -15,6 +15,20 @@ namespace spaint {
  */
 class PerLabelVoxelSampler_CPU : public PerLabelVoxelSampler
 {
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /**
+   * A memory block in which to store the locations of candidate voxels in the raycast result, grouped by label. Since each voxel
+   * can be a candidate for at most one label, this only needs to be as large as the raycast result itself.
+   */
+  boost::shared_ptr<ORUtils::MemoryBlock<Vector3s> > m_candidateVoxelLocationsMB;
+
+  /** A memory block in which to store the offsets of the groups of candidate voxels for the various labels in the candidate voxel locations array. */
+  boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_candidateVoxelOffsetsMB;
+
+  /** A memory block in which to store the label (if any) for which each voxel in the raycast result is a candidate (-1 if there is no such label). */
+  boost::shared_ptr<ORUtils::MemoryBlock<int> > m_voxelLabelsMB;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -30,16 +44,8 @@ public:
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
   /** Override */
-  virtual void calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const;
-
-  /** Override */
-  virtual void calculate_voxel_masks(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const;
-
-  /** Override */
-  virtual void write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
-
-  /** Override */
-  virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const;
+  virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                               const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
 
   /** Override */
   virtual void write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const;
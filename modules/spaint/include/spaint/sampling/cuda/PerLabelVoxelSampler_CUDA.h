@@ -15,6 +15,23 @@ namespace spaint {
  */
 class PerLabelVoxelSampler_CUDA : public PerLabelVoxelSampler
 {
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** A memory block in which to store the locations of candidate voxels in the raycast result, grouped by label. */
+  boost::shared_ptr<ORUtils::MemoryBlock<Vector3s> > m_candidateVoxelLocationsMB;
+
+  /**
+   * A memory block in which to store the prefix sums for the voxel masks. These are used to determine the locations in the
+   * candidate voxel locations array into which to write candidate voxels.
+   */
+  boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_voxelMaskPrefixSumsMB;
+
+  /**
+   * A memory block in which to store voxel masks indicating which voxels may be used as examples of which semantic labels.
+   * The masks for the different labels are concatenated into a single 1D array.
+   */
+  boost::shared_ptr<ORUtils::MemoryBlock<unsigned char> > m_voxelMasksMB;
+
   //#################### CONSTRUCTORS ####################
 public:
   /**
@@ -29,17 +46,40 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
-  /** Override */
-  virtual void calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const;
+  /**
+   * \brief Calculates the prefix sums for the voxel masks.
+   *
+   * \param labelMaskMB A memory block containing a mask specifying which labels are currently in use.
+   */
+  void calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const;
 
-  /** Override */
-  virtual void calculate_voxel_masks(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const;
+  /**
+   * \brief Calculates the voxel masks.
+   *
+   * \param raycastResult The current raycast result.
+   * \param voxelData     The scene's voxel data.
+   * \param indexData     The scene's index data.
+   */
+  void calculate_voxel_masks(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const;
 
-  /** Override */
-  virtual void write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
+  /**
+   * \brief Writes the number of candidate voxels that are available for each label into the voxel counts for labels memory block.
+   *
+   * \param labelMaskMB             A memory block containing a mask specifying which labels are currently in use.
+   * \param voxelCountsForLabelsMB  A memory block into which to write voxel counts for each label.
+   */
+  void write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
 
   /** Override */
-  virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const;
+  virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                               const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const;
+
+  /**
+   * \brief Writes the locations of the candidate voxels into the candidate voxel locations memory block, based on the voxel masks and their prefix sums.
+   *
+   * \param raycastResult The current raycast result.
+   */
+  void write_masked_voxel_locations(const ORFloat4Image *raycastResult) const;
 
   /** Override */
   virtual void write_sampled_voxel_locations(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const;
@@ -30,9 +30,6 @@ protected:
   /** A memory block in which to store random indices when sampling from the candidate voxels for each label. */
   boost::shared_ptr<ORUtils::MemoryBlock<int> > m_candidateVoxelIndicesMB;
 
-  /** A memory block in which to store the locations of candidate voxels in the raycast result, grouped by label. */
-  boost::shared_ptr<ORUtils::MemoryBlock<Vector3s> > m_candidateVoxelLocationsMB;
-
   /** The maximum number of labels that can be in use. */
   const size_t m_maxLabelCount;
 
@@ -45,18 +42,6 @@ protected:
   /** A random number generator. */
   boost::shared_ptr<tvgutil::RandomNumberGenerator> m_rng;
 
-  /**
-   * A memory block in which to store the prefix sums for the voxel masks. These are used to determine the locations in the
-   * candidate voxel locations array into which to write candidate voxels.
-   */
-  boost::shared_ptr<ORUtils::MemoryBlock<unsigned int> > m_voxelMaskPrefixSumsMB;
-
-  /**
-   * A memory block in which to store voxel masks indicating which voxels may be used as examples of which semantic labels.
-   * The masks for the different labels are concatenated into a single 1D array.
-   */
-  boost::shared_ptr<ORUtils::MemoryBlock<unsigned char> > m_voxelMasksMB;
-
   //#################### CONSTRUCTORS ####################
 protected:
   /**
@@ -79,35 +64,21 @@ public:
   //#################### PRIVATE ABSTRACT MEMBER FUNCTIONS ####################
 private:
   /**
-   * \brief Calculates the prefix sums for the voxel masks.
+   * \brief Finds the candidate voxels for each used label in the current raycast result, and writes their locations (grouped by label)
+   *        into the sampler's internal storage, and the number of candidate voxels that are available for each label into the voxel
+   *        counts for labels memory block.
    *
-   * \param labelMaskMB A memory block containing a mask specifying which labels are currently in use.
-   */
-  virtual void calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const = 0;
-
-  /**
-   * \brief Calculates the voxel masks.
-   *
-   * \param raycastResult The current raycast result.
-   * \param voxelData     The scene's voxel data.
-   * \param indexData     The scene's index data.
-   */
-  virtual void calculate_voxel_masks(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData) const = 0;
-
-  /**
-   * \brief Writes the number of candidate voxels that are available for each label into the voxel counts for labels memory block.
+   * \note  The candidate voxels for each label must be indexable from 0 to the number of candidates for that label minus one, since
+   *        these are the indices that will subsequently be passed to write_sampled_voxel_locations.
    *
+   * \param raycastResult           The current raycast result.
+   * \param voxelData               The scene's voxel data.
+   * \param indexData               The scene's index data.
    * \param labelMaskMB             A memory block containing a mask specifying which labels are currently in use.
-   * \param voxelCountsForLabelsMB  A memory block into which to write voxel counts for each label.
-   */
-  virtual void write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const = 0;
-
-  /**
-   * \brief Writes the locations of the candidate voxels into the candidate voxel locations memory block.
-   *
-   * \param raycastResult The current raycast result.
+   * \param voxelCountsForLabelsMB  A memory block into which to write voxel counts for each label (must be made available on the CPU).
    */
-  virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const = 0;
+  virtual void write_candidate_voxel_locations(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                               const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const = 0;
 
   /**
    * \brief Writes the locations of the sampled voxels into the sampled voxel locations memory block.
@@ -43,6 +43,30 @@ inline void copy_sampled_voxel_locations(int voxelIndex, const bool *labelMask,
   }
 }
 
+/**
+ * \brief Finds the label (if any) for which the specified voxel may be used as an example.
+ *
+ * \param voxelIndex        The index of the voxel in the raycast result.
+ * \param raycastResult     The current raycast result.
+ * \param voxelData         The scene's voxel data.
+ * \param indexData         The scene's index data.
+ * \param maxLabelCount     The maximum number of labels that can be in use.
+ * \return                  The label for which the voxel may be used as an example, or -1 if there is no such label.
+ */
+_CPU_AND_GPU_CODE_
+inline int find_candidate_label(int voxelIndex, const Vector4f *raycastResult, const SpaintVoxel *voxelData,
+                                const ITMVoxelIndex::IndexData *indexData, size_t maxLabelCount)
+{
+  Vector3i loc = raycastResult[voxelIndex].toVector3().toIntRound();
+  bool isFound;
+  int voxelAddress = findVoxel(indexData, loc, isFound);
+  if(!isFound) return -1;
+
+  // FIXME: We shouldn't hard-code which labels we're training from here.
+  const SpaintVoxel& voxel = voxelData[voxelAddress];
+  return voxel.packedLabel.label < maxLabelCount && voxel.packedLabel.group != SpaintVoxel::LG_FOREST ? static_cast<int>(voxel.packedLabel.label) : -1;
+}
+
 /**
  * \brief Updates the voxel masks for the various labels based on the contents of the specified voxel (if it exists).
  *
@@ -60,17 +84,12 @@ inline void update_masks_for_voxel(int voxelIndex, const Vector4f *raycastResult
                                    size_t maxLabelCount, unsigned char *voxelMasks)
 {
   // Note: We do not need to explicitly use the label mask in this function, since no voxel will ever be marked with an unused label.
-
-  Vector3i loc = raycastResult[voxelIndex].toVector3().toIntRound();
-  bool isFound;
-  int voxelAddress = findVoxel(indexData, loc, isFound);
-  const SpaintVoxel *voxel = isFound ? &voxelData[voxelAddress] : NULL;
+  const int label = find_candidate_label(voxelIndex, raycastResult, voxelData, indexData, maxLabelCount);
 
   // Update the voxel masks for the various labels (even the ones that are not currently active).
   for(size_t k = 0; k < maxLabelCount; ++k)
   {
-    // FIXME: We shouldn't hard-code which labels we're training from here.
-    voxelMasks[k * (raycastResultSize + 1) + voxelIndex] = voxel && voxel->packedLabel.label == k && voxel->packedLabel.group != SpaintVoxel::LG_FOREST ? 1 : 0;
+    voxelMasks[k * (raycastResultSize + 1) + voxelIndex] = label == static_cast<int>(k) ? 1 : 0;
   }
 }
 
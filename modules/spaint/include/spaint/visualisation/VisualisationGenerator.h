@@ -65,6 +65,9 @@ private:
   /** The depth visualiser. */
   itmx::DepthVisualiser_CPtr m_depthVisualiser;
 
+  /** A temporary image used when generating colourised depth visualisations (created lazily). */
+  mutable ORFloatImage_Ptr m_tempDepthImage;
+
   /** The label manager to use (only needed if we want to generate semantic visualisations). */
   LabelManager_CPtr m_labelManager;
 
@@ -96,6 +99,20 @@ public:
 
   //#################### PUBLIC MEMBER FUNCTIONS ####################
 public:
+  /**
+   * \brief Generates a synthetic depth image of a voxel scene from the raycast result already stored in a render state.
+   *
+   * \note  This can be used to obtain a depth image that matches a voxel visualisation that has just been generated from the same pose
+   *        using the same render state, without raycasting the scene a second time.
+   *
+   * \param output      The location into which to put the output image.
+   * \param pose        The pose from which the scene was raycast.
+   * \param renderState The render state containing the raycast result.
+   * \param depthType   The type of depth calculation to use.
+   */
+  void generate_depth_from_raycast(const ORFloatImage_Ptr& output, const ORUtils::SE3Pose& pose, const VoxelRenderState_CPtr& renderState,
+                                   itmx::DepthVisualiser::DepthType depthType) const;
+
   /**
    * \brief Generates a synthetic depth image of a voxel scene from the specified pose.
    *
@@ -167,6 +184,14 @@ public:
 
   //#################### PRIVATE MEMBER FUNCTIONS ####################
 private:
+  /**
+   * \brief Gets a temporary depth image of the specified size, creating or resizing it if necessary.
+   *
+   * \param imgSize The size of image required.
+   * \return        The temporary depth image.
+   */
+  const ORFloatImage_Ptr& get_temp_depth_image(const Vector2i& imgSize) const;
+
   /**
    * \brief Makes a copy of an input raycast, optionally post-processes it and then ensures that it is accessible on the CPU.
    *
@@ -6,8 +6,10 @@
 #include "collaboration/CollaborativePoseOptimiser.h"
 using namespace ORUtils;
 
+#include <algorithm>
 #include <deque>
 #include <fstream>
+#include <iterator>
 
 #include <MiniSlamGraphLib/GraphEdgeSE3.h>
 #include <MiniSlamGraphLib/GraphNodeSE3.h>
@@ -41,7 +43,8 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 CollaborativePoseOptimiser::CollaborativePoseOptimiser(const std::string& primarySceneID)
-: m_primarySceneID(primarySceneID),
+: m_globalPoseSnapshot(new GlobalPoseSnapshot),
+  m_primarySceneID(primarySceneID),
   m_relativeTransformSamplesChanged(false),
   m_shouldTerminate(false)
 {}
@@ -91,6 +94,11 @@ void CollaborativePoseOptimiser::add_relative_transform_sample(const std::string
 #endif
 }
 
+CollaborativePoseOptimiser::GlobalPoseSnapshot_CPtr CollaborativePoseOptimiser::get_global_pose_snapshot() const
+{
+  return boost::atomic_load(&m_globalPoseSnapshot);
+}
+
 void CollaborativePoseOptimiser::start(const std::string& globalPosesSpecifier)
 {
   m_globalPosesSpecifier = globalPosesSpecifier;
@@ -113,9 +121,9 @@ void CollaborativePoseOptimiser::terminate()
 
 boost::optional<SE3Pose> CollaborativePoseOptimiser::try_get_estimated_global_pose(const std::string& sceneID) const
 {
-  boost::lock_guard<boost::mutex> lock(m_mutex);
-  std::map<std::string,ORUtils::SE3Pose>::const_iterator it = m_estimatedGlobalPoses.find(sceneID);
-  return it != m_estimatedGlobalPoses.end() ? boost::optional<SE3Pose>(it->second) : boost::none;
+  GlobalPoseSnapshot_CPtr snapshot = get_global_pose_snapshot();
+  std::map<std::string,ORUtils::SE3Pose>::const_iterator it = snapshot->m_estimatedGlobalPoses.find(sceneID);
+  return it != snapshot->m_estimatedGlobalPoses.end() ? boost::optional<SE3Pose>(it->second) : boost::none;
 }
 
 boost::optional<CollaborativePoseOptimiser::SE3PoseCluster>
@@ -127,15 +135,18 @@ CollaborativePoseOptimiser::try_get_largest_cluster(const std::string& sceneI, c
 
 boost::optional<std::pair<SE3Pose,size_t> > CollaborativePoseOptimiser::try_get_relative_transform(const std::string& sceneI, const std::string& sceneJ) const
 {
-  boost::lock_guard<boost::mutex> lock(m_mutex);
-
-  std::map<std::string,ORUtils::SE3Pose>::const_iterator it = m_estimatedGlobalPoses.find(sceneI);
-  if(it == m_estimatedGlobalPoses.end()) return try_get_relative_transform_sub(sceneI, sceneJ);
-
-  std::map<std::string,ORUtils::SE3Pose>::const_iterator jt = m_estimatedGlobalPoses.find(sceneJ);
-  if(jt == m_estimatedGlobalPoses.end()) return try_get_relative_transform_sub(sceneI, sceneJ);
+  // If the global poses of both scenes have been estimated, compute the relative transform from the latest snapshot (without locking).
+  GlobalPoseSnapshot_CPtr snapshot = get_global_pose_snapshot();
+  std::map<std::string,ORUtils::SE3Pose>::const_iterator it = snapshot->m_estimatedGlobalPoses.find(sceneI);
+  std::map<std::string,ORUtils::SE3Pose>::const_iterator jt = snapshot->m_estimatedGlobalPoses.find(sceneJ);
+  if(it != snapshot->m_estimatedGlobalPoses.end() && jt != snapshot->m_estimatedGlobalPoses.end())
+  {
+    return std::make_pair(SE3Pose(it->second.GetM() * jt->second.GetInvM()), static_cast<size_t>(confidence_threshold()));
+  }
 
-  return std::make_pair(SE3Pose(it->second.GetM() * jt->second.GetInvM()), static_cast<size_t>(confidence_threshold()));
+  // Otherwise, fall back to using the samples directly.
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return try_get_relative_transform_sub(sceneI, sceneJ);
 }
 
 boost::optional<std::vector<CollaborativePoseOptimiser::SE3PoseCluster> >
@@ -197,13 +208,149 @@ bool CollaborativePoseOptimiser::add_relative_transform_sample_sub(const std::st
   return newCluster.size() >= confidence_threshold();
 }
 
+std::map<std::string,SE3Pose> CollaborativePoseOptimiser::optimise_global_poses(const std::map<SceneIDPair,SE3Pose>& edges, const std::map<SceneIDPair,SE3Pose>& previousEdges,
+                                                                                 const std::set<SceneIDPair>& changedPairs, const std::map<std::string,SE3Pose>& previousPoses) const
+{
+  // Determine which scenes are in the current graph, and which of them were also in the previous graph.
+  std::set<std::string> nodes, previousNodes;
+  for(std::map<SceneIDPair,SE3Pose>::const_iterator it = edges.begin(), iend = edges.end(); it != iend; ++it)
+  {
+    nodes.insert(it->first.first);
+    nodes.insert(it->first.second);
+  }
+
+  for(std::map<SceneIDPair,SE3Pose>::const_iterator it = previousEdges.begin(), iend = previousEdges.end(); it != iend; ++it)
+  {
+    previousNodes.insert(it->first.first);
+    previousNodes.insert(it->first.second);
+  }
+
+  // Initialise the poses of the scenes that already have estimated poses to those estimates, and the pose of the primary scene to the identity if necessary.
+  std::map<std::string,SE3Pose> initialPoses;
+  std::deque<std::string> frontier;
+  for(std::set<std::string>::const_iterator it = nodes.begin(), iend = nodes.end(); it != iend; ++it)
+  {
+    std::map<std::string,SE3Pose>::const_iterator jt = previousPoses.find(*it);
+    if(jt != previousPoses.end() || *it == m_primarySceneID)
+    {
+      initialPoses[*it] = jt != previousPoses.end() ? jt->second : SE3Pose();
+      frontier.push_back(*it);
+    }
+  }
+
+  // Initialise the poses of the remaining scenes by chaining relative transforms outwards from the scenes whose poses are known.
+  // Note that since the edge for (scene i, scene j) is an estimate of iTj = Gi * Gj^-1, we have Gi = iTj * Gj and Gj = iTj^-1 * Gi.
+  while(!frontier.empty())
+  {
+    const std::string sceneID = frontier.front();
+    frontier.pop_front();
+    const Matrix4f pose = initialPoses[sceneID].GetM();
+
+    for(std::map<SceneIDPair,SE3Pose>::const_iterator it = edges.begin(), iend = edges.end(); it != iend; ++it)
+    {
+      const std::string& sceneI = it->first.first;
+      const std::string& sceneJ = it->first.second;
+      if(sceneJ == sceneID && initialPoses.find(sceneI) == initialPoses.end())
+      {
+        initialPoses[sceneI] = SE3Pose(it->second.GetM() * pose);
+        frontier.push_back(sceneI);
+      }
+      else if(sceneI == sceneID && initialPoses.find(sceneJ) == initialPoses.end())
+      {
+        initialPoses[sceneJ] = SE3Pose(it->second.GetInvM() * pose);
+        frontier.push_back(sceneJ);
+      }
+    }
+  }
+
+  // Determine whether the only changes since the previous optimisation involve attaching new scenes to the graph without closing any loops.
+  // This is the case if every changed pair contains a new scene, and there are exactly as many changed pairs as new scenes (since all new
+  // scenes are connected to the rest of the graph via changed pairs, the changed pairs must then form a tree). In that case, the optimal
+  // poses of the existing scenes cannot have changed.
+  std::set<std::string> newNodes;
+  std::set_difference(nodes.begin(), nodes.end(), previousNodes.begin(), previousNodes.end(), std::inserter(newNodes, newNodes.begin()));
+
+  bool attachOnly = !newNodes.empty() && changedPairs.size() == newNodes.size();
+  for(std::set<SceneIDPair>::const_iterator it = changedPairs.begin(), iend = changedPairs.end(); attachOnly && it != iend; ++it)
+  {
+    attachOnly = newNodes.find(it->first) != newNodes.end() || newNodes.find(it->second) != newNodes.end();
+  }
+
+  // Construct the pose graph. If we're only attaching new scenes, we hold the poses of all the existing scenes fixed and
+  // only add the edges that involve new scenes; otherwise, we only hold the pose of the primary scene fixed.
+  PoseGraph graph;
+  std::vector<std::string> nodeIDs(nodes.begin(), nodes.end());
+  std::set<int> graphNodes;
+  for(std::map<SceneIDPair,SE3Pose>::const_iterator it = edges.begin(), iend = edges.end(); it != iend; ++it)
+  {
+    const std::string& sceneI = it->first.first;
+    const std::string& sceneJ = it->first.second;
+    if(attachOnly && newNodes.find(sceneI) == newNodes.end() && newNodes.find(sceneJ) == newNodes.end()) continue;
+
+    const int i = static_cast<int>(std::lower_bound(nodeIDs.begin(), nodeIDs.end(), sceneI) - nodeIDs.begin());
+    const int j = static_cast<int>(std::lower_bound(nodeIDs.begin(), nodeIDs.end(), sceneJ) - nodeIDs.begin());
+
+    GraphEdgeSE3 *edge = new GraphEdgeSE3;
+    edge->setFromNodeId(j);
+    edge->setToNodeId(i);
+    edge->setMeasurementSE3(it->second);
+    graph.addEdge(edge);
+
+    graphNodes.insert(i);
+    graphNodes.insert(j);
+  }
+
+  for(std::set<int>::const_iterator it = graphNodes.begin(), iend = graphNodes.end(); it != iend; ++it)
+  {
+    const std::string& sceneID = nodeIDs[*it];
+
+    GraphNodeSE3 *node = new GraphNodeSE3;
+    node->setId(*it);
+    node->setPose(initialPoses[sceneID]);
+    node->setFixed(sceneID == m_primarySceneID || (attachOnly && newNodes.find(sceneID) == newNodes.end()));
+    graph.addNode(node);
+  }
+
+  // Run the pose graph optimisation.
+  graph.prepareEvaluations();
+  SlamGraphErrorFunction errFunc(graph);
+  SlamGraphErrorFunction::Parameters params(graph);
+  LevenbergMarquardtMethod::minimize(errFunc, params);
+  graph.setNodeIndex(params.getNodes());
+
+  // Extract and return the optimised poses (if we were only attaching new scenes, only the poses of those scenes can have changed).
+  std::map<std::string,SE3Pose> result;
+  for(SlamGraph::NodeIndex::const_iterator it = graph.getNodeIndex().begin(), iend = graph.getNodeIndex().end(); it != iend; ++it)
+  {
+    const std::string& sceneID = nodeIDs[it->first];
+    if(attachOnly && newNodes.find(sceneID) == newNodes.end()) continue;
+
+    const GraphNodeSE3 *node = static_cast<const GraphNodeSE3*>(it->second);
+    result[sceneID] = node->getPose();
+  }
+
+  return result;
+}
+
+void CollaborativePoseOptimiser::publish_global_pose_snapshot()
+{
+  boost::shared_ptr<GlobalPoseSnapshot> snapshot(new GlobalPoseSnapshot);
+  snapshot->m_estimatedGlobalPoses = m_estimatedGlobalPoses;
+  snapshot->m_version = m_globalPoseSnapshot->m_version + 1;
+  boost::atomic_store(&m_globalPoseSnapshot, GlobalPoseSnapshot_CPtr(snapshot));
+}
+
 void CollaborativePoseOptimiser::run_pose_graph_optimisation()
 {
   std::cout << "Starting pose graph optimisation thread" << std::endl;
 
+  // The confident edges that were used for the most recent optimisation.
+  std::map<SceneIDPair,SE3Pose> previousEdges;
+
   while(!m_shouldTerminate)
   {
-    PoseGraph graph;
+    std::map<SceneIDPair,SE3Pose> edges;
+    std::map<std::string,SE3Pose> previousPoses;
     std::vector<std::string> sceneIDs;
 
     {
@@ -284,8 +431,7 @@ void CollaborativePoseOptimiser::run_pose_graph_optimisation()
       }
 #endif
 
-      // Add any edge with at least one endpoint that is confidently connected to the primary scene to the pose graph.
-      bool graphHasEdges = false;
+      // Collect any edge with at least one endpoint that is confidently connected to the primary scene.
       std::string edgeDesc;
       for(int i = 0; i < sceneCount; ++i)
       {
@@ -313,22 +459,17 @@ void CollaborativePoseOptimiser::run_pose_graph_optimisation()
                     << GeometryUtil::to_matlab(relativeTransform->first.GetM()) << '\n';
 #endif
 
-          GraphEdgeSE3 *edge = new GraphEdgeSE3;
-          edge->setFromNodeId(j);
-          edge->setToNodeId(i);
-          edge->setMeasurementSE3(relativeTransform->first);
-          graph.addEdge(edge);
+          edges.insert(std::make_pair(std::make_pair(sceneIDs[i], sceneIDs[j]), relativeTransform->first));
 
           edgeDesc += " [color=red];\n";
-
-          graphHasEdges = true;
         }
       }
 
       // If no scenes are currently confidently connected to the primary scene, we can't build a valid pose graph.
-      if(!graphHasEdges) continue;
+      if(edges.empty()) continue;
 
-      // Add a node for each scene that is confidently connected to the primary scene to the pose graph.
+#if defined(WITH_GRAPHVIZ) && defined(WITH_OPENCV) && DEBUGGING
+      // Describe the nodes for each scene that is confidently connected to the primary scene.
       std::string nodeDesc;
       for(int i = 0; i < sceneCount; ++i)
       {
@@ -340,53 +481,45 @@ void CollaborativePoseOptimiser::run_pose_graph_optimisation()
           continue;
         }
 
-        /*std::map<std::string,ORUtils::SE3Pose>::const_iterator jt = m_estimatedGlobalPoses.find(sceneIDs[i]);*/
-
-        GraphNodeSE3 *node = new GraphNodeSE3;
-        node->setId(i);
-        node->setPose(/*jt != m_estimatedGlobalPoses.end() ? jt->second : */ORUtils::SE3Pose());
-        node->setFixed(i == primarySceneID);
-        graph.addNode(node);
-
         nodeDesc += " [fillcolor=cyan];\n";
       }
 
-#if 1
-      std::cout << "Finished creating pose graph for optimisation" << std::endl;
-#endif
-
-#if defined(WITH_GRAPHVIZ) && defined(WITH_OPENCV) && DEBUGGING
       static GraphVisualiser gv;
       ORUChar4Image_Ptr img = gv.generate_visualisation("digraph { node [ shape=rectangle, style=filled, fillcolor=white];\n" + nodeDesc + edgeDesc + " }");
       cv::Mat3b cvImg = OpenCVUtil::make_rgb_image(img->GetData(MEMORYDEVICE_CPU), img->noDims.x, img->noDims.y);
       cv::imshow("Pose Graph", cvImg);
       cv::waitKey(1);
 #endif
+
+      previousPoses = m_estimatedGlobalPoses;
     }
 
+    // If none of the confident edges has changed since the last optimisation, the optimised poses would be the same as before, so skip the optimisation.
+    const std::set<SceneIDPair> changedPairs = find_changed_pairs(edges, previousEdges);
+    if(changedPairs.empty()) continue;
+
+#if 1
+    std::cout << "Finished creating pose graph for optimisation" << std::endl;
+#endif
+
     // Run the pose graph optimisation.
-    graph.prepareEvaluations();
-    SlamGraphErrorFunction errFunc(graph);
-    SlamGraphErrorFunction::Parameters params(graph);
-    LevenbergMarquardtMethod::minimize(errFunc, params);
-    graph.setNodeIndex(params.getNodes());
+    std::map<std::string,SE3Pose> updatedPoses = optimise_global_poses(edges, previousEdges, changedPairs, previousPoses);
+    previousEdges.swap(edges);
 
     {
       boost::lock_guard<boost::mutex> lock(m_mutex);
 
-      // Extract and store the optimised poses.
-      for(int i = 0, sceneCount = static_cast<int>(sceneIDs.size()); i < sceneCount; ++i)
+      // Store the optimised poses, and publish a new snapshot of them for any readers.
+      for(std::map<std::string,SE3Pose>::const_iterator it = updatedPoses.begin(), iend = updatedPoses.end(); it != iend; ++it)
       {
-        SlamGraph::NodeIndex::const_iterator jt = graph.getNodeIndex().find(i);
-        if(jt == graph.getNodeIndex().end()) continue;
-
-        const GraphNodeSE3 *node = static_cast<const GraphNodeSE3*>(jt->second);
-        m_estimatedGlobalPoses[sceneIDs[i]] = node->getPose();
+        m_estimatedGlobalPoses[it->first] = it->second;
 
 #if DEBUGGING
-        std::cout << "Estimated Pose (" << i << '/' << sceneIDs[i] << "): " << GeometryUtil::to_matlab(node->getPose().GetM()) << '\n';
+        std::cout << "Estimated Pose (" << it->first << "): " << GeometryUtil::to_matlab(it->second.GetM()) << '\n';
 #endif
       }
+
+      publish_global_pose_snapshot();
     }
   }
 }
@@ -459,4 +592,36 @@ boost::optional<std::pair<SE3Pose,size_t> > CollaborativePoseOptimiser::try_get_
   return largestCluster ? boost::optional<std::pair<SE3Pose,size_t> >(std::make_pair(GeometryUtil::blend_poses(*largestCluster), largestCluster->size())) : boost::none;
 }
 
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+std::set<CollaborativePoseOptimiser::SceneIDPair>
+CollaborativePoseOptimiser::find_changed_pairs(const std::map<SceneIDPair,SE3Pose>& edges, const std::map<SceneIDPair,SE3Pose>& previousEdges)
+{
+  std::set<SceneIDPair> result;
+
+  // Find any edges that have been added, or whose relative transforms have changed.
+  for(std::map<SceneIDPair,SE3Pose>::const_iterator it = edges.begin(), iend = edges.end(); it != iend; ++it)
+  {
+    std::map<SceneIDPair,SE3Pose>::const_iterator jt = previousEdges.find(it->first);
+    bool changed = jt == previousEdges.end();
+    for(int k = 0; !changed && k < 16; ++k)
+    {
+      changed = it->second.GetM().m[k] != jt->second.GetM().m[k];
+    }
+
+    if(changed) result.insert(std::make_pair(std::min(it->first.first, it->first.second), std::max(it->first.first, it->first.second)));
+  }
+
+  // Find any edges that have been removed.
+  for(std::map<SceneIDPair,SE3Pose>::const_iterator it = previousEdges.begin(), iend = previousEdges.end(); it != iend; ++it)
+  {
+    if(edges.find(it->first) == edges.end())
+    {
+      result.insert(std::make_pair(std::min(it->first.first, it->first.second), std::max(it->first.first, it->first.second)));
+    }
+  }
+
+  return result;
+}
+
 }
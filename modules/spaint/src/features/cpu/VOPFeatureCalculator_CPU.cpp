@@ -5,6 +5,7 @@
 
 #include "features/cpu/VOPFeatureCalculator_CPU.h"
 
+#include <algorithm>
 #include <vector>
 
 #include <ITMLib/Objects/Scene/ITMRepresentationAccess.h>
@@ -30,12 +31,14 @@ void VOPFeatureCalculator_CPU::calculate_surface_normals(const ORUtils::MemoryBl
   Vector3f *surfaceNormals = m_surfaceNormalsMB->GetData(MEMORYDEVICE_CPU);
   const Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
   const int voxelLocationCount = static_cast<int>(voxelLocationsMB.dataSize);
+  const std::vector<int> order = make_block_order(voxelLocationsMB);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
+  for(int i = 0; i < voxelLocationCount; ++i)
   {
+    const int voxelLocationIndex = order[i];
     write_surface_normal(voxelLocationIndex, voxelLocations, voxelData, indexData, surfaceNormals, featureCount, features);
   }
 }
@@ -95,12 +98,14 @@ void VOPFeatureCalculator_CPU::generate_rgb_patches(const ORUtils::MemoryBlock<V
   const Vector3f *yAxes = m_yAxesMB->GetData(MEMORYDEVICE_CPU);
   const Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
   const int voxelLocationCount = static_cast<int>(voxelLocationsMB.dataSize);
+  const std::vector<int> order = make_block_order(voxelLocationsMB);
 
 #ifdef WITH_OPENMP
   #pragma omp parallel for
 #endif
-  for(int voxelLocationIndex = 0; voxelLocationIndex < voxelLocationCount; ++voxelLocationIndex)
+  for(int i = 0; i < voxelLocationCount; ++i)
   {
+    const int voxelLocationIndex = order[i];
     generate_rgb_patch(voxelLocationIndex, voxelLocations, xAxes, yAxes, voxelData, indexData, m_patchSize, m_patchSpacing, featureCount, features);
   }
 }
@@ -150,4 +155,36 @@ void VOPFeatureCalculator_CPU::update_coordinate_systems(int voxelLocationCount,
   }
 }
 
+//#################### PRIVATE STATIC MEMBER FUNCTIONS ####################
+
+std::vector<int> VOPFeatureCalculator_CPU::make_block_order(const ORUtils::MemoryBlock<Vector3s>& voxelLocationsMB)
+{
+  const Vector3s *voxelLocations = voxelLocationsMB.GetData(MEMORYDEVICE_CPU);
+  const int voxelLocationCount = static_cast<int>(voxelLocationsMB.dataSize);
+
+  // Make a sort key for each voxel location by packing the coordinates of the voxel block that contains it into a single integer.
+  // Note that the block coordinates of any voxel location that can be represented using shorts comfortably fit into 21 bits each.
+  const long long blockCoordOffset = 1LL << 20;
+  std::vector<std::pair<long long,int> > keyedIndices(voxelLocationCount);
+  for(int i = 0; i < voxelLocationCount; ++i)
+  {
+    const Vector3s& loc = voxelLocations[i];
+    const long long bx = (loc.x < 0 ? loc.x - SDF_BLOCK_SIZE + 1 : loc.x) / SDF_BLOCK_SIZE + blockCoordOffset;
+    const long long by = (loc.y < 0 ? loc.y - SDF_BLOCK_SIZE + 1 : loc.y) / SDF_BLOCK_SIZE + blockCoordOffset;
+    const long long bz = (loc.z < 0 ? loc.z - SDF_BLOCK_SIZE + 1 : loc.z) / SDF_BLOCK_SIZE + blockCoordOffset;
+    keyedIndices[i] = std::make_pair((bz << 42) | (by << 21) | bx, i);
+  }
+
+  // Sort the voxel locations by their keys, and return their indices in sorted order.
+  std::sort(keyedIndices.begin(), keyedIndices.end());
+
+  std::vector<int> order(voxelLocationCount);
+  for(int i = 0; i < voxelLocationCount; ++i)
+  {
+    order[i] = keyedIndices[i].second;
+  }
+
+  return order;
+}
+
 }
@@ -28,13 +28,13 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 CollaborativeComponent::CollaborativeComponent(const CollaborativeContext_Ptr& context, CollaborationMode mode)
-: m_context(context),
+: m_activeRelocalisationCount(0),
+  m_context(context),
   m_frameIndex(0),
   m_mode(mode),
   m_reconstructionIsConsistent(false),
   m_rng(12345),
-  m_stopRelocalisationThread(false),
-  m_visualisationGenerator(new VisualisationGenerator(context->get_settings()))
+  m_stopRelocalisationThreads(false)
 {
   const Settings_CPtr& settings = context->get_settings();
   const std::string settingsNamespace = "CollaborativeComponent.";
@@ -42,7 +42,20 @@ CollaborativeComponent::CollaborativeComponent(const CollaborativeContext_Ptr& c
   m_stopAtFirstConsistentReconstruction = settings->get_first_value<bool>(settingsNamespace + "stopAtFirstConsistentReconstruction", false);
   m_timeCollaboration = settings->get_first_value<bool>(settingsNamespace + "timeCollaboration", false);
 
-  m_relocalisationThread = boost::thread(boost::bind(&CollaborativeComponent::run_relocalisation, this));
+  // Set up the relocalisation workers, each of which has its own visualisation generator (and, later, its own render states and images),
+  // and start a thread for each of them.
+  const int relocalisationWorkerCount = std::max(settings->get_first_value<int>(settingsNamespace + "relocalisationWorkerCount", 1), 1);
+  for(int i = 0; i < relocalisationWorkerCount; ++i)
+  {
+    RelocalisationWorker_Ptr worker(new RelocalisationWorker);
+    worker->m_visualisationGenerator.reset(new VisualisationGenerator(settings));
+    m_relocalisationWorkers.push_back(worker);
+  }
+
+  for(size_t i = 0, size = m_relocalisationWorkers.size(); i < size; ++i)
+  {
+    m_relocalisationThreads.create_thread(boost::bind(&CollaborativeComponent::run_relocalisation, this, i));
+  }
 
   const std::string globalPosesSpecifier = settings->get_first_value<std::string>("globalPosesSpecifier", "");
   m_context->get_collaborative_pose_optimiser()->start(globalPosesSpecifier);
@@ -52,9 +65,13 @@ CollaborativeComponent::CollaborativeComponent(const CollaborativeContext_Ptr& c
 
 CollaborativeComponent::~CollaborativeComponent()
 {
-  m_stopRelocalisationThread = true;
-  m_readyToRelocalise.notify_one();
-  m_relocalisationThread.join();
+  // Note: The stop flag is set whilst holding the mutex to make sure that no relocalisation thread can miss the notification.
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_stopRelocalisationThreads = true;
+  }
+  m_readyToRelocalise.notify_all();
+  m_relocalisationThreads.join_all();
 
   // If we're computing the time spent collaborating:
   if(m_collaborationTimer)
@@ -127,6 +144,157 @@ void CollaborativeComponent::run_collaborative_pose_estimation()
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+void CollaborativeComponent::attempt_relocalisation(CollaborativeRelocalisation& candidate, RelocalisationWorker& worker)
+{
+  // Render synthetic images of the source scene from the relevant pose and copy them across to the GPU for use by the relocaliser.
+  // The synthetic images have the size of the images in the target scene and are generated using the target scene's intrinsics.
+  const SLAMState_CPtr slamStateI = m_context->get_slam_state(candidate.m_sceneI);
+  const SLAMState_CPtr slamStateJ = m_context->get_slam_state(candidate.m_sceneJ);
+  const View_CPtr viewI = slamStateI->get_view();
+
+  // Note: The images and render states are owned by the worker, and are reused across relocalisation attempts against the same target scene.
+  ORFloatImage_Ptr& depth = worker.m_depthImages[candidate.m_sceneI];
+  if(!depth) depth.reset(new ORFloatImage(slamStateI->get_depth_image_size(), true, true));
+
+  ORUChar4Image_Ptr& rgb = worker.m_rgbImages[candidate.m_sceneI];
+  if(!rgb) rgb.reset(new ORUChar4Image(slamStateI->get_rgb_image_size(), true, true));
+
+  VoxelRenderState_Ptr& renderStateD = worker.m_depthRenderStates[candidate.m_sceneI];
+  worker.m_visualisationGenerator->generate_depth_from_voxels(
+    depth, slamStateJ->get_voxel_scene(), candidate.m_localPoseJ, viewI->calib.intrinsics_d,
+    renderStateD, DepthVisualiser::DT_ORTHOGRAPHIC
+  );
+
+  VoxelRenderState_Ptr& renderStateRGB = worker.m_rgbRenderStates[candidate.m_sceneI];
+  worker.m_visualisationGenerator->generate_voxel_visualisation(
+    rgb, slamStateJ->get_voxel_scene(), candidate.m_localPoseJ, viewI->calib.intrinsics_rgb,
+    renderStateRGB, VisualisationGenerator::VT_SCENE_COLOUR, boost::none
+  );
+
+  depth->UpdateDeviceFromHost();
+  rgb->UpdateDeviceFromHost();
+
+#ifdef WITH_OPENCV
+  // Make OpenCV copies of the synthetic images we're trying to relocalise (these may be needed later).
+  cv::Mat3b cvSourceRGB = OpenCVUtil::make_rgb_image(rgb->GetData(MEMORYDEVICE_CPU), rgb->noDims.x, rgb->noDims.y);
+  cv::Mat1b cvSourceDepth = OpenCVUtil::make_greyscale_image(depth->GetData(MEMORYDEVICE_CPU), depth->noDims.x, depth->noDims.y, OpenCVUtil::ROW_MAJOR, 100.0f);
+
+  #if DEBUGGING
+  // If we're debugging, show the synthetic images of the source scene to the user.
+  cv::imshow("Source Depth", cvSourceDepth);
+  cv::imshow("Source RGB", cvSourceRGB);
+  #endif
+#endif
+
+  // Attempt to relocalise the synthetic images using the relocaliser for the target scene. Since not all relocalisers
+  // can safely be used from several threads at once, we make sure that only one worker at a time uses any given one.
+  Relocaliser_CPtr relocaliserI;
+  boost::shared_ptr<boost::mutex> relocaliserMutex;
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    relocaliserI = m_context->get_relocaliser(candidate.m_sceneI);
+    boost::shared_ptr<boost::mutex>& mutex = m_relocaliserMutexes[candidate.m_sceneI];
+    if(!mutex) mutex.reset(new boost::mutex);
+    relocaliserMutex = mutex;
+  }
+
+  std::vector<Relocaliser::Result> results;
+  {
+    boost::unique_lock<boost::mutex> lock(*relocaliserMutex);
+    results = relocaliserI->relocalise(rgb.get(), depth.get(), candidate.m_depthIntrinsicsI);
+  }
+  boost::optional<Relocaliser::Result> result = results.empty() ? boost::none : boost::optional<Relocaliser::Result>(results[0]);
+
+  // If the relocaliser returned a result, store the initial relocalisation quality for later examination.
+  if(result) candidate.m_initialRelocalisationQuality = result->quality;
+
+  // If relocalisation succeeded, verify the result by thresholding the difference between the
+  // source depth image and a rendered depth image of the target scene at the relevant pose.
+  bool verified = false;
+  if(result && (result->quality == Relocaliser::RELOCALISATION_GOOD || m_considerPoorRelocalisations))
+  {
+#ifdef WITH_OPENCV
+    // Render synthetic images of the target scene from the relevant pose.
+    worker.m_visualisationGenerator->generate_depth_from_voxels(
+      depth, slamStateI->get_voxel_scene(), result->pose.GetM(), viewI->calib.intrinsics_d,
+      renderStateD, DepthVisualiser::DT_ORTHOGRAPHIC
+    );
+
+    worker.m_visualisationGenerator->generate_voxel_visualisation(
+      rgb, slamStateI->get_voxel_scene(), result->pose.GetM(), viewI->calib.intrinsics_rgb,
+      renderStateRGB, VisualisationGenerator::VT_SCENE_COLOUR, boost::none
+    );
+
+    // Make OpenCV copies of the synthetic images of the target scene.
+    cv::Mat3b cvTargetRGB = OpenCVUtil::make_rgb_image(rgb->GetData(MEMORYDEVICE_CPU), rgb->noDims.x, rgb->noDims.y);
+    cv::Mat1b cvTargetDepth = OpenCVUtil::make_greyscale_image(depth->GetData(MEMORYDEVICE_CPU), depth->noDims.x, depth->noDims.y, OpenCVUtil::ROW_MAJOR, 100.0f);
+
+  #if DEBUGGING
+    // If we're debugging, show the synthetic images of the target scene to the user.
+    cv::imshow("Target RGB", cvTargetRGB);
+    cv::imshow("Target Depth", cvTargetDepth);
+  #endif
+
+    // Compute a binary mask showing which pixels are valid in both the source and target depth images.
+    cv::Mat cvSourceMask;
+    cv::inRange(cvSourceDepth, cv::Scalar(0,0,0), cv::Scalar(0,0,0), cvSourceMask);
+    cv::bitwise_not(cvSourceMask, cvSourceMask);
+
+    cv::Mat cvTargetMask;
+    cv::inRange(cvTargetDepth, cv::Scalar(0,0,0), cv::Scalar(0,0,0), cvTargetMask);
+    cv::bitwise_not(cvTargetMask, cvTargetMask);
+
+    cv::Mat cvCombinedMask;
+    cv::bitwise_and(cvSourceMask, cvTargetMask, cvCombinedMask);
+
+    // Compute the difference between the source and target depth images, and mask it using the combined mask.
+    cv::Mat cvDepthDiff, cvMaskedDepthDiff;
+    cv::absdiff(cvSourceDepth, cvTargetDepth, cvDepthDiff);
+    cvDepthDiff.copyTo(cvMaskedDepthDiff, cvCombinedMask);
+  #if DEBUGGING
+    cv::imshow("Masked Depth Difference", cvMaskedDepthDiff);
+  #endif
+
+    // Determine the average depth difference for valid pixels in the source and target depth images.
+    candidate.m_meanDepthDiff = cv::mean(cvMaskedDepthDiff);
+  #if DEBUGGING
+    std::cout << "\nMean Depth Difference: " << candidate.m_meanDepthDiff << std::endl;
+  #endif
+
+    // Compute the fraction of the target depth image that is valid.
+    candidate.m_targetValidFraction = static_cast<float>(cv::countNonZero(cvTargetMask == 255)) / (cvTargetMask.size().width * cvTargetMask.size().height);
+  #if DEBUGGING
+    std::cout << "Valid Target Pixels: " << cv::countNonZero(cvTargetMask == 255) << std::endl;
+  #endif
+
+    // Decide whether or not to verify the relocalisation, based on the average depth difference and the fraction of the target depth image that is valid.
+    verified = is_verified(candidate);
+#else
+    // If we didn't build with OpenCV, we can't do any verification, so just mark the relocalisation as verified and hope for the best.
+    verified = true;
+#endif
+  }
+
+  // If relocalisation succeeded and we successfully verified the result, add a sample of the
+  // relative transform between the source and target scenes to the pose graph optimiser.
+  if(verified)
+  {
+    // cjTwi^-1 * cjTwj = wiTcj * cjTwj = wiTwj
+    candidate.m_relativePose = ORUtils::SE3Pose(result->pose.GetInvM() * candidate.m_localPoseJ.GetM());
+    m_context->get_collaborative_pose_optimiser()->add_relative_transform_sample(candidate.m_sceneI, candidate.m_sceneJ, *candidate.m_relativePose, m_mode);
+  }
+
+  // Report the outcome of the relocalisation (this is done in a single statement so that the output of different workers is not interleaved).
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    std::cout << "Relocalising frame " << candidate.m_frameIndexJ << " of " << candidate.m_sceneJ << " against " << candidate.m_sceneI << "..." << (verified ? "succeeded!" : "failed :(") << std::endl;
+  }
+
+#if defined(WITH_OPENCV) && DEBUGGING
+  cv::waitKey(1);
+#endif
+}
+
 std::list<CollaborativeRelocalisation> CollaborativeComponent::generate_random_candidates(size_t desiredCandidateCount) const
 {
   static bool batchThisTime = true;
@@ -356,164 +524,39 @@ void CollaborativeComponent::output_results() const
   }
 }
 
-void CollaborativeComponent::run_relocalisation()
+void CollaborativeComponent::run_relocalisation(size_t workerIndex)
 {
-  while(!m_stopRelocalisationThread)
+  RelocalisationWorker& worker = *m_relocalisationWorkers[workerIndex];
+
+  while(!m_stopRelocalisationThreads)
   {
-    // Wait for a relocalisation to be scheduled.
+    // Wait for a relocalisation to be scheduled, and take ownership of it.
+    boost::optional<CollaborativeRelocalisation> candidate;
     {
       boost::unique_lock<boost::mutex> lock(m_mutex);
-      while(!m_bestCandidate)
+      while(m_scheduledCandidates.empty())
       {
-        m_readyToRelocalise.wait(lock);
-
         // If the collaborative component is terminating, stop attempting relocalisations and let the thread terminate.
-        if(m_stopRelocalisationThread) return;
-      }
-    }
+        if(m_stopRelocalisationThreads) return;
 
-    std::cout << "Attempting to relocalise frame " << m_bestCandidate->m_frameIndexJ << " of " << m_bestCandidate->m_sceneJ << " against " << m_bestCandidate->m_sceneI << "...";
-
-    // Render synthetic images of the source scene from the relevant pose and copy them across to the GPU for use by the relocaliser.
-    // The synthetic images have the size of the images in the target scene and are generated using the target scene's intrinsics.
-    const SLAMState_CPtr slamStateI = m_context->get_slam_state(m_bestCandidate->m_sceneI);
-    const SLAMState_CPtr slamStateJ = m_context->get_slam_state(m_bestCandidate->m_sceneJ);
-    const View_CPtr viewI = slamStateI->get_view();
-
-    ORFloatImage_Ptr depth(new ORFloatImage(slamStateI->get_depth_image_size(), true, true));
-    ORUChar4Image_Ptr rgb(new ORUChar4Image(slamStateI->get_rgb_image_size(), true, true));
-
-    VoxelRenderState_Ptr& renderStateD = m_depthRenderStates[m_bestCandidate->m_sceneI];
-    m_visualisationGenerator->generate_depth_from_voxels(
-      depth, slamStateJ->get_voxel_scene(), m_bestCandidate->m_localPoseJ, viewI->calib.intrinsics_d,
-      renderStateD, DepthVisualiser::DT_ORTHOGRAPHIC
-    );
-
-    VoxelRenderState_Ptr& renderStateRGB = m_rgbRenderStates[m_bestCandidate->m_sceneI];
-    m_visualisationGenerator->generate_voxel_visualisation(
-      rgb, slamStateJ->get_voxel_scene(), m_bestCandidate->m_localPoseJ, viewI->calib.intrinsics_rgb,
-      renderStateRGB, VisualisationGenerator::VT_SCENE_COLOUR, boost::none
-    );
-
-    depth->UpdateDeviceFromHost();
-    rgb->UpdateDeviceFromHost();
-
-#ifdef WITH_OPENCV
-    // Make OpenCV copies of the synthetic images we're trying to relocalise (these may be needed later).
-    cv::Mat3b cvSourceRGB = OpenCVUtil::make_rgb_image(rgb->GetData(MEMORYDEVICE_CPU), rgb->noDims.x, rgb->noDims.y);
-    cv::Mat1b cvSourceDepth = OpenCVUtil::make_greyscale_image(depth->GetData(MEMORYDEVICE_CPU), depth->noDims.x, depth->noDims.y, OpenCVUtil::ROW_MAJOR, 100.0f);
-
-  #if DEBUGGING
-    // If we're debugging, show the synthetic images of the source scene to the user.
-    cv::imshow("Source Depth", cvSourceDepth);
-    cv::imshow("Source RGB", cvSourceRGB);
-  #endif
-#endif
-
-    // Attempt to relocalise the synthetic images using the relocaliser for the target scene.
-    Relocaliser_CPtr relocaliserI = m_context->get_relocaliser(m_bestCandidate->m_sceneI);
-    std::vector<Relocaliser::Result> results = relocaliserI->relocalise(rgb.get(), depth.get(), m_bestCandidate->m_depthIntrinsicsI);
-    boost::optional<Relocaliser::Result> result = results.empty() ? boost::none : boost::optional<Relocaliser::Result>(results[0]);
-
-    // If the relocaliser returned a result, store the initial relocalisation quality for later examination.
-    if(result) m_bestCandidate->m_initialRelocalisationQuality = result->quality;
+        m_readyToRelocalise.wait(lock);
+      }
 
-    // If relocalisation succeeded, verify the result by thresholding the difference between the
-    // source depth image and a rendered depth image of the target scene at the relevant pose.
-    bool verified = false;
-    if(result && (result->quality == Relocaliser::RELOCALISATION_GOOD || m_considerPoorRelocalisations))
-    {
-#ifdef WITH_OPENCV
-      // Render synthetic images of the target scene from the relevant pose.
-      m_visualisationGenerator->generate_depth_from_voxels(
-        depth, slamStateI->get_voxel_scene(), result->pose.GetM(), viewI->calib.intrinsics_d,
-        renderStateD, DepthVisualiser::DT_ORTHOGRAPHIC
-      );
-
-      m_visualisationGenerator->generate_voxel_visualisation(
-        rgb, slamStateI->get_voxel_scene(), result->pose.GetM(), viewI->calib.intrinsics_rgb,
-        renderStateRGB, VisualisationGenerator::VT_SCENE_COLOUR, boost::none
-      );
-
-      // Make OpenCV copies of the synthetic images of the target scene.
-      cv::Mat3b cvTargetRGB = OpenCVUtil::make_rgb_image(rgb->GetData(MEMORYDEVICE_CPU), rgb->noDims.x, rgb->noDims.y);
-      cv::Mat1b cvTargetDepth = OpenCVUtil::make_greyscale_image(depth->GetData(MEMORYDEVICE_CPU), depth->noDims.x, depth->noDims.y, OpenCVUtil::ROW_MAJOR, 100.0f);
-
-    #if DEBUGGING
-      // If we're debugging, show the synthetic images of the target scene to the user.
-      cv::imshow("Target RGB", cvTargetRGB);
-      cv::imshow("Target Depth", cvTargetDepth);
-    #endif
-
-      // Compute a binary mask showing which pixels are valid in both the source and target depth images.
-      cv::Mat cvSourceMask;
-      cv::inRange(cvSourceDepth, cv::Scalar(0,0,0), cv::Scalar(0,0,0), cvSourceMask);
-      cv::bitwise_not(cvSourceMask, cvSourceMask);
-
-      cv::Mat cvTargetMask;
-      cv::inRange(cvTargetDepth, cv::Scalar(0,0,0), cv::Scalar(0,0,0), cvTargetMask);
-      cv::bitwise_not(cvTargetMask, cvTargetMask);
-
-      cv::Mat cvCombinedMask;
-      cv::bitwise_and(cvSourceMask, cvTargetMask, cvCombinedMask);
-
-      // Compute the difference between the source and target depth images, and mask it using the combined mask.
-      cv::Mat cvDepthDiff, cvMaskedDepthDiff;
-      cv::absdiff(cvSourceDepth, cvTargetDepth, cvDepthDiff);
-      cvDepthDiff.copyTo(cvMaskedDepthDiff, cvCombinedMask);
-    #if DEBUGGING
-      cv::imshow("Masked Depth Difference", cvMaskedDepthDiff);
-    #endif
-
-      // Determine the average depth difference for valid pixels in the source and target depth images.
-      m_bestCandidate->m_meanDepthDiff = cv::mean(cvMaskedDepthDiff);
-    #if DEBUGGING
-      std::cout << "\nMean Depth Difference: " << m_bestCandidate->m_meanDepthDiff << std::endl;
-    #endif
-
-      // Compute the fraction of the target depth image that is valid.
-      m_bestCandidate->m_targetValidFraction = static_cast<float>(cv::countNonZero(cvTargetMask == 255)) / (cvTargetMask.size().width * cvTargetMask.size().height);
-    #if DEBUGGING
-      std::cout << "Valid Target Pixels: " << cv::countNonZero(cvTargetMask == 255) << std::endl;
-    #endif
-
-      // Decide whether or not to verify the relocalisation, based on the average depth difference and the fraction of the target depth image that is valid.
-      verified = is_verified(*m_bestCandidate);
-#else
-      // If we didn't build with OpenCV, we can't do any verification, so just mark the relocalisation as verified and hope for the best.
-      verified = true;
-#endif
+      candidate = m_scheduledCandidates.front();
+      m_scheduledCandidates.pop_front();
+      ++m_activeRelocalisationCount;
     }
 
-    // If relocalisation succeeded and we successfully verified the result, add a sample of the
-    // relative transform between the source and target scenes to the pose graph optimiser.
-    if(verified)
-    {
-      // cjTwi^-1 * cjTwj = wiTcj * cjTwj = wiTwj
-      m_bestCandidate->m_relativePose = ORUtils::SE3Pose(result->pose.GetInvM() * m_bestCandidate->m_localPoseJ.GetM());
-      m_context->get_collaborative_pose_optimiser()->add_relative_transform_sample(m_bestCandidate->m_sceneI, m_bestCandidate->m_sceneJ, *m_bestCandidate->m_relativePose, m_mode);
-      std::cout << "succeeded!" << std::endl;
-
-#if defined(WITH_OPENCV) && DEBUGGING
-      cv::waitKey(1);
-#endif
-    }
-    else
-    {
-      std::cout << "failed :(" << std::endl;
-
-#if defined(WITH_OPENCV) && DEBUGGING
-      cv::waitKey(1);
-#endif
-    }
+    // Attempt the relocalisation.
+    attempt_relocalisation(*candidate, worker);
 
     // Record the results of the relocalisation we just tried if desired, and prepare for another relocalisation.
     {
       boost::unique_lock<boost::mutex> lock(m_mutex);
 #if DEBUGGING
-      m_results.push_back(*m_bestCandidate);
+      m_results.push_back(*candidate);
 #endif
-      m_bestCandidate.reset();
+      --m_activeRelocalisationCount;
     }
 
     // In live mode, allow a bit of extra time for training before running the next relocalisation.
@@ -569,12 +612,13 @@ void CollaborativeComponent::try_schedule_relocalisation()
   {
     boost::unique_lock<boost::mutex> lock(m_mutex);
 
-    // If an existing relocalisation attempt is in progress, early out.
-    if(m_bestCandidate) return;
+    // Determine how many relocalisation workers are free. If they're all busy (or already have scheduled work), early out.
+    const int freeWorkerCount = static_cast<int>(m_relocalisationWorkers.size()) - m_activeRelocalisationCount - static_cast<int>(m_scheduledCandidates.size());
+    if(freeWorkerCount <= 0) return;
 
 #if 1
-    // Randomly generate a list of candidate relocalisations.
-    const size_t desiredCandidateCount = 10;
+    // Randomly generate a list of candidate relocalisations (we generate the same number of candidates per free worker as we would for a single worker).
+    const size_t desiredCandidateCount = 10 * freeWorkerCount;
     std::list<CollaborativeRelocalisation> candidates = generate_random_candidates(desiredCandidateCount);
 #else
     // Generate the frames from the source scene in order, for evaluation purposes.
@@ -599,18 +643,25 @@ void CollaborativeComponent::try_schedule_relocalisation()
     std::cout << "END CANDIDATES\n";
 #endif
 
-    // Schedule the best candidate for relocalisation.
-    m_bestCandidate.reset(new CollaborativeRelocalisation(candidates.back()));
-
-    // If we're in batch mode, record the index of the frame we're trying in case we want to avoid frames with similar poses later.
-    if(m_mode == CM_BATCH)
+    // Schedule the best candidates for relocalisation (one for each free worker), skipping any duplicates.
+    std::set<std::pair<std::pair<std::string,std::string>,int> > chosenCandidates;
+    for(std::list<CollaborativeRelocalisation>::const_reverse_iterator it = candidates.rbegin(), iend = candidates.rend(); it != iend && static_cast<int>(chosenCandidates.size()) < freeWorkerCount; ++it)
     {
-      std::set<int>& triedFrameIndices = m_triedFrameIndices[std::make_pair(m_bestCandidate->m_sceneI, m_bestCandidate->m_sceneJ)];
-      triedFrameIndices.insert(m_bestCandidate->m_frameIndexJ);
+      const CollaborativeRelocalisation& candidate = *it;
+      if(!chosenCandidates.insert(std::make_pair(std::make_pair(candidate.m_sceneI, candidate.m_sceneJ), candidate.m_frameIndexJ)).second) continue;
+
+      m_scheduledCandidates.push_back(candidate);
+
+      // If we're in batch mode, record the index of the frame we're trying in case we want to avoid frames with similar poses later.
+      if(m_mode == CM_BATCH)
+      {
+        std::set<int>& triedFrameIndices = m_triedFrameIndices[std::make_pair(candidate.m_sceneI, candidate.m_sceneJ)];
+        triedFrameIndices.insert(candidate.m_frameIndexJ);
+      }
     }
   }
 
-  m_readyToRelocalise.notify_one();
+  m_readyToRelocalise.notify_all();
 }
 
 bool CollaborativeComponent::update_trajectories()
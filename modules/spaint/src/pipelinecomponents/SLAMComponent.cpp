@@ -5,6 +5,9 @@
 
 #include "pipelinecomponents/SLAMComponent.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <boost/filesystem.hpp>
 #include <boost/serialization/extended_type_info.hpp>
 #include <boost/serialization/singleton.hpp>
@@ -13,6 +16,8 @@ namespace bf = boost::filesystem;
 
 #include <ITMLib/Engines/LowLevel/ITMLowLevelEngineFactory.h>
 #include <ITMLib/Engines/ViewBuilding/ITMViewBuilderFactory.h>
+#include <ITMLib/Engines/Visualisation/ITMSurfelVisualisationEngineFactory.h>
+#include <ITMLib/Engines/Visualisation/ITMVisualisationEngineFactory.h>
 #include <ITMLib/Objects/Camera/ITMCalibIO.h>
 #include <ITMLib/Objects/RenderStates/ITMRenderStateFactory.h>
 using namespace InputSource;
@@ -85,6 +90,10 @@ SLAMComponent::SLAMComponent(const SLAMContext_Ptr& context, const std::string&
   // Set up the view builder.
   m_viewBuilder.reset(ITMViewBuilderFactory::MakeViewBuilder(m_imageSourceEngine->getCalib(), settings->deviceType));
 
+  // Set up the visualisation engines used when preparing for tracking.
+  m_surfelVisualisationEngine.reset(ITMSurfelVisualisationEngineFactory<SpaintSurfel>::make_surfel_visualisation_engine(settings->deviceType));
+  m_voxelVisualisationEngine.reset(ITMVisualisationEngineFactory::MakeVisualisationEngine<SpaintVoxel,ITMVoxelIndex>(settings->deviceType));
+
   // Set up the scenes.
   MemoryDeviceType memoryType = settings->GetMemoryType();
   slamState->set_voxel_scene(SpaintVoxelScene_Ptr(new SpaintVoxelScene(&settings->sceneParams, settings->swappingMode == ITMLibSettings::SWAPPINGMODE_ENABLED, memoryType)));
@@ -126,6 +135,10 @@ SLAMComponent::SLAMComponent(const SLAMContext_Ptr& context, const std::string&
   // Add the scene to the list of existing scenes.
   context->add_scene_id(sceneID);
 
+  // Make sure that the context has a (possibly null) mapping client entry for the scene, so that looking it up when processing
+  // frames does not modify the context's map of mapping clients (this allows frames for different scenes to be processed concurrently).
+  context->get_mapping_client(sceneID);
+
   // Set up the fiducial detector (if any).
   setup_fiducial_detector();
 }
@@ -137,6 +150,11 @@ bool SLAMComponent::get_fusion_enabled() const
   return m_fusionEnabled;
 }
 
+const std::string& SLAMComponent::get_mirror_scene_id() const
+{
+  return m_mirrorSceneID;
+}
+
 const std::string& SLAMComponent::get_scene_id() const
 {
   return m_sceneID;
@@ -336,7 +354,7 @@ bool SLAMComponent::process_frame()
   // If we're using surfel mapping, render a supersampled index image to use when finding surfel correspondences in the next frame.
   if(m_mappingMode != MAP_VOXELS_ONLY)
   {
-    m_context->get_surfel_visualisation_engine()->FindSurfaceSuper(surfelScene.get(), trackingState->pose_d, &view->calib.intrinsics_d, USR_RENDER, liveSurfelRenderState.get());
+    m_surfelVisualisationEngine->FindSurfaceSuper(surfelScene.get(), trackingState->pose_d, &view->calib.intrinsics_d, USR_RENDER, liveSurfelRenderState.get());
   }
 
   // If we're using a composite image source engine, the current sub-engine has run out of images and we're not using global poses, disable fusion.
@@ -480,7 +498,7 @@ void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
     {
       const SpaintSurfelScene_Ptr& surfelScene = slamState->get_surfel_scene();
       const SurfelRenderState_Ptr& liveSurfelRenderState = slamState->get_live_surfel_render_state();
-      m_trackingController->Prepare(trackingState.get(), surfelScene.get(), view.get(), m_context->get_surfel_visualisation_engine().get(), liveSurfelRenderState.get());
+      m_trackingController->Prepare(trackingState.get(), surfelScene.get(), view.get(), m_surfelVisualisationEngine.get(), liveSurfelRenderState.get());
       break;
     }
     case TRACK_VOXELS:
@@ -488,7 +506,7 @@ void SLAMComponent::prepare_for_tracking(TrackingMode trackingMode)
     {
       const SpaintVoxelScene_Ptr& voxelScene = slamState->get_voxel_scene();
       const VoxelRenderState_Ptr& liveVoxelRenderState = slamState->get_live_voxel_render_state();
-      m_trackingController->Prepare(trackingState.get(), voxelScene.get(), view.get(), m_context->get_voxel_visualisation_engine().get(), liveVoxelRenderState.get());
+      m_trackingController->Prepare(trackingState.get(), voxelScene.get(), view.get(), m_voxelVisualisationEngine.get(), liveVoxelRenderState.get());
       break;
     }
   }
@@ -564,14 +582,22 @@ Relocaliser_Ptr SLAMComponent::refine_with_icp(const Relocaliser_Ptr& relocalise
   if(trackerParams != "") trackerConfig += "<params>" + trackerParams + "</params>";
   trackerConfig += "</tracker>";
 
+  // Make one refinement tracker for each refinement worker (on the CPU, the workers are used to refine several initial poses concurrently).
+  // On the GPU, the initial poses are refined one at a time, so any additional workers would never be used and we only make one.
+  const size_t refinementWorkerCount = settings->deviceType == DEVICE_CUDA ? 1 :
+    std::max<size_t>(settings->get_first_value<size_t>("ICPRefiningRelocaliser.refinementWorkerCount", 1), 1);
   const bool trackSurfels = false;
-  FallibleTracker *dummy;
-  Tracker_Ptr tracker = m_context->get_tracker_factory().make_tracker_from_string(
-    trackerConfig, m_sceneID, trackSurfels, rgbImageSize, depthImageSize, m_lowLevelEngine, m_imuCalibrator, settings, dummy
-  );
+  std::vector<Tracker_Ptr> trackers;
+  for(size_t i = 0; i < refinementWorkerCount; ++i)
+  {
+    FallibleTracker *dummy;
+    trackers.push_back(m_context->get_tracker_factory().make_tracker_from_string(
+      trackerConfig, m_sceneID, trackSurfels, rgbImageSize, depthImageSize, m_lowLevelEngine, m_imuCalibrator, settings, dummy
+    ));
+  }
 
   return Relocaliser_Ptr(new ICPRefiningRelocaliser<SpaintVoxel,ITMVoxelIndex>(
-    relocaliser, tracker, rgbImageSize, depthImageSize, m_imageSourceEngine->getCalib(), voxelScene, m_denseVoxelMapper, settings
+    relocaliser, trackers, rgbImageSize, depthImageSize, m_imageSourceEngine->getCalib(), voxelScene, m_denseVoxelMapper, settings
   ));
 }
 
@@ -63,6 +63,7 @@ SemanticSegmentationComponent::SemanticSegmentationComponent(const SemanticSegme
   MemoryBlockFactory& mbf = MemoryBlockFactory::instance();
   const size_t featureCount = m_featureCalculator->get_feature_count();
   m_predictionFeaturesMB = mbf.make_block<float>(m_maxPredictionVoxelCount * featureCount);
+  m_predictionForestLabels.resize(m_maxPredictionVoxelCount);
   m_predictionLabelsMB = mbf.make_block<SpaintVoxel::PackedLabel>(m_maxPredictionVoxelCount);
   m_predictionVoxelLocationsMB = mbf.make_block<Vector3s>(m_maxPredictionVoxelCount);
   m_trainingFeaturesMB = mbf.make_block<float>(maxTrainingVoxelCount * featureCount);
@@ -86,7 +87,8 @@ void SemanticSegmentationComponent::reset_forest()
 {
   const size_t treeCount = 5;
   DecisionTree<SpaintVoxel::Label>::Settings dtSettings(m_context->get_resources_dir() + "/RaflSettings.xml");
-  m_forest.reset(new RandomForest<SpaintVoxel::Label>(treeCount, dtSettings));
+  const bool parallelTraining = m_context->get_settings()->get_first_value<bool>("SemanticSegmentationComponent.parallelTraining", false);
+  m_forest.reset(new RandomForest<SpaintVoxel::Label>(treeCount, dtSettings, parallelTraining));
 }
 
 void SemanticSegmentationComponent::reset_voxel_samplers(int raycastResultSize)
@@ -138,17 +140,21 @@ void SemanticSegmentationComponent::run_prediction(const VoxelRenderState_CPtr&
 
   // Calculate feature descriptors for the sampled voxels.
   m_featureCalculator->calculate_features(*m_predictionVoxelLocationsMB, m_context->get_slam_state(m_sceneID)->get_voxel_scene().get(), *m_predictionFeaturesMB);
-  std::vector<Descriptor_CPtr> descriptors = ForestUtil::make_descriptors(*m_predictionFeaturesMB, m_maxPredictionVoxelCount, m_featureCalculator->get_feature_count());
+  m_predictionFeaturesMB->UpdateHostFromDevice();
 
-  // Predict labels for the voxels based on the feature descriptors.
-  SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
+  // Predict labels for the voxels based on the feature descriptors (directly from the feature memory block).
+  m_forest->predict_batch(
+    m_predictionFeaturesMB->GetData(MEMORYDEVICE_CPU),
+    m_maxPredictionVoxelCount,
+    m_featureCalculator->get_feature_count(),
+    &m_predictionForestLabels[0]
+  );
 
-#ifdef WITH_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < static_cast<int>(m_maxPredictionVoxelCount); ++i)
+  // Pack the predicted labels so that they can be used to mark the voxels.
+  SpaintVoxel::PackedLabel *labels = m_predictionLabelsMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < m_maxPredictionVoxelCount; ++i)
   {
-    labels[i] = SpaintVoxel::PackedLabel(m_forest->predict(descriptors[i]), SpaintVoxel::LG_FOREST);
+    labels[i] = SpaintVoxel::PackedLabel(m_predictionForestLabels[i], SpaintVoxel::LG_FOREST);
   }
 
   m_predictionLabelsMB->UpdateDeviceFromHost();
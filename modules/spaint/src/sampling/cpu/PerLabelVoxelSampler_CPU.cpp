@@ -5,6 +5,16 @@
 
 #include "sampling/cpu/PerLabelVoxelSampler_CPU.h"
 
+#include <algorithm>
+#include <vector>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+#include <orx/base/MemoryBlockFactory.h>
+using orx::MemoryBlockFactory;
+
 #include "sampling/shared/PerLabelVoxelSampler_Shared.h"
 
 namespace spaint {
@@ -12,96 +22,87 @@ namespace spaint {
 //#################### CONSTRUCTORS ####################
 
 PerLabelVoxelSampler_CPU::PerLabelVoxelSampler_CPU(size_t maxLabelCount, size_t maxVoxelsPerLabel, int raycastResultSize, unsigned int seed)
-: PerLabelVoxelSampler(maxLabelCount, maxVoxelsPerLabel, raycastResultSize, seed)
+: PerLabelVoxelSampler(maxLabelCount, maxVoxelsPerLabel, raycastResultSize, seed),
+  m_candidateVoxelLocationsMB(MemoryBlockFactory::instance().make_block<Vector3s>(raycastResultSize)),
+  m_candidateVoxelOffsetsMB(MemoryBlockFactory::instance().make_block<unsigned int>(maxLabelCount)),
+  m_voxelLabelsMB(MemoryBlockFactory::instance().make_block<int>(raycastResultSize))
 {}
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
-void PerLabelVoxelSampler_CPU::calculate_voxel_mask_prefix_sums(const ORUtils::MemoryBlock<bool>& labelMaskMB) const
+void PerLabelVoxelSampler_CPU::write_candidate_voxel_locations(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                                               const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
 {
   const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
-  const unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
-  unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CPU);
-
-  // For each possible label:
-  const int stride = m_raycastResultSize + 1;
-  for(size_t k = 0; k < m_maxLabelCount; ++k)
-  {
-    // If the label is not currently in use, continue.
-    if(!labelMask[k]) continue;
-
-    // Calculate the prefix sum of the voxel mask.
-    const size_t offset = k * stride;
-    voxelMaskPrefixSums[offset] = 0;
-    for(int i = 1; i < stride; ++i)
-    {
-      voxelMaskPrefixSums[offset + i] = voxelMaskPrefixSums[offset + (i - 1)] + voxelMasks[offset + (i - 1)];
-    }
-  }
-}
-
-void PerLabelVoxelSampler_CPU::calculate_voxel_masks(const ORFloat4Image *raycastResult,
-                                                     const SpaintVoxel *voxelData,
-                                                     const ITMVoxelIndex::IndexData *indexData) const
-{
   const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
-  unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
+  Vector3s *candidateVoxelLocations = m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  unsigned int *candidateVoxelOffsets = m_candidateVoxelOffsetsMB->GetData(MEMORYDEVICE_CPU);
+  int *voxelLabels = m_voxelLabelsMB->GetData(MEMORYDEVICE_CPU);
+  unsigned int *voxelCountsForLabels = voxelCountsForLabelsMB.GetData(MEMORYDEVICE_CPU);
 
+  // We bucket the candidate voxels by label using a parallel counting sort. To do this, we divide the raycast result into
+  // contiguous chunks (one per thread), and count the candidates for each label in each chunk. Since each chunk's candidates
+  // are later written out in order, the candidates for each label end up in raycast result order, as they would if the
+  // bucketing were done serially.
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  const int chunkCount = std::max(1, std::min(omp_get_max_threads(), m_raycastResultSize));
+#else
+  const int chunkCount = 1;
 #endif
-  for(int voxelIndex = 0; voxelIndex < m_raycastResultSize; ++voxelIndex)
-  {
-    // Update the voxel masks based on the contents of the voxel.
-    update_masks_for_voxel(
-      voxelIndex,
-      raycastResultData,
-      m_raycastResultSize,
-      voxelData,
-      indexData,
-      m_maxLabelCount,
-      voxelMasks
-    );
-  }
-}
-
-void PerLabelVoxelSampler_CPU::write_candidate_voxel_counts(const ORUtils::MemoryBlock<bool>& labelMaskMB,
-                                                            ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
-{
-  const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
-  const unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CPU);
-  unsigned int *voxelCountsForLabels = voxelCountsForLabelsMB.GetData(MEMORYDEVICE_CPU);
+  const int chunkSize = (m_raycastResultSize + chunkCount - 1) / chunkCount;
+  const int labelCount = static_cast<int>(m_maxLabelCount);
+  std::vector<unsigned int> chunkOffsets(chunkCount * labelCount, 0);
 
+  // First, find the label (if any) for which each voxel is a candidate, and count the candidates for each label in each chunk.
+  // Note that this is the only pass that needs to look up the voxels in the scene.
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(static, 1)
 #endif
-  for(int k = 0; k < static_cast<int>(m_maxLabelCount); ++k)
+  for(int chunk = 0; chunk < chunkCount; ++chunk)
   {
-    write_candidate_voxel_count(k, m_raycastResultSize, labelMask, voxelMaskPrefixSums, voxelCountsForLabels);
+    unsigned int *chunkCounts = &chunkOffsets[chunk * labelCount];
+    for(int voxelIndex = chunk * chunkSize, end = std::min(voxelIndex + chunkSize, m_raycastResultSize); voxelIndex < end; ++voxelIndex)
+    {
+      int label = find_candidate_label(voxelIndex, raycastResultData, voxelData, indexData, m_maxLabelCount);
+
+      // Note: We ignore any voxels whose labels are not currently in use (in practice, there should not be any).
+      if(label != -1 && !labelMask[label]) label = -1;
+
+      voxelLabels[voxelIndex] = label;
+      if(label != -1) ++chunkCounts[label];
+    }
   }
-}
 
-void PerLabelVoxelSampler_CPU::write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const
-{
-  const Vector4f *raycastResultData = raycastResult->GetData(MEMORYDEVICE_CPU);
-  const unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
-  const unsigned int *voxelMaskPrefixSums = m_voxelMaskPrefixSumsMB->GetData(MEMORYDEVICE_CPU);
-  Vector3s *candidateVoxelLocations = m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  // Next, compute the offset of each label's group of candidates in the candidate voxel locations array, and the offset of
+  // each chunk's candidates within each group. This pass only touches the per-chunk counts, so it is cheap to do serially.
+  unsigned int offset = 0;
+  for(int k = 0; k < labelCount; ++k)
+  {
+    candidateVoxelOffsets[k] = offset;
+    for(int chunk = 0; chunk < chunkCount; ++chunk)
+    {
+      const unsigned int count = chunkOffsets[chunk * labelCount + k];
+      chunkOffsets[chunk * labelCount + k] = offset;
+      offset += count;
+    }
+    voxelCountsForLabels[k] = offset - candidateVoxelOffsets[k];
+  }
 
+  // Finally, write the locations of the candidates into their groups in the candidate voxel locations array.
 #ifdef WITH_OPENMP
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(static, 1)
 #endif
-  for(int voxelIndex = 0; voxelIndex < m_raycastResultSize; ++voxelIndex)
+  for(int chunk = 0; chunk < chunkCount; ++chunk)
   {
-    write_candidate_voxel_location(
-      voxelIndex,
-      raycastResultData,
-      m_raycastResultSize,
-      voxelMasks,
-      voxelMaskPrefixSums,
-      m_maxLabelCount,
-      candidateVoxelLocations
-    );
+    unsigned int *nextIndices = &chunkOffsets[chunk * labelCount];
+    for(int voxelIndex = chunk * chunkSize, end = std::min(voxelIndex + chunkSize, m_raycastResultSize); voxelIndex < end; ++voxelIndex)
+    {
+      const int label = voxelLabels[voxelIndex];
+      if(label != -1)
+      {
+        candidateVoxelLocations[nextIndices[label]++] = raycastResultData[voxelIndex].toVector3().toShortRound();
+      }
+    }
   }
 }
 
@@ -109,6 +110,7 @@ void PerLabelVoxelSampler_CPU::write_sampled_voxel_locations(const ORUtils::Memo
                                                              ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB) const
 {
   const Vector3s *candidateVoxelLocations = m_candidateVoxelLocationsMB->GetData(MEMORYDEVICE_CPU);
+  const unsigned int *candidateVoxelOffsets = m_candidateVoxelOffsetsMB->GetData(MEMORYDEVICE_CPU);
   const int *candidateVoxelIndices = m_candidateVoxelIndicesMB->GetData(MEMORYDEVICE_CPU);
   const bool *labelMask = labelMaskMB.GetData(MEMORYDEVICE_CPU);
   Vector3s *sampledVoxelLocations = sampledVoxelLocationsMB.GetData(MEMORYDEVICE_CPU);
@@ -118,16 +120,18 @@ void PerLabelVoxelSampler_CPU::write_sampled_voxel_locations(const ORUtils::Memo
 #endif
   for(int voxelIndex = 0; voxelIndex < static_cast<int>(m_maxVoxelsPerLabel); ++voxelIndex)
   {
-    copy_sampled_voxel_locations(
-      voxelIndex,
-      labelMask,
-      m_maxLabelCount,
-      m_maxVoxelsPerLabel,
-      m_raycastResultSize,
-      candidateVoxelLocations,
-      candidateVoxelIndices,
-      sampledVoxelLocations
-    );
+    for(size_t k = 0; k < m_maxLabelCount; ++k)
+    {
+      if(!labelMask[k]) continue;
+
+      // Note: A candidate voxel index of -1 indicates that no voxel location has been sampled for this label and voxel index.
+      const size_t sampleIndex = k * m_maxVoxelsPerLabel + voxelIndex;
+      const int candidateVoxelIndex = candidateVoxelIndices[sampleIndex];
+      if(candidateVoxelIndex != -1)
+      {
+        sampledVoxelLocations[sampleIndex] = candidateVoxelLocations[candidateVoxelOffsets[k] + candidateVoxelIndex];
+      }
+    }
   }
 }
 
@@ -7,6 +7,9 @@
 
 #include <cassert>
 
+#include <orx/base/MemoryBlockFactory.h>
+using orx::MemoryBlockFactory;
+
 #ifdef _MSC_VER
   // Suppress some VC++ warnings that are produced when including the Thrust headers.
   #pragma warning(disable:4267)
@@ -72,8 +75,19 @@ __global__ void ck_write_candidate_voxel_locations(const Vector4f *raycastResult
 //#################### CONSTRUCTORS ####################
 
 PerLabelVoxelSampler_CUDA::PerLabelVoxelSampler_CUDA(size_t maxLabelCount, size_t maxVoxelsPerLabel, int raycastResultSize, unsigned int seed)
-: PerLabelVoxelSampler(maxLabelCount, maxVoxelsPerLabel, raycastResultSize, seed)
-{}
+: PerLabelVoxelSampler(maxLabelCount, maxVoxelsPerLabel, raycastResultSize, seed),
+  m_candidateVoxelLocationsMB(MemoryBlockFactory::instance().make_block<Vector3s>(maxLabelCount * raycastResultSize)),
+  m_voxelMaskPrefixSumsMB(MemoryBlockFactory::instance().make_block<unsigned int>(maxLabelCount * (raycastResultSize + 1))),
+  m_voxelMasksMB(MemoryBlockFactory::instance().make_block<unsigned char>(maxLabelCount * (raycastResultSize + 1)))
+{
+  // Make sure that the dummy elements at the end of the voxel masks for the various labels are properly initialised.
+  unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
+  for(size_t k = 1; k <= maxLabelCount; ++k)
+  {
+    voxelMasks[k * (raycastResultSize + 1) - 1] = 0;
+  }
+  m_voxelMasksMB->UpdateDeviceFromHost();
+}
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
@@ -143,7 +157,27 @@ void PerLabelVoxelSampler_CUDA::write_candidate_voxel_counts(const ORUtils::Memo
   voxelCountsForLabelsMB.UpdateHostFromDevice();
 }
 
-void PerLabelVoxelSampler_CUDA::write_candidate_voxel_locations(const ORFloat4Image *raycastResult) const
+void PerLabelVoxelSampler_CUDA::write_candidate_voxel_locations(const ORFloat4Image *raycastResult, const SpaintVoxel *voxelData, const ITMVoxelIndex::IndexData *indexData,
+                                                                const ORUtils::MemoryBlock<bool>& labelMaskMB, ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
+{
+  // Calculate the voxel masks for all labels (these indicate which voxels could serve as examples of each label).
+  // Note that we calculate masks even for unused labels to avoid unnecessary branching - these will always be empty.
+  calculate_voxel_masks(raycastResult, voxelData, indexData);
+
+  // Calculate the prefix sums of the voxel masks for the used labels (these can be used to determine the locations in
+  // the candidate voxel locations array into which candidate voxels should be written).
+  calculate_voxel_mask_prefix_sums(labelMaskMB);
+
+  // Based on the voxel masks and the prefix sums, write the candidate voxel locations into the candidate voxel locations array.
+  // Note that we do not need to explicitly use the label mask when writing candidate voxel locations, since the voxel mask for
+  // an unused label will be empty in any case.
+  write_masked_voxel_locations(raycastResult);
+
+  // Write the candidate voxel counts for the used labels into the voxel counts array.
+  write_candidate_voxel_counts(labelMaskMB, voxelCountsForLabelsMB);
+}
+
+void PerLabelVoxelSampler_CUDA::write_masked_voxel_locations(const ORFloat4Image *raycastResult) const
 {
   int threadsPerBlock = 256;
   int numBlocks = (m_raycastResultSize + threadsPerBlock - 1) / threadsPerBlock;
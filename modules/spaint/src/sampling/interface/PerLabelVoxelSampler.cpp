@@ -16,22 +16,11 @@ namespace spaint {
 
 PerLabelVoxelSampler::PerLabelVoxelSampler(size_t maxLabelCount, size_t maxVoxelsPerLabel, int raycastResultSize, unsigned int seed)
 : m_candidateVoxelIndicesMB(MemoryBlockFactory::instance().make_block<int>(maxLabelCount * maxVoxelsPerLabel)),
-  m_candidateVoxelLocationsMB(MemoryBlockFactory::instance().make_block<Vector3s>(maxLabelCount * raycastResultSize)),
   m_maxLabelCount(maxLabelCount),
   m_maxVoxelsPerLabel(maxVoxelsPerLabel),
   m_raycastResultSize(raycastResultSize),
-  m_rng(new tvgutil::RandomNumberGenerator(seed)),
-  m_voxelMaskPrefixSumsMB(MemoryBlockFactory::instance().make_block<unsigned int>(maxLabelCount * (raycastResultSize + 1))),
-  m_voxelMasksMB(MemoryBlockFactory::instance().make_block<unsigned char>(maxLabelCount * (raycastResultSize + 1)))
-{
-  // Make sure that the dummy elements at the end of the voxel masks for the various labels are properly initialised.
-  unsigned char *voxelMasks = m_voxelMasksMB->GetData(MEMORYDEVICE_CPU);
-  for(size_t k = 1; k <= maxLabelCount; ++k)
-  {
-    voxelMasks[k * (raycastResultSize + 1) - 1] = 0;
-  }
-  m_voxelMasksMB->UpdateDeviceFromHost();
-}
+  m_rng(new tvgutil::RandomNumberGenerator(seed))
+{}
 
 //#################### DESTRUCTOR ####################
 
@@ -44,23 +33,11 @@ void PerLabelVoxelSampler::sample_voxels(const ORFloat4Image *raycastResult, con
                                          ORUtils::MemoryBlock<Vector3s>& sampledVoxelLocationsMB,
                                          ORUtils::MemoryBlock<unsigned int>& voxelCountsForLabelsMB) const
 {
-  // Calculate the voxel masks for all labels (these indicate which voxels could serve as examples of each label).
-  // Note that we calculate masks even for unused labels to avoid unnecessary branching - these will always be empty.
+  // Find the candidate voxels for each used label (i.e. the voxels that could serve as examples of the label), and write
+  // their locations and the number of candidates available for each label into the appropriate arrays.
   const SpaintVoxel *voxelData = scene->localVBA.GetVoxelBlocks();
   const ITMVoxelIndex::IndexData *indexData = scene->index.getIndexData();
-  calculate_voxel_masks(raycastResult, voxelData, indexData);
-
-  // Calculate the prefix sums of the voxel masks for the used labels (these can be used to determine the locations in
-  // the candidate voxel locations array into which candidate voxels should be written).
-  calculate_voxel_mask_prefix_sums(labelMaskMB);
-
-  // Based on the voxel masks and the prefix sums, write the candidate voxel locations into the candidate voxel locations array.
-  // Note that we do not need to explicitly use the label mask when writing candidate voxel locations, since the voxel mask for
-  // an unused label will be empty in any case.
-  write_candidate_voxel_locations(raycastResult);
-
-  // Write the candidate voxel counts for the used labels into the voxel counts array.
-  write_candidate_voxel_counts(labelMaskMB, voxelCountsForLabelsMB);
+  write_candidate_voxel_locations(raycastResult, voxelData, indexData, labelMaskMB, voxelCountsForLabelsMB);
 
   // Randomly choose candidate voxel locations to sample for each used label.
   // TODO: It might be a good idea to implement this on both the CPU and GPU to avoid the memory transfer.
@@ -43,6 +43,12 @@ VisualisationGenerator::VisualisationGenerator(const Settings_CPtr& settings, co
 
 //#################### PUBLIC MEMBER FUNCTIONS ####################
 
+void VisualisationGenerator::generate_depth_from_raycast(const ORFloatImage_Ptr& output, const ORUtils::SE3Pose& pose, const VoxelRenderState_CPtr& renderState,
+                                                         DepthVisualiser::DepthType depthType) const
+{
+  DepthVisualisationUtil<SpaintVoxel,ITMVoxelIndex>::generate_depth_from_raycast(output, pose, renderState, depthType, m_depthVisualiser, m_settings);
+}
+
 void VisualisationGenerator::generate_depth_from_voxels(const ORFloatImage_Ptr& output, const SpaintVoxelScene_CPtr& scene, const ORUtils::SE3Pose& pose,
                                                         const ITMIntrinsics& intrinsics, VoxelRenderState_Ptr& renderState, DepthVisualiser::DepthType depthType) const
 {
@@ -83,10 +89,10 @@ void VisualisationGenerator::generate_surfel_visualisation(const ORUChar4Image_P
     case VT_SCENE_DEPTH:
     {
       // FIXME: This is a workaround that is needed because DepthToUchar4 is currently CPU-only.
-      static ORFloatImage temp(output->noDims, true, true);
-      m_surfelVisualisationEngine->RenderDepthImage(scene.get(), &pose, renderState.get(), &temp);
-      if(m_settings->deviceType == DEVICE_CUDA) temp.UpdateHostFromDevice();
-      IITMVisualisationEngine::DepthToUchar4(output.get(), &temp);
+      const ORFloatImage_Ptr& temp = get_temp_depth_image(output->noDims);
+      m_surfelVisualisationEngine->RenderDepthImage(scene.get(), &pose, renderState.get(), temp.get());
+      if(m_settings->deviceType == DEVICE_CUDA) temp->UpdateHostFromDevice();
+      IITMVisualisationEngine::DepthToUchar4(output.get(), temp.get());
       if(m_settings->deviceType == DEVICE_CUDA) output->UpdateDeviceFromHost();
       break;
     }
@@ -142,8 +148,10 @@ void VisualisationGenerator::generate_voxel_visualisation(const ORUChar4Image_Pt
     case VT_SCENE_DEPTH:
     {
       // FIXME: This is a workaround that is needed because DepthToUchar4 is currently CPU-only.
-      static ORFloatImage_Ptr temp(new ORFloatImage(output->noDims, true, true));
-      generate_depth_from_voxels(temp, scene, pose, intrinsics, renderState, DepthVisualiser::DT_ORTHOGRAPHIC);
+      // Note: The visible blocks and expected depths have already been computed, so we only need to find the surface before rendering the depth.
+      const ORFloatImage_Ptr& temp = get_temp_depth_image(output->noDims);
+      m_voxelVisualisationEngine->FindSurface(scene.get(), &pose, &intrinsics, renderState.get());
+      generate_depth_from_raycast(temp, pose, renderState, DepthVisualiser::DT_ORTHOGRAPHIC);
       IITMVisualisationEngine::DepthToUchar4(output.get(), temp.get());
       if(m_settings->deviceType == DEVICE_CUDA) output->UpdateDeviceFromHost();
       return;
@@ -232,6 +240,13 @@ bool VisualisationGenerator::supports_semantics() const
 
 //#################### PRIVATE MEMBER FUNCTIONS ####################
 
+const ORFloatImage_Ptr& VisualisationGenerator::get_temp_depth_image(const Vector2i& imgSize) const
+{
+  if(!m_tempDepthImage) m_tempDepthImage.reset(new ORFloatImage(imgSize, true, true));
+  m_tempDepthImage->ChangeDims(imgSize);
+  return m_tempDepthImage;
+}
+
 void VisualisationGenerator::make_postprocessed_cpu_copy(const ORUChar4Image *inputRaycast, const boost::optional<Postprocessor>& postprocessor,
                                                          const ORUChar4Image_Ptr& outputRaycast) const
 {
@@ -304,6 +304,19 @@ public:
     return m_queue.front();
   }
 
+  /**
+   * \brief Gets the number of elements that are currently available in the pool.
+   *
+   * \note  When using the 'discard' strategy, this is the number of further elements that can be pushed before pushes start to be discarded.
+   *
+   * \return  The number of elements that are currently available in the pool.
+   */
+  size_t pool_size() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_pool.size();
+  }
+
   /**
    * \brief Pops the first element from the queue and returns it to the pool.
    *
@@ -6,25 +6,52 @@
 #ifndef H_TVGUTIL_HISTOGRAM
 #define H_TVGUTIL_HISTOGRAM
 
+#include <iterator>
+#include <limits>
 #include <map>
 #include <stdexcept>
+#include <vector>
 
+#include <boost/mpl/bool.hpp>
+#include <boost/serialization/map.hpp>
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/type_traits/is_integral.hpp>
 
 #include "../containers/LimitedContainer.h"
 
 namespace tvgutil {
 
+//#################### TRAITS ####################
+
 /**
- * \brief An instance of an instantiation of this class template represents a histogram over the specified label type.
+ * \brief An instantiation of this struct template specifies whether or not histograms over the specified label type should store their bins densely.
+ *
+ * Dense storage is used for single-byte integral label types (e.g. the labels used by spaint), since every possible label
+ * can then be given its own bin in a small array, avoiding the need for any tree lookups or allocations when adding labels.
  */
 template <typename Label>
+struct UseDenseHistogram : boost::mpl::bool_<boost::is_integral<Label>::value && sizeof(Label) == 1>
+{};
+
+/**
+ * \brief An instance of an instantiation of this class template represents a histogram over the specified label type.
+ *
+ * This is the general version, which stores the bins in a map. A dense version is used for small integral label types
+ * (see below). Both versions provide the same interface, so code that uses the nested Bins type to refer to the bins
+ * works with either.
+ */
+template <typename Label, bool Dense = UseDenseHistogram<Label>::value>
 class Histogram
 {
+  //#################### TYPEDEFS ####################
+public:
+  typedef std::map<Label,size_t> Bins;
+
   //#################### PRIVATE VARIABLES ####################
 private:
   /** The bins that record the number of instances of each label that have been seen. */
-  std::map<Label,size_t> m_bins;
+  Bins m_bins;
 
   /** The total number of instances that are in the histogram. */
   size_t m_count;
@@ -61,12 +88,24 @@ public:
     return get_count() == 0;
   }
 
+  /**
+   * \brief Gets the number of instances of the specified label that have been seen.
+   *
+   * \param label The label.
+   * \return      The number of instances of the label that have been seen.
+   */
+  size_t get_bin(const Label& label) const
+  {
+    typename Bins::const_iterator it = m_bins.find(label);
+    return it != m_bins.end() ? it->second : 0;
+  }
+
   /**
    * \brief Gets the bins that record the number of instances of each label that have been seen.
    *
    * \return The bins that record the number of instances of each label that have been seen.
    */
-  const std::map<Label,size_t>& get_bins() const
+  const Bins& get_bins() const
   {
     return m_bins;
   }
@@ -99,6 +138,291 @@ private:
   friend class boost::serialization::access;
 };
 
+/**
+ * \brief An instance of an instantiation of this class template represents a histogram over a small integral label type.
+ *
+ * The bins are stored in an array indexed by label, which is grown on demand up to the fixed capacity of the label type.
+ * Iterating over the bins yields the non-empty bins in increasing order of label, exactly as for the general version.
+ */
+template <typename Label>
+class Histogram<Label,true>
+{
+  //#################### NESTED TYPES ####################
+public:
+  /**
+   * \brief An instance of this class provides a read-only, map-like view of the non-empty bins of a dense histogram.
+   */
+  class Bins
+  {
+    //~~~~~~~~~~~~~~~~~~~~ NESTED TYPES ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief An instance of this class can be used to iterate over the non-empty bins of a dense histogram in increasing order of label.
+     */
+    class const_iterator : public std::iterator<std::forward_iterator_tag, const std::pair<Label,size_t> >
+    {
+      //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+    private:
+      /** The bin counts. */
+      const std::vector<size_t> *m_counts;
+
+      /** The current (label, count) pair. */
+      std::pair<Label,size_t> m_current;
+
+      /** The index of the current bin. */
+      size_t m_index;
+
+      //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+    public:
+      /**
+       * \brief Constructs an iterator that points to the first non-empty bin at or after the specified index.
+       *
+       * \param counts  The bin counts.
+       * \param index   The index at which to start looking for a non-empty bin.
+       */
+      const_iterator(const std::vector<size_t> *counts, size_t index)
+      : m_counts(counts), m_index(index)
+      {
+        skip_empty_bins();
+      }
+
+      //~~~~~~~~~~~~~~~~~~~~ PUBLIC OPERATORS ~~~~~~~~~~~~~~~~~~~~
+    public:
+      const std::pair<Label,size_t>& operator*() const   { return m_current; }
+      const std::pair<Label,size_t> *operator->() const  { return &m_current; }
+
+      const_iterator& operator++()
+      {
+        ++m_index;
+        skip_empty_bins();
+        return *this;
+      }
+
+      const_iterator operator++(int)
+      {
+        const_iterator result = *this;
+        ++*this;
+        return result;
+      }
+
+      bool operator==(const const_iterator& rhs) const   { return m_index == rhs.m_index; }
+      bool operator!=(const const_iterator& rhs) const   { return m_index != rhs.m_index; }
+
+      //~~~~~~~~~~~~~~~~~~~~ PRIVATE MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+    private:
+      /**
+       * \brief Advances the iterator past any empty bins, and updates the current (label, count) pair.
+       */
+      void skip_empty_bins()
+      {
+        const size_t size = m_counts->size();
+        while(m_index < size && (*m_counts)[m_index] == 0) ++m_index;
+        if(m_index < size) m_current = std::make_pair(index_to_label(m_index), (*m_counts)[m_index]);
+      }
+    };
+
+    //~~~~~~~~~~~~~~~~~~~~ PRIVATE VARIABLES ~~~~~~~~~~~~~~~~~~~~
+  private:
+    /** The bin counts. */
+    const std::vector<size_t> *m_counts;
+
+    //~~~~~~~~~~~~~~~~~~~~ CONSTRUCTORS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    /**
+     * \brief Constructs a view of the non-empty bins of a dense histogram.
+     *
+     * \param counts  The bin counts.
+     */
+    explicit Bins(const std::vector<size_t> *counts)
+    : m_counts(counts)
+    {}
+
+    //~~~~~~~~~~~~~~~~~~~~ PUBLIC MEMBER FUNCTIONS ~~~~~~~~~~~~~~~~~~~~
+  public:
+    const_iterator begin() const  { return const_iterator(m_counts, 0); }
+    const_iterator end() const    { return const_iterator(m_counts, m_counts->size()); }
+
+    /**
+     * \brief Finds the bin for the specified label.
+     *
+     * \param label The label.
+     * \return      An iterator pointing to the bin for the label, if it is non-empty, or end() otherwise.
+     */
+    const_iterator find(const Label& label) const
+    {
+      size_t index = label_to_index(label);
+      return index < m_counts->size() && (*m_counts)[index] != 0 ? const_iterator(m_counts, index) : end();
+    }
+  };
+
+  //#################### PRIVATE VARIABLES ####################
+private:
+  /** The number of instances of each label that have been seen, indexed by label (see label_to_index). */
+  std::vector<size_t> m_counts;
+
+  /** The total number of instances that are in the histogram. */
+  size_t m_count;
+
+  //#################### CONSTRUCTORS ####################
+public:
+  /**
+   * \brief Constructs an empty histogram.
+   */
+  Histogram()
+  : m_count(0)
+  {}
+
+  //#################### PUBLIC STATIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Gets the maximum number of bins that a histogram over the label type can have.
+   *
+   * \return  The maximum number of bins that a histogram over the label type can have.
+   */
+  static size_t capacity()
+  {
+    return static_cast<size_t>(std::numeric_limits<Label>::max()) - std::numeric_limits<Label>::min() + 1;
+  }
+
+  /**
+   * \brief Gets the label corresponding to the specified bin index.
+   *
+   * \param index The bin index.
+   * \return      The corresponding label.
+   */
+  static Label index_to_label(size_t index)
+  {
+    return static_cast<Label>(static_cast<int>(index) + std::numeric_limits<Label>::min());
+  }
+
+  /**
+   * \brief Gets the bin index corresponding to the specified label.
+   *
+   * \note  Bin indices are ordered in the same way as labels.
+   *
+   * \param label The label.
+   * \return      The corresponding bin index.
+   */
+  static size_t label_to_index(const Label& label)
+  {
+    return static_cast<size_t>(static_cast<int>(label) - std::numeric_limits<Label>::min());
+  }
+
+  //#################### PUBLIC MEMBER FUNCTIONS ####################
+public:
+  /**
+   * \brief Adds an instance of the specified label to the histogram.
+   *
+   * \param label The label for which to add an instance.
+   */
+  void add(const Label& label)
+  {
+    size_t index = label_to_index(label);
+    if(index >= m_counts.size()) m_counts.resize(index + 1, 0);
+    ++m_counts[index];
+    ++m_count;
+  }
+
+  /**
+   * \brief Gets whether or not this is an empty histogram.
+   *
+   * \return  true, if the histogram is empty, or false otherwise.
+   */
+  bool empty() const
+  {
+    return get_count() == 0;
+  }
+
+  /**
+   * \brief Gets the number of instances of the specified label that have been seen.
+   *
+   * \param label The label.
+   * \return      The number of instances of the label that have been seen.
+   */
+  size_t get_bin(const Label& label) const
+  {
+    size_t index = label_to_index(label);
+    return index < m_counts.size() ? m_counts[index] : 0;
+  }
+
+  /**
+   * \brief Gets the bins that record the number of instances of each label that have been seen.
+   *
+   * \return A view of the bins that record the number of instances of each label that have been seen.
+   */
+  Bins get_bins() const
+  {
+    return Bins(&m_counts);
+  }
+
+  /**
+   * \brief Gets the total number of instances that are in the histogram.
+   *
+   * \return The total number of instances that are in the histogram.
+   */
+  size_t get_count() const
+  {
+    return m_count;
+  }
+
+  /**
+   * \brief Gets the dense array of bin counts, indexed by label (see label_to_index).
+   *
+   * \note  The array only extends as far as the largest label seen so far, and may contain empty bins.
+   *
+   * \return The dense array of bin counts.
+   */
+  const std::vector<size_t>& get_dense_bins() const
+  {
+    return m_counts;
+  }
+
+  //#################### SERIALIZATION ####################
+private:
+  /**
+   * \brief Loads the histogram from an archive.
+   *
+   * \note  The bins are stored as a map, so that the file format is the same as that of the general version.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void load(Archive& ar, const unsigned int version)
+  {
+    std::map<Label,size_t> bins;
+    ar & bins;
+    ar & m_count;
+
+    m_counts.clear();
+    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    {
+      size_t index = label_to_index(it->first);
+      if(index >= m_counts.size()) m_counts.resize(index + 1, 0);
+      m_counts[index] = it->second;
+    }
+  }
+
+  /**
+   * \brief Saves the histogram to an archive.
+   *
+   * \param ar      The archive.
+   * \param version The file format version number.
+   */
+  template <typename Archive>
+  void save(Archive& ar, const unsigned int version) const
+  {
+    Bins denseBins = get_bins();
+    std::map<Label,size_t> bins(denseBins.begin(), denseBins.end());
+    ar & bins;
+    ar & m_count;
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+  friend class boost::serialization::access;
+};
+
 //#################### STREAM OPERATORS ####################
 
 /**
@@ -108,11 +432,12 @@ private:
  * \param rhs The histogram to output.
  * \return    The stream.
  */
-template <typename Label>
-std::ostream& operator<<(std::ostream& os, const Histogram<Label>& rhs)
+template <typename Label, bool Dense>
+std::ostream& operator<<(std::ostream& os, const Histogram<Label,Dense>& rhs)
 {
   const size_t ELEMENT_DISPLAY_LIMIT = 10;
-  os << make_limited_container(rhs.get_bins(), ELEMENT_DISPLAY_LIMIT);
+  typename Histogram<Label,Dense>::Bins bins = rhs.get_bins();
+  os << make_limited_container(std::map<Label,size_t>(bins.begin(), bins.end()), ELEMENT_DISPLAY_LIMIT);
   return os;
 }
 
@@ -63,10 +63,10 @@ public:
   explicit ProbabilityMassFunction(const Histogram<Label>& histogram, const boost::optional<std::map<Label,float> >& multipliers = boost::none)
   {
     // Determine the masses for the labels in the histogram by dividing the number of instances in each bin by the histogram count.
-    const std::map<Label,size_t>& bins = histogram.get_bins();
+    const typename Histogram<Label>::Bins& bins = histogram.get_bins();
     size_t count = histogram.get_count();
     if(count == 0) throw std::runtime_error("Cannot make a probability mass function from an empty histogram");
-    for(typename std::map<Label,size_t>::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
+    for(typename Histogram<Label>::Bins::const_iterator it = bins.begin(), iend = bins.end(); it != iend; ++it)
     {
       float mass = static_cast<float>(it->second) / count;
 
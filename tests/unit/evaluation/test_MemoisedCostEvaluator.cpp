@@ -0,0 +1,164 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+#include <stdexcept>
+
+#include <boost/assign/list_of.hpp>
+#include <boost/atomic.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+using boost::assign::list_of;
+using boost::assign::map_list_of;
+
+#include <evaluation/util/CoordinateDescentParameterOptimiser.h>
+#include <evaluation/util/MemoisedCostEvaluator.h>
+using namespace evaluation;
+
+namespace bf = boost::filesystem;
+
+//#################### HELPER FUNCTIONS ####################
+
+boost::atomic<int> g_evaluationCount(0);
+
+float counting_cost_fn(const ParamSet& params)
+{
+  ++g_evaluationCount;
+  float value = boost::lexical_cast<float>(params.find("Foo")->second);
+  return value * value;
+}
+
+float failing_cost_fn(const ParamSet& params)
+{
+  throw std::runtime_error("Evaluation failed");
+}
+
+float timed_out_cost_fn(const ParamSet& params)
+{
+  ++g_evaluationCount;
+  return std::numeric_limits<float>::max();
+}
+
+void add_params(EpochBasedParameterOptimiser& optimiser)
+{
+  optimiser.add_param("Foo", list_of<int>(-4)(-3)(-1)(2)(5))
+           .add_param("Bar", list_of<int>(1)(2)(3));
+}
+
+ParamSet make_param_set(int foo)
+{
+  return map_list_of("Foo",boost::lexical_cast<std::string>(foo));
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_MemoisedCostEvaluator)
+
+BOOST_AUTO_TEST_CASE(evaluate_test)
+{
+  g_evaluationCount = 0;
+  MemoisedCostEvaluator evaluator(counting_cost_fn);
+
+  BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(3)), 9.0f);
+  BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(3)), 9.0f);
+  BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(-2)), 4.0f);
+  BOOST_CHECK_EQUAL(g_evaluationCount, 2);
+  BOOST_CHECK_EQUAL(evaluator.cached_cost_count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(evaluate_parallel_test)
+{
+  g_evaluationCount = 0;
+  MemoisedCostEvaluator evaluator(counting_cost_fn, 4);
+
+  // Evaluate a batch of parameter sets that contains some duplicates. Each distinct parameter set should only be evaluated once.
+  std::vector<ParamSet> paramSets;
+  for(int i = 0; i < 20; ++i)
+  {
+    paramSets.push_back(make_param_set(i % 5));
+  }
+
+  std::vector<float> costs = evaluator.evaluate(paramSets);
+  BOOST_REQUIRE_EQUAL(costs.size(), paramSets.size());
+  for(int i = 0; i < 20; ++i)
+  {
+    BOOST_CHECK_EQUAL(costs[i], static_cast<float>((i % 5) * (i % 5)));
+  }
+
+  BOOST_CHECK_EQUAL(g_evaluationCount, 5);
+
+  // If any of the evaluations fails, the batch evaluation should throw.
+  MemoisedCostEvaluator failingEvaluator(failing_cost_fn, 4);
+  BOOST_CHECK_THROW(failingEvaluator.evaluate(paramSets), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(persistence_test)
+{
+  const bf::path cachePath = bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%-%%%%.cache");
+
+  // Evaluate some parameter sets with an evaluator that persists its costs.
+  {
+    MemoisedCostEvaluator evaluator(counting_cost_fn, 1, cachePath.string());
+    evaluator.evaluate(make_param_set(3));
+    evaluator.evaluate(make_param_set(7));
+  }
+
+  // Check that a new evaluator using the same cache file can return the costs without evaluating the cost function.
+  {
+    MemoisedCostEvaluator evaluator(failing_cost_fn, 1, cachePath.string());
+    BOOST_CHECK_EQUAL(evaluator.cached_cost_count(), 2);
+    BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(3)), 9.0f);
+    BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(7)), 49.0f);
+    BOOST_CHECK_THROW(evaluator.evaluate(make_param_set(4)), std::runtime_error);
+  }
+
+  bf::remove(cachePath);
+}
+
+BOOST_AUTO_TEST_CASE(timed_out_persistence_test)
+{
+  const bf::path cachePath = bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%-%%%%.cache");
+
+  // Evaluate a parameter set whose evaluation produces no result. Its cost should be remembered by the evaluator itself...
+  g_evaluationCount = 0;
+  {
+    MemoisedCostEvaluator evaluator(timed_out_cost_fn, 1, cachePath.string());
+    BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(3)), std::numeric_limits<float>::max());
+    BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(3)), std::numeric_limits<float>::max());
+    BOOST_CHECK_EQUAL(g_evaluationCount, 1);
+  }
+
+  // ...but not persisted, so that a new evaluator using the same cache file will evaluate it again.
+  {
+    MemoisedCostEvaluator evaluator(counting_cost_fn, 1, cachePath.string());
+    BOOST_CHECK_EQUAL(evaluator.cached_cost_count(), 0);
+    BOOST_CHECK_EQUAL(evaluator.evaluate(make_param_set(3)), 9.0f);
+    BOOST_CHECK_EQUAL(g_evaluationCount, 2);
+  }
+
+  bf::remove(cachePath);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_optimiser_test)
+{
+  // Check that running the epochs of a coordinate descent optimiser in parallel gives the same result as running them sequentially.
+  CoordinateDescentParameterOptimiser sequentialOptimiser(counting_cost_fn, 8, 12345);
+  CoordinateDescentParameterOptimiser parallelOptimiser(counting_cost_fn, 8, 12345, 4);
+  add_params(sequentialOptimiser);
+  add_params(parallelOptimiser);
+
+  float sequentialCost, parallelCost;
+  ParamSet sequentialParams = sequentialOptimiser.optimise_for_parameters(&sequentialCost);
+  ParamSet parallelParams = parallelOptimiser.optimise_for_parameters(&parallelCost);
+
+  BOOST_CHECK_EQUAL(ParamSetUtil::param_set_to_string(parallelParams), ParamSetUtil::param_set_to_string(sequentialParams));
+  BOOST_CHECK_EQUAL(parallelCost, sequentialCost);
+  BOOST_CHECK_EQUAL(parallelCost, 1.0f);
+
+  // If none of the parameter sets produces a result, the optimiser should throw.
+  CoordinateDescentParameterOptimiser timedOutOptimiser(timed_out_cost_fn, 4, 12345, 2);
+  add_params(timedOutOptimiser);
+  BOOST_CHECK_THROW(timedOutOptimiser.optimise_for_parameters(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,240 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <grove/util/PackedFileReader.h>
+#include <grove/util/PackedFileWriter.h>
+using namespace grove;
+
+//#################### HELPER FUNCTIONS ####################
+
+std::string make_temp_filename()
+{
+  return (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%.pkd")).string();
+}
+
+/**
+ * \brief Overwrites some of the bytes in a file.
+ */
+void overwrite_bytes(const std::string& filename, std::streamoff offset, const void *data, size_t size)
+{
+  std::fstream fs(filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+  fs.seekp(offset);
+  fs.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+  BOOST_REQUIRE(fs);
+}
+
+/**
+ * \brief Reads the descriptor of the specified chunk directly from the chunk table of a packed file.
+ */
+PackedFileFormat::ChunkDescriptor read_descriptor(const std::string& filename, const std::string& name)
+{
+  std::ifstream fs(filename.c_str(), std::ios::binary);
+
+  PackedFileFormat::Header header;
+  fs.read(reinterpret_cast<char*>(&header), sizeof(PackedFileFormat::Header));
+
+  for(boost::uint32_t i = 0; i < header.chunkCount; ++i)
+  {
+    PackedFileFormat::ChunkDescriptor descriptor;
+    fs.read(reinterpret_cast<char*>(&descriptor), sizeof(PackedFileFormat::ChunkDescriptor));
+    if(fs && name == descriptor.name) return descriptor;
+  }
+
+  throw std::runtime_error("Error: Could not find chunk '" + name + "' in " + filename);
+}
+
+/**
+ * \brief Writes a packed file containing an array of integers (called "ints"), a string (called "text") and an empty chunk (called "empty").
+ */
+void write_test_file(const std::string& filename, const std::vector<int>& ints, const std::string& text)
+{
+  PackedFileWriter writer;
+  writer.add_chunk("ints", &ints[0], ints.size() * sizeof(int));
+  writer.add_chunk("text", text.c_str(), text.length());
+  writer.add_chunk("empty", NULL, 0);
+  writer.write(filename);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_PackedFile)
+
+BOOST_AUTO_TEST_CASE(chunk_round_trip_test)
+{
+  const std::string filename = make_temp_filename();
+
+  std::vector<int> ints;
+  for(int i = 0; i < 1000; ++i) ints.push_back(i * i);
+  const std::string text = "Hello, world!";
+  write_test_file(filename, ints, text);
+
+  BOOST_CHECK(PackedFileReader::is_packed_file(filename));
+
+  {
+    PackedFileReader reader(filename);
+
+    BOOST_CHECK(reader.has_chunk("ints"));
+    BOOST_CHECK(reader.has_chunk("text"));
+    BOOST_CHECK(reader.has_chunk("empty"));
+    BOOST_CHECK(!reader.has_chunk("missing"));
+
+    // Check that the integers are read back correctly, and that their chunk is suitably aligned.
+    size_t count;
+    const int *readInts = reader.get_chunk_as<int>("ints", count);
+    BOOST_REQUIRE_EQUAL(count, ints.size());
+    BOOST_CHECK(memcmp(readInts, &ints[0], count * sizeof(int)) == 0);
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(readInts) % PackedFileFormat::ChunkAlignment, 0U);
+
+    // Check that the text is read back correctly (its chunk size is not a multiple of the size of an int).
+    size_t size;
+    const char *readText = static_cast<const char*>(reader.get_chunk("text", size));
+    BOOST_CHECK_EQUAL(std::string(readText, size), text);
+    BOOST_CHECK_THROW(reader.get_chunk_as<int>("text", count), std::runtime_error);
+
+    reader.get_chunk("empty", size);
+    BOOST_CHECK_EQUAL(size, 0U);
+  }
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(memory_block_round_trip_test)
+{
+  const std::string filename = make_temp_filename();
+
+  ORUtils::MemoryBlock<float> block(100, true, false);
+  float *data = block.GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < block.dataSize; ++i) data[i] = i * 0.5f;
+
+  {
+    PackedFileWriter writer;
+    writer.add_memory_block("block", block);
+    writer.write(filename);
+  }
+
+  {
+    PackedFileReader reader(filename);
+
+    // Check that the block is read back correctly.
+    ORUtils::MemoryBlock<float> readBlock(100, true, false);
+    reader.read_memory_block("block", readBlock);
+    BOOST_CHECK(memcmp(readBlock.GetData(MEMORYDEVICE_CPU), data, block.dataSize * sizeof(float)) == 0);
+
+    // Check that reading the chunk into a block of the wrong size fails.
+    ORUtils::MemoryBlock<float> wrongSizeBlock(99, true, false);
+    BOOST_CHECK_THROW(reader.read_memory_block("block", wrongSizeBlock), std::runtime_error);
+  }
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_checksum_test)
+{
+  const std::string filename = make_temp_filename();
+
+  std::vector<int> ints(100, 23);
+  write_test_file(filename, ints, "Hello, world!");
+
+  // Corrupt one of the integers.
+  const int corruptValue = 24;
+  overwrite_bytes(filename, read_descriptor(filename, "ints").offset + 10 * sizeof(int), &corruptValue, sizeof(int));
+
+  // Check that the corruption is detected when the checksums are verified, but that the file can otherwise still be opened.
+  BOOST_CHECK_THROW(PackedFileReader reader(filename), std::runtime_error);
+  BOOST_CHECK_NO_THROW(PackedFileReader reader(filename, false));
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(bad_header_test)
+{
+  const std::string filename = make_temp_filename();
+
+  std::vector<int> ints(100, 23);
+  write_test_file(filename, ints, "Hello, world!");
+
+  // Check that a file with the wrong magic bytes is rejected.
+  const char badMagic[] = "GROVEBAD";
+  overwrite_bytes(filename, 0, badMagic, sizeof(PackedFileFormat::Header().magic));
+  BOOST_CHECK(!PackedFileReader::is_packed_file(filename));
+  BOOST_CHECK_THROW(PackedFileReader reader(filename), std::runtime_error);
+
+  // Check that a file with an unsupported version is rejected.
+  write_test_file(filename, ints, "Hello, world!");
+  const boost::uint32_t badVersion = PackedFileFormat::Version + 1;
+  overwrite_bytes(filename, offsetof(PackedFileFormat::Header, version), &badVersion, sizeof(boost::uint32_t));
+  BOOST_CHECK(PackedFileReader::is_packed_file(filename));
+  BOOST_CHECK_THROW(PackedFileReader reader(filename), std::runtime_error);
+
+  // Check that a file that does not exist is not a packed file.
+  bf::remove(filename);
+  BOOST_CHECK(!PackedFileReader::is_packed_file(filename));
+  BOOST_CHECK_THROW(PackedFileReader reader(filename), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(truncated_file_test)
+{
+  const std::string filename = make_temp_filename();
+
+  std::vector<int> ints(100, 23);
+  write_test_file(filename, ints, "Hello, world!");
+
+  // Check that a file that has been cut short is rejected (even if the checksums are not verified).
+  bf::resize_file(filename, bf::file_size(filename) - 1);
+  BOOST_CHECK_THROW(PackedFileReader reader(filename, false), std::runtime_error);
+
+  // Check that a file whose chunk table has been cut short is rejected.
+  bf::resize_file(filename, sizeof(PackedFileFormat::Header) + sizeof(PackedFileFormat::ChunkDescriptor));
+  BOOST_CHECK_THROW(PackedFileReader reader(filename, false), std::runtime_error);
+
+  // Check that a file that is too short to contain a header is not a packed file.
+  bf::resize_file(filename, sizeof(PackedFileFormat::Header) - 1);
+  BOOST_CHECK(!PackedFileReader::is_packed_file(filename));
+  BOOST_CHECK_THROW(PackedFileReader reader(filename, false), std::runtime_error);
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_names_test)
+{
+  const std::string filename = make_temp_filename();
+
+  // Check that the writer rejects empty, overly long and duplicate chunk names.
+  int value = 23;
+  PackedFileWriter writer;
+  BOOST_CHECK_THROW(writer.add_chunk("", &value, sizeof(int)), std::invalid_argument);
+  BOOST_CHECK_THROW(writer.add_chunk(std::string(PackedFileFormat::MaxChunkNameLength, 'x'), &value, sizeof(int)), std::invalid_argument);
+  BOOST_CHECK_NO_THROW(writer.add_chunk(std::string(PackedFileFormat::MaxChunkNameLength - 1, 'x'), &value, sizeof(int)));
+  BOOST_CHECK_NO_THROW(writer.add_chunk("value", &value, sizeof(int)));
+  BOOST_CHECK_THROW(writer.add_chunk("value", &value, sizeof(int)), std::invalid_argument);
+  writer.write(filename);
+
+  // Check that the reader finds the chunks that were written, and rejects requests for chunks that were not.
+  {
+    PackedFileReader reader(filename);
+    size_t count;
+    BOOST_CHECK_EQUAL(*reader.get_chunk_as<int>(std::string(PackedFileFormat::MaxChunkNameLength - 1, 'x'), count), value);
+    BOOST_CHECK_EQUAL(*reader.get_chunk_as<int>("value", count), value);
+
+    size_t size;
+    BOOST_CHECK(!reader.has_chunk("missing"));
+    BOOST_CHECK_THROW(reader.get_chunk("missing", size), std::runtime_error);
+
+    ORUtils::MemoryBlock<int> block(1, true, false);
+    BOOST_CHECK_THROW(reader.read_memory_block("missing", block), std::runtime_error);
+  }
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,220 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <grove/ransac/cpu/PreemptiveRansac_CPU.h>
+#include <grove/ransac/cpu/PreemptiveRansac_CPUVectorised.h>
+using namespace grove;
+
+#include <tvgutil/numbers/RandomNumberGenerator.h>
+using namespace tvgutil;
+
+//#################### HELPER TYPES ####################
+
+/**
+ * \brief An instance of an instantiation of this class template allows the energy computation of a preemptive RANSAC
+ *        implementation to be run directly on specified inputs.
+ */
+template <typename Base>
+class EnergyComputer : public Base
+{
+public:
+  explicit EnergyComputer(const SettingsContainer_CPtr& settings)
+  : Base(settings, "PreemptiveRansac.")
+  {}
+
+public:
+  /**
+   * \brief Computes (and sorts) the energies of the specified pose candidates.
+   *
+   * \param keypoints           The keypoints image.
+   * \param predictions         The predictions image.
+   * \param inlierRasterIndices The raster indices of the sampled inliers.
+   * \param candidates          The pose candidates (will be sorted in non-decreasing order of energy).
+   */
+  void compute_energies(const Keypoint3DColourImage_CPtr& keypoints, const ScorePredictionsImage_CPtr& predictions,
+                        const std::vector<int>& inlierRasterIndices, std::vector<PoseCandidate>& candidates)
+  {
+    this->m_keypointsImage = keypoints;
+    this->m_predictionsImage = predictions;
+
+    std::copy(inlierRasterIndices.begin(), inlierRasterIndices.end(), this->m_inlierRasterIndicesBlock->GetData(MEMORYDEVICE_CPU));
+    this->m_inlierRasterIndicesBlock->dataSize = inlierRasterIndices.size();
+
+    std::copy(candidates.begin(), candidates.end(), this->m_poseCandidates->GetData(MEMORYDEVICE_CPU));
+    this->m_poseCandidates->dataSize = candidates.size();
+
+    this->compute_energies_and_sort();
+
+    const PoseCandidate *sortedCandidates = this->m_poseCandidates->GetData(MEMORYDEVICE_CPU);
+    std::copy(sortedCandidates, sortedCandidates + candidates.size(), candidates.begin());
+  }
+};
+
+//#################### HELPER FUNCTIONS ####################
+
+SettingsContainer_CPtr make_settings()
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+
+  // Pose optimisation is not involved in the energy computation, and would require ALGLIB.
+  settings->add_value("PreemptiveRansac.poseUpdate", "false");
+
+  return settings;
+}
+
+Keypoint3DColourCluster make_mode(const Vector3f& position, float sigma, int nbInliers)
+{
+  Keypoint3DColourCluster mode;
+  mode.colour = Vector3u((uchar)0, (uchar)0, (uchar)0);
+  mode.determinant = sigma * sigma * sigma * sigma * sigma * sigma;
+  mode.nbInliers = nbInliers;
+  mode.position = position;
+  mode.positionInvCovariance.setZeros();
+  mode.positionInvCovariance.m[0] = mode.positionInvCovariance.m[4] = mode.positionInvCovariance.m[8] = 1.0f / (sigma * sigma);
+  return mode;
+}
+
+/**
+ * \brief Makes a set of pose candidates that are close to the identity (the index of each candidate is stored in pointsCamera[0].x).
+ */
+std::vector<PoseCandidate> make_candidates(int count, RandomNumberGenerator& rng)
+{
+  std::vector<PoseCandidate> candidates(count);
+  for(int i = 0; i < count; ++i)
+  {
+    ORUtils::SE3Pose pose(
+      rng.generate_real_from_uniform(-0.1f, 0.1f), rng.generate_real_from_uniform(-0.1f, 0.1f), rng.generate_real_from_uniform(-0.1f, 0.1f),
+      rng.generate_real_from_uniform(-0.1f, 0.1f), rng.generate_real_from_uniform(-0.1f, 0.1f), rng.generate_real_from_uniform(-0.1f, 0.1f)
+    );
+
+    candidates[i].cameraPose = pose.GetInvM();
+    candidates[i].energy = 0.0f;
+    candidates[i].pointsCamera[0].x = static_cast<float>(i);
+  }
+  return candidates;
+}
+
+/**
+ * \brief Makes a keypoints image and a predictions image in which the modes predicted for each keypoint are scattered around its position.
+ */
+void make_inputs(const Vector2i& imgSize, RandomNumberGenerator& rng, Keypoint3DColourImage_Ptr& keypoints, ScorePredictionsImage_Ptr& predictions)
+{
+  keypoints.reset(new Keypoint3DColourImage(imgSize, true, false));
+  predictions.reset(new ScorePredictionsImage(imgSize, true, false));
+
+  for(int i = 0, size = imgSize.x * imgSize.y; i < size; ++i)
+  {
+    Keypoint3DColour& keypoint = keypoints->GetData(MEMORYDEVICE_CPU)[i];
+    keypoint.colour = Vector3u((uchar)0, (uchar)0, (uchar)0);
+    keypoint.position = Vector3f(rng.generate_real_from_uniform(-1.0f, 1.0f), rng.generate_real_from_uniform(-1.0f, 1.0f), rng.generate_real_from_uniform(1.0f, 3.0f));
+    keypoint.valid = true;
+
+    ScorePrediction& prediction = predictions->GetData(MEMORYDEVICE_CPU)[i];
+    prediction.size = rng.generate_int_from_uniform(1, 5);
+    for(int j = 0; j < prediction.size; ++j)
+    {
+      const Vector3f offset(rng.generate_from_gaussian(0.0f, 0.1f), rng.generate_from_gaussian(0.0f, 0.1f), rng.generate_from_gaussian(0.0f, 0.1f));
+      prediction.elts[j] = make_mode(keypoint.position + offset, rng.generate_real_from_uniform(0.02f, 0.2f), rng.generate_int_from_uniform(1, 100));
+    }
+  }
+}
+
+std::map<int,float> to_energy_map(const std::vector<PoseCandidate>& candidates)
+{
+  std::map<int,float> result;
+  for(size_t i = 0, size = candidates.size(); i < size; ++i)
+  {
+    result[static_cast<int>(candidates[i].pointsCamera[0].x)] = candidates[i].energy;
+  }
+  return result;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_PreemptiveRansac)
+
+BOOST_AUTO_TEST_CASE(vectorised_energies_test)
+{
+  RandomNumberGenerator rng(12345);
+  SettingsContainer_CPtr settings = make_settings();
+  EnergyComputer<PreemptiveRansac_CPU> scalar(settings);
+  EnergyComputer<PreemptiveRansac_CPUVectorised> vectorised(settings);
+
+  Keypoint3DColourImage_Ptr keypoints;
+  ScorePredictionsImage_Ptr predictions;
+  make_inputs(Vector2i(16, 12), rng, keypoints, predictions);
+
+  // Sample some inliers (with repetition, as can happen in practice).
+  std::vector<int> inlierRasterIndices;
+  for(int i = 0; i < 100; ++i) inlierRasterIndices.push_back(rng.generate_int_from_uniform(0, 16 * 12 - 1));
+
+  // Use a number of candidates that is not a multiple of the block size, so that the last block is only partially filled.
+  const int candidateCount = 3 * PreemptiveRansac_CPUVectorised::CANDIDATE_BLOCK_SIZE + 5;
+  std::vector<PoseCandidate> scalarCandidates = make_candidates(candidateCount, rng);
+  std::vector<PoseCandidate> vectorisedCandidates = scalarCandidates;
+
+  scalar.compute_energies(keypoints, predictions, inlierRasterIndices, scalarCandidates);
+  vectorised.compute_energies(keypoints, predictions, inlierRasterIndices, vectorisedCandidates);
+
+  // Check that the energies of the candidates are identical, and that the candidates end up ranked in the same way.
+  const std::map<int,float> scalarEnergies = to_energy_map(scalarCandidates);
+  const std::map<int,float> vectorisedEnergies = to_energy_map(vectorisedCandidates);
+  BOOST_REQUIRE_EQUAL(scalarEnergies.size(), static_cast<size_t>(candidateCount));
+  BOOST_REQUIRE_EQUAL(vectorisedEnergies.size(), static_cast<size_t>(candidateCount));
+  for(int i = 0; i < candidateCount; ++i)
+  {
+    BOOST_CHECK_EQUAL(scalarEnergies.find(i)->second, vectorisedEnergies.find(i)->second);
+  }
+
+  for(int i = 0; i < candidateCount; ++i)
+  {
+    BOOST_CHECK_EQUAL(scalarCandidates[i].energy, vectorisedCandidates[i].energy);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(modes_without_inliers_test)
+{
+  RandomNumberGenerator rng(12345);
+  SettingsContainer_CPtr settings = make_settings();
+  EnergyComputer<PreemptiveRansac_CPU> scalar(settings);
+  EnergyComputer<PreemptiveRansac_CPUVectorised> vectorised(settings);
+
+  Keypoint3DColourImage_Ptr keypoints;
+  ScorePredictionsImage_Ptr predictions;
+  make_inputs(Vector2i(4, 4), rng, keypoints, predictions);
+
+  std::vector<int> inlierRasterIndices;
+  for(int i = 0; i < 16; ++i) inlierRasterIndices.push_back(i);
+
+  std::vector<PoseCandidate> candidates = make_candidates(20, rng);
+
+  // Add a mode without any inliers to one of the predictions. This mode can never be selected as the best mode
+  // (its energy is always zero, and the first mode is selected by default), so neither implementation should throw.
+  ScorePrediction& prediction = predictions->GetData(MEMORYDEVICE_CPU)[5];
+  prediction.elts[prediction.size++] = make_mode(keypoints->GetData(MEMORYDEVICE_CPU)[5].position, 0.1f, 0);
+
+  std::vector<PoseCandidate> scalarCandidates = candidates, vectorisedCandidates = candidates;
+  BOOST_CHECK_NO_THROW(scalar.compute_energies(keypoints, predictions, inlierRasterIndices, scalarCandidates));
+  BOOST_CHECK_NO_THROW(vectorised.compute_energies(keypoints, predictions, inlierRasterIndices, vectorisedCandidates));
+  for(int i = 0; i < 20; ++i)
+  {
+    BOOST_CHECK_EQUAL(scalarCandidates[i].energy, vectorisedCandidates[i].energy);
+  }
+
+  // Make the only mode of another prediction have no inliers. This mode will always be selected, so the vectorised
+  // implementation should throw, as the scalar one does. (We don't check the scalar implementation here, since it
+  // throws from inside an OpenMP region when OpenMP is enabled.)
+  ScorePrediction& otherPrediction = predictions->GetData(MEMORYDEVICE_CPU)[10];
+  otherPrediction.size = 1;
+  otherPrediction.elts[0].nbInliers = 0;
+
+  vectorisedCandidates = candidates;
+  BOOST_CHECK_THROW(vectorised.compute_energies(keypoints, predictions, inlierRasterIndices, vectorisedCandidates), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
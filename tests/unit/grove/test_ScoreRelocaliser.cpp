@@ -0,0 +1,125 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <grove/relocalisation/ScoreRelocaliserFactory.h>
+using namespace grove;
+
+#include <tvgutil/misc/SettingsContainer.h>
+using namespace tvgutil;
+
+//#################### HELPER FUNCTIONS ####################
+
+SettingsContainer_CPtr make_settings()
+{
+  SettingsContainer_Ptr settings(new SettingsContainer);
+
+  // Use a small, randomly-generated forest, so that every leaf receives plenty of examples during training.
+  settings->add_value("ScoreRelocaliser.randomlyGenerateForest", "true");
+  settings->add_value("DecisionForest.treeDepth", "4");
+
+  // Pose optimisation would require ALGLIB, and is not needed to exercise the query contexts.
+  settings->add_value("ScoreRelocaliser.PreemptiveRansac.poseUpdate", "false");
+
+  return settings;
+}
+
+/**
+ * \brief Makes a colour image and a depth image of a slanted, textured plane at the specified distance from the camera.
+ */
+void make_images(float distance, ORUChar4Image_Ptr& colourImage, ORFloatImage_Ptr& depthImage)
+{
+  const Vector2i imgSize(640, 480);
+  colourImage.reset(new ORUChar4Image(imgSize, true, false));
+  depthImage.reset(new ORFloatImage(imgSize, true, false));
+
+  Vector4u *colours = colourImage->GetData(MEMORYDEVICE_CPU);
+  float *depths = depthImage->GetData(MEMORYDEVICE_CPU);
+  for(int y = 0; y < imgSize.y; ++y)
+  {
+    for(int x = 0; x < imgSize.x; ++x)
+    {
+      const int i = y * imgSize.x + x;
+      colours[i] = Vector4u((uchar)(x % 256), (uchar)(y % 256), (uchar)((x * y) % 256), (uchar)255);
+      depths[i] = distance + 0.001f * x + 0.0005f * y;
+    }
+  }
+}
+
+/**
+ * \brief Repeatedly relocalises from the specified images, recording the message of any exception that is thrown.
+ */
+void relocalise_repeatedly(const ScoreRelocaliser_CPtr& relocaliser, const ORUChar4Image *colourImage, const ORFloatImage *depthImage,
+                           const Vector4f& depthIntrinsics, int callCount, std::string& error)
+{
+  try
+  {
+    for(int i = 0; i < callCount; ++i)
+    {
+      relocaliser->relocalise(colourImage, depthImage, depthIntrinsics);
+    }
+  }
+  catch(std::exception& e)
+  {
+    error = e.what();
+  }
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_ScoreRelocaliser)
+
+BOOST_AUTO_TEST_CASE(concurrent_relocalise_test)
+{
+  ScoreRelocaliser_Ptr relocaliser = ScoreRelocaliserFactory::make_score_relocaliser("", make_settings(), ORUtils::DEVICE_CPU);
+  const Vector4f depthIntrinsics(525.0f, 525.0f, 320.0f, 240.0f);
+
+  // Train the relocaliser on a single frame, and give it an extra update to make sure that all of its reservoirs are clustered
+  // (the forest only has 5 * 16 leaves, fewer than the number of reservoirs that are clustered on each call by default).
+  ORUChar4Image_Ptr trainingColourImage, testColourImage;
+  ORFloatImage_Ptr trainingDepthImage, testDepthImage;
+  make_images(1.0f, trainingColourImage, trainingDepthImage);
+  make_images(1.5f, testColourImage, testDepthImage);
+
+  relocaliser->train(trainingColourImage.get(), trainingDepthImage.get(), depthIntrinsics, ORUtils::SE3Pose());
+  relocaliser->update();
+
+  // Relocalise from the training frame, and take copies of the contents of the resulting keypoints and predictions images.
+  relocaliser->relocalise(trainingColourImage.get(), trainingDepthImage.get(), depthIntrinsics);
+  Keypoint3DColourImage_CPtr keypointsImage = relocaliser->get_keypoints_image();
+  ScorePredictionsImage_CPtr predictionsImage = relocaliser->get_predictions_image();
+  BOOST_REQUIRE(keypointsImage && predictionsImage);
+
+  const std::vector<Keypoint3DColour> keypoints(keypointsImage->GetData(MEMORYDEVICE_CPU), keypointsImage->GetData(MEMORYDEVICE_CPU) + keypointsImage->dataSize);
+  const std::vector<ScorePrediction> predictions(predictionsImage->GetData(MEMORYDEVICE_CPU), predictionsImage->GetData(MEMORYDEVICE_CPU) + predictionsImage->dataSize);
+
+  // Relocalise from a different frame on two threads at once.
+  const int callCount = 5;
+  std::string errors[2];
+  boost::thread thread1(boost::bind(&relocalise_repeatedly, relocaliser, testColourImage.get(), testDepthImage.get(), depthIntrinsics, callCount, boost::ref(errors[0])));
+  boost::thread thread2(boost::bind(&relocalise_repeatedly, relocaliser, testColourImage.get(), testDepthImage.get(), depthIntrinsics, callCount, boost::ref(errors[1])));
+  thread1.join();
+  thread2.join();
+
+  BOOST_CHECK_EQUAL(errors[0], "");
+  BOOST_CHECK_EQUAL(errors[1], "");
+
+  // Check that the images we obtained before the concurrent calls were not overwritten by them.
+  BOOST_REQUIRE_EQUAL(keypointsImage->dataSize, keypoints.size());
+  BOOST_REQUIRE_EQUAL(predictionsImage->dataSize, predictions.size());
+  BOOST_CHECK(memcmp(keypointsImage->GetData(MEMORYDEVICE_CPU), &keypoints[0], keypoints.size() * sizeof(Keypoint3DColour)) == 0);
+  BOOST_CHECK(memcmp(predictionsImage->GetData(MEMORYDEVICE_CPU), &predictions[0], predictions.size() * sizeof(ScorePrediction)) == 0);
+
+  // Check that the images now returned by the relocaliser are those from one of the concurrent calls.
+  BOOST_CHECK(relocaliser->get_keypoints_image() != keypointsImage);
+  BOOST_CHECK(relocaliser->get_predictions_image() != predictionsImage);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+#include <infermous/engines/MeanFieldInferenceEngine.h>
+using namespace infermous;
+
+//#################### HELPERS ####################
+
+enum Colour
+{
+  RED,
+  BLUE
+};
+
+namespace Eigen {
+template <> struct NumTraits<Colour> : NumTraits<int> {};
+}
+
+struct PPC : PairwisePotentialCalculator<Colour>
+{
+  float calculate_potential(const Colour& l1, const Colour& l2) const
+  {
+    return l1 == l2 ? 0.0f : 1.0f;
+  }
+};
+
+/**
+ * \brief Makes a CRF whose unaries favour RED everywhere except at a single (noisy) pixel in its centre.
+ */
+CRF2D_Ptr<Colour> make_crf(int size)
+{
+  ProbabilitiesGrid_Ptr<Colour> unaries(new ProbabilitiesGrid<Colour>(size, size));
+  for(int y = 0; y < size; ++y)
+  {
+    for(int x = 0; x < size; ++x)
+    {
+      (*unaries)(y,x)[RED] = x == size / 2 && y == size / 2 ? 0.3f : 0.8f;
+      (*unaries)(y,x)[BLUE] = 1.0f - (*unaries)(y,x)[RED];
+    }
+  }
+
+  return CRF2D_Ptr<Colour>(new CRF2D<Colour>(unaries, boost::shared_ptr<PPC>(new PPC)));
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_MeanFieldInferenceEngine)
+
+BOOST_AUTO_TEST_CASE(crf_test)
+{
+  CRF2D_Ptr<Colour> crf = make_crf(5);
+
+  BOOST_CHECK_EQUAL(crf->get_label_count(), 2);
+  BOOST_CHECK_EQUAL(crf->get_pairwise_potentials()[0 * 2 + 1], 1.0f);
+  BOOST_CHECK_EQUAL(crf->get_pairwise_potentials()[1 * 2 + 1], 0.0f);
+
+  std::map<Colour,float> marginals = crf->get_marginals_at(Eigen::Vector2i(2,2));
+  BOOST_CHECK_EQUAL(marginals.size(), 2);
+  BOOST_CHECK_CLOSE(marginals[RED], 0.3f, 1e-4f);
+  BOOST_CHECK_CLOSE(marginals[BLUE], 0.7f, 1e-4f);
+  BOOST_CHECK_EQUAL(crf->predict_labels()(2,2), BLUE);
+}
+
+BOOST_AUTO_TEST_CASE(update_crf_test)
+{
+  CRF2D_Ptr<Colour> crf = make_crf(5);
+  MeanFieldInferenceEngine<Colour> mfie(crf, CRFUtil::make_square_neighbour_offsets(1));
+  mfie.update_crf(1);
+
+  // Check the marginals of the noisy pixel against a direct evaluation of the update equation.
+  // Its 8 neighbours all have Q(RED) = 0.8 and Q(BLUE) = 0.2, so M(RED) = -log(0.3) + 8 * 0.2 and M(BLUE) = -log(0.7) + 8 * 0.8.
+  float eRed = expf(logf(0.3f) - 8 * 0.2f), eBlue = expf(logf(0.7f) - 8 * 0.8f);
+  std::map<Colour,float> marginals = crf->get_marginals_at(Eigen::Vector2i(2,2));
+  BOOST_CHECK_CLOSE(marginals[RED], eRed / (eRed + eBlue), 1e-3f);
+  BOOST_CHECK_CLOSE(marginals[BLUE], eBlue / (eRed + eBlue), 1e-3f);
+
+  // Check that the marginals of every pixel still sum to one, and that the noisy pixel has been smoothed away.
+  for(int y = 0; y < 5; ++y)
+  {
+    for(int x = 0; x < 5; ++x)
+    {
+      marginals = crf->get_marginals_at(Eigen::Vector2i(x,y));
+      BOOST_CHECK_CLOSE(marginals[RED] + marginals[BLUE], 1.0f, 1e-3f);
+    }
+  }
+
+  Grid<Colour> expectedLabels = Grid<Colour>::Constant(5, 5, RED);
+  BOOST_CHECK_EQUAL(crf->predict_labels(), expectedLabels);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,213 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+namespace bf = boost::filesystem;
+
+#include <itmx/imagesources/SequenceFileImageSourceEngine.h>
+#include <itmx/persistence/SequenceFileReader.h>
+#include <itmx/persistence/SequenceRecorder.h>
+using namespace itmx;
+
+//#################### HELPER FUNCTIONS ####################
+
+ITMLib::ITMRGBDCalib make_calib(const Vector2i& rgbImageSize, const Vector2i& depthImageSize)
+{
+  ITMLib::ITMRGBDCalib calib;
+  calib.intrinsics_rgb.imgSize = rgbImageSize;
+  calib.intrinsics_d.imgSize = depthImageSize;
+  return calib;
+}
+
+ORShortImage_Ptr make_depth_image(const Vector2i& size, int frameIndex)
+{
+  ORShortImage_Ptr image(new ORShortImage(size, true, false));
+  short *data = image->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < image->dataSize; ++i) data[i] = static_cast<short>(frameIndex * 1000 + i);
+  return image;
+}
+
+ORUChar4Image_Ptr make_rgb_image(const Vector2i& size, int frameIndex)
+{
+  ORUChar4Image_Ptr image(new ORUChar4Image(size, true, false));
+  Vector4u *data = image->GetData(MEMORYDEVICE_CPU);
+  for(size_t i = 0; i < image->dataSize; ++i) data[i] = Vector4u(frameIndex, i % 256, (i * 7) % 256, 255);
+  return image;
+}
+
+void record_sequence(const std::string& filename, const Vector2i& rgbImageSize, const Vector2i& depthImageSize, int frameCount)
+{
+  SequenceRecorder recorder(filename, make_calib(rgbImageSize, depthImageSize), RGB_COMPRESSION_NONE, DEPTH_COMPRESSION_NONE, 2);
+  for(int i = 0; i < frameCount; ++i)
+  {
+    ORUtils::SE3Pose pose;
+    pose.SetFrom(static_cast<float>(i), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    BOOST_CHECK(recorder.record_frame(make_rgb_image(rgbImageSize, i), make_depth_image(depthImageSize, i), pose));
+  }
+}
+
+void check_frame(const ORUChar4Image_Ptr& rgbImage, const ORShortImage_Ptr& depthImage, int frameIndex)
+{
+  ORShortImage_Ptr expectedDepthImage = make_depth_image(depthImage->noDims, frameIndex);
+  ORUChar4Image_Ptr expectedRgbImage = make_rgb_image(rgbImage->noDims, frameIndex);
+  BOOST_CHECK(memcmp(depthImage->GetData(MEMORYDEVICE_CPU), expectedDepthImage->GetData(MEMORYDEVICE_CPU), depthImage->dataSize * sizeof(short)) == 0);
+  BOOST_CHECK(memcmp(rgbImage->GetData(MEMORYDEVICE_CPU), expectedRgbImage->GetData(MEMORYDEVICE_CPU), rgbImage->dataSize * sizeof(Vector4u)) == 0);
+}
+
+void check_sequence(const std::string& filename, const Vector2i& rgbImageSize, const Vector2i& depthImageSize, int frameCount)
+{
+  SequenceFileReader reader(filename);
+  BOOST_REQUIRE_EQUAL(reader.get_frame_count(), static_cast<size_t>(frameCount));
+  BOOST_CHECK_EQUAL(reader.get_rgb_image_size(), rgbImageSize);
+  BOOST_CHECK_EQUAL(reader.get_depth_image_size(), depthImageSize);
+
+  ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+  ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+  ORUtils::SE3Pose pose;
+  for(int i = 0; i < frameCount; ++i)
+  {
+    reader.read_frame(i, rgbImage.get(), depthImage.get(), pose);
+    check_frame(rgbImage, depthImage, i);
+    BOOST_CHECK_CLOSE(pose.GetT().x, static_cast<float>(i), 1e-4f);
+    BOOST_CHECK_CLOSE(reader.read_pose(i).GetT().x, static_cast<float>(i), 1e-4f);
+  }
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_SequenceFile)
+
+BOOST_AUTO_TEST_CASE(round_trip_test)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%.seq")).string();
+  const Vector2i rgbImageSize(8, 6), depthImageSize(4, 3);
+  const int frameCount = 5;
+
+  record_sequence(filename, rgbImageSize, depthImageSize, frameCount);
+  BOOST_CHECK(SequenceFileReader::is_sequence_file(filename));
+  check_sequence(filename, rgbImageSize, depthImageSize, frameCount);
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(zero_capacity_test)
+{
+  // A recorder with no capacity could never record a frame, so constructing one should fail (without creating the file).
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%.seq")).string();
+  BOOST_CHECK_THROW(SequenceRecorder(filename, make_calib(Vector2i(8, 6), Vector2i(4, 3)), RGB_COMPRESSION_NONE, DEPTH_COMPRESSION_NONE, 0), std::invalid_argument);
+  BOOST_CHECK(!bf::exists(filename));
+}
+
+BOOST_AUTO_TEST_CASE(image_source_engine_test)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%.seq")).string();
+  const Vector2i rgbImageSize(8, 6), depthImageSize(4, 3);
+  const int frameCount = 10;
+
+  record_sequence(filename, rgbImageSize, depthImageSize, frameCount);
+
+  {
+    // Use a prefetch window that is smaller than the sequence, so that the workers have to wait for frames to be consumed.
+    SequenceFileImageSourceEngine engine(filename, 0, 3, 2);
+    ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+    ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+
+    for(int i = 0; i < frameCount; ++i)
+    {
+      BOOST_REQUIRE(engine.hasMoreImages());
+      engine.getImages(rgbImage.get(), depthImage.get());
+      check_frame(rgbImage, depthImage, i);
+      BOOST_CHECK_CLOSE(engine.get_last_pose().GetT().x, static_cast<float>(i), 1e-4f);
+    }
+
+    BOOST_CHECK(!engine.hasMoreImages());
+
+    // Seek back into the sequence, and check that we get the right frames from there.
+    engine.seek(4);
+    BOOST_CHECK_EQUAL(engine.get_position(), 4U);
+    for(int i = 4; i < frameCount; ++i)
+    {
+      BOOST_REQUIRE(engine.hasMoreImages());
+      engine.getImages(rgbImage.get(), depthImage.get());
+      check_frame(rgbImage, depthImage, i);
+    }
+
+    BOOST_CHECK(!engine.hasMoreImages());
+  }
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(recovery_test)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%.seq")).string();
+  const Vector2i rgbImageSize(8, 6), depthImageSize(4, 3);
+  const int frameCount = 5;
+
+  record_sequence(filename, rgbImageSize, depthImageSize, frameCount);
+
+  // Simulate an interrupted recording by chopping off the index and footer, together with part of the last frame.
+  const boost::uint64_t indexSize = frameCount * sizeof(SequenceFileFormat::IndexEntry) + sizeof(SequenceFileFormat::Footer);
+  bf::resize_file(filename, bf::file_size(filename) - indexSize - 1);
+
+  check_sequence(filename, rgbImageSize, depthImageSize, frameCount - 1);
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_header_test)
+{
+  const std::string filename = (bf::temp_directory_path() / bf::unique_path("%%%%-%%%%-%%%%.seq")).string();
+  const Vector2i rgbImageSize(8, 6), depthImageSize(4, 3);
+  const int frameCount = 5;
+
+  record_sequence(filename, rgbImageSize, depthImageSize, frameCount);
+
+  // Look up the offset of the last frame record in the index.
+  SequenceFileFormat::Footer footer;
+  SequenceFileFormat::IndexEntry lastEntry;
+  {
+    std::ifstream fs(filename.c_str(), std::ios::binary);
+    fs.seekg(-static_cast<std::streamoff>(sizeof(footer)), std::ios::end);
+    fs.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+    fs.seekg(footer.indexOffset + (frameCount - 1) * sizeof(SequenceFileFormat::IndexEntry));
+    fs.read(reinterpret_cast<char*>(&lastEntry), sizeof(lastEntry));
+    BOOST_REQUIRE(fs);
+  }
+
+  // Corrupt the compressed depth image size (the first field) in the header of the last frame record, so that the record
+  // appears to extend far beyond the end of the file.
+  {
+    std::fstream fs(filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    const boost::uint32_t hugeSize = 0xFFFFFFF0;
+    fs.seekp(lastEntry.offset);
+    fs.write(reinterpret_cast<const char*>(&hugeSize), sizeof(hugeSize));
+    BOOST_REQUIRE(fs);
+  }
+
+  // Check that reading the corrupt frame fails cleanly, and that the other frames can still be read.
+  {
+    SequenceFileReader reader(filename);
+    BOOST_REQUIRE_EQUAL(reader.get_frame_count(), static_cast<size_t>(frameCount));
+
+    ORShortImage_Ptr depthImage(new ORShortImage(depthImageSize, true, false));
+    ORUChar4Image_Ptr rgbImage(new ORUChar4Image(rgbImageSize, true, false));
+    ORUtils::SE3Pose pose;
+    BOOST_CHECK_THROW(reader.read_frame(frameCount - 1, rgbImage.get(), depthImage.get(), pose), std::runtime_error);
+
+    reader.read_frame(frameCount - 2, rgbImage.get(), depthImage.get(), pose);
+    check_frame(rgbImage, depthImage, frameCount - 2);
+  }
+
+  // Chop off the index and footer, and check that scanning the file stops at the corrupt record.
+  bf::resize_file(filename, footer.indexOffset);
+  check_sequence(filename, rgbImageSize, depthImageSize, frameCount - 1);
+
+  bf::remove(filename);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include <orx/geometry/PoseIndex.h>
+using namespace orx;
+
+//#################### HELPER FUNCTIONS ####################
+
+Eigen::Matrix4f make_random_pose(boost::random::mt19937& rng)
+{
+  boost::random::uniform_real_distribution<float> unit(-1.0f, 1.0f), angle(0.0f, 3.14f);
+
+  Eigen::Vector3f axis(unit(rng), unit(rng), unit(rng));
+  axis.normalize();
+
+  Eigen::Matrix4f pose = Eigen::Matrix4f::Identity();
+  pose.block<3,3>(0,0) = Eigen::AngleAxisf(angle(rng), axis).toRotationMatrix();
+  pose.block<3,1>(0,3) = Eigen::Vector3f(unit(rng), unit(rng), unit(rng)) * 2.0f;
+  return pose;
+}
+
+std::vector<Eigen::Matrix4f> make_random_poses(boost::random::mt19937& rng, size_t count)
+{
+  std::vector<Eigen::Matrix4f> poses;
+  for(size_t i = 0; i < count; ++i) poses.push_back(make_random_pose(rng));
+  return poses;
+}
+
+float translation_distance(const Eigen::Matrix4f& pose1, const Eigen::Matrix4f& pose2)
+{
+  return (Eigen::Vector3f(pose1.block<3,1>(0,3)) - Eigen::Vector3f(pose2.block<3,1>(0,3))).norm();
+}
+
+bool pose_matches(const Eigen::Matrix4f& pose, const Eigen::Matrix4f& query, float maxTranslation, float maxAngle)
+{
+  return translation_distance(pose, query) <= maxTranslation
+      && PoseIndexf::angular_separation(pose.block<3,3>(0,0), query.block<3,3>(0,0)) <= maxAngle;
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_PoseIndex)
+
+BOOST_AUTO_TEST_CASE(find_nearest_poses_test)
+{
+  boost::random::mt19937 rng(12345);
+  const std::vector<Eigen::Matrix4f> poses = make_random_poses(rng, 1000);
+  const PoseIndexf index(poses);
+  const size_t k = 5;
+  const float maxAngle = 1.0f;
+
+  for(int i = 0; i < 100; ++i)
+  {
+    const Eigen::Matrix4f query = make_random_pose(rng);
+
+    // Find the nearest poses by brute force.
+    std::vector<std::pair<float,size_t> > candidates;
+    for(size_t j = 0, size = poses.size(); j < size; ++j)
+    {
+      if(pose_matches(poses[j], query, std::numeric_limits<float>::max(), maxAngle))
+      {
+        candidates.push_back(std::make_pair(translation_distance(poses[j], query), j));
+      }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    // Check that the index finds the same poses, in the same order.
+    const std::vector<size_t> result = index.find_nearest_poses(query, k, std::numeric_limits<float>::max(), maxAngle);
+    BOOST_REQUIRE_EQUAL(result.size(), std::min(k, candidates.size()));
+    for(size_t j = 0, size = result.size(); j < size; ++j)
+    {
+      BOOST_CHECK_EQUAL(result[j], candidates[j].second);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(find_poses_within_test)
+{
+  boost::random::mt19937 rng(12345);
+  const std::vector<Eigen::Matrix4f> poses = make_random_poses(rng, 1000);
+  const PoseIndexf index(poses);
+  const float maxTranslation = 0.5f, maxAngle = 0.5f;
+
+  for(int i = 0; i < 100; ++i)
+  {
+    const Eigen::Matrix4f query = make_random_pose(rng);
+
+    // Find the matching poses by brute force.
+    std::vector<size_t> expected;
+    for(size_t j = 0, size = poses.size(); j < size; ++j)
+    {
+      if(pose_matches(poses[j], query, maxTranslation, maxAngle)) expected.push_back(j);
+    }
+
+    // Check that the index finds the same poses, in the same order.
+    const std::vector<size_t> result = index.find_poses_within(query, maxTranslation, maxAngle);
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(empty_index_test)
+{
+  const PoseIndexf index((std::vector<Eigen::Matrix4f>()));
+  BOOST_CHECK_EQUAL(index.size(), 0U);
+  BOOST_CHECK(index.find_nearest_poses(Eigen::Matrix4f::Identity(), 5).empty());
+  BOOST_CHECK(index.find_poses_within(Eigen::Matrix4f::Identity(), 1.0f, 1.0f).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
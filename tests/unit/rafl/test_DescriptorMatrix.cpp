@@ -0,0 +1,107 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <rafl/decisionfunctions/FeatureThresholdingDecisionFunction.h>
+#include <rafl/examples/ExampleReservoir.h>
+using namespace rafl;
+
+typedef int Label;
+
+BOOST_AUTO_TEST_SUITE(test_DescriptorMatrix)
+
+BOOST_AUTO_TEST_CASE(add_row_test)
+{
+  const float features[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+
+  // Check that a matrix made from a contiguous array of descriptors contains the right rows.
+  DescriptorMatrix m1(features, 2, 3);
+  BOOST_CHECK_EQUAL(m1.get_feature_count(), 3);
+  BOOST_CHECK_EQUAL(m1.get_row_count(), 2);
+  BOOST_CHECK_EQUAL(m1.get_row(1)[0], 4.0f);
+
+  // Check that appending rows to a matrix works.
+  DescriptorMatrix m2(2);
+  BOOST_CHECK_EQUAL(m2.get_row_count(), 0);
+  BOOST_CHECK_EQUAL(m2.add_row(features), 0);
+  BOOST_CHECK_EQUAL(m2.add_row(features + 4), 1);
+  BOOST_CHECK_EQUAL(m2.get_row_count(), 2);
+  BOOST_CHECK_EQUAL(m2.get_row(1)[0], 5.0f);
+  BOOST_CHECK_EQUAL(m2.get_row(1)[1], 6.0f);
+}
+
+BOOST_AUTO_TEST_CASE(example_test)
+{
+  const float features[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+  DescriptorMatrix_CPtr matrix(new DescriptorMatrix(features, 2, 2));
+  Descriptor_CPtr descriptor(new Descriptor(features + 2, features + 4));
+
+  // Check that examples whose descriptors are stored in a matrix refer to the right row.
+  Example<Label> matrixExample(matrix, 1, 23);
+  BOOST_CHECK_EQUAL(matrixExample.get_descriptor_data(), matrix->get_row(1));
+  BOOST_CHECK_EQUAL(matrixExample.get_descriptor_size(), 2);
+  BOOST_CHECK_EQUAL(matrixExample.get_label(), 23);
+  BOOST_CHECK_THROW(matrixExample.get_descriptor(), std::runtime_error);
+
+  // Check that examples whose descriptors are stored in a matrix are classified in the same way as examples whose descriptors are stored separately.
+  Example<Label> separateExample(descriptor, 23);
+  BOOST_CHECK_EQUAL(separateExample.get_descriptor_size(), 2);
+
+  FeatureThresholdingDecisionFunction df(1, 4.0f);
+  BOOST_CHECK_EQUAL(df.classify_descriptor(matrixExample.get_descriptor_data()), DecisionFunction::DC_RIGHT);
+  BOOST_CHECK_EQUAL(df.classify_descriptor(separateExample.get_descriptor_data()), DecisionFunction::DC_RIGHT);
+  BOOST_CHECK_EQUAL(df.classify_descriptor(*descriptor), DecisionFunction::DC_RIGHT);
+  BOOST_CHECK_EQUAL(df.classify_descriptor(matrix->get_row(0)), DecisionFunction::DC_LEFT);
+}
+
+BOOST_AUTO_TEST_CASE(standalone_example_test)
+{
+  const float features[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+  DescriptorMatrix_CPtr matrix(new DescriptorMatrix(features, 2, 2));
+  boost::shared_ptr<const Example<Label> > matrixExample(new Example<Label>(matrix, 1, 23));
+
+  // Check that making a standalone version of an example whose descriptor is stored in a matrix copies its descriptor.
+  boost::shared_ptr<const Example<Label> > standaloneExample = Example<Label>::make_standalone(matrixExample);
+  BOOST_REQUIRE(standaloneExample != matrixExample);
+  BOOST_CHECK_EQUAL((*standaloneExample->get_descriptor())[0], 3.0f);
+  BOOST_CHECK_EQUAL((*standaloneExample->get_descriptor())[1], 4.0f);
+  BOOST_CHECK_EQUAL(standaloneExample->get_label(), 23);
+
+  // Check that making a standalone version of an example that is already standalone returns the example itself.
+  BOOST_CHECK(Example<Label>::make_standalone(standaloneExample) == standaloneExample);
+
+  // Check that examples added to a reservoir do not keep the matrix alive.
+  tvgutil::RandomNumberGenerator_Ptr rng(new tvgutil::RandomNumberGenerator(12345));
+  ExampleReservoir<Label> reservoir(10, rng);
+  const long useCount = matrix.use_count();
+  reservoir.add_example(matrixExample);
+  BOOST_CHECK_EQUAL(matrix.use_count(), useCount);
+  BOOST_REQUIRE_EQUAL(reservoir.get_examples().size(), 1);
+  BOOST_CHECK_EQUAL((*reservoir.get_examples()[0]->get_descriptor())[0], 3.0f);
+
+  // Check that serializing an example whose descriptor is stored in a matrix only saves its own descriptor.
+  std::stringstream ss;
+  {
+    boost::archive::text_oarchive oa(ss);
+    oa << matrixExample;
+  }
+
+  boost::shared_ptr<const Example<Label> > loadedExample;
+  {
+    boost::archive::text_iarchive ia(ss);
+    ia >> loadedExample;
+  }
+
+  BOOST_REQUIRE_EQUAL(loadedExample->get_descriptor()->size(), 2);
+  BOOST_CHECK_EQUAL((*loadedExample->get_descriptor())[0], 3.0f);
+  BOOST_CHECK_EQUAL((*loadedExample->get_descriptor())[1], 4.0f);
+  BOOST_CHECK_EQUAL(loadedExample->get_label(), 23);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
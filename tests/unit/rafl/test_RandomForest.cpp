@@ -0,0 +1,115 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/assign/list_of.hpp>
+using boost::assign::list_of;
+
+#include <rafl/core/RandomForest.h>
+#include <rafl/decisionfunctions/PairwiseOpAndThresholdDecisionFunctionGenerator.h>
+#include <rafl/examples/UnitCircleExampleGenerator.h>
+using namespace rafl;
+
+typedef int Label;
+typedef DecisionTree<Label> DT;
+typedef RandomForest<Label> RF;
+
+//#################### HELPER FUNCTIONS ####################
+
+/**
+ * \brief Makes a random forest that is suitable for classifying 2D points.
+ *
+ * \param treeCount         The number of trees in the forest.
+ * \param parallelTraining  Whether or not to train the trees in parallel.
+ * \return                  The random forest.
+ */
+RF make_forest(size_t treeCount, bool parallelTraining = false)
+{
+  DecisionFunctionGeneratorFactory<Label>::instance().register_rafl_makers();
+
+  std::map<std::string,std::string> properties;
+  properties["candidateCount"] = "256";
+  properties["decisionFunctionGeneratorParams"] = "";
+  properties["decisionFunctionGeneratorType"] = PairwiseOpAndThresholdDecisionFunctionGenerator<Label>::get_static_type();
+  properties["gainThreshold"] = "0";
+  properties["maxClassSize"] = "10000";
+  properties["maxTreeHeight"] = "20";
+  properties["randomSeed"] = "12345";
+  properties["seenExamplesThreshold"] = "50";
+  properties["splittabilityThreshold"] = "0.5";
+  properties["usePMFReweighting"] = "1";
+
+  return RF(treeCount, DT::Settings(properties), parallelTraining);
+}
+
+//#################### TESTS ####################
+
+BOOST_AUTO_TEST_SUITE(test_RandomForest)
+
+BOOST_AUTO_TEST_CASE(predict_batch_test)
+{
+  RF forest = make_forest(2);
+
+  // Generate a grid of descriptors covering the region of the plane around the unit circle.
+  std::vector<float> descriptors;
+  for(float y = -1.5f; y <= 1.5f; y += 0.1f)
+  {
+    for(float x = -1.5f; x <= 1.5f; x += 0.1f)
+    {
+      descriptors.push_back(x);
+      descriptors.push_back(y);
+    }
+  }
+
+  const size_t featureCount = 2;
+  const size_t descriptorCount = descriptors.size() / featureCount;
+  std::vector<Label> labels(descriptorCount);
+
+  // Check that neither batched nor individual prediction succeeds before any examples have been added to the forest
+  // (since every leaf reached will be empty), and that batched prediction does not need to do anything if there are no descriptors.
+  BOOST_CHECK_THROW(forest.predict(&descriptors[0]), std::runtime_error);
+  BOOST_CHECK_THROW(forest.predict_batch(&descriptors[0], descriptorCount, featureCount, &labels[0]), std::runtime_error);
+  BOOST_CHECK_NO_THROW(forest.predict_batch(&descriptors[0], 0, featureCount, &labels[0]));
+
+  // Train the forest on examples generated around the unit circle.
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234, 0.05f, 0.18f);
+  for(int i = 0; i < 10; ++i)
+  {
+    forest.add_examples(generator.generate_examples(list_of(1)(2)(3)(4), 50));
+    forest.train(1);
+  }
+
+  // Check that batched prediction now gives the same labels as individual prediction.
+  forest.predict_batch(&descriptors[0], descriptorCount, featureCount, &labels[0]);
+  for(size_t i = 0; i < descriptorCount; ++i)
+  {
+    BOOST_CHECK_EQUAL(labels[i], forest.predict(&descriptors[i * featureCount]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parallel_training_test)
+{
+  // Make two forests with the same settings (and hence the same seed), one of which is trained in parallel.
+  RF serialForest = make_forest(4, false);
+  RF parallelForest = make_forest(4, true);
+
+  // Train both forests on the same examples.
+  UnitCircleExampleGenerator<Label> generator(list_of(1)(2)(3)(4), 1234, 0.05f, 0.18f);
+  for(int i = 0; i < 10; ++i)
+  {
+    std::vector<boost::shared_ptr<const Example<Label> > > examples = generator.generate_examples(list_of(1)(2)(3)(4), 50);
+    serialForest.add_examples(examples);
+    parallelForest.add_examples(examples);
+    BOOST_CHECK_EQUAL(serialForest.train(4), parallelForest.train(4));
+  }
+
+  // Check that the trees in the two forests are identical.
+  std::ostringstream serialOS, parallelOS;
+  serialForest.output(serialOS);
+  parallelForest.output(parallelOS);
+  BOOST_CHECK_EQUAL(serialOS.str(), parallelOS.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
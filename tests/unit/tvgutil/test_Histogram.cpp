@@ -0,0 +1,84 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+#include <tvgutil/statistics/ProbabilityMassFunction.h>
+using namespace tvgutil;
+
+BOOST_AUTO_TEST_SUITE(test_Histogram)
+
+BOOST_AUTO_TEST_CASE(dense_bins_test)
+{
+  BOOST_CHECK_EQUAL(UseDenseHistogram<unsigned char>::value, true);
+  BOOST_CHECK_EQUAL(UseDenseHistogram<signed char>::value, true);
+  BOOST_CHECK_EQUAL(UseDenseHistogram<int>::value, false);
+
+  Histogram<signed char> hist;
+  hist.add(-5);
+  hist.add(3);
+  hist.add(-5);
+  hist.add(100);
+    BOOST_CHECK_EQUAL(hist.get_count(), 4);
+    BOOST_CHECK_EQUAL(hist.get_bin(-5), 2);
+    BOOST_CHECK_EQUAL(hist.get_bin(7), 0);
+
+  // Check that iterating over the bins yields the non-empty bins in increasing order of label.
+  std::vector<std::pair<signed char,size_t> > bins(hist.get_bins().begin(), hist.get_bins().end());
+    BOOST_REQUIRE_EQUAL(bins.size(), 3);
+    BOOST_CHECK_EQUAL(bins[0].first, -5);
+    BOOST_CHECK_EQUAL(bins[0].second, 2);
+    BOOST_CHECK_EQUAL(bins[1].first, 3);
+    BOOST_CHECK_EQUAL(bins[2].first, 100);
+
+    BOOST_CHECK(hist.get_bins().find(3) != hist.get_bins().end());
+    BOOST_CHECK(hist.get_bins().find(4) == hist.get_bins().end());
+}
+
+BOOST_AUTO_TEST_CASE(pmf_test)
+{
+  Histogram<int> sparseHist;
+  Histogram<unsigned char> denseHist;
+  const int labels[] = { 1, 2, 2, 7, 7, 7 };
+  for(size_t i = 0; i < sizeof(labels) / sizeof(int); ++i)
+  {
+    sparseHist.add(labels[i]);
+    denseHist.add(static_cast<unsigned char>(labels[i]));
+  }
+
+  // Check that PMFs made from the two types of histogram are the same.
+  ProbabilityMassFunction<int> sparsePMF(sparseHist);
+  ProbabilityMassFunction<unsigned char> densePMF(denseHist);
+    BOOST_CHECK_EQUAL(densePMF.calculate_best_label(), 7);
+    BOOST_CHECK_EQUAL(densePMF.calculate_entropy(), sparsePMF.calculate_entropy());
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+  Histogram<int> sparseHist;
+  sparseHist.add(4);
+  sparseHist.add(9);
+  sparseHist.add(9);
+
+  // Check that a dense histogram can be loaded from an archive containing a sparse one (the file formats are the same).
+  std::stringstream ss;
+  {
+    boost::archive::text_oarchive oa(ss);
+    oa << sparseHist;
+  }
+
+  Histogram<unsigned char> denseHist;
+  {
+    boost::archive::text_iarchive ia(ss);
+    ia >> denseHist;
+  }
+
+    BOOST_CHECK_EQUAL(denseHist.get_count(), 3);
+    BOOST_CHECK_EQUAL(denseHist.get_bin(4), 1);
+    BOOST_CHECK_EQUAL(denseHist.get_bin(9), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()